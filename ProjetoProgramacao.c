@@ -6,12 +6,19 @@
 
 #include "models.h"
 #include "cstdin.h"
+#include "screen.h"
 
-#include "repository.h"
+#include "bookbyte.h"
+#include "legacy.h"
 
 #include "client_controller.h"
 #include "book_controller.h"
 #include "loan_controller.h"
+#include "maintenance_controller.h"
+#include "batch.h"
+#include "server.h"
+#include "desk.h"
+#include "stress.h"
 
 /**
  * @brief Authenticates a user by comparing input login and password with stored credentials.
@@ -47,6 +54,7 @@ int login() {
  * If a file is successfully opened, it reads the data into the corresponding data structures.
  *
  * The function handles the following files:
+ * - "data/strings.bin": Contains the interned strings referenced by the other files.
  * - "data/clients.bin": Contains client data.
  * - "data/books.bin": Contains book data.
  * - "data/addresses.bin": Contains address data.
@@ -54,89 +62,97 @@ int login() {
  * - "data/users.bin": Contains user data.
  * - "data/authors.bin": Contains author data.
  * - "data/loans.bin": Contains loan data.
+ * - "data/reservations.bin": Contains the waiting lists of the books.
+ * - "data/ledger.bin": Contains the fines charged to the clients and their payments.
+ * - "data/history.bin": Contains the returned loans, by month.
+ * - "data/branches.bin": Contains the library branches and the records of each.
+ * - "data/copies.bin": Contains every copy of the books, by barcode, and where it is.
  *
- * The function initializes the following data structures if the files cannot be opened:
- * - clients: Initializes each client's fields to default values.
- * - books: Initializes each book's fields to default values.
- * - addresses: Initializes each address's fields to default values.
- * - genres: Initializes each genre's fields to default values.
- * - adm: Initializes each admin's login and password to default values, with the first admin having a predefined login and password.
- * - authors: Initializes each author's fields to default values.
- * - loans: Initializes each loan's fields to default values.
+ * Every table starts with MAX_ENTITIES empty slots. If the users file cannot be opened, each admin's
+ * login and password are initialized to default values, with the first admin having a predefined login and password.
  *
- * The function reads data from the files into the following data structures if the files are successfully opened:
+ * The function reads every record of the files into the following data structures if the files are successfully opened,
+ * growing the tables as needed. Files saved before strings were interned are converted on the fly (see legacy.h):
  * - clients: Reads client data from "data/clients.bin".
  * - books: Reads book data from "data/books.bin".
  * - addresses: Reads address data from "data/addresses.bin".
  * - genres: Reads genre data from "data/genres.bin".
  * - adm: Reads user data from "data/users.bin".
  * - authors: Reads author data from "data/authors.bin".
- * - loans: Reads loan data from "data/loans.bin".
+ * - loans: Reads loan data from "data/loans.bin" and their books from "data/loan_items.bin".
+ * - reservations: Reads the waiting lists from "data/reservations.bin". A file without the
+ *   magic number is ignored: it was an unused copy of the legacy loans file.
+ * - ledger: Reads the fines and payments of the clients from "data/ledger.bin".
+ * - history: Reads the returned loans from "data/history.bin" and indexes every month of them.
+ * - branches: Reads the branches and which clients, books and loans belong to each from "data/branches.bin".
+ *   Without it, every record belongs to the main branch.
+ * - copies: Reads the copies of the books from "data/copies.bin". Books saved before copies had barcodes get theirs
+ *   while the copies are rebuilt.
+ *
+ * Finally, it rebuilds the occupied-slot sets and the partitions of the branches, the copies of every book, the clients' balances from their ledger, the deadline index, the address index, the address, author and genre reference counts,
+ * the book views, the circulation statistics of the last 30 days, the co-borrowing matrix and the first snapshot of the tables.
  */
 void ImportData(void) {
-    int i;
+    int i, version;
+
+    FILE *fstrings = fopen("data/strings.bin", "rb");
+    if(fstrings != NULL){
+        LoadStringHeap(fstrings);
+        fclose(fstrings);
+    }
 
+    growClients();
     FILE *fclients = fopen("data/clients.bin", "rb");
-    if (fclients == NULL) {
-        for(i = 0 ; i < MAX_ENTITIES ; i++){
-            strcpy(clients[i].cpf, "0\0");
-            strcpy(clients[i].name, "0\0");
-            strcpy(clients[i].deadline, "0\0");
-            clients[i].addressId = -1;
-            clients[i].bookId1 = -1;
-            clients[i].bookId2 = -1;
-            clients[i].fineAmount = 0;
-        }
-    }else{
-        for(i=0;i<MAX_ENTITIES;i++){
-            fread(&clients[i], sizeof(Client), 1, fclients);
+    if(fclients != NULL){
+        Client c;
+        version = dataFileVersion(fclients);
+        for(i = 0; (version < DATA_VERSION_ITEMS ? readLegacyClient(fclients, &c, version) : fread(&c, sizeof(Client), 1, fclients) == 1); i++){
+            if(i == clientsCapacity && growClients() == -1){
+                break;
+            }
+            clients[i] = c;
         }
         fclose(fclients);
     }
 
+    growBooks();
     FILE *fbooks = fopen("data/books.bin", "rb");
-    if(fbooks == NULL){
-        for(i = 0 ; i < MAX_ENTITIES ; i++){
-            strcpy(books[i].title, "0\0");
-            books[i].authorId = -1;
-            books[i].genreId = -1;
-            books[i].stock = 0;
-            books[i].id = -1;
-            books[i].amount = 0;
-            books[i].stock = 0;
-        }        
-    } else{
-        for(i=0;i<MAX_ENTITIES;i++){
-            fread(&books[i], sizeof(Book), 1, fbooks);
+    if(fbooks != NULL){
+        Book b;
+        version = dataFileVersion(fbooks);
+        for(i = 0; (version == DATA_VERSION_LEGACY ? readLegacyBook(fbooks, &b) : fread(&b, sizeof(Book), 1, fbooks) == 1); i++){
+            if(i == booksCapacity && growBooks() == -1){
+                break;
+            }
+            books[i] = b;
         }
         fclose(fbooks);
     }
 
+    growAddresses();
     FILE *faddresses = fopen("data/addresses.bin", "rb");
-    if(faddresses == NULL){
-        for(i = 0 ; i < MAX_ENTITIES ; i++){
-            strcpy(addresses[i].street, "0\0");
-            strcpy(addresses[i].number, "0\0");
-            strcpy(addresses[i].cep, "0\0");
-            strcpy(addresses[i].complement, "0\0");
-            addresses[i].id = -1;
-        }
-    } else{
-        for(i=0;i<MAX_ENTITIES;i++){
-            fread(&addresses[i], sizeof(Address), 1, faddresses);
+    if(faddresses != NULL){
+        Address add;
+        version = dataFileVersion(faddresses);
+        for(i = 0; (version == DATA_VERSION_LEGACY ? readLegacyAddress(faddresses, &add) : fread(&add, sizeof(Address), 1, faddresses) == 1); i++){
+            if(i == addressesCapacity && growAddresses() == -1){
+                break;
+            }
+            addresses[i] = add;
         }
         fclose(faddresses);
     }
 
+    growGenres();
     FILE *fgenres = fopen("data/genres.bin", "rb");
-    if(fgenres == NULL){
-        for (i = 0 ; i < MAX_ENTITIES ; i++) {
-            strcpy(genres[i].genre, "0\0");
-            genres[i].id = -1;
-        }
-    } else {
-        for(i=0;i<MAX_ENTITIES;i++){
-            fread(&genres[i], sizeof(Address), 1, fgenres);
+    if(fgenres != NULL){
+        Genre g;
+        version = dataFileVersion(fgenres);
+        for(i = 0; (version == DATA_VERSION_LEGACY ? readLegacyGenre(fgenres, &g) : fread(&g, sizeof(Genre), 1, fgenres) == 1); i++){
+            if(i == genresCapacity && growGenres() == -1){
+                break;
+            }
+            genres[i] = g;
         }
         fclose(fgenres);
     }
@@ -156,42 +172,113 @@ void ImportData(void) {
         fclose(fusers);
     }
 
-    FILE* fauthors = fopen("data/authors.bin", "rb");
-    if(fauthors == NULL) {
-        for (i = 0; i < MAX_ENTITIES ; i++) {
-            authors[i].id = -1;
-            strcpy(authors[i].name, "\0");
-        }
-    }else {
-        for(i = 0; i < MAX_ENTITIES; i++) {
-            fread(&authors[i], sizeof(Author), 1, fauthors);
+    growAuthors();
+    FILE *fauthors = fopen("data/authors.bin", "rb");
+    if(fauthors != NULL){
+        Author a;
+        version = dataFileVersion(fauthors);
+        for(i = 0; (version == DATA_VERSION_LEGACY ? readLegacyAuthor(fauthors, &a) : fread(&a, sizeof(Author), 1, fauthors) == 1); i++){
+            if(i == authorsCapacity && growAuthors() == -1){
+                break;
+            }
+            authors[i] = a;
         }
         fclose(fauthors);
     }
 
-    FILE* floans = fopen("data/loans.bin", "rb");
-    if(floans == NULL) {
-        for (i = 0; i < MAX_ENTITIES ; i++) {
-            loans[i].id = -1;
-            loans[i].book1Id = -1;
-            loans[i].book2Id = -1;
-            strcpy(loans[i].userCpf, "0\0");
-            strcpy(loans[i].startDate, "0\0");
-            strcpy(loans[i].deadline, "0\0");
-        }
-    }else {
-        for(i = 0; i < MAX_ENTITIES; i++) {
-            fread(&loans[i], sizeof(Loan), 1, floans);
+    growLoans();
+    FILE *floans = fopen("data/loans.bin", "rb");
+    if(floans != NULL){
+        Loan l;
+        version = dataFileVersion(floans);
+        for(i = 0; (version < DATA_VERSION_ITEMS ? readLegacyLoan(floans, &l) : fread(&l, sizeof(Loan), 1, floans) == 1); i++){
+            if(i == loansCapacity && growLoans() == -1){
+                break;
+            }
+            loans[i] = l;
         }
         fclose(floans);
+
+        FILE *fitems = version >= DATA_VERSION_ITEMS ? fopen("data/loan_items.bin", "rb") : NULL;
+        if(fitems != NULL){
+            int itemsVersion = dataFileVersion(fitems);
+            LoanItem item;
+            while(itemsVersion < DATA_VERSION ? readLegacyLoanItem(fitems, &item) : fread(&item, sizeof(LoanItem), 1, fitems) == 1){
+                if(loanItemsUsed == loanItemsCapacity &&
+                   ArenaGrowTable(&loanItemsArena, sizeof(LoanItem), &loanItemsCapacity, MAX_ENTITIES * 2) == -1){
+                    break;
+                }
+                loanItems[loanItemsUsed++] = item;
+            }
+            fclose(fitems);
+        }
+        for(i = 0; version >= DATA_VERSION_ITEMS && i < loansCapacity; i++){
+            if(loans[i].id == -1 || loans[i].itemOffset < 0 || loans[i].itemOffset + loans[i].itemCount > loanItemsUsed){
+                loans[i].itemOffset = 0;
+                loans[i].itemCount = 0;
+            }
+            loanItemsLive += loans[i].itemCount;
+        }
+    }
+
+    FILE *freservations = fopen("data/reservations.bin", "rb");
+    if(freservations != NULL){
+        if(dataFileVersion(freservations) >= DATA_VERSION_ITEMS){
+            LoadReservations(freservations);
+        }
+        fclose(freservations);
+    }
+
+    FILE *fledger = fopen("data/ledger.bin", "rb");
+    if(fledger != NULL){
+        if(dataFileVersion(fledger) >= DATA_VERSION_ITEMS){
+            LoadLedger(fledger);
+        }
+        fclose(fledger);
+    }
+
+    FILE *fhistory = fopen("data/history.bin", "rb");
+    if(fhistory != NULL){
+        version = dataFileVersion(fhistory);
+        if(version >= DATA_VERSION_ITEMS){
+            LoadHistory(fhistory, version == DATA_VERSION);
+        }
+        fclose(fhistory);
+    }
+
+    FILE *fbranches = fopen("data/branches.bin", "rb");
+    if(fbranches != NULL){
+        if(dataFileVersion(fbranches) >= DATA_VERSION_ITEMS){
+            LoadBranches(fbranches);
+        }
+        fclose(fbranches);
     }
+
+    FILE *fcopies = fopen("data/copies.bin", "rb");
+    if(fcopies != NULL){
+        if(dataFileVersion(fcopies) == DATA_VERSION){
+            LoadCopies(fcopies);
+        }
+        fclose(fcopies);
+    }
+
+    RebuildLiveSlots();
+    RebuildCopies();
+    RebuildBalances();
+    RebuildDeadlineIndex();
+    RebuildAddressIndex();
+    RebuildReferenceCounts();
+    RebuildBookViews();
+    RebuildCirculationStats();
+    CoBorrowRebuild(0);
+    SnapshotRebuild();
 }
 
 /**
  * @brief SaveData function saves the data of clients, books, addresses, genres, authors, and loans to binary files.
  *
- * This function creates a directory named "data" and then opens or creates binary files for clients, books, addresses, genres, authors, and loans.
- * It writes the data from the respective arrays to these files.
+ * This function creates a directory named "data" and then opens or creates binary files for clients, books, addresses, genres, authors, loans, reservations, the fine ledger, the loan history, the branches and the copies.
+ * It writes DATA_MAGIC followed by the data from the respective arrays to these files, and the interned strings to "data/strings.bin".
  * 
  * The function performs the following steps:
  * 1. Creates a directory named "data" with permissions 0777.
@@ -200,12 +287,17 @@ void ImportData(void) {
  * 4. Opens or creates "data/addresses.bin" and writes the addresses data to it.
  * 5. Opens or creates "data/genres.bin" and writes the genres data to it.
  * 6. Opens or creates "data/authors.bin" and writes the authors data to it.
- * 7. Opens or creates "data/loans.bin" and writes the loans data to it.
+ * 7. Compacts the loan items, then opens or creates "data/loans.bin" and "data/loan_items.bin" and writes the loans and their items to them.
+ * 8. Opens or creates "data/reservations.bin" and writes the waiting lists to it.
+ * 9. Opens or creates "data/ledger.bin" and writes the ledger of every client to it.
+ * 10. Opens or creates "data/history.bin" and writes the returned loans to it, month by month.
+ * 11. Opens or creates "data/branches.bin" and writes the branches and their records to it.
+ * 12. Opens or creates "data/copies.bin" and writes every copy to it.
+ * 13. Opens or creates "data/strings.bin" and writes the string heap to it.
  *
  * If any file cannot be opened, an error message is printed using perror and the function returns early.
  *
- * @note The function assumes that the arrays clients, books, addresses, genres, authors, and loans are defined and populated elsewhere in the code.
- * @note The function assumes that MAX_ENTITIES is defined and represents the number of entities in each array.
+ * @note Every table is written up to its current capacity.
  */
 void SaveData(void) {
     int i;
@@ -215,43 +307,81 @@ void SaveData(void) {
         perror("Error opening clients file");
         return;
     }
-    fseek(fclients, 0, SEEK_SET);
-    for( i = 0 ; i < MAX_ENTITIES ; i++) {
+    fwrite(DATA_MAGIC, 4, 1, fclients);
+    for( i = 0 ; i < clientsCapacity ; i++) {
         fwrite(&clients[i], sizeof(Client), 1, fclients);
     }
     fclose(fclients);
 
     FILE *fbooks = fopen("data/books.bin", "wb+");
-    fseek(fbooks, 0, SEEK_SET);
-    for(i = 0 ; i < MAX_ENTITIES ; i++) {
+    fwrite(DATA_MAGIC, 4, 1, fbooks);
+    for(i = 0 ; i < booksCapacity ; i++) {
         fwrite(&books[i], sizeof(Book), 1, fbooks);
     }
     fclose(fbooks);
 
     FILE *faddress= fopen("data/addresses.bin", "wb+");
-    fseek(faddress, 0, SEEK_SET);
-    for( i = 0 ; i < MAX_ENTITIES ; i++) {
+    fwrite(DATA_MAGIC, 4, 1, faddress);
+    for( i = 0 ; i < addressesCapacity ; i++) {
         fwrite(&addresses[i], sizeof(Address), 1, faddress);
     }
     fclose(faddress);
     
     FILE *fgenres = fopen("data/genres.bin", "wb+");
-    for(i = 0 ; i < MAX_ENTITIES ; i++){
-        fwrite(&genres[i], sizeof(Address), 1, fgenres);
+    fwrite(DATA_MAGIC, 4, 1, fgenres);
+    for(i = 0 ; i < genresCapacity ; i++){
+        fwrite(&genres[i], sizeof(Genre), 1, fgenres);
     }
     fclose(fgenres);
 
     FILE *fauthors = fopen("data/authors.bin", "wb+");
-    for(i = 0 ; i < MAX_ENTITIES ; i++){
+    fwrite(DATA_MAGIC, 4, 1, fauthors);
+    for(i = 0 ; i < authorsCapacity ; i++){
         fwrite(&authors[i], sizeof(Author), 1, fauthors);
     }
     fclose(fauthors);
 
+    CompactLoanItems();
     FILE *floans = fopen("data/loans.bin", "wb+");
-    for(i = 0 ; i < MAX_ENTITIES ; i++){
+    fwrite(DATA_MAGIC, 4, 1, floans);
+    for(i = 0 ; i < loansCapacity ; i++){
         fwrite(&loans[i], sizeof(Loan), 1, floans);
     }
     fclose(floans);
+
+    FILE *fitems = fopen("data/loan_items.bin", "wb+");
+    fwrite(DATA_MAGIC, 4, 1, fitems);
+    fwrite(loanItems, sizeof(LoanItem), loanItemsUsed, fitems);
+    fclose(fitems);
+
+    FILE *freservations = fopen("data/reservations.bin", "wb+");
+    fwrite(DATA_MAGIC, 4, 1, freservations);
+    SaveReservations(freservations);
+    fclose(freservations);
+
+    FILE *fledger = fopen("data/ledger.bin", "wb+");
+    fwrite(DATA_MAGIC, 4, 1, fledger);
+    SaveLedger(fledger);
+    fclose(fledger);
+
+    FILE *fhistory = fopen("data/history.bin", "wb+");
+    fwrite(DATA_MAGIC, 4, 1, fhistory);
+    SaveHistory(fhistory);
+    fclose(fhistory);
+
+    FILE *fbranches = fopen("data/branches.bin", "wb+");
+    fwrite(DATA_MAGIC, 4, 1, fbranches);
+    SaveBranches(fbranches);
+    fclose(fbranches);
+
+    FILE *fcopies = fopen("data/copies.bin", "wb+");
+    fwrite(DATA_MAGIC, 4, 1, fcopies);
+    SaveCopies(fcopies);
+    fclose(fcopies);
+
+    FILE *fstrings = fopen("data/strings.bin", "wb+");
+    SaveStringHeap(fstrings);
+    fclose(fstrings);
 }
 
 /**
@@ -266,26 +396,28 @@ void SaveData(void) {
  */
 
 int WorkSystem() {
-    system("clear");
+    ScreenClear();
     printf("Login successful\n");
     printf("Type anything to continue...");
     getch();
-    system("clear");
+    ScreenClear();
     int choice;
 
     do {
-        printf("Menu\n\n1. Client\n2. Book\n3. Loan\n4. Exit\nOption: ");
+        printf("Menu\n\n1. Client\n2. Book\n3. Loan\n4. Maintenance\n5. Exit\nOption: ");
         fillBuffer(1);
         sscanf(buffer, "%d", &choice);
-        system("clear");
+        ScreenClear();
         if(choice==1){
             ClientMenu();
         } else if(choice==2) {
             BookMenu();
         } else if(choice==3) {
             ReservationMenu();
+        } else if(choice==4) {
+            MaintenanceMenu();
         }
-    } while(choice!=4);
+    } while(choice!=5);
     SaveData();
     return 1;
 }
@@ -309,25 +441,71 @@ int WorkSystem() {
  * @note
  * This program is intended to be run on a Linux system.
  * 
+ * @note
+ * `main --batch <file>` (or `-` for the standard input) runs the commands of batch.h instead
+ * of the menus, saves the data unless the file cannot be opened, and exits with 0 only if
+ * every command succeeded.
+ * `main --serve <socket>` serves the same commands to many desks until SIGINT or SIGTERM,
+ * then saves the data; `main --connect <socket>` is the desk side. `main --stress <threads>`
+ * benchmarks the table locks with up to that many reader threads, and `main --checkout <threads>`
+ * the stock of one hot title with up to that many desks, `main --fines <loans>` the fine sweep
+ * over that many open loans, `main --popular <books>` the circulation statistics over that
+ * many lent books, and `main --coborrow <loans>` the rebuild of the co-borrowing matrix from that
+ * many archived loans, without saving anything.
+ * 
  * @return Returns 1 upon successful execution.
  */
-int main()
+int main(int argc, char** argv)
 {
+    if (argc == 3 && !strcmp(argv[1], "--connect")) {
+        return RunDesk(argv[2]) == 0 ? 0 : 1;
+    }
+    if (!BookByteInit()) {
+        perror("Error reserving storage");
+        return 1;
+    }
     ImportData();
+    if (argc == 3 && !strcmp(argv[1], "--batch")) {
+        int failed = RunBatch(argv[2]);
+        if (failed >= 0) {
+            SaveData();
+        }
+        return failed == 0 ? 0 : 1;
+    }
+    if (argc == 3 && !strcmp(argv[1], "--stress")) {
+        return RunStress(atoi(argv[2]) > 0 ? atoi(argv[2]) : 1, 1.0) == 0 ? 0 : 1;
+    }
+    if (argc == 3 && !strcmp(argv[1], "--fines")) {
+        return RunFineSweep(atoi(argv[2]) > 0 ? atoi(argv[2]) : 1) == 0 ? 0 : 1;
+    }
+    if (argc == 3 && !strcmp(argv[1], "--popular")) {
+        return RunPopularity(atoi(argv[2]) > 0 ? atoi(argv[2]) : 1) == 0 ? 0 : 1;
+    }
+    if (argc == 3 && !strcmp(argv[1], "--coborrow")) {
+        return RunCoBorrow(atoi(argv[2]) > 0 ? atoi(argv[2]) : 1) == 0 ? 0 : 1;
+    }
+    if (argc == 3 && !strcmp(argv[1], "--checkout")) {
+        return RunCheckout(atoi(argv[2]) > 0 ? atoi(argv[2]) : 1, 1.0) == 0 ? 0 : 1;
+    }
+    if (argc == 3 && !strcmp(argv[1], "--serve")) {
+        int served = RunServer(argv[2]);
+        SaveData();
+        return served == 0 ? 0 : 1;
+    }
     printf("||||||Library||||||\n\n\n\n\n\ndeveloped by  DLRS\n\n\n\n\n");
     printf("Type anything to continue...");
     getch();
-    system("clear");
+    ScreenClear();
     int exit = 0;
     while(!exit){
         if (login()){
             exit = WorkSystem();
         } else {
-            system("clear");
+            ScreenClear();
             printf("Incorrect login or password\n");
             printf("Type anything to continue...");
             getch();
-            system("clear");
+            ScreenClear();
         }
     }
     return 1;
@@ -0,0 +1,328 @@
+#ifndef ADDRESS_INDEX_H
+#define ADDRESS_INDEX_H
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "models.h"
+#include "repository.h"
+
+/**
+ * @brief Open-addressing hash table from an address's four fields to its slot.
+ *
+ * Each entry holds the index of an address in `addresses`, or -1 if the entry is free.
+ * The key is the tuple (street, number, cep, complement) of interned strings, so two
+ * addresses are the same exactly when the four identifiers are equal.
+ */
+int* addressIndex;
+uint32_t addressIndexMask;
+int addressIndexCount;
+
+/**
+ * @brief Normalizes free text in place: trims it, collapses runs of blanks and uppercases it.
+ *
+ * @param s The string to normalize.
+ */
+void NormalizeText(char* s) {
+    char* out = s;
+    for (char* in = s; *in; in++) {
+        if (isspace((unsigned char) *in)) {
+            if (out != s && out[-1] != ' ') {
+                *out++ = ' ';
+            }
+        } else {
+            *out++ = (char) toupper((unsigned char) *in);
+        }
+    }
+    if (out != s && out[-1] == ' ') {
+        out--;
+    }
+    *out = '\0';
+}
+
+/**
+ * @brief Normalizes a postal code (CEP) in place.
+ *
+ * A CEP with exactly eight digits is rewritten as "00000-000" whatever its punctuation.
+ * Anything else is only normalized as free text.
+ *
+ * @param cep The postal code to normalize. It must have room for at least 10 characters.
+ */
+void NormalizeCep(char* cep) {
+    char digits[9];
+    int n = 0;
+    for (char* c = cep; *c; c++) {
+        if (isdigit((unsigned char) *c)) {
+            if (n == 8) {
+                n++;
+                break;
+            }
+            digits[n++] = *c;
+        } else if (*c != '-' && *c != '.' && !isspace((unsigned char) *c)) {
+            n = 9;
+            break;
+        }
+    }
+    if (n != 8) {
+        NormalizeText(cep);
+        return;
+    }
+    memcpy(cep, digits, 5);
+    cep[5] = '-';
+    memcpy(cep + 6, digits + 5, 3);
+    cep[9] = '\0';
+}
+
+/**
+ * @brief Hashes the four fields of an address.
+ */
+uint32_t addressHashOf(StringId street, StringId number, StringId cep, StringId complement) {
+    uint64_t h = street * 0x9E3779B97F4A7C15ull;
+    h = (h ^ number) * 0xC2B2AE3D27D4EB4Full;
+    h = (h ^ cep) * 0x165667B19E3779F9ull;
+    h = (h ^ complement) * 0x9E3779B97F4A7C15ull;
+    return (uint32_t) (h >> 32);
+}
+
+/**
+ * @brief Finds the index entry of an address with the given fields, or the free entry where it would go.
+ */
+int* addressIndexEntry(StringId street, StringId number, StringId cep, StringId complement) {
+    uint32_t i = addressHashOf(street, number, cep, complement) & addressIndexMask;
+    for (; ; i = (i + 1) & addressIndexMask) {
+        int slot = addressIndex[i];
+        if (slot == -1 || (addresses[slot].street == street && addresses[slot].number == number &&
+                           addresses[slot].cep == cep && addresses[slot].complement == complement)) {
+            return &addressIndex[i];
+        }
+    }
+}
+
+/**
+ * @brief Allocates an empty index with room for at least `capacity` addresses at half load.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int addressIndexAllocate(int capacity) {
+    uint32_t size = 64;
+    while (size < (uint32_t) capacity * 2) {
+        size *= 2;
+    }
+    int* table = malloc(size * sizeof(int));
+    if (!table) {
+        return 0;
+    }
+    memset(table, 0xff, size * sizeof(int));
+    free(addressIndex);
+    addressIndex = table;
+    addressIndexMask = size - 1;
+    addressIndexCount = 0;
+    return 1;
+}
+
+/**
+ * @brief Adds an address to the index.
+ *
+ * If an address with the same fields is already indexed, the index keeps the existing one.
+ *
+ * @param add The address to index.
+ */
+void IndexAddress(Address* add) {
+    if ((uint32_t) (addressIndexCount + 1) * 2 > addressIndexMask + 1) {
+        int* old = addressIndex;
+        uint32_t oldSize = addressIndexMask + 1;
+        addressIndex = NULL;
+        if (!addressIndexAllocate(addressIndexCount + 1)) {
+            addressIndex = old;
+        } else {
+            for (uint32_t i = 0; i < oldSize; i++) {
+                if (old[i] != -1) {
+                    Address* a = &addresses[old[i]];
+                    *addressIndexEntry(a->street, a->number, a->cep, a->complement) = old[i];
+                    addressIndexCount++;
+                }
+            }
+            free(old);
+        }
+    }
+    int* entry = addressIndexEntry(add->street, add->number, add->cep, add->complement);
+    if (*entry == -1) {
+        *entry = (int) (add - addresses);
+        addressIndexCount++;
+    }
+}
+
+/**
+ * @brief Removes an address from the index.
+ *
+ * Uses backward-shift deletion, so lookups never have to skip tombstones.
+ *
+ * @param add The address to remove.
+ */
+void UnindexAddress(Address* add) {
+    int* entry = addressIndexEntry(add->street, add->number, add->cep, add->complement);
+    if (*entry != (int) (add - addresses)) {
+        return;
+    }
+    uint32_t hole = (uint32_t) (entry - addressIndex);
+    addressIndex[hole] = -1;
+    addressIndexCount--;
+    for (uint32_t i = (hole + 1) & addressIndexMask; addressIndex[i] != -1; i = (i + 1) & addressIndexMask) {
+        Address* a = &addresses[addressIndex[i]];
+        uint32_t home = addressHashOf(a->street, a->number, a->cep, a->complement) & addressIndexMask;
+        if (((i - home) & addressIndexMask) >= ((i - hole) & addressIndexMask)) {
+            addressIndex[hole] = addressIndex[i];
+            addressIndex[i] = -1;
+            hole = i;
+        }
+    }
+}
+
+/**
+ * @brief Looks up an address by its fields in O(1).
+ *
+ * @return Address* Pointer to the matching address, or NULL if there is none.
+ */
+Address* FindAddress(StringId street, StringId number, StringId cep, StringId complement) {
+    int slot = *addressIndexEntry(street, number, cep, complement);
+    return slot == -1 ? NULL : &addresses[slot];
+}
+
+/**
+ * @brief Records that one more client lives at an address.
+ *
+ * @param id The ID of the address.
+ */
+void AcquireAddress(int id) {
+    if (id >= 0 && id < addressesCapacity) {
+        addressRefs[id]++;
+    }
+}
+
+/**
+ * @brief Records that one client less lives at an address, removing it once no client does.
+ *
+ * @param id The ID of the address.
+ * @return int Returns 1 if the address was removed, otherwise returns 0.
+ */
+int ReleaseAddress(int id) {
+    if (id < 0 || id >= addressesCapacity || addresses[id].id == -1) {
+        return 0;
+    }
+    if (--addressRefs[id] > 0) {
+        return 0;
+    }
+    addressRefs[id] = 0;
+    UnindexAddress(&addresses[id]);
+    initEmptyAddress(&addresses[id]);
+    return 1;
+}
+
+/**
+ * @brief Rebuilds the address index and the per-address reference counts from scratch.
+ *
+ * Called once after the data files are imported.
+ */
+void RebuildAddressIndex(void) {
+    addressIndexAllocate(addressesCapacity);
+    memset(addressRefs, 0, addressesCapacity * sizeof(int));
+    for (int i = 0; i < addressesCapacity; i++) {
+        if (addresses[i].id != -1) {
+            IndexAddress(&addresses[i]);
+        }
+    }
+    for (int i = 0; i < clientsCapacity; i++) {
+        if (strcmp(clients[i].cpf, "0")) {
+            AcquireAddress(clients[i].addressId);
+        }
+    }
+}
+
+/**
+ * @brief Interns one address field in normalized form.
+ *
+ * @param field The field as typed.
+ * @param isCep Nonzero if the field is a postal code.
+ * @return StringId The identifier of the normalized field, or STRING_NONE if it cannot be stored.
+ */
+StringId InternAddressField(const char* field, int isCep) {
+    size_t length = strlen(field) + 1;
+    char* s = malloc(length < 10 ? 10 : length);
+    if (!s) {
+        return STRING_NONE;
+    }
+    memcpy(s, field, length);
+    if (isCep) {
+        NormalizeCep(s);
+    } else {
+        NormalizeText(s);
+    }
+    StringId normalized = StringIntern(s);
+    free(s);
+    return normalized;
+}
+
+/**
+ * @brief Re-interns one address field in normalized form.
+ */
+StringId normalizeAddressField(StringId field, int isCep) {
+    StringId normalized = InternAddressField(StringGet(field), isCep);
+    return normalized == STRING_NONE ? field : normalized;
+}
+
+/**
+ * @brief Normalizes every address and merges the ones that become identical.
+ *
+ * Clients of a duplicate are moved to the first address with the same fields and the
+ * duplicate is removed. Addresses that no client references are removed as well.
+ * Runs in a single pass over addresses and clients.
+ *
+ * @return int The number of addresses removed.
+ */
+int MergeDuplicateAddresses(void) {
+    int removed = 0;
+    int* canonical = malloc(addressesCapacity * sizeof(int));
+    if (!canonical) {
+        return 0;
+    }
+    addressIndexAllocate(addressesCapacity);
+    for (int i = 0; i < addressesCapacity; i++) {
+        canonical[i] = i;
+        if (addresses[i].id == -1) {
+            continue;
+        }
+        Address* add = &addresses[i];
+        add->street = normalizeAddressField(add->street, 0);
+        add->number = normalizeAddressField(add->number, 0);
+        add->cep = normalizeAddressField(add->cep, 1);
+        add->complement = normalizeAddressField(add->complement, 0);
+        Address* existing = FindAddress(add->street, add->number, add->cep, add->complement);
+        if (existing) {
+            canonical[i] = (int) (existing - addresses);
+        } else {
+            IndexAddress(add);
+        }
+    }
+    memset(addressRefs, 0, addressesCapacity * sizeof(int));
+    for (int i = 0; i < clientsCapacity; i++) {
+        int id = clients[i].addressId;
+        if (strcmp(clients[i].cpf, "0") && id >= 0 && id < addressesCapacity) {
+            clients[i].addressId = canonical[id];
+            AcquireAddress(clients[i].addressId);
+        }
+    }
+    TableChanged(ROW_CLIENTS);
+    for (int i = 0; i < addressesCapacity; i++) {
+        if (addresses[i].id != -1 && addressRefs[i] == 0) {
+            if (canonical[i] == i) {
+                UnindexAddress(&addresses[i]);
+            }
+            initEmptyAddress(&addresses[i]);
+            removed++;
+        }
+    }
+    free(canonical);
+    return removed;
+}
+
+#endif
@@ -0,0 +1,230 @@
+#ifndef ARENA_H
+#define ARENA_H
+#include <string.h>
+#include <sys/mman.h>
+
+/**
+ * @brief Alignment, in bytes, of every block handed out by an arena (one cache line).
+ */
+#define ARENA_ALIGNMENT 64
+
+/**
+ * @brief Granularity, in bytes, in which an arena commits memory (one 2 MiB huge page).
+ */
+#define ARENA_CHUNK_SIZE ((size_t)2 * 1024 * 1024)
+
+/**
+ * @brief Virtual address space reserved up front by each arena.
+ *
+ * Only the committed part is backed by memory, so reserving generously costs nothing
+ * and lets a table grow in place without ever being copied.
+ */
+#define ARENA_RESERVE_SIZE ((size_t)16 * 1024 * 1024 * 1024)
+
+#define ARENA_HUGE_NONE 0
+#define ARENA_HUGE_TRANSPARENT 1
+#define ARENA_HUGE_EXPLICIT 2
+
+/**
+ * @brief Huge page mode used by the arenas.
+ *
+ * - ARENA_HUGE_NONE: regular pages.
+ * - ARENA_HUGE_TRANSPARENT: committed chunks are advised as transparent huge pages.
+ * - ARENA_HUGE_EXPLICIT: the reservation is backed by the hugetlbfs pool (vm.nr_hugepages).
+ *   If the pool cannot hold the reservation, the arena falls back to transparent huge pages.
+ *
+ * Override at compile time, e.g. `gcc -DARENA_HUGE_PAGES=1 ProjetoProgramacao.c -o main`.
+ */
+#ifndef ARENA_HUGE_PAGES
+#define ARENA_HUGE_PAGES ARENA_HUGE_NONE
+#endif
+
+/**
+ * @struct Arena
+ * @brief A slab of contiguous memory that grows in large chunks without moving.
+ *
+ * @var Arena::name
+ * Name reported in the storage statistics.
+ *
+ * @var Arena::base
+ * Start of the reserved address range. It is page aligned, hence cache-line aligned.
+ *
+ * @var Arena::reserved
+ * Size of the reserved address range.
+ *
+ * @var Arena::committed
+ * Bytes of the range that are readable and writable.
+ *
+ * @var Arena::used
+ * Bytes of the committed range that have been handed out.
+ *
+ * @var Arena::hugePages
+ * Huge page mode actually in effect for this arena.
+ */
+typedef struct {
+    const char* name;
+    char* base;
+    size_t reserved;
+    size_t committed;
+    size_t used;
+    int hugePages;
+} Arena;
+
+/**
+ * @brief Reserves the address range of an arena.
+ *
+ * Nothing is committed yet; memory is committed chunk by chunk as the arena grows.
+ *
+ * @param a The arena to initialize.
+ * @param name The name reported in the storage statistics.
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int ArenaInit(Arena* a, const char* name) {
+    a->name = name;
+    a->reserved = ARENA_RESERVE_SIZE;
+    a->committed = 0;
+    a->used = 0;
+    a->hugePages = ARENA_HUGE_PAGES;
+    a->base = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (a->hugePages == ARENA_HUGE_EXPLICIT) {
+        a->base = mmap(NULL, a->reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (a->base == MAP_FAILED) {
+            a->hugePages = ARENA_HUGE_TRANSPARENT;
+        }
+    }
+#else
+    if (a->hugePages == ARENA_HUGE_EXPLICIT) {
+        a->hugePages = ARENA_HUGE_TRANSPARENT;
+    }
+#endif
+    if (a->base == MAP_FAILED) {
+        a->base = mmap(NULL, a->reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    }
+    if (a->base == MAP_FAILED) {
+        a->base = NULL;
+        a->reserved = 0;
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Makes sure at least `size` bytes of the arena are committed.
+ *
+ * Memory is committed in multiples of ARENA_CHUNK_SIZE, so growing a table one record
+ * at a time only touches the page tables once every chunk.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int arenaCommit(Arena* a, size_t size) {
+    if (size <= a->committed) {
+        return 1;
+    }
+    if (size > a->reserved) {
+        return 0;
+    }
+    size_t target = (size + ARENA_CHUNK_SIZE - 1) / ARENA_CHUNK_SIZE * ARENA_CHUNK_SIZE;
+    if (target > a->reserved) {
+        target = a->reserved;
+    }
+    if (mprotect(a->base + a->committed, target - a->committed, PROT_READ | PROT_WRITE)) {
+        return 0;
+    }
+#ifdef MADV_HUGEPAGE
+    if (a->hugePages == ARENA_HUGE_TRANSPARENT) {
+        madvise(a->base + a->committed, target - a->committed, MADV_HUGEPAGE);
+    }
+#endif
+    a->committed = target;
+    return 1;
+}
+
+/**
+ * @brief Hands out a zeroed, cache-line aligned block from the arena.
+ *
+ * @param a The arena to allocate from.
+ * @param size The size of the block in bytes.
+ * @return void* Pointer to the block, or NULL if the arena is exhausted.
+ */
+void* ArenaAlloc(Arena* a, size_t size) {
+    size_t start = (a->used + ARENA_ALIGNMENT - 1) & ~((size_t)ARENA_ALIGNMENT - 1);
+    if (!arenaCommit(a, start + size)) {
+        return NULL;
+    }
+    a->used = start + size;
+    return a->base + start;
+}
+
+/**
+ * @brief Hands out a zeroed block from the arena without aligning it.
+ *
+ * Used for data that is only read byte by byte, such as strings.
+ *
+ * @param a The arena to allocate from.
+ * @param size The size of the block in bytes.
+ * @return void* Pointer to the block, or NULL if the arena is exhausted.
+ */
+void* ArenaAllocPacked(Arena* a, size_t size) {
+    if (!arenaCommit(a, a->used + size)) {
+        return NULL;
+    }
+    a->used += size;
+    return a->base + a->used - size;
+}
+
+/**
+ * @brief Grows a table stored at the base of its own arena.
+ *
+ * The table never moves, so pointers to its records stay valid. The capacity at least
+ * doubles on every call and the new records are zeroed.
+ *
+ * @param a The arena holding the table.
+ * @param recordSize The size of one record.
+ * @param capacity The current capacity in records; updated on success.
+ * @param minimum The capacity to use for an empty table.
+ * @return int The index of the first new record, or -1 if the arena is exhausted.
+ */
+int ArenaGrowTable(Arena* a, size_t recordSize, int* capacity, int minimum) {
+    int first = *capacity;
+    int next = first ? first * 2 : minimum;
+    if (!arenaCommit(a, (size_t)next * recordSize)) {
+        return -1;
+    }
+    a->used = (size_t)next * recordSize;
+    *capacity = next;
+    return first;
+}
+
+/**
+ * @brief Sizes a column stored at the base of its own arena to match its table.
+ *
+ * Columns are per-record values kept next to a table rather than inside its records,
+ * such as reference counts. New entries are zeroed.
+ *
+ * @param a The arena holding the column.
+ * @param recordSize The size of one entry.
+ * @param capacity The capacity of the table the column belongs to.
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int ArenaResizeColumn(Arena* a, size_t recordSize, int capacity) {
+    if (!arenaCommit(a, (size_t)capacity * recordSize)) {
+        return 0;
+    }
+    if ((size_t)capacity * recordSize > a->used) {
+        a->used = (size_t)capacity * recordSize;
+    }
+    return 1;
+}
+
+/**
+ * @brief Releases every block of the arena at once.
+ *
+ * The memory stays committed, so the arena can be refilled without faulting again.
+ */
+void ArenaReset(Arena* a) {
+    memset(a->base, 0, a->used);
+    a->used = 0;
+}
+
+#endif
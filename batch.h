@@ -0,0 +1,512 @@
+#ifndef BATCH_H
+#define BATCH_H
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bookbyte.h"
+
+/**
+ * @file batch.h
+ * @brief Non-interactive front end running a line-oriented command language.
+ *
+ * Each line holds a command, a space, then its arguments separated by '|':
+ *
+ * ```
+ * LOGIN LUCAS|12345
+ * BRANCH name
+ * ADD_CLIENT name|cpf|street|number|cep|complement
+ * RENAME_CLIENT cpf|name
+ * MOVE_CLIENT cpf|street|number|cep|complement
+ * REMOVE_CLIENT cpf
+ * ADD_AUTHOR name
+ * ADD_GENRE name
+ * ADD_BOOK title|authorId|genreId|copies
+ * EDIT_BOOK id|title|authorId|genreId
+ * REMOVE_BOOK id|copies
+ * COPIES id
+ * DAMAGE barcode
+ * REPAIR barcode
+ * LOAN cpf|date|title[|title...]
+ * RETURN cpf
+ * PAY cpf|cents
+ * OWING cents
+ * HISTORY cpf
+ * POPULAR days
+ * COBORROWED bookId
+ * RESERVE cpf|title
+ * DUE days
+ * SWEEP threads
+ * SEARCH_CLIENT cpf
+ * SEARCH_BOOK title
+ * STOCK title
+ * REPORT
+ * ```
+ *
+ * Arguments are uppercased like the interactive prompts do. Empty lines and lines starting
+ * with '#' are ignored. Every other line produces exactly one line on stdout, either
+ * `OK` followed by tab-separated results, or `ERR<TAB>line<TAB>code<TAB>message` where
+ * code is the numeric Status. The session must start with LOGIN.
+ *
+ * LOAN answers with the loan, its number of books, its deadline and the barcode of every copy
+ * lent. COPIES answers with the copies of a book on the shelf, lent, held and damaged, then
+ * the barcode of the first copy on the shelf, or -1.
+ *
+ * A session works at the main branch until BRANCH moves it to another, adding the branch if
+ * there is none with that name. Clients, books and loans it adds belong to its branch, and
+ * titles are looked up there. STOCK lists the copies of a title at every branch, as
+ * `branch:stock/amount` pairs.
+ *
+ * batchCommand takes the locks of table_locks.h, so several threads may run commands at once,
+ * and commits the rows it changed to snapshot.h before releasing them. REPORT reads a
+ * snapshot and takes no lock at all.
+ */
+
+/**
+ * @brief Most arguments a command line may have.
+ */
+#define BATCH_MAX_ARGS 64
+
+/**
+ * @brief Books listed by POPULAR and COBORROWED, as `id:count` pairs.
+ */
+#define BATCH_POPULAR 10
+
+/**
+ * @struct BatchLocks
+ * @brief The tables a command locks. Commands that are not listed lock nothing.
+ */
+typedef struct {
+    const char* command;
+    LockSet locks;
+} BatchLocks;
+
+const BatchLocks batchLocks[] = {
+    {"ADD_CLIENT", {0, LOCK_BIT(LOCK_STRINGS) | LOCK_BIT(LOCK_ADDRESSES) | LOCK_BIT(LOCK_CLIENTS)}},
+    {"RENAME_CLIENT", {LOCK_BIT(LOCK_CLIENTS), LOCK_BIT(LOCK_STRINGS)}},
+    {"MOVE_CLIENT", {LOCK_BIT(LOCK_CLIENTS), LOCK_BIT(LOCK_STRINGS) | LOCK_BIT(LOCK_ADDRESSES)}},
+    {"REMOVE_CLIENT", {0, LOCK_BIT(LOCK_ADDRESSES) | LOCK_BIT(LOCK_CLIENTS) | LOCK_BIT(LOCK_LOANS)}},
+    {"ADD_AUTHOR", {0, LOCK_BIT(LOCK_STRINGS) | LOCK_BIT(LOCK_AUTHORS)}},
+    {"ADD_GENRE", {0, LOCK_BIT(LOCK_STRINGS) | LOCK_BIT(LOCK_GENRES)}},
+    {"ADD_BOOK", {0, LOCK_BIT(LOCK_STRINGS) | LOCK_BIT(LOCK_AUTHORS) | LOCK_BIT(LOCK_GENRES) | LOCK_BIT(LOCK_BOOKS)}},
+    {"EDIT_BOOK", {0, LOCK_BIT(LOCK_STRINGS) | LOCK_BIT(LOCK_AUTHORS) | LOCK_BIT(LOCK_GENRES) | LOCK_BIT(LOCK_BOOKS)}},
+    {"REMOVE_BOOK", {LOCK_BIT(LOCK_LOANS), LOCK_BIT(LOCK_AUTHORS) | LOCK_BIT(LOCK_GENRES) | LOCK_BIT(LOCK_BOOKS)}},
+    {"COPIES", {LOCK_BIT(LOCK_BOOKS), 0}},
+    {"DAMAGE", {LOCK_BIT(LOCK_BOOKS), 0}},
+    {"REPAIR", {LOCK_BIT(LOCK_BOOKS), 0}},
+    {"LOAN", {LOCK_BIT(LOCK_STRINGS) | LOCK_BIT(LOCK_CLIENTS) | LOCK_BIT(LOCK_BOOKS), LOCK_BIT(LOCK_LOANS)}},
+    {"RETURN", {LOCK_BIT(LOCK_CLIENTS) | LOCK_BIT(LOCK_BOOKS), LOCK_BIT(LOCK_LOANS)}},
+    {"PAY", {LOCK_BIT(LOCK_CLIENTS), LOCK_BIT(LOCK_LOANS)}},
+    {"OWING", {LOCK_BIT(LOCK_CLIENTS) | LOCK_BIT(LOCK_LOANS), 0}},
+    {"HISTORY", {LOCK_BIT(LOCK_LOANS), 0}},
+    {"POPULAR", {LOCK_BIT(LOCK_BOOKS), LOCK_BIT(LOCK_LOANS)}},
+    {"COBORROWED", {LOCK_BIT(LOCK_LOANS), 0}},
+    {"RESERVE", {LOCK_BIT(LOCK_STRINGS) | LOCK_BIT(LOCK_CLIENTS) | LOCK_BIT(LOCK_BOOKS), LOCK_BIT(LOCK_LOANS)}},
+    {"DUE", {LOCK_BIT(LOCK_LOANS), 0}},
+    {"SWEEP", {LOCK_BIT(LOCK_LOANS), LOCK_BIT(LOCK_CLIENTS)}},
+    {"SEARCH_CLIENT", {LOCK_BIT(LOCK_CLIENTS) | LOCK_BIT(LOCK_LOANS), 0}},
+    {"SEARCH_BOOK", {LOCK_BIT(LOCK_STRINGS) | LOCK_BIT(LOCK_BOOKS), 0}},
+    {"BRANCH", {0, LOCK_BIT(LOCK_STRINGS) | LOCK_BIT(LOCK_CLIENTS) | LOCK_BIT(LOCK_BOOKS) | LOCK_BIT(LOCK_LOANS)}},
+    {"STOCK", {LOCK_BIT(LOCK_STRINGS) | LOCK_BIT(LOCK_BOOKS), 0}},
+};
+
+/**
+ * @brief The tables a command locks.
+ */
+LockSet batchLockSet(const char* command) {
+    for (size_t i = 0; i < sizeof(batchLocks) / sizeof(batchLocks[0]); i++) {
+        if (!strcmp(batchLocks[i].command, command)) {
+            return batchLocks[i].locks;
+        }
+    }
+    return (LockSet) {0, 0};
+}
+
+/**
+ * @brief Prints the error line of a failed command.
+ */
+void batchError(FILE* out, int line, Status s) {
+    fprintf(out, "ERR\t%d\t%d\t%s\n", line, (int) s, StatusText(s));
+}
+
+/**
+ * @brief Splits the arguments of a command in place and uppercases them.
+ *
+ * @return int The number of arguments.
+ */
+int batchSplit(char* args, char** argv) {
+    int argc = 0;
+    if (!args) {
+        return 0;
+    }
+    for (char* c = args; *c; c++) {
+        *c = toupper((unsigned char) *c);
+    }
+    argv[argc++] = args;
+    for (char* c = args; *c && argc < BATCH_MAX_ARGS; c++) {
+        if (*c == '|') {
+            *c = '\0';
+            argv[argc++] = c + 1;
+        }
+    }
+    return argc;
+}
+
+/**
+ * @brief Looks a client up by CPF, turning a miss into a Status.
+ */
+Status batchClient(const char* cpf, Client** c) {
+    *c = SearchClientByCPF(cpf);
+    return *c ? STATUS_OK : STATUS_NOT_FOUND;
+}
+
+/**
+ * @brief Opens a loan with every listed book, or with none of them, and counts its books in
+ *        the circulation statistics and the co-borrowing matrix.
+ */
+Status batchLoan(Client* c, const char* date, char** titles, int n, Loan** out) {
+    Loan* l = NULL;
+    Transaction tx;
+    TxBegin(&tx);
+    Status s = LoanOpen(c, date, &l);
+    for (int i = 0; s == STATUS_OK && i < n; i++) {
+        Book* b = SearchBookByTitle(titles[i]);
+        s = b ? LoanAddBook(l, b) : STATUS_NOT_FOUND;
+    }
+    if (s == STATUS_OK) {
+        s = TxCommit();
+    } else {
+        TxAbort();
+    }
+    if (s == STATUS_OK) {
+        CirculationRecordLoan(l);
+        CoBorrowRecordLoan(l);
+    }
+    *out = l;
+    return s;
+}
+
+/**
+ * @brief Runs one command and prints its result line.
+ *
+ * @param out Where the result line goes.
+ * @param loggedIn Set to 1 by a successful LOGIN. Every other command is refused until then.
+ * @param branch The branch the session works at, set by BRANCH.
+ * @return Status The outcome of the command.
+ */
+Status batchCommand(FILE* out, int line, char* command, char* args, int* loggedIn, int* branch) {
+    char* argv[BATCH_MAX_ARGS];
+    int argc = batchSplit(args, argv);
+    Status s = STATUS_INVALID;
+    Client* c;
+
+    for (char* k = command; *k; k++) {
+        *k = toupper((unsigned char) *k);
+    }
+    LockSet locks = batchLockSet(command);
+    LockTables(locks);
+    branchCurrent = *branch;
+    if (!strcmp(command, "LOGIN")) {
+        s = STATUS_NOT_FOUND;
+        for (int i = 0; argc == 2 && i < 10; i++) {
+            if (!strcmp(adm[i].login, argv[0]) && !strcmp(adm[i].password, argv[1])) {
+                *loggedIn = 1;
+                s = STATUS_OK;
+            }
+        }
+        if (s == STATUS_OK) {
+            fprintf(out, "OK\n");
+        }
+    } else if (!*loggedIn) {
+        s = STATUS_INVALID;
+    } else if (!strcmp(command, "BRANCH") && argc == 1) {
+        int b = BranchFind(argv[0]);
+        s = b == -1 ? BranchAdd(argv[0], &b) : STATUS_OK;
+        if (s == STATUS_OK) {
+            *branch = b;
+            fprintf(out, "OK\t%d\n", b);
+        }
+    } else if (!strcmp(command, "ADD_CLIENT") && argc == 6) {
+        s = ClientAdd(argv[0], argv[1], argv[2], argv[3], argv[4], argv[5], &c);
+        if (s == STATUS_OK) {
+            fprintf(out, "OK\t%s\n", c->cpf);
+        }
+    } else if (!strcmp(command, "RENAME_CLIENT") && argc == 2) {
+        s = batchClient(argv[0], &c);
+        if (s == STATUS_OK) {
+            LockStripes(LOCK_CLIENTS, StripeOf(c - clients), 1);
+            s = ClientRename(c, argv[1]);
+            SnapshotCommit();
+            UnlockStripes(LOCK_CLIENTS, StripeOf(c - clients));
+        }
+        if (s == STATUS_OK) {
+            fprintf(out, "OK\n");
+        }
+    } else if (!strcmp(command, "MOVE_CLIENT") && argc == 5) {
+        s = batchClient(argv[0], &c);
+        if (s == STATUS_OK) {
+            LockStripes(LOCK_CLIENTS, StripeOf(c - clients), 1);
+            s = ClientMove(c, argv[1], argv[2], argv[3], argv[4]);
+            if (s == STATUS_OK) {
+                fprintf(out, "OK\t%d\n", c->addressId);
+            }
+            SnapshotCommit();
+            UnlockStripes(LOCK_CLIENTS, StripeOf(c - clients));
+        }
+    } else if (!strcmp(command, "REMOVE_CLIENT") && argc == 1) {
+        s = batchClient(argv[0], &c);
+        if (s == STATUS_OK && (s = ClientRemove(c, NULL)) == STATUS_OK) {
+            fprintf(out, "OK\n");
+        }
+    } else if (!strcmp(command, "ADD_AUTHOR") && argc == 1) {
+        Author* a;
+        s = AuthorAdd(argv[0], &a);
+        if (s == STATUS_OK) {
+            fprintf(out, "OK\t%d\n", a->id);
+        }
+    } else if (!strcmp(command, "ADD_GENRE") && argc == 1) {
+        Genre* g;
+        s = GenreAdd(argv[0], &g);
+        if (s == STATUS_OK) {
+            fprintf(out, "OK\t%d\n", g->id);
+        }
+    } else if (!strcmp(command, "ADD_BOOK") && argc == 4) {
+        Book* b;
+        s = BookAdd(argv[0], atoi(argv[1]), atoi(argv[2]), atoi(argv[3]), &b);
+        if (s == STATUS_OK) {
+            fprintf(out, "OK\t%d\n", b->id);
+        }
+    } else if (!strcmp(command, "EDIT_BOOK") && argc == 4) {
+        Book* b = SearchBookById(atoi(argv[0]));
+        s = b ? BookEdit(b, argv[1], atoi(argv[2]), atoi(argv[3])) : STATUS_NOT_FOUND;
+        if (s == STATUS_OK) {
+            fprintf(out, "OK\n");
+        }
+    } else if (!strcmp(command, "REMOVE_BOOK") && argc == 2) {
+        Book* b = SearchBookById(atoi(argv[0]));
+        int removed;
+        s = b ? BookRemoveCopies(b, atoi(argv[1]), &removed) : STATUS_NOT_FOUND;
+        if (s == STATUS_OK) {
+            fprintf(out, "OK\t%d\n", removed);
+        }
+    } else if (!strcmp(command, "COPIES") && argc == 1) {
+        Book* b = SearchBookById(atoi(argv[0]));
+        s = b ? STATUS_OK : STATUS_NOT_FOUND;
+        if (s == STATUS_OK) {
+            fprintf(out, "OK\t%d\t%d\t%d\t%d\t%d\n", CopiesCount(b->id, COPY_ON_SHELF), CopiesCount(b->id, COPY_LENT),
+                    CopiesCount(b->id, COPY_HELD), CopiesCount(b->id, COPY_DAMAGED), CopyNext(b->id, COPY_ON_SHELF, 0));
+        }
+    } else if ((!strcmp(command, "DAMAGE") || !strcmp(command, "REPAIR")) && argc == 1) {
+        int barcode = atoi(argv[0]);
+        s = !strcmp(command, "DAMAGE") ? CopyDamage(barcode) : CopyRepair(barcode);
+        if (s == STATUS_OK) {
+            fprintf(out, "OK\t%d\n", (int) books[copies[barcode].bookId].stock);
+        }
+    } else if (!strcmp(command, "LOAN") && argc >= 3) {
+        Loan* l;
+        s = batchClient(argv[0], &c);
+        if (s == STATUS_OK) {
+            s = batchLoan(c, argv[1], argv + 2, argc - 2, &l);
+        }
+        if (s == STATUS_OK) {
+            fprintf(out, "OK\t%d\t%d\t%s", l->id, l->itemCount, l->deadline);
+            for (int k = 0; k < l->itemCount; k++) {
+                fprintf(out, "\t%d", loanItems[l->itemOffset + k].copyId);
+            }
+            fprintf(out, "\n");
+        }
+    } else if (!strcmp(command, "RETURN") && argc == 1) {
+        int fine;
+        s = batchClient(argv[0], &c);
+        if (s == STATUS_OK) {
+            Transaction tx;
+            LockStripes(LOCK_CLIENTS, StripeOf(c - clients), 1);
+            TxBegin(&tx);
+            s = LoanReturn(c, time(NULL), &fine);
+            if (s == STATUS_OK) {
+                s = TxCommit();
+            } else {
+                TxAbort();
+            }
+            SnapshotCommit();
+            UnlockStripes(LOCK_CLIENTS, StripeOf(c - clients));
+        }
+        if (s == STATUS_OK) {
+            fprintf(out, "OK\t%d\n", fine);
+        }
+    } else if (!strcmp(command, "PAY") && argc == 2) {
+        s = batchClient(argv[0], &c);
+        if (s == STATUS_OK) {
+            LockStripes(LOCK_CLIENTS, StripeOf(c - clients), 1);
+            s = FinePay(c, atoi(argv[1]), DeadlineToday());
+            if (s == STATUS_OK) {
+                fprintf(out, "OK\t%d\n", c->fineAmount);
+            }
+            SnapshotCommit();
+            UnlockStripes(LOCK_CLIENTS, StripeOf(c - clients));
+        }
+    } else if (!strcmp(command, "OWING") && argc == 1) {
+        int found = ClientsOwingMoreThan(atoi(argv[0]), NULL, NULL);
+        s = found < 0 ? STATUS_NO_MEMORY : STATUS_OK;
+        if (s == STATUS_OK) {
+            fprintf(out, "OK\t%d\n", found);
+        }
+    } else if (!strcmp(command, "HISTORY") && argc == 1) {
+        s = STATUS_OK;
+        fprintf(out, "OK\t%d\n", HistoryOfClient(argv[0], INT_MIN, INT_MAX, NULL, NULL));
+    } else if (!strcmp(command, "POPULAR") && argc == 1) {
+        HeavyHitter top[BATCH_POPULAR];
+        CirculationAdvance(DeadlineToday());
+        int found = CirculationTop(STATS_BOOKS, atoi(argv[0]), -1, top, BATCH_POPULAR);
+        s = found < 0 ? STATUS_INVALID : STATUS_OK;
+        if (s == STATUS_OK) {
+            fprintf(out, "OK");
+            for (int i = 0; i < found; i++) {
+                fprintf(out, "\t%d:%u", top[i].id, top[i].count);
+            }
+            fprintf(out, "\n");
+        }
+    } else if (!strcmp(command, "COBORROWED") && argc == 1) {
+        CoBorrow top[BATCH_POPULAR];
+        int found = CoBorrowTop(atoi(argv[0]), top, BATCH_POPULAR);
+        s = STATUS_OK;
+        fprintf(out, "OK");
+        for (int i = 0; i < found; i++) {
+            fprintf(out, "\t%d:%u", top[i].bookId, top[i].count);
+        }
+        fprintf(out, "\n");
+    } else if (!strcmp(command, "RESERVE") && argc == 2) {
+        Book* b = SearchBookByTitle(argv[1]);
+        int position;
+        s = batchClient(argv[0], &c);
+        if (s == STATUS_OK) {
+            s = b ? ReservationAdd(c, b, &position) : STATUS_NOT_FOUND;
+        }
+        if (s == STATUS_OK) {
+            fprintf(out, "OK\t%d\n", position);
+        }
+    } else if (!strcmp(command, "DUE") && argc == 1) {
+        int today = DeadlineToday();
+        int days = atoi(argv[0]);
+        s = days < 0 ? STATUS_INVALID : STATUS_OK;
+        if (s == STATUS_OK) {
+            fprintf(out, "OK\t%d\t%d\t%d\n", LoansOverdue(today, NULL, NULL), LoansDueBetween(today, today, NULL, NULL),
+                    LoansDueBetween(today + 1, today + days, NULL, NULL));
+        }
+    } else if (!strcmp(command, "SWEEP") && argc == 1) {
+        int swept = FineSweep(DeadlineToday(), atoi(argv[0]));
+        s = swept < 0 ? STATUS_NO_MEMORY : STATUS_OK;
+        if (s == STATUS_OK) {
+            fprintf(out, "OK\t%d\n", swept);
+        }
+    } else if (!strcmp(command, "SEARCH_CLIENT") && argc == 1) {
+        s = batchClient(argv[0], &c);
+        if (s == STATUS_OK) {
+            Loan* l = SearchLoanByClient(c->cpf);
+            LockStripes(LOCK_CLIENTS, StripeOf(c - clients), 0);
+            fprintf(out, "OK\t%s\t%s\t%d\t%d\n", c->cpf, StringGet(c->name), l ? l->id : -1, c->fineAmount);
+            UnlockStripes(LOCK_CLIENTS, StripeOf(c - clients));
+        }
+    } else if (!strcmp(command, "SEARCH_BOOK") && argc == 1) {
+        Book* b = SearchBookByTitle(argv[0]);
+        s = b ? STATUS_OK : STATUS_NOT_FOUND;
+        if (s == STATUS_OK) {
+            LockStripes(LOCK_BOOKS, StripeOf(b->id), 0);
+            fprintf(out, "OK\t%d\t%s\t%d\t%d\t%d\t%d\n", b->id, StringGet(b->title), b->authorId, b->genreId,
+                   b->stock, b->amount);
+            UnlockStripes(LOCK_BOOKS, StripeOf(b->id));
+        }
+    } else if (!strcmp(command, "STOCK") && argc == 1) {
+        BranchStock found[BRANCH_MAX];
+        int n = BranchesStock(argv[0], found);
+        s = n ? STATUS_OK : STATUS_NOT_FOUND;
+        if (s == STATUS_OK) {
+            fprintf(out, "OK");
+            for (int i = 0; i < n; i++) {
+                fprintf(out, "\t%s:%d/%d", BranchName(found[i].branch), found[i].stock, found[i].amount);
+            }
+            fprintf(out, "\n");
+        }
+    } else if (!strcmp(command, "REPORT") && argc == 0) {
+        CirculationTotals totals;
+        char today[11];
+        time_t now = time(NULL);
+        struct tm tm;
+        strftime(today, sizeof(today), "%Y-%m-%d", localtime_r(&now, &tm));
+        s = CirculationReport(today, &totals);
+        if (s == STATUS_OK) {
+            fprintf(out, "OK\t%d\t%d\t%d\t%d\t%d\t%d\t%d\n", totals.clients, totals.books, totals.copies,
+                    totals.inStock, totals.openLoans, totals.booksOnLoan, totals.overdueLoans);
+        }
+    }
+    SnapshotCommit();
+    UnlockTables(locks);
+    if (s != STATUS_OK) {
+        batchError(out, line, s);
+    }
+    return s;
+}
+
+/**
+ * @brief Splits a line into its command and its arguments, in place.
+ *
+ * @param args Set to the arguments, or NULL if the command has none.
+ * @return char* The command, or NULL for an empty line or a comment.
+ */
+char* batchParse(char* text, char** args) {
+    text[strcspn(text, "\r\n")] = '\0';
+    if (text[0] == '\0' || text[0] == '#') {
+        return NULL;
+    }
+    *args = strchr(text, ' ');
+    if (*args) {
+        *(*args)++ = '\0';
+    }
+    return text;
+}
+
+/**
+ * @brief Runs every command of a file and reports the throughput on stderr.
+ *
+ * @param path The command file, or "-" for the standard input.
+ * @return int The number of commands that failed, or -1 if the file cannot be opened.
+ */
+int RunBatch(const char* path) {
+    FILE* f = strcmp(path, "-") ? fopen(path, "r") : stdin;
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    char* text = NULL;
+    size_t size = 0;
+    int line = 0, commands = 0, failed = 0, loggedIn = 0, branch = BRANCH_MAIN;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while (getline(&text, &size, f) != -1) {
+        line++;
+        char* args;
+        char* command = batchParse(text, &args);
+        if (!command) {
+            continue;
+        }
+        commands++;
+        if (batchCommand(stdout, line, command, args, &loggedIn, &branch) != STATUS_OK) {
+            failed++;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr, "%d commands, %d failed, %.3f s, %.0f ops/s\n", commands, failed, seconds,
+            seconds > 0 ? commands / seconds : 0.0);
+    free(text);
+    if (f != stdin) {
+        fclose(f);
+    }
+    return failed;
+}
+
+#endif
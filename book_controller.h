@@ -1,46 +1,125 @@
 #ifndef BOOK_CONTROLLER_H
 #define BOOK_CONTROLLER_H
-#include "repository.h"
+#include "catalog_service.h"
+#include "co_borrow.h"
+#include "list_view.h"
 #include "genre_controller.h"
 #include "author_controller.h"
 
 /**
- * @brief Lists all the books in the system.
+ * @brief Books suggested under a book found by ID.
+ */
+#define ALSO_BORROWED 3
+
+/**
+ * @brief Barcodes listed per line by CopiesMenu.
+ */
+#define BARCODES_PER_LINE 6
+
+/**
+ * @brief Prints the ID, title, author, genre, stock and copies of a book.
  *
- * This function iterates through the list of books and prints the details
- * of each book that has a valid ID. For each book, it displays the ID,
- * title, author name, genre, and stock information. The function waits for
- * user input before clearing the screen.
+ * A missing author or genre is reported instead of printed.
  */
-void ListBooks() {
-    printf("Books:\n");
-    for (int i = 0; i < MAX_ENTITIES; i++) {
-        if (books[i].id != -1) {
-            printf("ID: %d, Title: %s\n", books[i].id, books[i].title);
-            Author *a = SearchAuthorById(books[i].authorId);
-            printf("Author: %s\n", a->name);
-            Genre *g = SearchGenreById(books[i].genreId);
-            printf("Genre: %s\n", g->genre);
-            printf("Stock: %d / %d\n", books[i].stock, books[i].amount);
-            printf("\n");
+void printBookDetails(Book* b, void* context) {
+    const BookView* v = BookViewOf(b);
+    printf("ID: %d\nTitle: %s\n", b->id, StringGet(b->title));
+    if (v->author != STRING_EMPTY) {
+        printf("Author: %s\n", StringGet(v->author));
+    } else {
+        printf("Author not found.\n");
+    }
+    if (v->genre != STRING_EMPTY) {
+        printf("Genre: %s\n", StringGet(v->genre));
+    } else {
+        printf("Genre not found.\n");
+    }
+    printf("Stock: %d / %d\n", b->stock, b->amount);
+    printf("Copies: %d lent, %d held, %d damaged\n", CopiesCount(b->id, COPY_LENT), CopiesCount(b->id, COPY_HELD),
+           CopiesCount(b->id, COPY_DAMAGED));
+}
+
+/**
+ * @brief Prints the books readers borrowed the most together with a book, if any.
+ */
+void printAlsoBorrowed(const Book* b) {
+    CoBorrow top[ALSO_BORROWED + 8];
+    int count = CoBorrowTop(b->id, top, ALSO_BORROWED + 8), shown = 0;
+    for (int i = 0; i < count && shown < ALSO_BORROWED; i++) {
+        Book* other = SearchBookById(top[i].bookId);
+        if (other) {
+            printf("%s%s (%u)", shown ? ", " : "Readers also borrowed: ", StringGet(other->title), top[i].count);
+            shown++;
         }
     }
-    printf("Type anything to continue...");
-    getch();
-    system("clear");
+    if (shown) {
+        printf("\n");
+    }
+}
+
+/**
+ * @brief Adds the book in a slot to a page of the book list.
+ */
+void listBook(int slot, ScreenText* text) {
+    Book* b = &books[slot];
+    const BookView* v = &bookViews[slot];
+    ScreenTextAdd(text, "ID: %d, Title: %s", b->id, StringGet(b->title));
+    ScreenTextAdd(text, "Author: %s", v->author != STRING_EMPTY ? StringGet(v->author) : "-");
+    ScreenTextAdd(text, "Genre: %s", v->genre != STRING_EMPTY ? StringGet(v->genre) : "-");
+    ScreenTextAdd(text, "Stock: %d / %d", b->stock, b->amount);
+    ScreenTextAdd(text, "");
+}
+
+/**
+ * @brief Prints one book found by an author search.
+ */
+void printAuthorBook(Book* b, void* context) {
+    printBookDetails(b, context);
+    printf("\n");
+}
+
+/**
+ * @brief Moves the book list to the book with an ID.
+ */
+int seekBook(Cursor* c, const char* id) {
+    Book* b = SearchBookById(atoi(id));
+    return b && CursorSeek(c, b->id);
+}
+
+/**
+ * @brief Reopens the book list in another order.
+ */
+int orderBooks(Cursor* c, int order, int pageSize) {
+    return BookCursor(c, (BookOrder) order, pageSize);
+}
+
+/**
+ * @brief Lists all the books in the system.
+ *
+ * This function shows the books one page at a time and lets the user jump to
+ * a book ID. For each book, it displays the ID, title, author name, genre, and
+ * stock information. Pressing s lists the books by title, by author or by stock
+ * instead. The screen is cleared when the user leaves the list.
+ */
+void ListBooks() {
+    static const char* const orders[] = {"ID", "title", "author", "stock"};
+    Cursor c;
+    BookCursor(&c, BOOK_BY_ID, 1);
+    ListView("Books", &c, 5, listBook, "ID", seekBook, orders, 4, orderBooks);
 }
 /**
  * @brief Displays a menu to search for a book by its ID and prints the book details.
  *
  * This function prompts the user to enter a book ID, searches for the book using the provided ID,
- * and displays the book's details including its title, author, genre, and stock information.
+ * and displays the book's details including its title, author, genre, and stock information,
+ * followed by the books borrowed the most together with it, from co_borrow.h.
  * If the book, author, or genre is not found, appropriate messages are displayed.
  *
  * @note This function assumes the existence of the following functions:
  *       - fillBuffer(int size): Fills a buffer with user input.
  *       - SearchBookById(int id): Searches for a book by its ID and returns a pointer to the Book structure.
- *       - SearchAuthorById(int id): Searches for an author by their ID and returns a pointer to the Author structure.
- *       - SearchGenreById(int id): Searches for a genre by its ID and returns a pointer to the Genre structure.
+ *       - BookViewOf(const Book* b): Returns the resolved author and genre names of the book.
+ *       - CoBorrowTop(int bookId, CoBorrow* top, int n): Finds the books borrowed the most with it.
  *
  * @note This function also assumes the existence of the following global variables:
  *       - buffer: A character array used to store user input.
@@ -60,20 +139,8 @@ void SearchBookByIdMenu() {
     if (b == NULL) {
         printf("Book not found.\n");
     } else {
-        Author* a = SearchAuthorById(b->authorId);
-        Genre* g = SearchGenreById(b->genreId);
-        printf("ID: %d\nTitle: %s\n", b->id, b->title);
-        if (a && a->id != -1) {
-            printf("Author: %s\n", a->name);
-        } else {
-            printf("Author not found.\n");
-        }
-        if (g && g->id != -1) {
-            printf("Genre: %s\n", g->genre);
-        } else {
-            printf("Genre not found.\n");
-        }
-        printf("Stock: %d / %d\n", b->stock, b->amount);
+        printBookDetails(b, NULL);
+        printAlsoBorrowed(b);
     }
 }
 
@@ -88,33 +155,36 @@ void SearchBookByIdMenu() {
  * @note This function relies on the following external functions:
  * - fillBuffer(size_t size): Fills a buffer with user input.
  * - SearchBookByTitle(const char* title): Searches for a book by its title.
- * - SearchAuthorById(int authorId): Searches for an author by their ID.
- * - SearchGenreById(int genreId): Searches for a genre by its ID.
+ * - BookViewOf(const Book* b): Returns the resolved author and genre names of the book.
  * 
  * @note The buffer used for storing the book title input is assumed to be a global
  * or external variable.
  */
 void SearchBookByTitleMenu() {
     printf("Enter the book title to search: ");
-    fillBuffer(40);
+    fillBuffer(TEXT_MAX);
     Book* b = SearchBookByTitle(buffer);
     if (b == NULL) {
         printf("Book not found.\n");
     } else {
-        Author* a = SearchAuthorById(b->authorId);
-        Genre* g = SearchGenreById(b->genreId);
-        printf("ID: %d\nTitle: %s\n", b->id, b->title);
-        if (a && a->id != -1) {
-            printf("Author: %s\n", a->name);
-        } else {
-            printf("Author not found.\n");
-        }
-        if (g && g->id != -1) {
-            printf("Genre: %s\n", g->genre);
-        } else {
-            printf("Genre not found.\n");
-        }
-        printf("Stock: %d / %d\n", b->stock, b->amount);
+        printBookDetails(b, NULL);
+    }
+}
+
+/**
+ * @brief Shows the copies every branch has of a title, found by BranchesStock.
+ */
+void SearchBookInBranchesMenu(void) {
+    BranchStock found[BRANCH_MAX];
+    printf("Enter the book title to search: ");
+    fillBuffer(TEXT_MAX);
+    int count = BranchesStock(buffer, found);
+    if (count == 0) {
+        printf("Book not found in any branch.\n");
+    }
+    for (int i = 0; i < count; i++) {
+        printf("%-20s ID %-6d %d of %d in stock\n", BranchName(found[i].branch), found[i].bookId, found[i].stock,
+               found[i].amount);
     }
 }
 
@@ -128,35 +198,21 @@ void SearchBookByTitleMenu() {
  * @details
  * - Prompts the user to enter an author name.
  * - Searches for the author using the `SearchAuthorByName` function.
- * - If the author is found, iterates through the list of books and displays
- *   details for each book written by the author.
+ * - If the author is found, walks the author's books with `BooksByAuthor` and
+ *   displays details for each of them.
  * - If the author is not found, displays an appropriate message.
- * - For each book, the genre is retrieved using the `SearchGenreById` function.
  * 
  * @see SearchAuthorByName
- * @see SearchGenreById
+ * @see BooksByAuthor
  */
 void SearchBookByAuthorMenu(void) {
     printf("Enter the author name to search: ");
-    fillBuffer(40);
+    fillBuffer(TEXT_MAX);
     Author* a = SearchAuthorByName(buffer);
     if (a == NULL) {
         printf("Author not found.\n");
     } else {
-        for (int i = 0; i < MAX_ENTITIES; i++) {
-            if (books[i].authorId == a->id && books[i].id != -1) {
-                Genre* g = SearchGenreById(books[i].genreId);
-                printf("ID: %d\nTitle: %s\n", books[i].id, books[i].title);
-                printf("Author: %s\n", a->name);
-                if (g && g->id != -1) {
-                    printf("Genre: %s\n", g->genre);
-                } else {
-                    printf("Genre not found.\n");
-                }
-                printf("Stock: %d / %d\n", books[i].stock, books[i].amount);
-                printf("\n");
-            }
-        }
+        BooksByAuthor(a->id, printAuthorBook, NULL);
     }
 }
 
@@ -170,10 +226,10 @@ void SearchBookByAuthorMenu(void) {
  */
 void SearchBookMenu() {
     int choice = 0;
-    printf("Search by:\n1. ID\n2. Title\n3. Author\n");
+    printf("Search by:\n1. ID\n2. Title\n3. Author\n4. Title in every branch\n");
     fillBuffer(1);
     sscanf(buffer, "%d", &choice);
-    system("clear");
+    ScreenClear();
 
     switch (choice) {
         case 1:
@@ -186,120 +242,90 @@ void SearchBookMenu() {
             SearchBookByAuthorMenu();
             break;
         }
+        case 4:
+            SearchBookInBranchesMenu();
+            break;
         default:
             printf("Invalid choice. Please try again.\n");
             break;
     }
     printf("Type anything to continue...");
     getch();
-    system("clear");
+    ScreenClear();
 }
 
 /**
  * @brief Adds a new book to the system.
  * 
- * This function prompts the user to enter the details of a new book, including the title, author ID, genre ID, and the number of copies. 
- * It performs various checks to ensure the validity of the entered data, such as checking for duplicate titles, valid author IDs, and valid genre IDs.
- * If any of the checks fail, the function will notify the user and return without adding the book.
+ * This function prompts the user to enter the details of a new book, including the title, author ID, genre ID, and the number of copies,
+ * and registers it with BookAdd. The title and author are checked as soon as they are entered so the user does not type the rest in vain;
+ * BookAdd checks everything again before anything is stored. If any of the checks fail, the function notifies the user and returns
+ * without adding the book.
  * 
  * The function follows these steps:
  * 1. Prompts the user to enter the book's title and checks if a book with the same title already exists.
- * 2. Displays the list of available authors and prompts the user to enter the author ID.
- * 3. Checks if the entered author ID is valid.
- * 4. Displays the list of available genres and prompts the user to enter the genre ID.
- * 5. Checks if the entered genre ID is valid.
- * 6. Prompts the user to enter the number of copies and sets the book's stock to this number.
- * 7. If all checks pass, the book is successfully registered.
+ * 2. Displays the list of available authors, prompts the user to enter the author ID and checks it.
+ * 3. Displays the list of available genres and prompts the user to enter the genre ID.
+ * 4. Prompts the user to enter the number of copies.
+ * 5. Registers the book, or reports why it could not be registered.
  * 
- * @note The function uses several helper functions such as `fillBuffer`, `SearchBookByTitle`, `SearchAuthorById`, and `SearchGenreById`.
- * @note The function uses global variables `buffer`, `authors`, `genres`, and constants like `MAX_ENTITIES`.
+ * @note The function uses several helper functions such as `fillBuffer`, `SearchBookByTitle`, `SearchAuthorById`, and `BookAdd`.
+ * @note The function uses the global variable `buffer`.
  * 
  * @return void
  */
-void AddBook () {
-    int k = 0;
+void AddBook(void) {
+    char title[TEXT_MAX + 1];
+    int authorId = -1, genreId = -1, amount = 0;
+
     printf("Enter the new book's title: ");
-    fillBuffer(40);
-    Book* b = SearchBookByTitle(buffer);
-    if(b){
+    fillBuffer(TEXT_MAX);
+    if (SearchBookByTitle(buffer)) {
         printf("A book with the same title already exists.\n");
         printf("Type anything to continue...");
         getch();
-        system("clear");
+        ScreenClear();
         return;
     }
-    strcpy(b->title, buffer);
+    strcpy(title, buffer);
 
     printf("Available authors:\n");
-    for (int i = 0; i < MAX_ENTITIES; i++) {
-        if (authors[i].id != -1) {
-            k++;
-            printf("ID: %d, Name: %s\n", authors[i].id, authors[i].name);
-        }
-    }
-    if(k == 0) {
-        b->id = -1;
-        printf("No authors available. Please add an author first.\n");
-        printf("Type anything to continue...");
-        getch();
-        system("clear");
-        return;
-    }
-
+    AuthorForEach(printAuthor, NULL);
     printf("Enter the new book's author ID: ");
     fillBuffer(20);
-    sscanf(buffer, "%d", &(b->authorId));
-    Author* a = SearchAuthorById(b->authorId);
+    sscanf(buffer, "%d", &authorId);
+    Author* a = SearchAuthorById(authorId);
     if (!a || a->id == -1) {
-        b->id = -1;
-        printf("Invalid author ID. Please try again.\n");
+        printf("Invalid author ID. Please add an author first if there is none.\n");
         printf("Type anything to continue...");
         getch();
-        system("clear");
+        ScreenClear();
         return;
     }
 
-    k = 0;
     printf("Available genres:\n");
-    for (int i = 0; i < MAX_ENTITIES; i++) {
-        if (genres[i].id != -1) {
-            k++;
-            printf("ID: %d, Genre: %s\n", genres[i].id, genres[i].genre);
-        }
-    }
-
-    if(k == 0) {
-        b->id =  -1;
-        printf("No genres available. Please add a genre first.\n");
-        printf("Type anything to continue...");
-        getch();
-        system("clear");
-        return;
-    }
-
+    GenreForEach(printGenre, NULL);
     printf("Enter the new book's genre ID: ");
     fillBuffer(20);
-    sscanf(buffer, "%d", &(b->genreId));
-    Genre* g = SearchGenreById(b->genreId);
-    if (!g || g->id == -1) {
-        b->id = -1;
-        printf("Invalid genre ID. Please try again.\n");
-        printf("Type anything to continue...");
-        getch();
-        system("clear");
-        return;
-    }
+    sscanf(buffer, "%d", &genreId);
 
     printf("Enter the number of copies: ");
     fillBuffer(20);
-    sscanf(buffer, "%d", &(b->amount));
-
-    b->stock = b->amount;
-
-    printf("Book successfully registered!!!\n");
+    sscanf(buffer, "%d", &amount);
+
+    Status s = BookAdd(title, authorId, genreId, amount, NULL);
+    if (s == STATUS_OK) {
+        printf("Book successfully registered!!!\n");
+    } else if (s == STATUS_NOT_FOUND) {
+        printf("Invalid genre ID. Please add a genre first if there is none.\n");
+    } else if (s == STATUS_INVALID) {
+        printf("Invalid number of copies.\n");
+    } else {
+        printf("Error: %s.\n", StatusText(s));
+    }
     printf("Type anything to continue...");
     getch();
-    system("clear");
+    ScreenClear();
 }
 
 /**
@@ -310,102 +336,57 @@ void AddBook () {
  * The user is then prompted to confirm if they want to edit the book.
  * If confirmed, the user is prompted to enter a new title, select a new author from the list of available authors,
  * and select a new genre from the list of available genres.
- * The function performs validation checks to ensure the new title does not already exist (unless it belongs to the same book),
+ * BookEdit then checks that the new title does not already exist (unless it belongs to the same book),
  * and that the selected author and genre IDs are valid.
- * If any validation fails, the function displays an error message and returns.
+ * If any validation fails, the function displays an error message and the book is left unchanged.
  * Upon successful update, a confirmation message is displayed.
  *
  * @param b Pointer to the Book structure to be edited.
  * @param a Pointer to the Author structure associated with the book.
  */
 void EditBook(Book* b, Author* a) {
-    system("clear");
-    printf("%s\n%s", b->title, a->name);
+    ScreenClear();
+    printf("%s\n%s", StringGet(b->title), a && a->id != -1 ? StringGet(a->name) : "-");
     printf("\n\nEdit selected book? y/n");
     char choice = getchar();
-    system("clear");
+    ScreenClear();
 
     if (choice == 'y' || choice == 'Y') {
+        char title[TEXT_MAX + 1];
+        int authorId = -1, genreId = -1;
+
         printf("Title: ");
-        fillBuffer(40);
-        Book* existingBook = SearchBookByTitle(buffer);
-        if (existingBook && existingBook->id != b->id) {
-            printf("A book with the same title already exists.\n");
-            printf("Type anything to continue...");
-            getch();
-            system("clear");
-            return;
-        }
-        strcpy(b->title, buffer);
+        fillBuffer(TEXT_MAX);
+        strcpy(title, buffer);
 
         printf("Available authors:\n");
-        for (int i = 0; i < MAX_ENTITIES; i++) {
-            if (authors[i].id != -1) {
-                printf("ID: %d, Name: %s\n", authors[i].id, authors[i].name);
-            }
-        }
+        AuthorForEach(printAuthor, NULL);
         printf("Authors Id: ");
         fillBuffer(20);
-        int authorId;
         sscanf(buffer, "%d", &authorId);
-        Author* newAuthor = SearchAuthorById(authorId);
-        if (!newAuthor || newAuthor->id == -1) {
-            printf("Invalid author ID. Please try again.\n");
-            printf("Type anything to continue...");
-            getch();
-            system("clear");
-            return;
-        }
-        b->authorId = authorId;
 
         printf("Available genres:\n");
-        for (int i = 0; i < MAX_ENTITIES; i++) {
-            if (genres[i].id != -1) {
-                printf("ID: %d, Genre: %s\n", genres[i].id, genres[i].genre);
-            }
-        }
+        GenreForEach(printGenre, NULL);
         printf("Genre: ");
         fillBuffer(20);
-        int genreId;
         sscanf(buffer, "%d", &genreId);
-        Genre* newGenre = SearchGenreById(genreId);
-        if (!newGenre || newGenre->id == -1) {
-            printf("Invalid genre ID. Please try again.\n");
-            printf("Type anything to continue...");
-            getch();
-            system("clear");
-            return;
-        }
-        b->genreId = genreId;
 
-        printf("Book details updated successfully.\n");
+        Status s = BookEdit(b, title, authorId, genreId);
+        if (s == STATUS_OK) {
+            printf("Book details updated successfully.\n");
+        } else if (s == STATUS_DUPLICATE) {
+            printf("A book with the same title already exists.\n");
+        } else if (s == STATUS_NOT_FOUND) {
+            printf("Invalid author or genre ID. Please try again.\n");
+        } else {
+            printf("Error: %s.\n", StatusText(s));
+        }
         printf("Type anything to continue...");
         getch();
-        system("clear");
+        ScreenClear();
     }
 }
 
-/**
- * @brief Checks if a book is currently on loan.
- *
- * This function iterates through the list of loans and checks if the given book ID
- * matches either book1Id or book2Id in any of the loan records. If a match is found
- * and the loan record is valid (id is not -1), the function returns 1 indicating
- * that the book is on loan. Otherwise, it returns 0.
- *
- * @param bookId The ID of the book to check.
- * @return int Returns 1 if the book is on loan, otherwise returns 0.
- */
-int IsBookOnLoan(int bookId) {
-    for (int i = 0; i < MAX_ENTITIES; i++) {
-        if ((loans[i].book1Id == bookId || loans[i].book2Id == bookId) && loans[i].id != -1) {
-            return 1; 
-        }
-    }
-    return 0;
-}
-
-
 /**
  * @brief Removes a book from the collection.
  *
@@ -413,82 +394,72 @@ int IsBookOnLoan(int bookId) {
  * If the book is currently on loan, it cannot be removed. The user is then asked
  * to confirm the removal and specify the quantity to remove. If the quantity to
  * remove is greater than or equal to the stock, the book is completely removed
- * from the collection. Otherwise, the specified quantity is deducted from the stock.
+ * from the collection. Otherwise, the specified quantity is deducted from the stock
+ * and from the number of copies the library owns.
  *
  * @note The function uses several helper functions:
  * - fillBuffer(int size): Fills a buffer with user input.
  * - IsBookOnLoan(int id): Checks if the book with the given ID is currently on loan.
- * - SearchAuthorById(int id): Searches for an author by their ID.
- * - SearchGenreById(int id): Searches for a genre by its ID.
+ * - BookRemoveCopies(Book* b, int n, int* bookRemoved): Removes the copies.
  *
- * @warning The function uses system calls like `system("clear")` and `getch()`, which
+ * @warning The function uses system calls like `ScreenClear()` and `getch()`, which
  * may not be portable across different operating systems.
  */
 void RemoveBook() {
-    Book v;
-    int id = 0;
-
-    strcpy(v.title, "\0");
+    int id = -1;
 
-    do {
-        printf("Enter the id of the book you want to remove (type \"exit\" to go back): \n");
-        fillBuffer(20);
-        if (!strcmp("EXIT", buffer)) {
-            system("clear");
-            return;
-        }
-        sscanf(buffer, "%d", &id);
+    printf("Enter the id of the book you want to remove (type \"exit\" to go back): \n");
+    fillBuffer(20);
+    if (!strcmp("EXIT", buffer)) {
+        ScreenClear();
+        return;
+    }
+    sscanf(buffer, "%d", &id);
 
-        for(int j = 0; j < MAX_ENTITIES; j++) {
-            if(books[j].id == id) {
-                if (IsBookOnLoan(id)) {
-                    printf("The book is currently on loan and cannot be removed.\n");
-                    printf("Type anything to continue...");
-                    getch();
-                    system("clear");
-                    return;
-                }
-                int n;
-                Author* a = SearchAuthorById(books[j].authorId);
-                Genre* g = SearchGenreById(books[j].genreId);
-                system("clear");
-                printf("ID: %d\nTitle: %s\n", books[j].id, books[j].title);
-                printf("Author: %s\n", a->name);
-                printf("Genre: %s\n", g->genre);
-                printf("Stock: %d / %d", books[j].stock, books[j].amount);
-                printf("\n\n");
-                printf("Enter the quantity of books you want to remove: ");
-                fillBuffer(20);
-                sscanf(buffer, "%d", &n);
-                printf("\n\nAre you sure you want to remove? (Y or N) ");
-                char x = getchar();
-
-                if(x == 'Y' || x == 'y') {
-                    if(n >= books[j].stock) {
-                       books[j].stock = 0;
-                       books[j].id = -1;
-                       printf("Book removed from the collection.\n");
-                       break;
-                    }
-                    books[j].stock -= n;
-                    printf("%d books were removed from the collection.\n", n);
-                    printf("Type anything to continue...");
-                    getch();
-                   break;
-                }
-                printf("Operation canceled.\n");
-                printf("Type anything to continue...");
-                getch();
-                system("clear");
-                break;
-            }
-        }
-        system("clear");
+    Book* b = SearchBookById(id);
+    if (!b) {
+        ScreenClear();
         printf("Book not found. Try again...\n");
         printf("Type anything to continue...");
         getch();
-        system("clear");
-    } while(!strcmp("EXIT\0", buffer));
+        ScreenClear();
+        return;
+    }
+    if (IsBookOnLoan(b->id)) {
+        printf("The book is currently on loan and cannot be removed.\n");
+        printf("Type anything to continue...");
+        getch();
+        ScreenClear();
+        return;
+    }
+    int n = 0;
+    ScreenClear();
+    printBookDetails(b, NULL);
+    printf("\n");
+    printf("Enter the quantity of books you want to remove: ");
+    fillBuffer(20);
+    sscanf(buffer, "%d", &n);
+    printf("\n\nAre you sure you want to remove? (Y or N) ");
+    char x = getchar();
+
+    if (x == 'Y' || x == 'y') {
+        int removed = 0;
+        Status s = BookRemoveCopies(b, n, &removed);
+        if (s == STATUS_ON_LOAN) {
+            printf("The book is currently on loan and cannot be removed.\n");
+        } else if (s != STATUS_OK) {
+            printf("Invalid quantity.\n");
+        } else if (removed) {
+            printf("Book removed from the collection.\n");
+        } else {
+            printf("%d books were removed from the collection.\n", n);
+        }
+    } else {
+        printf("Operation canceled.\n");
+    }
+    printf("Type anything to continue...");
+    getch();
+    ScreenClear();
 }
 
 /**
@@ -499,7 +470,7 @@ void RemoveBook() {
  * and allows the user to edit the book details. The screen is cleared after the operation.
  *
  * @note The function uses a buffer to read user input and compares it to the string "EXIT" to determine if the user wants to exit.
- *       It also uses the `system("clear")` command to clear the screen.
+ *       It also uses the `ScreenClear()` command to clear the screen.
  */
 void UpdateBook() {
     int id;
@@ -507,7 +478,7 @@ void UpdateBook() {
         printf("Edit\n\nBook ID (or exit to leave): ");
         fillBuffer(20);
         if (!strcmp(buffer, "EXIT")) {
-            system("clear");
+            ScreenClear();
             return;
         }
         sscanf(buffer, "%d", &id);
@@ -518,36 +489,97 @@ void UpdateBook() {
             printf("Book not found!\n");
             printf("Type anything to continue...");
             getch();
-            system("clear");
+            ScreenClear();
             continue;
         }
         Author* a = SearchAuthorById(b->authorId);
         EditBook(b, a);
-        system("clear");
+        ScreenClear();
         break;
     } while(!strcmp(buffer, "EXIT"));
 }
 
+/**
+ * @brief Prints a barcode, starting a new line every BARCODES_PER_LINE barcodes.
+ */
+void printBarcode(int copy, void* context) {
+    int* printed = context;
+    printf("%08d%s", copy, ++*printed % BARCODES_PER_LINE ? "  " : "\n");
+}
+
+/**
+ * @brief Prints the barcodes of the copies of a book in a state, if any.
+ */
+void printCopies(int bookId, CopyState state, const char* heading) {
+    int printed = 0;
+    if (!CopiesCount(bookId, state)) {
+        return;
+    }
+    printf("%s:\n", heading);
+    CopiesForEach(bookId, state, printBarcode, &printed);
+    printf(printed % BARCODES_PER_LINE ? "\n\n" : "\n");
+}
+
+/**
+ * @brief Lists the copies of a book by barcode, then marks a copy on the shelf as damaged or
+ *        a damaged one as repaired.
+ */
+void CopiesMenu() {
+    int id = -1, barcode = -1;
+    printf("Enter the id of the book: ");
+    fillBuffer(20);
+    sscanf(buffer, "%d", &id);
+    Book* b = SearchBookById(id);
+    ScreenClear();
+    if (!b) {
+        printf("Book not found.\n");
+    } else {
+        printBookDetails(b, NULL);
+        printf("\n");
+        printCopies(b->id, COPY_ON_SHELF, "On the shelf");
+        printCopies(b->id, COPY_LENT, "Lent");
+        printCopies(b->id, COPY_HELD, "Held for reservations");
+        printCopies(b->id, COPY_DAMAGED, "Damaged");
+        printf("Barcode to mark damaged or repaired [Empty to leave]: ");
+        fillBuffer(20);
+        if (buffer[0] && sscanf(buffer, "%d", &barcode) == 1 && SearchCopyByBarcode(barcode) &&
+            copies[barcode].bookId == b->id) {
+            int damaged = copies[barcode].state == COPY_DAMAGED;
+            Status s = damaged ? CopyRepair(barcode) : CopyDamage(barcode);
+            if (s == STATUS_OK) {
+                printf("Copy %08d %s.\n", barcode, damaged ? "back on the shelf" : "marked damaged");
+            } else {
+                printf("Only copies on the shelf can be marked damaged.\n");
+            }
+        } else if (buffer[0]) {
+            printf("The book has no copy with that barcode.\n");
+        }
+    }
+    printf("Type anything to continue...");
+    getch();
+    ScreenClear();
+}
+
 /**
  * @brief Displays the book edit menu and handles user input for editing options.
  *
  * This function presents a menu to the user with options to remove a book, update a book,
- * or go back to the previous menu. It reads the user's choice, clears the screen, and
+ * list and mark its copies, or go back to the previous menu. It reads the user's choice, clears the screen, and
  * executes the corresponding action based on the user's input.
  *
  * @note The function uses `getchar` to read user input and `sscanf` to parse the input into an integer.
- *       It also uses `system("clear")` to clear the console screen.
+ *       It also uses `ScreenClear()` to clear the console screen.
  *
  * @warning The function assumes that `RemoveBook`, `UpdateBook`, and `getch` are defined elsewhere in the codebase.
  *          It also assumes that `buffer` is a valid character array with sufficient size.
  */
 void BookEditMenu() {
     int choice;
-    printf("Edit\n\n1. Remove\n2. Update\n3. Back\n");
+    printf("Edit\n\n1. Remove\n2. Update\n3. Copies\n4. Back\n");
     buffer[0] = getchar();
     buffer[1] = '\0';
     sscanf(buffer, "%d",&choice);
-    system("clear");
+    ScreenClear();
     switch(choice) {
         case 1:
             RemoveBook();
@@ -556,13 +588,16 @@ void BookEditMenu() {
             UpdateBook();
             break;
         case 3:
-            system("clear");
+            CopiesMenu();
+            break;
+        case 4:
+            ScreenClear();
             break;
         default:
             printf("Invalid choice. Please try again.\n");
             printf("Type anything to continue...");
             getch();
-            system("clear");
+            ScreenClear();
             break;
     }
 }
@@ -588,7 +623,7 @@ void BookMenu() {
         printf("Book\n\n1. List\n2. Genres\n3. Authors\n4. Search\n5. Add\n6. Edit\n7. Back\n");
         fillBuffer(1);
         sscanf(buffer, "%d", &choice);
-        system("clear");
+        ScreenClear();
         switch(choice) {
             case 1:
                 ListBooks();
@@ -603,15 +638,7 @@ void BookMenu() {
                 SearchBookMenu();
             break;
             case 5:
-                Book* b = getEmptyBook();
-                if (!b) {
-                    printf("Error creating book.\n");
-                    printf("Type anything to continue...");
-                    getch();
-                    system("clear");
-                    break;
-                }
-                AddBook(b);
+                AddBook();
                 break;
             case 6:
                 BookEditMenu();
@@ -622,9 +649,10 @@ void BookMenu() {
                 printf("Invalid choice. Please try again.\n");
             printf("Type anything to continue...");
             getch();
-            system("clear");
+            ScreenClear();
             break;
         }
+        SnapshotCommit();
     } while(choice != 7);
 }
 #endif //BOOK_CONTROLLER_H
@@ -0,0 +1,71 @@
+#ifndef BOOK_VIEW_H
+#define BOOK_VIEW_H
+
+#include "models.h"
+#include "repository.h"
+
+/**
+ * @file book_view.h
+ * @brief Keeps `bookViews` in step with the books, authors and genres.
+ *
+ * A book's row is resolved when the book is added or edited. Renaming an author or a genre
+ * rewrites the rows of its books only, and stops once its reference count is reached.
+ */
+
+/**
+ * @brief Resolves the author and genre names of a book.
+ */
+void RefreshBookView(const Book* b) {
+    Author* a = SearchAuthorById(b->authorId);
+    Genre* g = SearchGenreById(b->genreId);
+    bookViews[b->id].author = a ? a->name : STRING_EMPTY;
+    bookViews[b->id].genre = g ? g->genre : STRING_EMPTY;
+}
+
+/**
+ * @brief Copies the new name of an author into the rows of its books.
+ */
+void RenameAuthorInBookViews(const Author* a) {
+    int left = authorRefs[a->id];
+    for (int i = SlotSetNext(&booksLive, 0, booksCapacity); i != -1 && left > 0;
+         i = SlotSetNext(&booksLive, i + 1, booksCapacity)) {
+        if (books[i].authorId == a->id) {
+            bookViews[i].author = a->name;
+            left--;
+        }
+    }
+}
+
+/**
+ * @brief Copies the new name of a genre into the rows of its books.
+ */
+void RenameGenreInBookViews(const Genre* g) {
+    int left = genreRefs[g->id];
+    for (int i = SlotSetNext(&booksLive, 0, booksCapacity); i != -1 && left > 0;
+         i = SlotSetNext(&booksLive, i + 1, booksCapacity)) {
+        if (books[i].genreId == g->id) {
+            bookViews[i].genre = g->genre;
+            left--;
+        }
+    }
+}
+
+/**
+ * @brief Resolves the rows of every book.
+ *
+ * Called once after the data files are imported.
+ */
+void RebuildBookViews(void) {
+    for (int i = SlotSetNext(&booksLive, 0, booksCapacity); i != -1; i = SlotSetNext(&booksLive, i + 1, booksCapacity)) {
+        RefreshBookView(&books[i]);
+    }
+}
+
+/**
+ * @brief The resolved author and genre names of a book.
+ */
+const BookView* BookViewOf(const Book* b) {
+    return &bookViews[b->id];
+}
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef BOOKBYTE_H
+#define BOOKBYTE_H
+
+/**
+ * @file bookbyte.h
+ * @brief The library core, without any terminal input or output.
+ *
+ * Every operation returns a Status and lists are walked with visitor callbacks, so the
+ * core can be driven by the terminal UI, by tests or by benchmarks alike.
+ */
+#include "status.h"
+#include "table_locks.h"
+#include "models.h"
+#include "string_heap.h"
+#include "repository.h"
+#include "branches.h"
+#include "copies.h"
+#include "address_index.h"
+#include "reference_counts.h"
+#include "book_view.h"
+#include "snapshot.h"
+#include "fine_ledger.h"
+#include "loan_history.h"
+#include "transaction.h"
+#include "reservations.h"
+#include "sorted_view.h"
+#include "cursor.h"
+#include "client_service.h"
+#include "catalog_service.h"
+#include "loan_service.h"
+#include "fine_sweep.h"
+#include "circulation_stats.h"
+#include "co_borrow.h"
+
+/**
+ * @brief Sets up an empty library: the string heap, the tables, their locks, the address index,
+ *        the fine ledger, the accrued fines and the heaps of the circulation statistics.
+ *
+ * Must be called once before any other operation. Data files, if any, are loaded afterwards.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int BookByteInit(void) {
+    return InitStringHeap() && InitRepository() && InitTableLocks() && addressIndexAllocate(0) &&
+           InitLedger() && InitFineSweep() && InitCirculationStats();
+}
+
+#endif
@@ -0,0 +1,247 @@
+#ifndef BRANCHES_H
+#define BRANCHES_H
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "models.h"
+#include "status.h"
+#include "string_heap.h"
+#include "repository.h"
+
+/**
+ * @file branches.h
+ * @brief The library branches sharing the tables, each with its own partition of them.
+ *
+ * Every client, book and loan belongs to one branch, given by `rowBranches`, and every
+ * branch has its own occupied-slot set of each table in `branchRows`. A desk works at one
+ * branch at a time, `branchCurrent`: what it adds goes to that branch, and it finds books
+ * by title there, so several branches may stock the same title. CPFs are unique across the
+ * branches, and clients may borrow at any of them.
+ *
+ * Queries over every branch fan out, one thread per branch walking its own partition.
+ *
+ * On disk, after the names of the branches, every branch but BRANCH_MAIN has a segment per
+ * table listing its slots. Slots listed nowhere belong to BRANCH_MAIN.
+ *
+ * Adding a branch takes the clients, books and loans tables exclusively; fanning out takes
+ * the tables it reads shared, the threads it starts reading under the caller's locks.
+ */
+
+/**
+ * @struct BranchSegment
+ * @brief The header of the slots of a table in a branch on disk.
+ */
+typedef struct {
+    int32_t branch;
+    int32_t table;
+    int32_t count;
+} BranchSegment;
+
+/**
+ * @struct BranchStock
+ * @brief The copies a branch has of a title, as found by BranchesStock.
+ */
+typedef struct {
+    int branch;
+    int bookId;
+    int stock;
+    int amount;
+} BranchStock;
+
+/**
+ * @struct BranchStockJob
+ * @brief The title one thread of BranchesStock looks for in its branch, and what it found.
+ */
+typedef struct {
+    StringId title;
+    BranchStock found;
+} BranchStockJob;
+
+/**
+ * @brief The names of the branches, BRANCH_MAIN being "MAIN" until renamed on disk.
+ */
+StringId branchNames[BRANCH_MAX];
+
+/**
+ * @brief The name of a branch.
+ */
+const char* BranchName(int branch) {
+    return branch == BRANCH_MAIN && branchNames[branch] == STRING_EMPTY ? "MAIN" : StringGet(branchNames[branch]);
+}
+
+/**
+ * @brief Finds a branch by name.
+ *
+ * @return int The branch, or -1 if there is none with that name.
+ */
+int BranchFind(const char* name) {
+    for (int b = 0; b < branchCount; b++) {
+        if (!strcmp(BranchName(b), name)) {
+            return b;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Reserves the partition of a new branch, empty and sized like the tables, its arenas
+ *        named after the branch number for the storage statistics.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int branchPartitionInit(int branch) {
+    static const char* tables[] = {"clients", "books", "loans"};
+    static char names[BRANCH_MAX][ROW_LOAN_ITEMS][24];
+    int capacities[] = {clientsCapacity, booksCapacity, loansCapacity};
+    for (int t = 0; t < ROW_LOAN_ITEMS; t++) {
+        snprintf(names[branch][t], sizeof(names[branch][t]), "branch %d %s", branch, tables[t]);
+        if (!SlotSetInit(&branchRows[branch][t], names[branch][t]) || !SlotSetResize(&branchRows[branch][t], capacities[t])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Adds a branch.
+ *
+ * @param out Receives the new branch. May be NULL.
+ * @return Status STATUS_OK, STATUS_INVALID for an empty name, STATUS_DUPLICATE if a branch has
+ *         that name, or STATUS_NO_MEMORY, also when there are BRANCH_MAX branches already.
+ */
+Status BranchAdd(const char* name, int* out) {
+    if (!name[0]) {
+        return STATUS_INVALID;
+    }
+    if (BranchFind(name) != -1) {
+        return STATUS_DUPLICATE;
+    }
+    if (branchCount == BRANCH_MAX || !branchPartitionInit(branchCount)) {
+        return STATUS_NO_MEMORY;
+    }
+    StringId id = StringIntern(name);
+    if (id == STRING_NONE) {
+        return STATUS_NO_MEMORY;
+    }
+    branchNames[branchCount] = id;
+    if (out) {
+        *out = branchCount;
+    }
+    branchCount++;
+    return STATUS_OK;
+}
+
+/**
+ * @brief Looks for a title in the books of one branch, on its own thread.
+ */
+void* branchStockThread(void* arg) {
+    BranchStockJob* job = arg;
+    const SlotSet* partition = &branchRows[job->found.branch][ROW_BOOKS];
+    job->found.bookId = -1;
+    for (int i = SlotSetNext(partition, 0, booksCapacity); i != -1; i = SlotSetNext(partition, i + 1, booksCapacity)) {
+        if (books[i].title == job->title && books[i].id != -1) {
+            job->found = (BranchStock) {job->found.branch, i, books[i].stock, books[i].amount};
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Finds the copies every branch has of a title, searching the branches in parallel.
+ *
+ * @param found Receives one entry per branch holding the title, by branch. Room for
+ *        BRANCH_MAX entries.
+ * @return int The number of branches holding the title.
+ */
+int BranchesStock(const char* title, BranchStock* found) {
+    StringId id = StringFind(title);
+    if (id == STRING_NONE) {
+        return 0;
+    }
+    BranchStockJob jobs[BRANCH_MAX];
+    pthread_t workers[BRANCH_MAX];
+    int started[BRANCH_MAX];
+    for (int b = 0; b < branchCount; b++) {
+        jobs[b].title = id;
+        jobs[b].found.branch = b;
+        started[b] = b > 0 && !pthread_create(&workers[b], NULL, branchStockThread, &jobs[b]);
+    }
+    branchStockThread(&jobs[0]);
+    int count = 0;
+    for (int b = 0; b < branchCount; b++) {
+        if (started[b]) {
+            pthread_join(workers[b], NULL);
+        } else if (b > 0) {
+            branchStockThread(&jobs[b]);
+        }
+        if (jobs[b].found.bookId != -1) {
+            found[count++] = jobs[b].found;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Reads the branches written by SaveBranches, before RebuildLiveSlots sorts the slots
+ *        into the partitions.
+ *
+ * Slots beyond their table are skipped.
+ *
+ * @param f The file to read from, past its magic number.
+ */
+void LoadBranches(FILE* f) {
+    int32_t count;
+    if (fread(&count, sizeof(int32_t), 1, f) != 1 || count < 1 || count > BRANCH_MAX) {
+        return;
+    }
+    for (int b = 0; b < count; b++) {
+        StringId name;
+        if (fread(&name, sizeof(StringId), 1, f) != 1 || (b > 0 && !branchPartitionInit(b))) {
+            return;
+        }
+        branchNames[b] = name;
+        branchCount = b + 1;
+    }
+    BranchSegment segment;
+    int capacities[] = {clientsCapacity, booksCapacity, loansCapacity};
+    while (fread(&segment, sizeof(BranchSegment), 1, f) == 1) {
+        for (int i = 0; i < segment.count; i++) {
+            int32_t slot;
+            if (fread(&slot, sizeof(int32_t), 1, f) != 1) {
+                return;
+            }
+            if (segment.branch >= 0 && segment.branch < branchCount && segment.table >= 0 &&
+                segment.table < ROW_LOAN_ITEMS && slot >= 0 && slot < capacities[segment.table]) {
+                rowBranches[segment.table][slot] = segment.branch;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Writes the names of the branches, then the slots of every table in every branch
+ *        but BRANCH_MAIN.
+ *
+ * @param f The file to write to, past its magic number.
+ */
+void SaveBranches(FILE* f) {
+    int32_t count = branchCount;
+    fwrite(&count, sizeof(int32_t), 1, f);
+    fwrite(branchNames, sizeof(StringId), branchCount, f);
+    int capacities[] = {clientsCapacity, booksCapacity, loansCapacity};
+    for (int b = BRANCH_MAIN + 1; b < branchCount; b++) {
+        for (int t = 0; t < ROW_LOAN_ITEMS; t++) {
+            const SlotSet* partition = &branchRows[b][t];
+            BranchSegment segment = {b, t, partition->count};
+            fwrite(&segment, sizeof(BranchSegment), 1, f);
+            for (int32_t i = SlotSetNext(partition, 0, capacities[t]); i != -1; i = SlotSetNext(partition, i + 1, capacities[t])) {
+                fwrite(&i, sizeof(int32_t), 1, f);
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,471 @@
+#ifndef CATALOG_SERVICE_H
+#define CATALOG_SERVICE_H
+#include <stdatomic.h>
+
+#include "models.h"
+#include "status.h"
+#include "repository.h"
+#include "copies.h"
+#include "reference_counts.h"
+#include "book_view.h"
+#include "reservations.h"
+#include "cursor.h"
+
+/**
+ * @brief Called once per book by BookForEach and BooksByAuthor.
+ */
+typedef void (*BookVisitor)(Book* b, void* context);
+
+/**
+ * @brief Orders a book listing can be walked in.
+ */
+typedef enum {
+    BOOK_BY_ID,
+    BOOK_BY_TITLE,
+    BOOK_BY_AUTHOR,
+    BOOK_BY_STOCK
+} BookOrder;
+
+/**
+ * @brief Called once per author by AuthorForEach.
+ */
+typedef void (*AuthorVisitor)(Author* a, void* context);
+
+/**
+ * @brief Called once per genre by GenreForEach.
+ */
+typedef void (*GenreVisitor)(Genre* g, void* context);
+
+/**
+ * @brief Looks a genre up by its name.
+ *
+ * @return Genre* The genre, or NULL if there is none.
+ */
+Genre* SearchGenreByName(const char* name) {
+    StringId id = StringFind(name);
+    for (int i = 0; id != STRING_NONE && i < genresCapacity; i++) {
+        if (genres[i].id != -1 && genres[i].genre == id) {
+            return &genres[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Registers a new author.
+ *
+ * @param out Receives the new author on success. May be NULL.
+ * @return Status STATUS_OK, STATUS_DUPLICATE if the name is taken, or STATUS_NO_MEMORY.
+ */
+Status AuthorAdd(const char* name, Author** out) {
+    if (SearchAuthorByName(name)) {
+        return STATUS_DUPLICATE;
+    }
+    StringId id = StringIntern(name);
+    if (id == STRING_NONE) {
+        return STATUS_NO_MEMORY;
+    }
+    Author* a = getEmptyAuthor();
+    if (!a) {
+        return STATUS_NO_MEMORY;
+    }
+    a->name = id;
+    if (out) {
+        *out = a;
+    }
+    return STATUS_OK;
+}
+
+/**
+ * @brief Renames an author.
+ *
+ * @return Status STATUS_OK, STATUS_NOT_FOUND, STATUS_DUPLICATE if another author has the name,
+ *         or STATUS_NO_MEMORY.
+ */
+Status AuthorRename(int id, const char* name) {
+    Author* a = SearchAuthorById(id);
+    if (!a || a->id == -1) {
+        return STATUS_NOT_FOUND;
+    }
+    Author* existing = SearchAuthorByName(name);
+    if (existing && existing != a) {
+        return STATUS_DUPLICATE;
+    }
+    StringId interned = StringIntern(name);
+    if (interned == STRING_NONE) {
+        return STATUS_NO_MEMORY;
+    }
+    a->name = interned;
+    RenameAuthorInBookViews(a);
+    authorsVersion++;
+    return STATUS_OK;
+}
+
+/**
+ * @brief Removes an author that has no books.
+ *
+ * @return Status STATUS_OK, STATUS_NOT_FOUND, or STATUS_IN_USE if books from the author remain.
+ */
+Status AuthorRemove(int id) {
+    Author* a = SearchAuthorById(id);
+    if (!a || a->id == -1) {
+        return STATUS_NOT_FOUND;
+    }
+    if (authorRefs[a->id] > 0) {
+        return STATUS_IN_USE;
+    }
+    initEmptyAuthor(a);
+    return STATUS_OK;
+}
+
+/**
+ * @brief Calls `visit` for every author, in ID order.
+ */
+void AuthorForEach(AuthorVisitor visit, void* context) {
+    for (int i = 0; i < authorsCapacity; i++) {
+        if (authors[i].id != -1) {
+            visit(&authors[i], context);
+        }
+    }
+}
+
+/**
+ * @brief Registers a new genre.
+ *
+ * @param out Receives the new genre on success. May be NULL.
+ * @return Status STATUS_OK, STATUS_DUPLICATE if the name is taken, or STATUS_NO_MEMORY.
+ */
+Status GenreAdd(const char* name, Genre** out) {
+    if (SearchGenreByName(name)) {
+        return STATUS_DUPLICATE;
+    }
+    StringId id = StringIntern(name);
+    if (id == STRING_NONE) {
+        return STATUS_NO_MEMORY;
+    }
+    Genre* g = getEmptyGenre();
+    if (!g) {
+        return STATUS_NO_MEMORY;
+    }
+    g->genre = id;
+    if (out) {
+        *out = g;
+    }
+    return STATUS_OK;
+}
+
+/**
+ * @brief Renames a genre.
+ *
+ * @return Status STATUS_OK, STATUS_NOT_FOUND, STATUS_DUPLICATE if another genre has the name,
+ *         or STATUS_NO_MEMORY.
+ */
+Status GenreRename(int id, const char* name) {
+    Genre* g = SearchGenreById(id);
+    if (!g || g->id == -1) {
+        return STATUS_NOT_FOUND;
+    }
+    Genre* existing = SearchGenreByName(name);
+    if (existing && existing != g) {
+        return STATUS_DUPLICATE;
+    }
+    StringId interned = StringIntern(name);
+    if (interned == STRING_NONE) {
+        return STATUS_NO_MEMORY;
+    }
+    g->genre = interned;
+    RenameGenreInBookViews(g);
+    return STATUS_OK;
+}
+
+/**
+ * @brief Removes a genre that has no books.
+ *
+ * @return Status STATUS_OK, STATUS_NOT_FOUND, or STATUS_IN_USE if books of the genre remain.
+ */
+Status GenreRemove(int id) {
+    Genre* g = SearchGenreById(id);
+    if (!g || g->id == -1) {
+        return STATUS_NOT_FOUND;
+    }
+    if (genreRefs[g->id] > 0) {
+        return STATUS_IN_USE;
+    }
+    initEmptyGenre(g);
+    return STATUS_OK;
+}
+
+/**
+ * @brief Calls `visit` for every genre, in ID order.
+ */
+void GenreForEach(GenreVisitor visit, void* context) {
+    for (int i = 0; i < genresCapacity; i++) {
+        if (genres[i].id != -1) {
+            visit(&genres[i], context);
+        }
+    }
+}
+
+/**
+ * @brief Checks the author and genre of a book.
+ *
+ * @return Status STATUS_OK, or STATUS_NOT_FOUND if either does not exist.
+ */
+Status checkBookLinks(int authorId, int genreId) {
+    Author* a = SearchAuthorById(authorId);
+    Genre* g = SearchGenreById(genreId);
+    if (!a || a->id == -1 || !g || g->id == -1) {
+        return STATUS_NOT_FOUND;
+    }
+    return STATUS_OK;
+}
+
+/**
+ * @brief Registers a new book with all of its copies in stock, each with a new barcode.
+ *
+ * @param out Receives the new book on success. May be NULL.
+ * @return Status STATUS_OK, STATUS_DUPLICATE if the title is taken, STATUS_NOT_FOUND for an
+ *         unknown author or genre, STATUS_INVALID for a negative amount, or STATUS_NO_MEMORY.
+ */
+Status BookAdd(const char* title, int authorId, int genreId, int amount, Book** out) {
+    if (SearchBookByTitle(title)) {
+        return STATUS_DUPLICATE;
+    }
+    Status s = checkBookLinks(authorId, genreId);
+    if (s != STATUS_OK) {
+        return s;
+    }
+    if (amount < 0) {
+        return STATUS_INVALID;
+    }
+    StringId id = StringIntern(title);
+    if (id == STRING_NONE) {
+        return STATUS_NO_MEMORY;
+    }
+    Book* b = getEmptyBook();
+    if (!b) {
+        return STATUS_NO_MEMORY;
+    }
+    b->title = id;
+    b->authorId = authorId;
+    b->genreId = genreId;
+    if (!CopiesIssue(b->id, amount)) {
+        initEmptyBook(b);
+        return STATUS_NO_MEMORY;
+    }
+    b->amount = amount;
+    b->stock = amount;
+    LinkBook(b);
+    RefreshBookView(b);
+    if (out) {
+        *out = b;
+    }
+    return STATUS_OK;
+}
+
+/**
+ * @brief Changes the title, author and genre of a book.
+ *
+ * Nothing is changed unless every new value is valid.
+ *
+ * @return Status STATUS_OK, STATUS_DUPLICATE if another book has the title, STATUS_NOT_FOUND for
+ *         an unknown author or genre, or STATUS_NO_MEMORY.
+ */
+Status BookEdit(Book* b, const char* title, int authorId, int genreId) {
+    Book* existing = SearchBookByTitle(title);
+    if (existing && existing != b) {
+        return STATUS_DUPLICATE;
+    }
+    Status s = checkBookLinks(authorId, genreId);
+    if (s != STATUS_OK) {
+        return s;
+    }
+    StringId id = StringIntern(title);
+    if (id == STRING_NONE) {
+        return STATUS_NO_MEMORY;
+    }
+    UnlinkBook(b);
+    b->title = id;
+    b->authorId = authorId;
+    b->genreId = genreId;
+    LinkBook(b);
+    RefreshBookView(b);
+    RowChanged(ROW_BOOKS, b->id);
+    booksVersion++;
+    return STATUS_OK;
+}
+
+/**
+ * @brief Removes copies of a book from the collection, or the whole book.
+ *
+ * @param n The number of copies to remove, taken off the shelf and retired. Removing at least
+ *        the whole stock removes the book and retires its damaged copies too.
+ * @param bookRemoved Set to 1 if the book itself was removed, otherwise 0. May be NULL.
+ * @return Status STATUS_OK, STATUS_ON_LOAN if copies of the book are lent, STATUS_IN_USE if the
+ *         book is reserved, or STATUS_INVALID for a negative count.
+ */
+Status BookRemoveCopies(Book* b, int n, int* bookRemoved) {
+    if (n < 0) {
+        return STATUS_INVALID;
+    }
+    if (IsBookOnLoan(b->id)) {
+        return STATUS_ON_LOAN;
+    }
+    if (BookHasReservations(b->id)) {
+        return STATUS_IN_USE;
+    }
+    int removed = n >= b->stock;
+    CopiesRetire(b->id, removed ? -1 : n);
+    if (removed) {
+        UnlinkBook(b);
+        initEmptyBook(b);
+    } else {
+        b->stock -= n;
+        b->amount -= n;
+        RowChanged(ROW_BOOKS, b->id);
+        booksVersion++;
+    }
+    if (bookRemoved) {
+        *bookRemoved = removed;
+    }
+    return STATUS_OK;
+}
+
+/**
+ * @brief Takes one copy of a book off the shelf and lends it, if one is left.
+ *
+ * The copy is claimed with CopyTake, so desks lending the same title at once never lend
+ * the same copy and need no lock on the book. The stock follows. The caller logs the change
+ * with StockChanged.
+ *
+ * @return int The barcode of the copy taken, or -1 if none is on the shelf.
+ */
+int BookTakeCopy(Book* b) {
+    int copy = CopyTake(b->id, COPY_ON_SHELF, COPY_LENT);
+    if (copy != -1) {
+        atomic_fetch_sub(&b->stock, 1);
+    }
+    return copy;
+}
+
+/**
+ * @brief Puts a copy of a book the caller holds back on the shelf. The caller logs the change
+ *        with StockChanged.
+ *
+ * @param copy The barcode of the copy, or -1 for a copy lent before copies had barcodes.
+ */
+void BookReturnCopy(Book* b, int copy) {
+    if (copy != -1) {
+        CopyMove(copy, COPY_ON_SHELF);
+    }
+    atomic_fetch_add(&b->stock, 1);
+}
+
+/**
+ * @brief Calls `visit` for every book, in ID order.
+ */
+void BookForEach(BookVisitor visit, void* context) {
+    for (int i = SlotSetNext(&booksLive, 0, booksCapacity); i != -1; i = SlotSetNext(&booksLive, i + 1, booksCapacity)) {
+        visit(&books[i], context);
+    }
+}
+
+/**
+ * @brief Calls `visit` for every book written by an author, in ID order.
+ *
+ * The walk stops once the author's reference count of books has been visited.
+ *
+ * @return int The number of books visited.
+ */
+int BooksByAuthor(int authorId, BookVisitor visit, void* context) {
+    int found = 0;
+    int left = authorId >= 0 && authorId < authorsCapacity ? authorRefs[authorId] : 0;
+    for (int i = SlotSetNext(&booksLive, 0, booksCapacity); i != -1 && found < left;
+         i = SlotSetNext(&booksLive, i + 1, booksCapacity)) {
+        if (books[i].authorId == authorId) {
+            if (visit) {
+                visit(&books[i], context);
+            }
+            found++;
+        }
+    }
+    return found;
+}
+
+uint32_t bookTitleKey(int slot) {
+    return SortKeyOfString(StringGet(books[slot].title));
+}
+
+int bookTitleTie(int a, int b) {
+    return strcmp(StringGet(books[a].title), StringGet(books[b].title));
+}
+
+/**
+ * @brief Name of the author of the book in a slot, or "" if the author is missing.
+ */
+const char* bookAuthorName(int slot) {
+    return StringGet(bookViews[slot].author);
+}
+
+uint32_t bookAuthorKey(int slot) {
+    return SortKeyOfString(bookAuthorName(slot));
+}
+
+/**
+ * @brief Orders books of the same author by title.
+ */
+int bookAuthorTie(int a, int b) {
+    int order = strcmp(bookAuthorName(a), bookAuthorName(b));
+    return order ? order : bookTitleTie(a, b);
+}
+
+/**
+ * @brief Packs the stock so that negative values, if any, still come first.
+ */
+uint32_t bookStockKey(int slot) {
+    return (uint32_t) books[slot].stock ^ 0x80000000u;
+}
+
+unsigned booksVersionOf(void) {
+    return booksVersion;
+}
+
+/**
+ * @brief The version of the books and of the authors they are sorted by.
+ */
+unsigned booksAndAuthorsVersionOf(void) {
+    return booksVersion + authorsVersion;
+}
+
+/**
+ * @brief The books sorted by title, by author and by stock, sorted again when they change.
+ */
+SortedView booksByTitle = {&booksLive, &booksCapacity, bookTitleKey, bookTitleTie, booksVersionOf,
+                           PTHREAD_MUTEX_INITIALIZER};
+SortedView booksByAuthor = {&booksLive, &booksCapacity, bookAuthorKey, bookAuthorTie, booksAndAuthorsVersionOf,
+                            PTHREAD_MUTEX_INITIALIZER};
+SortedView booksByStock = {&booksLive, &booksCapacity, bookStockKey, NULL, booksVersionOf,
+                           PTHREAD_MUTEX_INITIALIZER};
+
+/**
+ * @brief Points a cursor at the first page of books.
+ *
+ * Book IDs are slots, so `CursorSeek(c, id)` moves to the page starting at a book.
+ *
+ * @param order The order to walk the books in.
+ * @return int The number of books on the page.
+ */
+int BookCursor(Cursor* c, BookOrder order, int pageSize) {
+    switch (order) {
+        case BOOK_BY_TITLE:
+            return CursorOpenSorted(c, &booksByTitle, pageSize);
+        case BOOK_BY_AUTHOR:
+            return CursorOpenSorted(c, &booksByAuthor, pageSize);
+        case BOOK_BY_STOCK:
+            return CursorOpenSorted(c, &booksByStock, pageSize);
+        default:
+            return CursorOpen(c, &booksLive, &booksCapacity, pageSize);
+    }
+}
+
+#endif
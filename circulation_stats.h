@@ -0,0 +1,542 @@
+#ifndef CIRCULATION_STATS_H
+#define CIRCULATION_STATS_H
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "models.h"
+#include "repository.h"
+#include "deadline_index.h"
+#include "loan_history.h"
+
+/**
+ * @file circulation_stats.h
+ * @brief The books, authors and genres lent the most over the last days, estimated in bounded memory.
+ *
+ * Every book lent is counted on the day its loan started, in a count-min sketch of that day
+ * per dimension. A ring of STATS_DAYS daily sketches backs a running total sketch for each
+ * window of CIRCULATION_WINDOWS: a lent book is added to the totals of the windows covering
+ * its day, and when the clock moves past a day, that day's sketch is subtracted from the
+ * totals it leaves. Each window also keeps a min-heap of the STATS_TRACKED items with the
+ * highest estimates, updated as books are lent, so the top items are read without scanning.
+ * The books of every genre have heaps of their own too, so that a genre's top books are
+ * found even when none of them is among the most lent books overall.
+ *
+ * Only today moves the clock, before each loan is counted and before each query, so loans
+ * made past midnight count on their own day. Loans dated after today are not counted, so a
+ * loan started in the future cannot empty the sketches or push the windows past today.
+ *
+ * Estimates never fall below the true counts, and exceed them by at most a small share of
+ * the books lent in the window. CirculationExact recounts a window from the loans and the
+ * loan history, to check the estimates against.
+ *
+ * The statistics are guarded by the loans table lock: LOCK_LOANS exclusively to record or
+ * move the clock, shared to read.
+ */
+
+/**
+ * @brief Rows of a sketch, each hashed independently.
+ */
+#define STATS_DEPTH 4
+
+/**
+ * @brief Counters per row of a sketch. A power of two.
+ */
+#define STATS_WIDTH 1024
+
+/**
+ * @brief Days of the ring of daily sketches. Longer than the longest window.
+ */
+#define STATS_DAYS 32
+
+/**
+ * @brief Items with the highest estimates tracked per window.
+ */
+#define STATS_TRACKED 32
+
+/**
+ * @brief Windows the statistics are kept for.
+ */
+#define CIRCULATION_WINDOWS 3
+
+/**
+ * @brief What is counted.
+ */
+typedef enum {
+    STATS_BOOKS,
+    STATS_AUTHORS,
+    STATS_GENRES,
+    STATS_DIMENSIONS
+} StatsDimension;
+
+/**
+ * @brief The days of every window, the current day included.
+ */
+const int circulationWindowDays[CIRCULATION_WINDOWS] = {1, 7, 30};
+
+/**
+ * @struct CountMinSketch
+ * @brief Counters of items, each item adding to one counter per row.
+ */
+typedef struct {
+    uint32_t counts[STATS_DEPTH][STATS_WIDTH];
+} CountMinSketch;
+
+/**
+ * @struct HeavyHitter
+ * @brief An item and how many times it was lent.
+ */
+typedef struct {
+    int id;
+    uint32_t count;
+} HeavyHitter;
+
+/**
+ * @struct StatsTop
+ * @brief The most lent items of a window, as a min-heap by count.
+ */
+typedef struct {
+    HeavyHitter items[STATS_TRACKED];
+    int count;
+} StatsTop;
+
+/**
+ * @struct StatsWindow
+ * @brief The total sketch of a window and its most lent items.
+ */
+typedef struct {
+    CountMinSketch total;
+    StatsTop top;
+} StatsWindow;
+
+/**
+ * @struct StatsTable
+ * @brief The daily sketches and windows of a dimension.
+ */
+typedef struct {
+    CountMinSketch days[STATS_DAYS];
+    StatsWindow windows[CIRCULATION_WINDOWS];
+} StatsTable;
+
+StatsTable circulationStats[STATS_DIMENSIONS];
+
+/**
+ * @brief The most lent books of each genre, CIRCULATION_WINDOWS heaps per genre slot.
+ */
+StatsTop* statsGenreTops;
+Arena statsGenreTopsArena;
+
+/**
+ * @brief The genre slots `statsGenreTops` has heaps for.
+ */
+int statsGenreCapacity;
+
+/**
+ * @brief The newest day counted, as counted by DeadlineDay, or INT_MIN before anything was.
+ */
+int circulationDay = INT_MIN;
+
+/**
+ * @brief The odd multipliers hashing an item to a counter in each row.
+ */
+const uint32_t statsSeeds[STATS_DEPTH] = {0x9e3779b1u, 0x85ebca77u, 0xc2b2ae3du, 0x27d4eb2fu};
+
+/**
+ * @brief The counter of an item in a row of a sketch.
+ */
+uint32_t statsSlot(int row, int id) {
+    uint32_t h = ((uint32_t) id + 1) * statsSeeds[row];
+    return (h ^ (h >> 16)) & (STATS_WIDTH - 1);
+}
+
+/**
+ * @brief The estimated count of an item: the smallest of its counters.
+ */
+uint32_t statsEstimate(const CountMinSketch* s, int id) {
+    uint32_t count = UINT32_MAX;
+    for (int r = 0; r < STATS_DEPTH; r++) {
+        uint32_t c = s->counts[r][statsSlot(r, id)];
+        count = c < count ? c : count;
+    }
+    return count;
+}
+
+/**
+ * @brief Restores the heap order of a window's top items below a position.
+ */
+void statsSiftDown(StatsTop* top, int i) {
+    while (1) {
+        int smallest = i, left = 2 * i + 1, right = 2 * i + 2;
+        if (left < top->count && top->items[left].count < top->items[smallest].count) {
+            smallest = left;
+        }
+        if (right < top->count && top->items[right].count < top->items[smallest].count) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            return;
+        }
+        HeavyHitter swap = top->items[i];
+        top->items[i] = top->items[smallest];
+        top->items[smallest] = swap;
+        i = smallest;
+    }
+}
+
+/**
+ * @brief Restores the heap order of a window's top items above a position.
+ */
+void statsSiftUp(StatsTop* top, int i) {
+    while (i > 0 && top->items[(i - 1) / 2].count > top->items[i].count) {
+        HeavyHitter swap = top->items[i];
+        top->items[i] = top->items[(i - 1) / 2];
+        top->items[(i - 1) / 2] = swap;
+        i = (i - 1) / 2;
+    }
+}
+
+/**
+ * @brief Gives an item its new estimate among a window's top items, if it belongs there.
+ */
+void statsOffer(StatsTop* top, int id, uint32_t count) {
+    for (int i = 0; i < top->count; i++) {
+        if (top->items[i].id == id) {
+            top->items[i].count = count;
+            statsSiftDown(top, i);
+            return;
+        }
+    }
+    if (top->count < STATS_TRACKED) {
+        top->items[top->count++] = (HeavyHitter) {id, count};
+        statsSiftUp(top, top->count - 1);
+    } else if (count > top->items[0].count) {
+        top->items[0] = (HeavyHitter) {id, count};
+        statsSiftDown(top, 0);
+    }
+}
+
+/**
+ * @brief Reads the estimates of a window's top items again from its total, dropping the
+ *        items no longer lent in it.
+ */
+void statsRefresh(StatsTop* top, const CountMinSketch* total) {
+    int kept = 0;
+    for (int i = 0; i < top->count; i++) {
+        uint32_t count = statsEstimate(total, top->items[i].id);
+        if (count) {
+            top->items[kept++] = (HeavyHitter) {top->items[i].id, count};
+        }
+    }
+    top->count = kept;
+    for (int i = kept / 2 - 1; i >= 0; i--) {
+        statsSiftDown(top, i);
+    }
+}
+
+/**
+ * @brief The top books of a genre in a window, the heaps of the genre slots being made as
+ *        the genres table grows.
+ *
+ * @return StatsTop* The heap, or NULL if the genre has none and none can be made.
+ */
+StatsTop* statsGenreTop(int genreId, int w) {
+    if (genreId < 0) {
+        return NULL;
+    }
+    if (genreId >= statsGenreCapacity) {
+        if (genreId >= genresCapacity ||
+            !ArenaResizeColumn(&statsGenreTopsArena, sizeof(StatsTop) * CIRCULATION_WINDOWS, genresCapacity)) {
+            return NULL;
+        }
+        statsGenreCapacity = genresCapacity;
+    }
+    return &statsGenreTops[genreId * CIRCULATION_WINDOWS + w];
+}
+
+/**
+ * @brief Reserves the heaps of the genres.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int InitCirculationStats(void) {
+    if (!ArenaInit(&statsGenreTopsArena, "genre tops")) {
+        return 0;
+    }
+    statsGenreTops = (StatsTop*) statsGenreTopsArena.base;
+    return 1;
+}
+
+/**
+ * @brief Moves the clock forward to a day, dropping the days that leave each window.
+ *
+ * The estimates of the top items, those of the genres included, are read again from the
+ * totals, and items no longer lent in a window leave its top.
+ */
+void CirculationAdvance(int day) {
+    if (circulationDay == INT_MIN || day - circulationDay >= STATS_DAYS) {
+        memset(circulationStats, 0, sizeof(circulationStats));
+        memset(statsGenreTops, 0, (size_t) statsGenreCapacity * CIRCULATION_WINDOWS * sizeof(StatsTop));
+        circulationDay = day;
+        return;
+    }
+    if (day <= circulationDay) {
+        return;
+    }
+    for (int d = circulationDay + 1; d <= day; d++) {
+        for (int t = 0; t < STATS_DIMENSIONS; t++) {
+            StatsTable* table = &circulationStats[t];
+            for (int w = 0; w < CIRCULATION_WINDOWS; w++) {
+                const CountMinSketch* leaving = &table->days[(d - circulationWindowDays[w]) % STATS_DAYS];
+                uint32_t* total = &table->windows[w].total.counts[0][0];
+                for (int i = 0; i < STATS_DEPTH * STATS_WIDTH; i++) {
+                    total[i] -= (&leaving->counts[0][0])[i];
+                }
+            }
+            memset(&table->days[d % STATS_DAYS], 0, sizeof(CountMinSketch));
+        }
+    }
+    circulationDay = day;
+    for (int w = 0; w < CIRCULATION_WINDOWS; w++) {
+        for (int t = 0; t < STATS_DIMENSIONS; t++) {
+            statsRefresh(&circulationStats[t].windows[w].top, &circulationStats[t].windows[w].total);
+        }
+        for (int g = 0; g < statsGenreCapacity; g++) {
+            statsRefresh(&statsGenreTops[g * CIRCULATION_WINDOWS + w], &circulationStats[STATS_BOOKS].windows[w].total);
+        }
+    }
+}
+
+/**
+ * @brief Counts an item lent on a day. Days before the longest window or after the clock
+ *        are ignored.
+ *
+ * A book is offered to the top of its genre as well.
+ */
+void CirculationRecord(StatsDimension dimension, int id, int day) {
+    if (id < 0 || day > circulationDay) {
+        return;
+    }
+    Book* b = dimension == STATS_BOOKS ? SearchBookById(id) : NULL;
+    int age = circulationDay - day;
+    if (age >= circulationWindowDays[CIRCULATION_WINDOWS - 1]) {
+        return;
+    }
+    StatsTable* table = &circulationStats[dimension];
+    for (int r = 0; r < STATS_DEPTH; r++) {
+        table->days[day % STATS_DAYS].counts[r][statsSlot(r, id)]++;
+    }
+    for (int w = CIRCULATION_WINDOWS - 1; w >= 0 && age < circulationWindowDays[w]; w--) {
+        StatsWindow* window = &table->windows[w];
+        for (int r = 0; r < STATS_DEPTH; r++) {
+            window->total.counts[r][statsSlot(r, id)]++;
+        }
+        uint32_t count = statsEstimate(&window->total, id);
+        statsOffer(&window->top, id, count);
+        StatsTop* genreTop = b ? statsGenreTop(b->genreId, w) : NULL;
+        if (genreTop) {
+            statsOffer(genreTop, id, count);
+        }
+    }
+}
+
+/**
+ * @brief Counts the books of a loan, with their authors and genres, on the day it started.
+ *
+ * The clock is first moved to today, so a loan started today is counted.
+ */
+void CirculationRecordLoan(const Loan* l) {
+    CirculationAdvance(DeadlineToday());
+    int day = DeadlineDay(l->startDate);
+    if (day == DEADLINE_NONE) {
+        return;
+    }
+    for (int k = 0; k < l->itemCount; k++) {
+        Book* b = SearchBookById(loanItems[l->itemOffset + k].bookId);
+        if (b) {
+            CirculationRecord(STATS_BOOKS, b->id, day);
+            CirculationRecord(STATS_AUTHORS, b->authorId, day);
+            CirculationRecord(STATS_GENRES, b->genreId, day);
+        }
+    }
+}
+
+/**
+ * @brief Finds the window of a number of days.
+ *
+ * @return int Its index, or -1 if no window has that many days.
+ */
+int circulationWindowOf(int days) {
+    for (int w = 0; w < CIRCULATION_WINDOWS; w++) {
+        if (circulationWindowDays[w] == days) {
+            return w;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Orders heavy hitters by count, highest first, then by ID.
+ */
+int compareHeavyHitters(const void* a, const void* b) {
+    const HeavyHitter* x = a;
+    const HeavyHitter* y = b;
+    if (x->count != y->count) {
+        return x->count < y->count ? 1 : -1;
+    }
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+/**
+ * @brief Tells whether an item is kept by a genre filter: any item without one, only the
+ *        books of the genre with one.
+ */
+int statsInGenre(StatsDimension dimension, int id, int genreId) {
+    if (genreId < 0) {
+        return 1;
+    }
+    Book* b = dimension == STATS_BOOKS ? SearchBookById(id) : NULL;
+    return b && b->genreId == genreId;
+}
+
+/**
+ * @brief The items lent the most in a window ending on the day of the clock, by estimate.
+ *
+ * Reads the tracked top items of the window only, so the time does not depend on the loans.
+ * With a genre, reads the genre's own top books.
+ *
+ * @param days The days of the window, one of `circulationWindowDays`.
+ * @param genreId Only counts the books of this genre, or -1 for every item. Books only.
+ * @param top Receives at most `k` items, most lent first.
+ * @return int The number of items, or -1 if no window has that many days.
+ */
+int CirculationTop(StatsDimension dimension, int days, int genreId, HeavyHitter* top, int k) {
+    int w = circulationWindowOf(days);
+    if (w == -1) {
+        return -1;
+    }
+    const StatsTop* tracked = &circulationStats[dimension].windows[w].top;
+    if (genreId >= 0) {
+        tracked = dimension == STATS_BOOKS && genreId < statsGenreCapacity ? &statsGenreTops[genreId * CIRCULATION_WINDOWS + w] : NULL;
+        if (!tracked) {
+            return 0;
+        }
+    }
+    HeavyHitter sorted[STATS_TRACKED];
+    memcpy(sorted, tracked->items, tracked->count * sizeof(HeavyHitter));
+    qsort(sorted, tracked->count, sizeof(HeavyHitter), compareHeavyHitters);
+    int count = 0;
+    for (int i = 0; i < tracked->count && count < k; i++) {
+        if (statsInGenre(dimension, sorted[i].id, genreId)) {
+            top[count++] = sorted[i];
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief The estimated number of times an item was lent in a window.
+ *
+ * @return uint32_t The estimate, or 0 if no window has that many days.
+ */
+uint32_t CirculationEstimate(StatsDimension dimension, int days, int id) {
+    int w = circulationWindowOf(days);
+    return w == -1 ? 0 : statsEstimate(&circulationStats[dimension].windows[w].total, id);
+}
+
+/**
+ * @brief Adds the books lent on a day from `firstDay` to `lastDay` to the counts of a dimension.
+ */
+void statsCountItems(StatsDimension dimension, int day, const LoanItem* items, int itemCount, int firstDay,
+                     int lastDay, uint32_t* counts, int capacity) {
+    if (day < firstDay || day > lastDay) {
+        return;
+    }
+    for (int k = 0; k < itemCount; k++) {
+        Book* b = SearchBookById(items[k].bookId);
+        int id = !b ? -1 : dimension == STATS_BOOKS ? b->id : dimension == STATS_AUTHORS ? b->authorId : b->genreId;
+        if (id >= 0 && id < capacity) {
+            counts[id]++;
+        }
+    }
+}
+
+/**
+ * @brief Counts exactly the items lent from `firstDay` to `lastDay`, from the open loans and
+ *        the loan history, and gives the most lent.
+ *
+ * Only the history partitions of loans returned since `firstDay` are read. Like the sketches,
+ * days after the clock are not counted.
+ *
+ * @param genreId Only counts the books of this genre, or -1 for every item. Books only.
+ * @param top Receives at most `k` items, most lent first.
+ * @return int The number of items, or -1 if memory ran out.
+ */
+int CirculationExact(StatsDimension dimension, int firstDay, int lastDay, int genreId, HeavyHitter* top, int k) {
+    int capacity = dimension == STATS_BOOKS ? booksCapacity : dimension == STATS_AUTHORS ? authorsCapacity : genresCapacity;
+    uint32_t* counts = calloc(capacity ? capacity : 1, sizeof(uint32_t));
+    if (!counts) {
+        return -1;
+    }
+    lastDay = lastDay > circulationDay ? circulationDay : lastDay;
+    for (int b = historyPartitionAt(HistoryMonthOf(firstDay)); b < historyPartitionCount; b++) {
+        HistoryPartition* p = &historyPartitions[b];
+        for (int i = 0; i < p->loanCount; i++) {
+            const ArchivedLoan* a = &p->loans[i];
+            statsCountItems(dimension, a->startDay, &p->items[a->itemOffset], a->itemCount, firstDay, lastDay, counts, capacity);
+        }
+    }
+    for (int i = SlotSetNext(&loansLive, 0, loansCapacity); i != -1; i = SlotSetNext(&loansLive, i + 1, loansCapacity)) {
+        statsCountItems(dimension, DeadlineDay(loans[i].startDate), &loanItems[loans[i].itemOffset], loans[i].itemCount,
+                        firstDay, lastDay, counts, capacity);
+    }
+    int count = 0;
+    for (int id = 0; id < capacity; id++) {
+        if (!counts[id] || !statsInGenre(dimension, id, genreId)) {
+            continue;
+        }
+        int i = count < k ? count++ : k;
+        if (i == k && compareHeavyHitters(&(HeavyHitter) {id, counts[id]}, &top[k - 1]) >= 0) {
+            continue;
+        }
+        for (i = i == k ? k - 1 : i; i > 0 && compareHeavyHitters(&(HeavyHitter) {id, counts[id]}, &top[i - 1]) < 0; i--) {
+            top[i] = top[i - 1];
+        }
+        top[i] = (HeavyHitter) {id, counts[id]};
+    }
+    free(counts);
+    return count;
+}
+
+/**
+ * @brief Counts again the books of the loans started in the longest window, after the data
+ *        files were read.
+ *
+ * The clock is set to today. Loans started after today are not counted.
+ */
+void RebuildCirculationStats(void) {
+    int day = DeadlineToday();
+    circulationDay = INT_MIN;
+    CirculationAdvance(day);
+    int firstDay = day - circulationWindowDays[CIRCULATION_WINDOWS - 1] + 1;
+    for (int b = historyPartitionAt(HistoryMonthOf(firstDay)); b < historyPartitionCount; b++) {
+        HistoryPartition* p = &historyPartitions[b];
+        for (int i = 0; i < p->loanCount; i++) {
+            const ArchivedLoan* a = &p->loans[i];
+            for (int k = 0; k < a->itemCount; k++) {
+                Book* book = SearchBookById(p->items[a->itemOffset + k].bookId);
+                if (book && a->startDay >= firstDay) {
+                    CirculationRecord(STATS_BOOKS, book->id, a->startDay);
+                    CirculationRecord(STATS_AUTHORS, book->authorId, a->startDay);
+                    CirculationRecord(STATS_GENRES, book->genreId, a->startDay);
+                }
+            }
+        }
+    }
+    for (int i = SlotSetNext(&loansLive, 0, loansCapacity); i != -1; i = SlotSetNext(&loansLive, i + 1, loansCapacity)) {
+        CirculationRecordLoan(&loans[i]);
+    }
+}
+
+#endif
@@ -2,34 +2,104 @@
 #define CLIENT_CONTROLLER_H
 #include "models.h"
 #include "cstdin.h"
+#include "screen.h"
+#include "list_view.h"
 #include "repository.h"
+#include "client_service.h"
+#include "fine_sweep.h"
+#include "snapshot.h"
 
 
+/**
+ * @brief Prints the address of a client, or that it was not found.
+ */
+void printClientAddress(const Client* c) {
+    Address *add = SearchAddressById(c->addressId);
+    if (add && add->id != -1) {
+        printf("Street: %s, Number: %s, Complement: %s\n", StringGet(add->street), StringGet(add->number), StringGet(add->complement));
+        printf("CEP: %s\n", StringGet(add->cep));
+    } else {
+        printf("Address not found.\n");
+    }
+}
+
+/**
+ * @brief Prints a client with its address, numbered by the counter in `context`.
+ */
+void printNumberedClient(Client* c, void* context) {
+    int* k = context;
+    printf("%d:\nName: %s\n", ++*k, StringGet(c->name));
+    printf("CPF: %s\n", c->cpf);
+    printClientAddress(c);
+    printf("\n");
+}
+
+/**
+ * @brief Adds the client in a slot, with its address, to a page of the client list.
+ */
+void listClient(int slot, ScreenText* text) {
+    Client* c = &clients[slot];
+    ScreenTextAdd(text, "Name: %s, CPF: %s", StringGet(c->name), c->cpf);
+    Address *add = SearchAddressById(c->addressId);
+    if (add && add->id != -1) {
+        ScreenTextAdd(text, "Street: %s, Number: %s, Complement: %s, CEP: %s", StringGet(add->street), StringGet(add->number), StringGet(add->complement), StringGet(add->cep));
+    } else {
+        ScreenTextAdd(text, "Address not found.");
+    }
+    ScreenTextAdd(text, "");
+}
+
+/**
+ * @brief Prints the message of a failed client operation.
+ */
+void printClientError(Status s) {
+    switch (s) {
+        case STATUS_DUPLICATE:
+            printf("A client with this CPF already exists. Operation aborted.\n");
+            break;
+        case STATUS_INVALID:
+            printf("Invalid CPF. Operation aborted.\n");
+            break;
+        case STATUS_ACTIVE_LOAN:
+            printf("The client must return their books first.\n");
+            break;
+        case STATUS_IN_USE:
+            printf("The client has reservations or owes fines.\n");
+            break;
+        case STATUS_NO_MEMORY:
+            printf("Storage is full. Operation aborted.\n");
+            break;
+        default:
+            printf("Error: %s.\n", StatusText(s));
+            break;
+    }
+}
+
 /**
  * @brief Displays a menu to search for a client by name and shows the client's details.
  *
  * This function prompts the user to enter a client's name, searches for the client by name,
- * and displays the client's CPF and address details if found. If the address is not found,
- * it notifies the user. The function waits for user input before clearing the screen.
+ * and displays the client's CPF and address details if found. If the client or the address is not
+ * found, it notifies the user. The function waits for user input before clearing the screen.
  *
  * @note This function uses the global buffer to store the client's name input.
  */
 void SearchClientByNameMenu() {
     printf("Enter the client's name: ");
-    fillBuffer(20);
+    fillBuffer(TEXT_MAX);
     Client *c = SearchClientByName(buffer);
-    printf("CPF: %s\n", c->cpf);
-    Address *add = SearchAddressById(c->addressId);
-    if(add && add->id != -1) {
-        printf("Street: %s, Number: %s, Complement: %s\n", add->street, add->number, add->complement);
-        printf("CEP: %s  \n", add->cep);
-        printf("\n");
+    if (!c) {
+        printf("Client not found.\n");
     } else {
-        printf("Address not found.\n");
+        printf("CPF: %s\n", c->cpf);
+        printf("Fines owed: $%d.%02d\n", c->fineAmount / 100, c->fineAmount % 100);
+        printf("Accrued fine: $%d.%02d\n", FineAccrued(c) / 100, FineAccrued(c) % 100);
+        printClientAddress(c);
+        printf("\n");
     }
     printf("Type anything to continue...");
     getch();
-    system("clear");
+    ScreenClear();
 }
 
 /**
@@ -42,31 +112,23 @@ void SearchClientByNameMenu() {
  * 
  */
 void SearchClientByCPFMenu() {
-    int k = 0;
-    char cpf[12];
-    system("clear");
+    ScreenClear();
     printf("Enter the client's CPF: ");
-    fillBuffer(12);
-    strcpy(cpf, buffer);
-    for(int j = 0; j < MAX_ENTITIES; j++) {
-        if(!strcmp(clients[j].cpf, cpf) && strcmp(clients[j].cpf, "0")) {
-            Address *add = SearchAddressById(clients[j].addressId);
-            printf("Name: %s\n", clients[j].name);
-            printf("CPF: %s\n", clients[j].cpf);
-            if(add && add->id != -1) {
-                printf("Street: %s, Number: %s, Complement: %s\n", add->street, add->number, add->complement);
-                printf("CEP: %s  ", add->cep);
-                printf("\n\n");
-            } else {
-                printf("Address not found.\n");
-            }
-            return;
-        }
+    fillBuffer(11);
+    Client* c = SearchClientByCPF(buffer);
+    if (c) {
+        printf("Name: %s\n", StringGet(c->name));
+        printf("CPF: %s\n", c->cpf);
+        printf("Fines owed: $%d.%02d\n", c->fineAmount / 100, c->fineAmount % 100);
+        printf("Accrued fine: $%d.%02d\n", FineAccrued(c) / 100, FineAccrued(c) % 100);
+        printClientAddress(c);
+        printf("\n");
+    } else {
+        printf("Client not found.\n");
     }
-    printf("Client not found.\n");
-    printf("type anything to continue...");
+    printf("Type anything to continue...");
     getch();
-    system("clear");
+    ScreenClear();
 }
 
 /**
@@ -75,68 +137,36 @@ void SearchClientByCPFMenu() {
  * This function prompts the user to enter a street name, searches for clients
  * living at that address, and displays the details of the clients found.
  * 
- * @note The function uses global variables `addresses`, `clients`, and `buffer`.
+ * @note The function uses the global `buffer`.
  * 
  * @details
  * - Prompts the user to enter a street name.
- * - Searches the `addresses` array for a matching street name.
- * - If the address is found, it searches the `clients` array for clients living at that address.
- * - Displays the details of the clients found.
- * - If no address is found, it notifies the user and returns.
+ * - Lists every client living on that street through ClientsAtStreet.
+ * - If nobody lives there, it notifies the user and returns.
  * 
  * @return void
  */
 
 void SearchClientByAddressMenu() {
-    int j, k = 0;
-    char street[40];
-
-    int id = -1;
+    int k = 0;
 
     printf("Enter the client's street: ");
-    fillBuffer(40);
-    strcpy(street, buffer);
-
-    for(j = 0; j < MAX_ENTITIES; j++) {
-        if(!strcmp(addresses[j].street, street) && strcmp(clients[j].cpf, "0")) {
-            id = addresses[j].id;
-            break;
-        }
-    }
-
-    if(id == -1) {
+    fillBuffer(TEXT_MAX);
+    int found = ClientsAtStreet(buffer, NULL, NULL);
+    if (found == 0) {
         printf("Address not found.\n");
         printf("Type anything to continue...");
         getch();
-        system("clear");
+        ScreenClear();
         return;
     }
 
-    Address *add = SearchAddressById(id);
-
-    for(j = 0; j < MAX_ENTITIES; j++) {
-        if(strcmp(clients[j].cpf, "0") && clients[j].addressId == add->id) {
-            k++;
-        }
-    }
-
-    system("clear");
-    
-    printf("\nFound %d clients living at this address: \n", k);
-    
-    int v = 1;
-    for(j = 0; j < MAX_ENTITIES; j++) {
-        if (strcmp(clients[j].cpf, "0") && clients[j].addressId == add->id) {
-            printf("%d:\nName: %s\n", v++, clients[j].name);
-            printf("CPF: %s\n", clients[j].cpf);
-            printf("Street: %s, Number: %s, Complement: %s\n", add->street, add->number, add->complement);
-            printf("CEP: %s\n", add->cep);
-            printf("\n");
-        }
-    }
+    ScreenClear();
+    printf("\nFound %d clients living at this address: \n", found);
+    ClientsAtStreet(buffer, printNumberedClient, &k);
     printf("Type anything to continue...");
     getch();
-    system("clear");
+    ScreenClear();
 }
 
 
@@ -166,74 +196,63 @@ void SearchClient(int i) {
         printf("Type anything to continue...");
         getch();
     }
-    system("clear");
+    ScreenClear();
 }
 
 /**
  * @brief Adds a new client to the system.
  *
- * This function prompts the user to enter the new client's details including name, CPF, and address.
- * It checks if a client with the given CPF already exists and aborts the operation if so.
- * If the address already exists in the system, it uses the existing address; otherwise, it registers the new address.
- *
- * @param c Pointer to the Client structure where the new client's details will be stored.
- * @param add Pointer to the Address structure where the new client's address details will be stored.
+ * This function prompts the user to enter the new client's details including name, CPF, and address,
+ * then registers the client with ClientAdd. A client with the same CPF aborts the operation.
+ * The address is normalized and looked up in the address index; if it already exists in the system,
+ * it is shared, otherwise the new address is registered.
  */
-void AddClient(Client* c, Address *add) {
+void AddClient(void) {
+    char name[BUFFER_SIZE], cpf[12], street[BUFFER_SIZE], number[8], cep[16];
+
     printf("Enter the new client's name: ");
-    fillBuffer(40);
-    strcpy(c->name, buffer);
+    fillBuffer(TEXT_MAX);
+    strcpy(name, buffer);
 
     printf("Enter the new client's CPF: ");
-    fillBuffer(12);
-    strcpy(c->cpf, buffer);
-
-    Client *existingClient = SearchClientByCPF(c->cpf);
-    if (existingClient) {
-        printf("A client with this CPF already exists. Operation aborted.\n");
+    fillBuffer(11);
+    strcpy(cpf, buffer);
+    if (SearchClientByCPF(cpf)) {
+        printClientError(STATUS_DUPLICATE);
         printf("Type anything to continue...");
         getch();
-        system("clear");
+        ScreenClear();
         return;
     }
 
     printf("Enter the new client's address (Street): ");
-    fillBuffer(40);
-    strcpy(add->street, buffer);
+    fillBuffer(TEXT_MAX);
+    strcpy(street, buffer);
 
     printf("Enter the new client's house number: ");
     fillBuffer(5);
-    strcpy(add->number, buffer);
+    strcpy(number, buffer);
 
     printf("Enter the new client's postal code (CEP): ");
     fillBuffer(10);
-    strcpy(add->cep, buffer);
+    strcpy(cep, buffer);
 
     printf("Enter an additional address information for the new client: ");
-    fillBuffer(40);
-    strcpy(add->complement, buffer);
-
-    for (int i = 0; i < MAX_ENTITIES; i++) {
-        if (!strcmp(addresses[i].street, add->street) &&
-            !strcmp(addresses[i].number, add->number) &&
-            !strcmp(addresses[i].cep, add->cep) &&
-            !strcmp(addresses[i].complement, add->complement)) {
-            c->addressId = addresses[i].id;
-            add->id = -1;
-            printf("Existing address found and used.\n");
-            printf("Client successfully registered!!!\n");
-            printf("Type anything to continue...");
-            getch();
-            system("clear");
-            return;
-        }
+    fillBuffer(TEXT_MAX);
+
+    Client* c;
+    Status s = ClientAdd(name, cpf, street, number, cep, buffer, &c);
+    if (s != STATUS_OK) {
+        printClientError(s);
+    } else if (addressRefs[c->addressId] > 1) {
+        printf("Existing address found and used.\n");
+        printf("Client successfully registered!!!\n");
+    } else {
+        printf("Client successfully registered with new address!!!\n");
     }
-
-    c->addressId = add->id;
-    printf("Client successfully registered with new address!!!\n");
     printf("Type anything to continue...");
     getch();
-    system("clear");
+    ScreenClear();
 }
 
 
@@ -242,9 +261,9 @@ void AddClient(Client* c, Address *add) {
  * 
  * This function prompts the user to enter the CPF of the client they wish to remove.
  * If the client is found, their details are displayed and the user is asked to confirm
- * the removal. If confirmed, the client's CPF is set to "0" to indicate removal.
- * Additionally, if the client's address has no other associated clients, the address
- * is also removed.
+ * the removal. If confirmed, the client is removed with ClientRemove, unless they still have
+ * books to return. Additionally, if the client's address has no other associated clients, the
+ * address is also removed. The address reference count makes that check O(1).
  * 
  * @note The user can type "exit" to go back without removing any client.
  * 
@@ -256,39 +275,31 @@ void RemoveClient() {
         printf("Enter the CPF of the client you want to remove (type \"exit\" to go back): \n");
         fillBuffer(12);
         if(!strcmp("EXIT", buffer)) {
-            system("clear");
+            ScreenClear();
             return;
         }
         Client* c = SearchClientByCPF(buffer);
         if (c) {
             char x = '\0';
-            system("clear");
-            printf("Name: %s\n", c->name);
+            ScreenClear();
+            printf("Name: %s\n", StringGet(c->name));
             printf("CPF: %s\n", c->cpf);
-            Address *add = SearchAddressById(c->addressId);
-            printf("Street: %s, Number: %s, Complement: %s\n", add->street, add->number, add->complement);
-            printf("CEP: %s", add->cep);
-            printf("\n\n");
+            printClientAddress(c);
+            printf("\n");
             printf("Are you sure you want to remove this client? (Y or N) ");
             fillBuffer(1);
             x = buffer[0];
             if(x == 'Y') {
-                strcpy(c->cpf, "0\0");
-                printf("Client removed.\n");
-
-                // Check if the address has no other clients
-                int hasClients = 0;
-                for (int i = 0; i < MAX_ENTITIES; i++) {
-                    if (clients[i].addressId == add->id && strcmp(clients[i].cpf, "0") != 0) {
-                        hasClients = 1;
-                        break;
+                int addressRemoved;
+                Status s = ClientRemove(c, &addressRemoved);
+                if (s != STATUS_OK) {
+                    printClientError(s);
+                } else {
+                    printf("Client removed.\n");
+                    if (addressRemoved) {
+                        printf("Address removed as it has no other clients.\n");
                     }
                 }
-                if (!hasClients) {
-                    add->id = -1;
-                    printf("Address removed as it has no other clients.\n");
-                }
-
                 printf("Type anything to continue...");
                 getch();
             } else {
@@ -296,13 +307,13 @@ void RemoveClient() {
                 printf("Type anything to continue...");
                 getch();
             }
-            system("clear");
+            ScreenClear();
             return;
         }
         printf("Client not found. Try again...\n");
         printf("Type anything to continue...");
         getch();
-        system("clear");
+        ScreenClear();
     } while(!strcmp("EXIT", buffer));
 }
 
@@ -313,175 +324,116 @@ void RemoveClient() {
  * If the client is found, it displays a menu with options to edit the client's name,
  * CPF, or address. The user can also choose to go back to the previous menu.
  *
- * @note The function uses several helper functions such as fillBuffer, SearchClientByCPF,
- *       SearchAddressById, and getch. It also uses the global buffer and addresses array.
+ * @note The function uses fillBuffer, SearchClientByCPF and getch for the dialog and the
+ *       client service (ClientRename, ClientChangeCpf, ClientMove) for the changes.
  *
  * @details
  * - If the client is not found, a message is displayed and the function returns.
  * - If the client is found, the user is presented with the following options:
  *   1. Edit name: Prompts the user to enter a new name and updates the client's name.
  *   2. Edit CPF: Prompts the user to enter a new CPF and updates the client's CPF if it is unique.
- *   3. Address: Prompts the user to enter new address details and updates the client's address.
+ *   3. Address: Prompts the user to enter new address details and moves the client to that address
+ *      with ClientMove, which shares an identical existing address.
  *   4. Back: Returns to the previous menu.
  * - After each successful update, a confirmation message is displayed.
  * - If an invalid choice is entered, an error message is displayed and the menu is cleared.
  */
 void UpdateClientMenu() {
     printf("Enter the client's CPF: ");
-    fillBuffer(12);
+    fillBuffer(11);
     Client* c = SearchClientByCPF(buffer);
     if (!c) {
         printf("Client not found.\n");
         printf("Type anything to continue...");
         getch();
-        system("clear");
+        ScreenClear();
         return;
     }
     int choice;
-    Address* add = SearchAddressById(c->addressId);
-    system("clear");
-    printf("Name: %s\nCPF: %s", c->name, c->cpf);
+    ScreenClear();
+    printf("Name: %s\nCPF: %s", StringGet(c->name), c->cpf);
     printf("\n\n1. Edit name\n2. Edit CPF\n3. Address\n4. Back\nOption:");
     fillBuffer(20);
     sscanf(buffer, "%d", &choice);
-    system("clear");
+    ScreenClear();
+    Status s = STATUS_OK;
     switch (choice) {
         case 1:
             printf("Enter the new name: ");
-            fillBuffer(40);
-            strcpy(c->name, buffer);
-            printf("\n\nClient successfully updated!\n");
-            printf("Type anything to continue...");
-            getch();
+            fillBuffer(TEXT_MAX);
+            s = ClientRename(c, buffer);
             break;
         case 2:
             printf("Enter the new CPF: ");
-            fillBuffer(12);
-            Client *existingClient = SearchClientByCPF(buffer);
-            if (existingClient) {
-                printf("A client with this CPF already exists. Operation aborted.\n");
-                printf("Type anything to continue...");
-                getch();
-                system("clear");
-                break;
-            }
-            strcpy(c->cpf, buffer);
-            printf("\n\nClient successfully updated!\n");
-            printf("Type anything to continue...");
-            getch();
+            fillBuffer(11);
+            s = ClientChangeCpf(c, buffer);
             break;
-        case 3:
+        case 3: {
+            char street[BUFFER_SIZE], number[8], cep[16];
             printf("Enter the street: ");
-            fillBuffer(40);
-            strcpy(add->street, buffer);
+            fillBuffer(TEXT_MAX);
+            strcpy(street, buffer);
 
             printf("Enter the number: ");
             fillBuffer(5);
-            strcpy(add->number, buffer);
+            strcpy(number, buffer);
 
             printf("Enter the postal code (CEP): ");
             fillBuffer(10);
-            strcpy(add->cep, buffer);
+            strcpy(cep, buffer);
 
             printf("Enter the complement: ");
-            fillBuffer(40);
-            strcpy(add->complement, buffer);
-            int existingAddress = 0;
-            // Check if the address already exists
-            for (int i = 0; i < MAX_ENTITIES; i++) {
-                if (!strcmp(addresses[i].street, add->street) &&
-                    !strcmp(addresses[i].number, add->number) &&
-                    !strcmp(addresses[i].cep, add->cep) &&
-                    !strcmp(addresses[i].complement, add->complement)) {
-                    c->addressId = addresses[i].id;
-                    add->id = -1;
-                    existingAddress = 1;
-                    printf("Existing address found and used.\n");
-                    printf("\n\nClient successfully updated!\n");
-                    printf("Type anything to continue...");
-                    getch();
-                    break;
-                }
-            }
-            if(existingAddress) {
-                break;
-            }
-
-            // If address does not exist, use the new one
-            c->addressId = add->id;
-            printf("\n\nClient successfully updated with new address!\n");
-            printf("Type anything to continue...");
-            getch();
+            fillBuffer(TEXT_MAX);
+            s = ClientMove(c, street, number, cep, buffer);
             break;
+        }
         case 4:
-            break;
+            return;
         default:
             printf("Invalid choice. Please try again.\n");
             printf("Type anything to continue...");
             getch();
-            system("clear");
-            break;
+            ScreenClear();
+            return;
     }
+    if (s != STATUS_OK) {
+        printClientError(s);
+    } else {
+        printf("\n\nClient successfully updated!\n");
+    }
+    printf("Type anything to continue...");
+    getch();
 }
 
 /**
- * @brief Lists all clients and their respective addresses.
- *
- * This function iterates through the list of clients and prints their names,
- * CPFs, and addresses. If a client's CPF is not "0", it prints the client's
- * name and CPF. It then searches for the client's address using the client's
- * address ID. If the address is found and valid, it prints the address details
- * (street, number, complement, and CEP). If the address is not found, it prints
- * "Address not found." After listing all clients, it prompts the user to type
- * anything to continue and clears the screen.
- *
- * @note This function uses the global array `clients` and the constant `MAX_ENTITIES`.
- *       It also relies on the `SearchAddressById` function to retrieve address details.
+ * @brief Moves the client list to the client with a CPF.
  */
-void ListClients() {
-    printf("Clients:\n");
-    for (int i = 0; i < MAX_ENTITIES; i++) {
-        if (strcmp(clients[i].cpf, "0") != 0) {
-            printf("Name: %s, CPF: %s\n", clients[i].name, clients[i].cpf);
-            Address *add = SearchAddressById(clients[i].addressId);
-            if (add && add->id != -1) {
-                printf("Street: %s, Number: %s, Complement: %s, CEP: %s\n", add->street, add->number, add->complement, add->cep);
-            } else {
-                printf("Address not found.\n");
-            }
-            printf("\n");
-        }
-    }
-    printf("Type anything to continue...");
-    getch();
-    system("clear");
+int seekClient(Cursor* c, const char* cpf) {
+    return ClientCursorSeek(c, cpf) == STATUS_OK;
 }
 
 /**
- * @brief Adds a new client to the system.
+ * @brief Reopens the client list in another order.
+ */
+int orderClients(Cursor* c, int order, int pageSize) {
+    return ClientCursor(c, (ClientOrder) order, pageSize);
+}
+
+/**
+ * @brief Lists all clients and their respective addresses.
  *
- * This function attempts to add a new client by first retrieving an empty user slot.
- * If no empty user slot is available, it prints an error message and waits for user input to continue.
- * Next, it attempts to retrieve an empty address slot. If no empty address slot is available,
- * it prints an error message and waits for user input to continue.
- * If both an empty user slot and an empty address slot are available, it adds the client using these slots.
+ * This function shows the name, CPF and address of the clients one page at a time,
+ * and lets the user jump to a CPF. It looks up each client's address using the
+ * client's address ID. If the address is found and valid, it shows the address
+ * details (street, number, complement, and CEP). If the address is not found, it
+ * shows "Address not found." Pressing s lists the clients by name or by CPF instead.
+ * The screen is cleared when the user leaves the list.
  */
-void AddClientMenu(void) {
-    Client *c = getEmptyUser();
-    if(!c){
-        printf("No empty user available.\n");
-        printf("Type anything to continue...");
-        getch();
-        return;
-    }
-    Address *add = getEmptyAddress();
-    if (!add) {
-        printf("Addresses are full\n");
-        printf("Type anything to continue...");
-        getch();
-        return;
-    }
-    AddClient(c, add);
+void ListClients() {
+    static const char* const orders[] = {"registration", "name", "CPF"};
+    Cursor c;
+    ClientCursor(&c, CLIENT_BY_SLOT, 1);
+    ListView("Clients", &c, 3, listClient, "CPF", seekClient, orders, 3, orderClients);
 }
 
 /**
@@ -500,23 +452,24 @@ void AddClientMenu(void) {
 void EditClientMenu() {
     int choice = 0;
     do{
-        system("clear");
+        ScreenClear();
         printf("1. Update\n2. Remove\n3. Exit\nOption:");
         fillBuffer(1);
         sscanf(buffer,"%d",&choice);
         if(choice == 1) {
-            system("clear");
+            ScreenClear();
             UpdateClientMenu();
         }else if(choice == 2) {
-            system("clear");
+            ScreenClear();
             RemoveClient();
         } else if (choice == 3){
-            system("clear");
+            ScreenClear();
         } else{
             printf("Invalid option!\n Try again\n");
             printf("Type anything to continue...");
             getch();
         }
+        SnapshotCommit();
     }while (choice != 3);
 }
 
@@ -535,11 +488,111 @@ void SearchClientMenu() {
         printf("Search client by:\n1.Name\n2.CPF\n3.Address\n4.Back\nOption: ");
         fillBuffer(20);
         sscanf(buffer, "%d", &op);
-        system("clear");
+        ScreenClear();
         SearchClient(op);
     } while(op!=4);
 }
 
+/**
+ * @brief Prints a ledger entry: its date, and the amount charged or paid.
+ */
+void printLedgerEntry(const LedgerEntry* e, void* context) {
+    time_t t = (time_t) e->day * 86400;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    int amount = e->amount < 0 ? -e->amount : e->amount;
+    printf("%04d-%02d-%02d  %-7s $%d.%02d\n", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+           e->amount < 0 ? "Payment" : "Fine", amount / 100, amount % 100);
+}
+
+/**
+ * @brief Reads an amount typed as dollars and cents, such as 12.5, from the buffer.
+ *
+ * @return int The amount in cents.
+ */
+int readCents(void) {
+    int dollars = 0;
+    char fraction[3] = "";
+    sscanf(buffer, "%d.%2[0-9]", &dollars, fraction);
+    int cents = fraction[0] ? (fraction[0] - '0') * 10 + (fraction[1] ? fraction[1] - '0' : 0) : 0;
+    return dollars * 100 + cents;
+}
+
+/**
+ * @brief Prints a client with what they owe.
+ */
+void printClientBalance(Client* c, void* context) {
+    printf("%-11s  $%d.%02d  %s\n", c->cpf, c->fineAmount / 100, c->fineAmount % 100, StringGet(c->name));
+}
+
+/**
+ * @brief Displays the fines menu: paying fines, a client's ledger and the clients owing the most.
+ *
+ * The menu options are:
+ * 1. Pay - Records a payment of a client's fines with FinePay.
+ * 2. History - Lists the fines and payments of a client, newest first.
+ * 3. Owing - Lists the clients owing more than an amount, largest debt first.
+ * 4. Back - Returns to the client menu.
+ */
+void FinesMenu() {
+    int choice = 0;
+    do {
+        printf("Fines\n\n");
+        printf("1. Pay\n2. History\n3. Owing\n4. Back\nOption:");
+        fillBuffer(1);
+        sscanf(buffer, "%d", &choice);
+        ScreenClear();
+        if (choice < 1 || choice > 3) {
+            continue;
+        }
+        Client* c = NULL;
+        if (choice != 3) {
+            printf("Enter the client's CPF: ");
+            fillBuffer(11);
+            c = SearchClientByCPF(buffer);
+            if (!c) {
+                printf("Client not found.\n");
+                printf("Type anything to continue...");
+                getch();
+                ScreenClear();
+                continue;
+            }
+            printf("Name: %s\nFines owed: $%d.%02d\n\n", StringGet(c->name), c->fineAmount / 100, c->fineAmount % 100);
+        }
+        if (choice == 1) {
+            printf("Enter the amount paid: $");
+            fillBuffer(12);
+            Status s = FinePay(c, readCents(), DeadlineToday());
+            if (s == STATUS_INVALID) {
+                printf("The amount must be positive and at most what the client owes.\n");
+            } else if (s != STATUS_OK) {
+                printClientError(s);
+            } else {
+                printf("Payment recorded. Fines owed: $%d.%02d\n", c->fineAmount / 100, c->fineAmount % 100);
+            }
+        } else if (choice == 2) {
+            if (!LedgerForEach((int) (c - clients), printLedgerEntry, NULL)) {
+                printf("No fines charged.\n");
+            }
+        } else {
+            printf("List the clients owing more than: $");
+            fillBuffer(12);
+            int cents = readCents();
+            ScreenClear();
+            int found = ClientsOwingMoreThan(cents, printClientBalance, NULL);
+            if (found < 0) {
+                printClientError(STATUS_NO_MEMORY);
+            } else {
+                printf("\n%d client(s) owe more than $%d.%02d\n", found, cents / 100, cents % 100);
+            }
+        }
+        printf("\nType anything to continue...");
+        getch();
+        ScreenClear();
+        SnapshotCommit();
+    } while (choice != 4);
+}
+
 /**
  * @brief Displays the client menu and handles user input for various client operations.
  *
@@ -550,9 +603,10 @@ void SearchClientMenu() {
  * The menu options are:
  * 1. List - Calls the ListClients() function to display a list of clients.
  * 2. Search - Calls the SearchClientMenu() function to search for a client.
- * 3. Add - Calls the AddClientMenu() function to add a new client.
+ * 3. Add - Calls the AddClient() function to add a new client.
  * 4. Edit - Calls the EditClientMenu() function to edit an existing client.
- * 5. Back - Exits the client menu and returns to the previous menu.
+ * 5. Fines - Calls the FinesMenu() function to take payments and look at the fines owed.
+ * 6. Back - Exits the client menu and returns to the previous menu.
  *
  * The function uses a loop to repeatedly display the menu and process user input until the user
  * chooses the "Back" option.
@@ -561,10 +615,10 @@ void ClientMenu() {
     int choice;
     do {
         printf("Client\n\n");
-        printf("1. List\n2. Search\n3. Add\n4. Edit\n5. Back\nOption:");
+        printf("1. List\n2. Search\n3. Add\n4. Edit\n5. Fines\n6. Back\nOption:");
         fillBuffer(1);
         sscanf(buffer, "%d",&choice);
-        system("clear");
+        ScreenClear();
         switch(choice) {
             case 1:
                 ListClients();
@@ -573,14 +627,18 @@ void ClientMenu() {
                 SearchClientMenu();
             break;
             case 3:
-                AddClientMenu();
+                AddClient();
             break;
             case 4:
                 EditClientMenu();
             break;
+            case 5:
+                FinesMenu();
+            break;
             default: break;
         }
-    } while(choice!=5);
+        SnapshotCommit();
+    } while(choice!=6);
 }
 
 
@@ -0,0 +1,336 @@
+#ifndef CLIENT_SERVICE_H
+#define CLIENT_SERVICE_H
+#include <string.h>
+
+#include "models.h"
+#include "status.h"
+#include "repository.h"
+#include "address_index.h"
+#include "reservations.h"
+#include "transaction.h"
+#include "fine_ledger.h"
+#include "cursor.h"
+
+/**
+ * @brief Called once per client by ClientForEach and ClientsAtStreet.
+ */
+typedef void (*ClientVisitor)(Client* c, void* context);
+
+/**
+ * @brief Orders a client listing can be walked in.
+ */
+typedef enum {
+    CLIENT_BY_SLOT,
+    CLIENT_BY_NAME,
+    CLIENT_BY_CPF
+} ClientOrder;
+
+/**
+ * @brief Tells whether a CPF can be stored: 1 to 11 characters and not the empty-slot marker "0".
+ */
+int isValidCpf(const char* cpf) {
+    size_t length = strlen(cpf);
+    return length > 0 && length < sizeof(((Client*) 0)->cpf) && strcmp(cpf, "0");
+}
+
+/**
+ * @brief Moves a client to the address with the given normalized fields.
+ *
+ * An identical address is reused through the address index. Otherwise the client's current
+ * address is edited in place if nobody else lives there, or a new address is registered.
+ *
+ * @return Status STATUS_OK, or STATUS_NO_MEMORY if a new address cannot be stored.
+ */
+Status clientSetAddress(Client* c, StringId street, StringId number, StringId cep, StringId complement) {
+    if (street == STRING_NONE || number == STRING_NONE || cep == STRING_NONE || complement == STRING_NONE) {
+        return STATUS_NO_MEMORY;
+    }
+    Address* add = FindAddress(street, number, cep, complement);
+    if (add) {
+        if (add->id != c->addressId) {
+            AcquireAddress(add->id);
+            ReleaseAddress(c->addressId);
+            c->addressId = add->id;
+            RowChanged(ROW_CLIENTS, (int) (c - clients));
+        }
+        return STATUS_OK;
+    }
+
+    add = SearchAddressById(c->addressId);
+    if (add && add->id != -1 && addressRefs[add->id] == 1) {
+        UnindexAddress(add);
+    } else {
+        add = getEmptyAddress();
+        if (!add) {
+            return STATUS_NO_MEMORY;
+        }
+        AcquireAddress(add->id);
+        ReleaseAddress(c->addressId);
+        c->addressId = add->id;
+        RowChanged(ROW_CLIENTS, (int) (c - clients));
+    }
+    add->street = street;
+    add->number = number;
+    add->cep = cep;
+    add->complement = complement;
+    IndexAddress(add);
+    return STATUS_OK;
+}
+
+/**
+ * @brief Registers a new client living at the given address.
+ *
+ * The address fields are normalized and an identical existing address is shared.
+ *
+ * @param out Receives the new client on success. May be NULL.
+ * @return Status STATUS_OK, STATUS_INVALID for a malformed CPF, STATUS_DUPLICATE if the CPF is
+ *         taken, or STATUS_NO_MEMORY.
+ */
+Status ClientAdd(const char* name, const char* cpf, const char* street, const char* number,
+                 const char* cep, const char* complement, Client** out) {
+    if (!isValidCpf(cpf)) {
+        return STATUS_INVALID;
+    }
+    if (SearchClientByCPF(cpf)) {
+        return STATUS_DUPLICATE;
+    }
+    Client* c = getEmptyUser();
+    StringId id = StringIntern(name);
+    if (!c || id == STRING_NONE) {
+        return STATUS_NO_MEMORY;
+    }
+    c->addressId = -1;
+    Status s = clientSetAddress(c, InternAddressField(street, 0), InternAddressField(number, 0),
+                                InternAddressField(cep, 1), InternAddressField(complement, 0));
+    if (s != STATUS_OK) {
+        return s;
+    }
+    c->name = id;
+    c->fineAmount = 0;
+    strcpy(c->cpf, cpf);
+    SlotSetAdd(&clientsLive, (int) (c - clients));
+    branchTake(ROW_CLIENTS, (int) (c - clients));
+    RowChanged(ROW_CLIENTS, (int) (c - clients));
+    clientsVersion++;
+    if (out) {
+        *out = c;
+    }
+    return STATUS_OK;
+}
+
+/**
+ * @brief Changes the name of a client.
+ *
+ * @return Status STATUS_OK or STATUS_NO_MEMORY.
+ */
+Status ClientRename(Client* c, const char* name) {
+    StringId id = StringIntern(name);
+    if (id == STRING_NONE) {
+        return STATUS_NO_MEMORY;
+    }
+    c->name = id;
+    RowChanged(ROW_CLIENTS, (int) (c - clients));
+    clientsVersion++;
+    return STATUS_OK;
+}
+
+/**
+ * @brief Changes the CPF of a client, along with the CPF recorded on their open loan.
+ *
+ * @return Status STATUS_OK, STATUS_INVALID for a malformed CPF or STATUS_DUPLICATE if the CPF is taken.
+ */
+Status ClientChangeCpf(Client* c, const char* cpf) {
+    if (!isValidCpf(cpf)) {
+        return STATUS_INVALID;
+    }
+    Client* existing = SearchClientByCPF(cpf);
+    if (existing) {
+        return existing == c ? STATUS_OK : STATUS_DUPLICATE;
+    }
+    Loan* l = SearchLoanByClient(c->cpf);
+    if (l) {
+        strcpy(l->userCpf, cpf);
+        RowChanged(ROW_LOANS, l->id);
+    }
+    strcpy(c->cpf, cpf);
+    RowChanged(ROW_CLIENTS, (int) (c - clients));
+    clientsVersion++;
+    return STATUS_OK;
+}
+
+/**
+ * @brief Moves a client to another address.
+ *
+ * @return Status STATUS_OK or STATUS_NO_MEMORY.
+ */
+Status ClientMove(Client* c, const char* street, const char* number, const char* cep, const char* complement) {
+    return clientSetAddress(c, InternAddressField(street, 0), InternAddressField(number, 0),
+                            InternAddressField(cep, 1), InternAddressField(complement, 0));
+}
+
+/**
+ * @brief Removes a client. Their address goes away with its last client, and their ledger
+ *        with them.
+ *
+ * @param addressRemoved Set to 1 if the client's address was removed too, otherwise 0. May be NULL.
+ * @return Status STATUS_OK, STATUS_ACTIVE_LOAN if the client still has books to return, or
+ *         STATUS_IN_USE if the client has reservations or owes fines.
+ */
+Status ClientRemove(Client* c, int* addressRemoved) {
+    if (SearchLoanByClient(c->cpf)) {
+        return STATUS_ACTIVE_LOAN;
+    }
+    if (ClientHasReservations((int) (c - clients)) || c->fineAmount) {
+        return STATUS_IN_USE;
+    }
+    int removed = ReleaseAddress(c->addressId);
+    if (addressRemoved) {
+        *addressRemoved = removed;
+    }
+    LedgerForget((int) (c - clients));
+    initEmptyClient(c);
+    return STATUS_OK;
+}
+
+/**
+ * @brief Records a payment of a client's fines.
+ *
+ * @param cents The amount paid, at most what the client owes.
+ * @param day The day of the payment, as counted by DeadlineDay.
+ * @return Status STATUS_OK, STATUS_INVALID if the amount is not positive or more than the
+ *         client owes, or STATUS_NO_MEMORY.
+ */
+Status FinePay(Client* c, int cents, int day) {
+    if (cents <= 0 || cents > c->fineAmount) {
+        return STATUS_INVALID;
+    }
+    if (!TxSave(ROW_CLIENTS, (int) (c - clients)) || !LedgerPost((int) (c - clients), day, -cents)) {
+        return STATUS_NO_MEMORY;
+    }
+    return STATUS_OK;
+}
+
+/**
+ * @brief Calls `visit` for every registered client, in slot order.
+ */
+void ClientForEach(ClientVisitor visit, void* context) {
+    for (int i = SlotSetNext(&clientsLive, 0, clientsCapacity); i != -1; i = SlotSetNext(&clientsLive, i + 1, clientsCapacity)) {
+        visit(&clients[i], context);
+    }
+}
+
+/**
+ * @brief Calls `visit` for every client living on a street.
+ *
+ * @param street The street, normalized like the stored addresses before the lookup.
+ * @return int The number of clients visited.
+ */
+int ClientsAtStreet(const char* street, ClientVisitor visit, void* context) {
+    char* s = strdup(street);
+    if (!s) {
+        return 0;
+    }
+    NormalizeText(s);
+    StringId id = StringFind(s);
+    free(s);
+    int found = 0;
+    for (int i = 0; id != STRING_NONE && i < clientsCapacity; i++) {
+        int a = clients[i].addressId;
+        if (strcmp(clients[i].cpf, "0") && a >= 0 && a < addressesCapacity && addresses[a].street == id) {
+            if (visit) {
+                visit(&clients[i], context);
+            }
+            found++;
+        }
+    }
+    return found;
+}
+
+uint32_t clientNameKey(int slot) {
+    return SortKeyOfString(StringGet(clients[slot].name));
+}
+
+int clientNameTie(int a, int b) {
+    return strcmp(StringGet(clients[a].name), StringGet(clients[b].name));
+}
+
+uint32_t clientCpfKey(int slot) {
+    return SortKeyOfString(clients[slot].cpf);
+}
+
+int clientCpfTie(int a, int b) {
+    return strcmp(clients[a].cpf, clients[b].cpf);
+}
+
+unsigned clientsVersionOf(void) {
+    return clientsVersion;
+}
+
+/**
+ * @brief The clients sorted by name and by CPF, sorted again when the clients table changes.
+ */
+SortedView clientsByName = {&clientsLive, &clientsCapacity, clientNameKey, clientNameTie, clientsVersionOf,
+                            PTHREAD_MUTEX_INITIALIZER};
+SortedView clientsByCpf = {&clientsLive, &clientsCapacity, clientCpfKey, clientCpfTie, clientsVersionOf,
+                           PTHREAD_MUTEX_INITIALIZER};
+
+/**
+ * @brief Calls `visit` for every client owing more than an amount, largest debt first.
+ *
+ * Reads the ordering of fine_ledger.h: a binary search, then the clients visited. Takes the
+ * loans table shared, like the ledger. Balances are never negative, so below 0 the clients
+ * owing nothing follow, found by walking the clients.
+ *
+ * @param cents The amount in cents.
+ * @param visit The visitor, or NULL to only count the clients.
+ * @return int The number of clients owing more.
+ */
+int ClientsOwingMoreThan(int cents, ClientVisitor visit, void* context) {
+    int first = cents < 0 ? 0 : LedgerDebtAt((uint64_t) ((uint32_t) cents + 1) << 32);
+    int found = ledgerDebtCount - first;
+    for (int i = ledgerDebtCount - 1; visit && i >= first; i--) {
+        visit(&clients[(uint32_t) ledgerDebts[i]], context);
+    }
+    for (int i = SlotSetNext(&clientsLive, 0, clientsCapacity); cents < 0 && i != -1; i = SlotSetNext(&clientsLive, i + 1, clientsCapacity)) {
+        if (clients[i].fineAmount <= 0) {
+            if (visit) {
+                visit(&clients[i], context);
+            }
+            found++;
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief Points a cursor at the first page of clients.
+ *
+ * @param order The order to walk the clients in.
+ * @return int The number of clients on the page.
+ */
+int ClientCursor(Cursor* c, ClientOrder order, int pageSize) {
+    switch (order) {
+        case CLIENT_BY_NAME:
+            return CursorOpenSorted(c, &clientsByName, pageSize);
+        case CLIENT_BY_CPF:
+            return CursorOpenSorted(c, &clientsByCpf, pageSize);
+        default:
+            return CursorOpen(c, &clientsLive, &clientsCapacity, pageSize);
+    }
+}
+
+/**
+ * @brief Moves a client cursor to the page starting at a CPF.
+ *
+ * @return Status STATUS_OK, or STATUS_NOT_FOUND if no client has the CPF. The page is kept then.
+ */
+Status ClientCursorSeek(Cursor* c, const char* cpf) {
+    Client* found = SearchClientByCPF(cpf);
+    if (!found) {
+        return STATUS_NOT_FOUND;
+    }
+    CursorSeek(c, (int) (found - clients));
+    return STATUS_OK;
+}
+
+#endif
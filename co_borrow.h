@@ -0,0 +1,677 @@
+#ifndef CO_BORROW_H
+#define CO_BORROW_H
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "models.h"
+#include "repository.h"
+#include "deadline_index.h"
+#include "loan_history.h"
+
+/**
+ * @file co_borrow.h
+ * @brief How often every two books were borrowed together, for "readers also borrowed".
+ *
+ * Two books are borrowed together once for every loan holding both, and once for every time
+ * a client borrowed one of them and the other in their next loan, started at most
+ * COBORROW_GAP_DAYS after the first was returned.
+ *
+ * The counts form a sparse matrix with a row per book ID, kept in compressed sparse rows:
+ * the entries of book `b` are `coBorrowEntries[coBorrowRows[b]]` up to `coBorrowRows[b + 1]`,
+ * most borrowed first, so the top of a row is its first entries. New loans leave the rows
+ * alone: their pairs go to a hash table of pending counts, chained per row, which a query
+ * reads along with the row. Pending counts are merged into new rows once there are more than
+ * COBORROW_PENDING of them and they make up an eighth of the matrix.
+ *
+ * CoBorrowRebuild counts every pair again from the open loans and the loan history on
+ * several threads: each counts the pairs of a slice of the loans per row, then writes them at
+ * offsets summed over all the slices, and finally sorts and adds up a range of the rows.
+ *
+ * The matrix is guarded by the loans table lock: LOCK_LOANS exclusively to count a loan or
+ * rebuild, shared to read.
+ */
+
+/**
+ * @brief Most days between the return of a loan and the start of the client's next loan
+ *        for their books to count as borrowed together.
+ */
+#define COBORROW_GAP_DAYS 30
+
+/**
+ * @brief Pending counts kept at least before they are merged into the rows.
+ */
+#define COBORROW_PENDING 4096
+
+/**
+ * @brief Most threads a rebuild uses.
+ */
+#define COBORROW_MAX_THREADS 64
+
+/**
+ * @struct CoBorrow
+ * @brief A book and how many times it was borrowed together with the book of its row.
+ */
+typedef struct {
+    int bookId;
+    uint32_t count;
+} CoBorrow;
+
+/**
+ * @struct CoBorrowPending
+ * @brief A count not merged into the rows yet, chained to the previous pending count of its row.
+ */
+typedef struct {
+    int row;
+    int next;
+    CoBorrow entry;
+} CoBorrowPending;
+
+/**
+ * @struct CoBorrowJob
+ * @brief A slice of the loans, or a range of the rows, for one thread of a rebuild.
+ */
+typedef struct {
+    int pass;
+    long first;
+    long last;
+    int firstRow;
+    int lastRow;
+    long* rows;
+} CoBorrowJob;
+
+/**
+ * @brief Called once per pair of books by coBorrowPairs, for both orders of the pair.
+ */
+typedef void (*CoBorrowPairVisitor)(int row, int col, void* context);
+
+CoBorrow* coBorrowEntries;
+long* coBorrowRows;
+int coBorrowRowCount;
+CoBorrowPending* coBorrowPending;
+int coBorrowPendingCount;
+int coBorrowPendingCapacity;
+int* coBorrowPendingHead;
+int* coBorrowPendingSlots;
+int coBorrowPendingSlotCapacity;
+
+/**
+ * @brief Where a rebuild gets its loans and puts its pairs and rows.
+ *
+ * `coBorrowUnits` gives the first loan of every history partition in the numbering of the
+ * slices, the open loans coming after the last partition.
+ */
+long* coBorrowUnits;
+int* coBorrowRaw;
+int* coBorrowUnique;
+long* coBorrowRawRows;
+CoBorrow* coBorrowBuilt;
+long* coBorrowBuiltRows;
+
+/**
+ * @brief Orders co-borrowed books by count, highest first, then by ID.
+ */
+int compareCoBorrows(const void* a, const void* b) {
+    const CoBorrow* x = a;
+    const CoBorrow* y = b;
+    if (x->count != y->count) {
+        return x->count < y->count ? 1 : -1;
+    }
+    return (x->bookId > y->bookId) - (x->bookId < y->bookId);
+}
+
+/**
+ * @brief Orders book IDs.
+ */
+int compareCoBorrowIds(const void* a, const void* b) {
+    int x = *(const int*) a, y = *(const int*) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Adds empty rows up to `rows`.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int coBorrowFit(int rows) {
+    if (rows <= coBorrowRowCount) {
+        return 1;
+    }
+    long* grown = realloc(coBorrowRows, (rows + 1) * sizeof(long));
+    if (!grown) {
+        return 0;
+    }
+    coBorrowRows = grown;
+    int* heads = realloc(coBorrowPendingHead, rows * sizeof(int));
+    if (!heads) {
+        return 0;
+    }
+    coBorrowPendingHead = heads;
+    if (!coBorrowRowCount) {
+        coBorrowRows[0] = 0;
+    }
+    for (int r = coBorrowRowCount; r < rows; r++) {
+        coBorrowRows[r + 1] = coBorrowRows[r];
+        coBorrowPendingHead[r] = -1;
+    }
+    coBorrowRowCount = rows;
+    return 1;
+}
+
+/**
+ * @brief Hashes a pair of books for the pending counts.
+ */
+uint32_t coBorrowHash(int row, int col) {
+    return ((uint32_t) row * 2654435761u) ^ ((uint32_t) col * 2246822519u);
+}
+
+/**
+ * @brief Finds the pending count of a pair in the hash table.
+ *
+ * @return int The index of the slot holding the pair, the empty slot it would go in, or -1
+ *         if the table is empty.
+ */
+int coBorrowPendingSlot(int row, int col) {
+    if (!coBorrowPendingSlotCapacity) {
+        return -1;
+    }
+    uint32_t mask = (uint32_t) coBorrowPendingSlotCapacity - 1;
+    for (uint32_t s = coBorrowHash(row, col) & mask; ; s = (s + 1) & mask) {
+        int e = coBorrowPendingSlots[s];
+        if (e == -1 || (coBorrowPending[e].row == row && coBorrowPending[e].entry.bookId == col)) {
+            return (int) s;
+        }
+    }
+}
+
+/**
+ * @brief Tells whether a pair has a pending count.
+ */
+int coBorrowIsPending(int row, int col) {
+    int s = coBorrowPendingSlot(row, col);
+    return s != -1 && coBorrowPendingSlots[s] != -1;
+}
+
+/**
+ * @brief Makes room for one more pending count, keeping the hash table at most half full.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int coBorrowPendingFit(void) {
+    if (coBorrowPendingCount == coBorrowPendingCapacity) {
+        int capacity = coBorrowPendingCapacity ? coBorrowPendingCapacity * 2 : COBORROW_PENDING;
+        CoBorrowPending* grown = realloc(coBorrowPending, capacity * sizeof(CoBorrowPending));
+        if (!grown) {
+            return 0;
+        }
+        coBorrowPending = grown;
+        coBorrowPendingCapacity = capacity;
+    }
+    if ((coBorrowPendingCount + 1) * 2 <= coBorrowPendingSlotCapacity) {
+        return 1;
+    }
+    int capacity = coBorrowPendingSlotCapacity ? coBorrowPendingSlotCapacity * 2 : COBORROW_PENDING * 2;
+    int* slots = malloc(capacity * sizeof(int));
+    if (!slots) {
+        return 0;
+    }
+    memset(slots, 0xff, capacity * sizeof(int));
+    free(coBorrowPendingSlots);
+    coBorrowPendingSlots = slots;
+    coBorrowPendingSlotCapacity = capacity;
+    for (int e = 0; e < coBorrowPendingCount; e++) {
+        coBorrowPendingSlots[coBorrowPendingSlot(coBorrowPending[e].row, coBorrowPending[e].entry.bookId)] = e;
+    }
+    return 1;
+}
+
+/**
+ * @brief Drops every pending count.
+ */
+void coBorrowPendingClear(void) {
+    for (int e = 0; e < coBorrowPendingCount; e++) {
+        coBorrowPendingHead[coBorrowPending[e].row] = -1;
+    }
+    if (coBorrowPendingSlotCapacity) {
+        memset(coBorrowPendingSlots, 0xff, coBorrowPendingSlotCapacity * sizeof(int));
+    }
+    coBorrowPendingCount = 0;
+}
+
+/**
+ * @brief Counts a pair once more, as a pending count.
+ *
+ * @return int Returns 1 on success, otherwise returns 0 and the pair is not counted.
+ */
+int coBorrowAdd(int row, int col) {
+    if (!coBorrowFit((row > col ? row : col) + 1)) {
+        return 0;
+    }
+    int s = coBorrowPendingSlot(row, col);
+    if (s != -1 && coBorrowPendingSlots[s] != -1) {
+        coBorrowPending[coBorrowPendingSlots[s]].entry.count++;
+        return 1;
+    }
+    if (!coBorrowPendingFit()) {
+        return 0;
+    }
+    uint32_t count = 1;
+    for (long k = coBorrowRows[row]; k < coBorrowRows[row + 1]; k++) {
+        if (coBorrowEntries[k].bookId == col) {
+            count += coBorrowEntries[k].count;
+            break;
+        }
+    }
+    int e = coBorrowPendingCount++;
+    coBorrowPending[e] = (CoBorrowPending) {row, coBorrowPendingHead[row], {col, count}};
+    coBorrowPendingHead[row] = e;
+    coBorrowPendingSlots[coBorrowPendingSlot(row, col)] = e;
+    return 1;
+}
+
+/**
+ * @brief Writes the pending counts into new rows, sorting again the rows they changed.
+ *
+ * @return int Returns 1 on success, otherwise returns 0 and the counts stay pending.
+ */
+int coBorrowMerge(void) {
+    CoBorrow* entries = malloc((coBorrowRows[coBorrowRowCount] + coBorrowPendingCount) * sizeof(CoBorrow));
+    if (!entries) {
+        return 0;
+    }
+    long used = 0;
+    for (int r = 0; r < coBorrowRowCount; r++) {
+        long first = used;
+        if (coBorrowPendingHead[r] == -1) {
+            memcpy(&entries[used], &coBorrowEntries[coBorrowRows[r]], (coBorrowRows[r + 1] - coBorrowRows[r]) * sizeof(CoBorrow));
+            used += coBorrowRows[r + 1] - coBorrowRows[r];
+        } else {
+            for (long k = coBorrowRows[r]; k < coBorrowRows[r + 1]; k++) {
+                if (!coBorrowIsPending(r, coBorrowEntries[k].bookId)) {
+                    entries[used++] = coBorrowEntries[k];
+                }
+            }
+            for (int e = coBorrowPendingHead[r]; e != -1; e = coBorrowPending[e].next) {
+                entries[used++] = coBorrowPending[e].entry;
+            }
+            qsort(&entries[first], used - first, sizeof(CoBorrow), compareCoBorrows);
+        }
+        coBorrowRows[r] = first;
+    }
+    coBorrowRows[coBorrowRowCount] = used;
+    free(coBorrowEntries);
+    coBorrowEntries = entries;
+    coBorrowPendingClear();
+    return 1;
+}
+
+/**
+ * @brief Calls `visit` for every pair of books of a loan, and for every pair of a book of the
+ *        loan and a book of the previous loan of its client. Repeated books count once.
+ *
+ * @param previous The books of the previous loan, or NULL.
+ */
+void coBorrowPairs(const LoanItem* items, int count, const LoanItem* previous, int previousCount, CoBorrowPairVisitor visit,
+                   void* context) {
+    for (int i = 0; i < count; i++) {
+        int a = items[i].bookId, repeated = a < 0;
+        for (int k = 0; k < i && !repeated; k++) {
+            repeated = items[k].bookId == a;
+        }
+        if (repeated) {
+            continue;
+        }
+        for (int j = 0; j < count; j++) {
+            int b = items[j].bookId;
+            repeated = b < 0 || b == a;
+            for (int k = 0; k < j && !repeated; k++) {
+                repeated = items[k].bookId == b;
+            }
+            if (!repeated) {
+                visit(a, b, context);
+            }
+        }
+        for (int j = 0; j < previousCount; j++) {
+            int b = previous[j].bookId;
+            repeated = b < 0 || b == a;
+            for (int k = 0; k < j && !repeated; k++) {
+                repeated = previous[k].bookId == b;
+            }
+            if (!repeated) {
+                visit(a, b, context);
+                visit(b, a, context);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Finds the loan a client returned before starting a loan, if it was returned at most
+ *        COBORROW_GAP_DAYS before.
+ *
+ * @param partition The history partition of the loan, or historyPartitionCount for an open loan.
+ * @param loan The loan in its partition, or -1 for an open loan.
+ * @param items Receives the books of the previous loan.
+ * @return const ArchivedLoan* The previous loan, or NULL.
+ */
+const ArchivedLoan* coBorrowPrevious(const char* cpf, int startDay, int partition, int loan, const LoanItem** items) {
+    if (startDay == DEADLINE_NONE) {
+        return NULL;
+    }
+    int b = partition;
+    int i = loan == -1 ? -1 : historyPartitions[partition].clientNext[loan];
+    int first = historyPartitionAt(HistoryMonthOf(startDay - COBORROW_GAP_DAYS));
+    uint32_t hash = deadlineCpfHash(cpf);
+    while (i < 0 && --b >= first) {
+        HistoryPartition* p = &historyPartitions[b];
+        int s = historySlotOf(p, &p->byCpf, hash, cpf, -1);
+        i = s == -1 ? -1 : p->byCpf.slots[s].head;
+    }
+    if (i < 0) {
+        return NULL;
+    }
+    const HistoryPartition* p = &historyPartitions[b];
+    const ArchivedLoan* a = &p->loans[i];
+    if (startDay - a->returnDay > COBORROW_GAP_DAYS) {
+        return NULL;
+    }
+    *items = &p->items[a->itemOffset];
+    return a;
+}
+
+/**
+ * @brief Calls `visit` for every pair a loan counts, given where it is.
+ */
+void coBorrowLoanPairs(const char* cpf, int startDay, const LoanItem* items, int count, int partition, int loan,
+                       CoBorrowPairVisitor visit, void* context) {
+    const LoanItem* previousItems = NULL;
+    const ArchivedLoan* previous = coBorrowPrevious(cpf, startDay, partition, loan, &previousItems);
+    coBorrowPairs(items, count, previousItems, previous ? previous->itemCount : 0, visit, context);
+}
+
+/**
+ * @brief Counts a pair as pending.
+ */
+void coBorrowRecordPair(int row, int col, void* context) {
+    coBorrowAdd(row, col);
+}
+
+/**
+ * @brief Counts the pairs of a loan just made, merging the pending counts if they grew enough.
+ *
+ * Pairs that do not fit in memory are left out until the next rebuild.
+ */
+void CoBorrowRecordLoan(const Loan* l) {
+    coBorrowLoanPairs(l->userCpf, DeadlineDay(l->startDate), &loanItems[l->itemOffset], l->itemCount, historyPartitionCount, -1,
+                      coBorrowRecordPair, NULL);
+    if (coBorrowPendingCount > COBORROW_PENDING && coBorrowPendingCount * 8L > coBorrowRows[coBorrowRowCount]) {
+        coBorrowMerge();
+    }
+}
+
+/**
+ * @brief Counts a pair in its row, in the first pass of a rebuild.
+ */
+void coBorrowCountPair(int row, int col, void* context) {
+    CoBorrowJob* job = context;
+    if (row < coBorrowRowCount && col < coBorrowRowCount) {
+        job->rows[row]++;
+    }
+}
+
+/**
+ * @brief Writes a pair at the next offset of its row, in the second pass of a rebuild.
+ */
+void coBorrowWritePair(int row, int col, void* context) {
+    CoBorrowJob* job = context;
+    if (row < coBorrowRowCount && col < coBorrowRowCount) {
+        coBorrowRaw[job->rows[row]++] = col;
+    }
+}
+
+/**
+ * @brief Visits the pairs of a slice of the loans: archived loans, then open loan slots.
+ */
+void coBorrowSlice(CoBorrowJob* job, CoBorrowPairVisitor visit) {
+    int b = 0;
+    while (b < historyPartitionCount && coBorrowUnits[b + 1] <= job->first) {
+        b++;
+    }
+    for (long u = job->first; u < job->last; u++) {
+        while (b < historyPartitionCount && u >= coBorrowUnits[b + 1]) {
+            b++;
+        }
+        if (b < historyPartitionCount) {
+            HistoryPartition* p = &historyPartitions[b];
+            int i = (int) (u - coBorrowUnits[b]);
+            const ArchivedLoan* a = &p->loans[i];
+            coBorrowLoanPairs(a->userCpf, a->startDay, &p->items[a->itemOffset], a->itemCount, b, i, visit, job);
+        } else {
+            Loan* l = &loans[u - coBorrowUnits[b]];
+            if (l->id != -1) {
+                coBorrowLoanPairs(l->userCpf, DeadlineDay(l->startDate), &loanItems[l->itemOffset], l->itemCount,
+                                  historyPartitionCount, -1, visit, job);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Runs one pass of a rebuild over the slice or the rows of a job.
+ *
+ * Pass 0 counts the pairs per row, pass 1 writes them, pass 2 sorts the rows and counts
+ * their distinct books, and pass 3 writes the counts of the distinct books, most first.
+ */
+void* coBorrowPass(void* arg) {
+    CoBorrowJob* job = arg;
+    if (job->pass == 0 || job->pass == 1) {
+        coBorrowSlice(job, job->pass == 0 ? coBorrowCountPair : coBorrowWritePair);
+        return NULL;
+    }
+    for (int r = job->firstRow; r < job->lastRow; r++) {
+        int* raw = &coBorrowRaw[coBorrowRawRows[r]];
+        long n = coBorrowRawRows[r + 1] - coBorrowRawRows[r];
+        if (job->pass == 2) {
+            qsort(raw, n, sizeof(int), compareCoBorrowIds);
+            int unique = 0;
+            for (long k = 0; k < n; k++) {
+                unique += k == 0 || raw[k] != raw[k - 1];
+            }
+            coBorrowUnique[r] = unique;
+            continue;
+        }
+        CoBorrow* row = &coBorrowBuilt[coBorrowBuiltRows[r]];
+        int used = 0;
+        for (long k = 0; k < n; k++) {
+            if (k == 0 || raw[k] != raw[k - 1]) {
+                row[used++] = (CoBorrow) {raw[k], 0};
+            }
+            row[used - 1].count++;
+        }
+        qsort(row, used, sizeof(CoBorrow), compareCoBorrows);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Runs one pass of a rebuild on every job, the first on the calling thread.
+ */
+void coBorrowRun(CoBorrowJob* jobs, int threads, int pass) {
+    pthread_t workers[COBORROW_MAX_THREADS];
+    int started[COBORROW_MAX_THREADS];
+    for (int t = 0; t < threads; t++) {
+        jobs[t].pass = pass;
+        started[t] = t > 0 && !pthread_create(&workers[t], NULL, coBorrowPass, &jobs[t]);
+    }
+    coBorrowPass(&jobs[0]);
+    for (int t = 1; t < threads; t++) {
+        if (started[t]) {
+            pthread_join(workers[t], NULL);
+        } else {
+            coBorrowPass(&jobs[t]);
+        }
+    }
+}
+
+/**
+ * @brief Splits the rows between the jobs so that each gets about as many pairs.
+ */
+void coBorrowSplitRows(CoBorrowJob* jobs, int threads, const long* rows) {
+    int r = 0;
+    for (int t = 0; t < threads; t++) {
+        long until = rows[coBorrowRowCount] * (t + 1) / threads;
+        jobs[t].firstRow = r;
+        while (r < coBorrowRowCount && (rows[r + 1] <= until || t == threads - 1)) {
+            r++;
+        }
+        jobs[t].lastRow = r;
+    }
+}
+
+/**
+ * @brief Frees what a rebuild allocated for itself.
+ */
+void coBorrowRebuildFree(CoBorrowJob* jobs, int threads) {
+    for (int t = 0; t < threads; t++) {
+        free(jobs[t].rows);
+    }
+    free(coBorrowUnits);
+    free(coBorrowRaw);
+    free(coBorrowUnique);
+    free(coBorrowRawRows);
+    free(coBorrowBuilt);
+    free(coBorrowBuiltRows);
+    coBorrowUnits = NULL;
+    coBorrowRaw = NULL;
+    coBorrowUnique = NULL;
+    coBorrowRawRows = NULL;
+    coBorrowBuilt = NULL;
+    coBorrowBuiltRows = NULL;
+}
+
+/**
+ * @brief Counts every pair again from the open loans and the loan history, with a row per
+ *        slot of the books table.
+ *
+ * @param threads The threads to use, or 0 for one per online CPU (at most COBORROW_MAX_THREADS).
+ * @return int Returns 1 on success, otherwise returns 0 and the matrix is left as it was.
+ */
+int CoBorrowRebuild(int threads) {
+    if (threads <= 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online < 1 ? 1 : (int) online;
+    }
+    threads = threads > COBORROW_MAX_THREADS ? COBORROW_MAX_THREADS : threads;
+    if (!coBorrowFit(booksCapacity)) {
+        return 0;
+    }
+    CoBorrowJob jobs[COBORROW_MAX_THREADS] = {0};
+    coBorrowUnits = malloc((historyPartitionCount + 1) * sizeof(long));
+    coBorrowUnique = malloc((coBorrowRowCount + 1) * sizeof(int));
+    coBorrowRawRows = malloc((coBorrowRowCount + 1) * sizeof(long));
+    coBorrowBuiltRows = malloc((coBorrowRowCount + 1) * sizeof(long));
+    int fits = coBorrowUnits && coBorrowUnique && coBorrowRawRows && coBorrowBuiltRows;
+    for (int t = 0; fits && t < threads; t++) {
+        jobs[t].rows = calloc(coBorrowRowCount + 1, sizeof(long));
+        fits = jobs[t].rows != NULL;
+    }
+    if (!fits) {
+        coBorrowRebuildFree(jobs, threads);
+        return 0;
+    }
+    coBorrowUnits[0] = 0;
+    for (int b = 0; b < historyPartitionCount; b++) {
+        coBorrowUnits[b + 1] = coBorrowUnits[b] + historyPartitions[b].loanCount;
+    }
+    long units = coBorrowUnits[historyPartitionCount] + loansCapacity;
+    for (int t = 0; t < threads; t++) {
+        jobs[t].first = units * t / threads;
+        jobs[t].last = units * (t + 1) / threads;
+    }
+    coBorrowRun(jobs, threads, 0);
+
+    long total = 0;
+    for (int r = 0; r < coBorrowRowCount; r++) {
+        coBorrowRawRows[r] = total;
+        for (int t = 0; t < threads; t++) {
+            long count = jobs[t].rows[r];
+            jobs[t].rows[r] = total;
+            total += count;
+        }
+    }
+    coBorrowRawRows[coBorrowRowCount] = total;
+    coBorrowRaw = malloc((total ? total : 1) * sizeof(int));
+    if (!coBorrowRaw) {
+        coBorrowRebuildFree(jobs, threads);
+        return 0;
+    }
+    coBorrowRun(jobs, threads, 1);
+    coBorrowSplitRows(jobs, threads, coBorrowRawRows);
+    coBorrowRun(jobs, threads, 2);
+
+    coBorrowBuiltRows[0] = 0;
+    for (int r = 0; r < coBorrowRowCount; r++) {
+        coBorrowBuiltRows[r + 1] = coBorrowBuiltRows[r] + coBorrowUnique[r];
+    }
+    coBorrowBuilt = malloc((coBorrowBuiltRows[coBorrowRowCount] ? coBorrowBuiltRows[coBorrowRowCount] : 1) * sizeof(CoBorrow));
+    if (!coBorrowBuilt) {
+        coBorrowRebuildFree(jobs, threads);
+        return 0;
+    }
+    coBorrowRun(jobs, threads, 3);
+
+    coBorrowPendingClear();
+    free(coBorrowEntries);
+    free(coBorrowRows);
+    coBorrowEntries = coBorrowBuilt;
+    coBorrowRows = coBorrowBuiltRows;
+    coBorrowBuilt = NULL;
+    coBorrowBuiltRows = NULL;
+    coBorrowRebuildFree(jobs, threads);
+    return 1;
+}
+
+/**
+ * @brief Keeps a co-borrowed book among the `n` most borrowed found so far, sorted.
+ */
+void coBorrowOffer(CoBorrow* top, int* count, int n, CoBorrow entry) {
+    int i = *count < n ? (*count)++ : n;
+    if (i == n && compareCoBorrows(&entry, &top[n - 1]) >= 0) {
+        return;
+    }
+    for (i = i == n ? n - 1 : i; i > 0 && compareCoBorrows(&entry, &top[i - 1]) < 0; i--) {
+        top[i] = top[i - 1];
+    }
+    top[i] = entry;
+}
+
+/**
+ * @brief The books borrowed the most together with a book.
+ *
+ * Reads the pending counts of the book, then its row until `n` books without a pending
+ * count were read, so the time does not depend on the loans.
+ *
+ * @param top Receives at most `n` books, most borrowed together first. Removed books are included.
+ * @return int The number of books.
+ */
+int CoBorrowTop(int bookId, CoBorrow* top, int n) {
+    int count = 0;
+    if (bookId < 0 || bookId >= coBorrowRowCount || n <= 0) {
+        return 0;
+    }
+    for (int e = coBorrowPendingHead[bookId]; e != -1; e = coBorrowPending[e].next) {
+        coBorrowOffer(top, &count, n, coBorrowPending[e].entry);
+    }
+    int taken = 0;
+    for (long k = coBorrowRows[bookId]; k < coBorrowRows[bookId + 1] && taken < n; k++) {
+        if (coBorrowPendingHead[bookId] == -1 || !coBorrowIsPending(bookId, coBorrowEntries[k].bookId)) {
+            coBorrowOffer(top, &count, n, coBorrowEntries[k]);
+            taken++;
+        }
+    }
+    return count;
+}
+
+#endif
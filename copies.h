@@ -0,0 +1,349 @@
+#ifndef COPIES_H
+#define COPIES_H
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "models.h"
+#include "status.h"
+#include "repository.h"
+#include "row_log.h"
+
+/**
+ * @file copies.h
+ * @brief The physical copies of the books: their barcodes and where each one is.
+ *
+ * The copies of a book are a run of the copy table, given by `copyRuns`, and `copyBits` has a
+ * bitset per CopyState telling which copies are in it. Finding a copy in a state takes the
+ * first set bit of the run's words and counting them adds up the popcounts of those words,
+ * so both take a step per 64 copies however many a title has.
+ *
+ * A copy leaves a state by clearing its bit with an atomic and. The desk whose and cleared
+ * the bit holds the copy and puts it in its next state, so desks lending the same title at
+ * once never lend the same copy, and need no lock on the book. `Book::stock` and
+ * `Book::amount` keep counting the copies on the shelf and in the collection.
+ *
+ * Copies are appended with the books table locked exclusively, and read and moved with it
+ * locked shared. Lent and held copies are only moved with the loans table locked
+ * exclusively. On disk, the copies are written in barcode order.
+ */
+
+/**
+ * @brief Copies per word of the bitsets.
+ */
+#define COPY_WORD_BITS 64
+
+/**
+ * @brief Called once per copy by CopiesForEach.
+ */
+typedef void (*CopyVisitor)(int copy, void* context);
+
+/**
+ * @brief The bit of a copy in its word.
+ */
+uint64_t copyBit(int copy) {
+    return (uint64_t) 1 << (copy % COPY_WORD_BITS);
+}
+
+/**
+ * @brief The bits of the words of a run that belong to its copies.
+ */
+uint64_t copyRunMask(const CopyRun* run, int word) {
+    int last = run->first + run->count - 1;
+    uint64_t mask = ~(uint64_t) 0;
+    if (word == run->first / COPY_WORD_BITS) {
+        mask &= ~(uint64_t) 0 << (run->first % COPY_WORD_BITS);
+    }
+    if (word == last / COPY_WORD_BITS) {
+        mask &= ~(uint64_t) 0 >> (COPY_WORD_BITS - 1 - last % COPY_WORD_BITS);
+    }
+    return mask;
+}
+
+/**
+ * @brief Makes room for `n` more copies in the copy table and its bitsets.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int copiesReserve(int n) {
+    while (copiesUsed + n > copiesCapacity) {
+        if (ArenaGrowTable(&copiesArena, sizeof(Copy), &copiesCapacity, MAX_ENTITIES) == -1) {
+            return 0;
+        }
+    }
+    int words = (copiesCapacity + COPY_WORD_BITS - 1) / COPY_WORD_BITS;
+    for (int s = 0; s < COPY_STATES; s++) {
+        if (!ArenaResizeColumn(&copyBitsArenas[s], sizeof(uint64_t), words)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Puts a copy the caller holds in a state.
+ */
+void copyEnter(int copy, CopyState state) {
+    atomic_store(&copies[copy].state, state);
+    if (state != COPY_RETIRED) {
+        atomic_fetch_or(&copyBits[state][copy / COPY_WORD_BITS], copyBit(copy));
+    }
+}
+
+/**
+ * @brief Takes a copy out of a state.
+ *
+ * @return int Returns 1 if the copy was in the state and is now held by the caller, otherwise
+ *         returns 0.
+ */
+int copyLeave(int copy, CopyState state) {
+    return (atomic_fetch_and(&copyBits[state][copy / COPY_WORD_BITS], ~copyBit(copy)) & copyBit(copy)) != 0;
+}
+
+/**
+ * @brief Finds the first copy of a book in a state, from a barcode on.
+ *
+ * @return int The barcode of the copy, or -1 if there is none.
+ */
+int CopyNext(int bookId, CopyState state, int from) {
+    const CopyRun* run = &copyRuns[bookId];
+    int end = run->first + run->count;
+    if (from < run->first) {
+        from = run->first;
+    }
+    for (int w = from / COPY_WORD_BITS; from < end && w <= (end - 1) / COPY_WORD_BITS; w++) {
+        uint64_t bits = atomic_load_explicit(&copyBits[state][w], memory_order_relaxed) & copyRunMask(run, w);
+        if (w == from / COPY_WORD_BITS) {
+            bits &= ~(uint64_t) 0 << (from % COPY_WORD_BITS);
+        }
+        if (bits) {
+            return w * COPY_WORD_BITS + __builtin_ctzll(bits);
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Counts the copies of a book in a state.
+ */
+int CopiesCount(int bookId, CopyState state) {
+    const CopyRun* run = &copyRuns[bookId];
+    int count = 0;
+    for (int w = run->first / COPY_WORD_BITS; run->count && w <= (run->first + run->count - 1) / COPY_WORD_BITS; w++) {
+        count += __builtin_popcountll(atomic_load_explicit(&copyBits[state][w], memory_order_relaxed) & copyRunMask(run, w));
+    }
+    return count;
+}
+
+/**
+ * @brief Calls `visit` for every copy of a book in a state, by barcode.
+ *
+ * @return int The number of copies visited.
+ */
+int CopiesForEach(int bookId, CopyState state, CopyVisitor visit, void* context) {
+    int count = 0;
+    for (int copy = CopyNext(bookId, state, 0); copy != -1; copy = CopyNext(bookId, state, copy + 1)) {
+        visit(copy, context);
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Moves any copy of a book from one state to another.
+ *
+ * A copy taken by another desk meanwhile is skipped, and the search starts over.
+ *
+ * @return int The barcode of the copy moved, or -1 if the book has none in `from`.
+ */
+int CopyTake(int bookId, CopyState from, CopyState to) {
+    int copy = CopyNext(bookId, from, 0);
+    while (copy != -1 && !copyLeave(copy, from)) {
+        copy = CopyNext(bookId, from, 0);
+    }
+    if (copy != -1) {
+        copyEnter(copy, to);
+    }
+    return copy;
+}
+
+/**
+ * @brief Moves a copy the caller holds, lent, held or damaged, to another state.
+ *
+ * Copies on the shelf are taken with CopyTake instead, since other desks may take them.
+ */
+void CopyMove(int copy, CopyState to) {
+    int from = atomic_load(&copies[copy].state);
+    if (from != COPY_RETIRED) {
+        copyLeave(copy, from);
+    }
+    copyEnter(copy, to);
+}
+
+/**
+ * @brief Appends the copies of a new book to the copy table, all of them on the shelf.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int CopiesIssue(int bookId, int n) {
+    if (!copiesReserve(n)) {
+        return 0;
+    }
+    copyRuns[bookId] = (CopyRun) {copiesUsed, n};
+    for (int k = 0; k < n; k++) {
+        copies[copiesUsed + k].bookId = bookId;
+        copyEnter(copiesUsed + k, COPY_ON_SHELF);
+    }
+    copiesUsed += n;
+    return 1;
+}
+
+/**
+ * @brief Takes copies of a book out of the collection.
+ *
+ * @param n The number of copies on the shelf to retire, or -1 to retire every copy.
+ */
+void CopiesRetire(int bookId, int n) {
+    int copy;
+    for (int k = 0; (n == -1 || k < n) && (copy = CopyNext(bookId, COPY_ON_SHELF, 0)) != -1; k++) {
+        CopyMove(copy, COPY_RETIRED);
+    }
+    for (int s = COPY_LENT; n == -1 && s < COPY_STATES; s++) {
+        while ((copy = CopyNext(bookId, s, 0)) != -1) {
+            CopyMove(copy, COPY_RETIRED);
+        }
+    }
+}
+
+/**
+ * @brief Finds a copy by barcode.
+ *
+ * @return Copy* The copy, or NULL if there is none or it was retired.
+ */
+Copy* SearchCopyByBarcode(int barcode) {
+    if (barcode < 0 || barcode >= copiesUsed || copies[barcode].state == COPY_RETIRED) {
+        return NULL;
+    }
+    return &copies[barcode];
+}
+
+/**
+ * @brief Moves a copy between the shelf and the damaged copies, changing the stock of its book.
+ *
+ * @return Status STATUS_OK, STATUS_NOT_FOUND for an unknown barcode, or STATUS_INVALID if the
+ *         copy is not in `from`.
+ */
+Status copySwap(int barcode, CopyState from, CopyState to) {
+    Copy* c = SearchCopyByBarcode(barcode);
+    if (!c) {
+        return STATUS_NOT_FOUND;
+    }
+    if (!copyLeave(barcode, from)) {
+        return STATUS_INVALID;
+    }
+    copyEnter(barcode, to);
+    int delta = to == COPY_ON_SHELF ? 1 : -1;
+    atomic_fetch_add(&books[c->bookId].stock, delta);
+    StockChanged(c->bookId, delta);
+    booksVersion++;
+    return STATUS_OK;
+}
+
+/**
+ * @brief Takes a copy off the shelf as damaged. It still counts in the amount of its book.
+ *
+ * @return Status STATUS_OK, STATUS_NOT_FOUND for an unknown barcode, or STATUS_INVALID if the
+ *         copy is not on the shelf.
+ */
+Status CopyDamage(int barcode) {
+    return copySwap(barcode, COPY_ON_SHELF, COPY_DAMAGED);
+}
+
+/**
+ * @brief Puts a damaged copy back on the shelf.
+ *
+ * @return Status STATUS_OK, STATUS_NOT_FOUND for an unknown barcode, or STATUS_INVALID if the
+ *         copy is not damaged.
+ */
+Status CopyRepair(int barcode) {
+    return copySwap(barcode, COPY_DAMAGED, COPY_ON_SHELF);
+}
+
+/**
+ * @brief Reads the copies written by SaveCopies.
+ *
+ * @param f The file to read from, past its magic number.
+ */
+void LoadCopies(FILE* f) {
+    Copy c;
+    while (fread(&c, sizeof(Copy), 1, f) == 1 && copiesReserve(1)) {
+        copies[copiesUsed++] = c;
+    }
+}
+
+/**
+ * @brief Writes every copy, retired ones included, so that barcodes are kept.
+ *
+ * @param f The file to write to, past its magic number.
+ */
+void SaveCopies(FILE* f) {
+    fwrite(copies, sizeof(Copy), copiesUsed, f);
+}
+
+/**
+ * @brief Rebuilds the runs and bitsets from the state of every copy, then counts the stock
+ *        and amount of every book from its copies.
+ *
+ * Books saved before copies had barcodes get their `amount` copies now: `stock` of them on
+ * the shelf, one lent for every item of an open loan that names no copy, and the rest held
+ * for reservations. Copies of books that no longer exist are retired.
+ *
+ * Called once after the data files are imported.
+ */
+void RebuildCopies(void) {
+    for (int s = 0; s < COPY_STATES; s++) {
+        memset(copyBits[s], 0, (copiesCapacity + COPY_WORD_BITS - 1) / COPY_WORD_BITS * sizeof(uint64_t));
+    }
+    memset(copyRuns, 0, booksCapacity * sizeof(CopyRun));
+    for (int i = 0; i < copiesUsed; i++) {
+        int bookId = copies[i].bookId;
+        int state = copies[i].state;
+        if (bookId < 0 || bookId >= booksCapacity || books[bookId].id == -1 || state < 0 || state > COPY_RETIRED) {
+            copies[i].state = state = COPY_RETIRED;
+        }
+        if (state == COPY_RETIRED) {
+            continue;
+        }
+        CopyRun* run = &copyRuns[bookId];
+        if (!run->count) {
+            run->first = i;
+        }
+        run->count = i - run->first + 1;
+        copyEnter(i, state);
+    }
+    for (int i = 0; i < booksCapacity; i++) {
+        if (books[i].id != -1 && !copyRuns[i].count && books[i].amount > 0 && CopiesIssue(i, books[i].amount)) {
+            for (int k = books[i].stock; k < books[i].amount; k++) {
+                CopyMove(copyRuns[i].first + k, COPY_HELD);
+            }
+        }
+    }
+    for (int i = 0; i < loansCapacity; i++) {
+        for (int k = 0; loans[i].id != -1 && k < loans[i].itemCount; k++) {
+            LoanItem* item = &loanItems[loans[i].itemOffset + k];
+            if (item->copyId == -1 && item->bookId >= 0 && item->bookId < booksCapacity && books[item->bookId].id != -1) {
+                item->copyId = CopyTake(item->bookId, COPY_HELD, COPY_LENT);
+            }
+        }
+    }
+    for (int i = 0; i < booksCapacity; i++) {
+        if (books[i].id != -1) {
+            books[i].stock = CopiesCount(i, COPY_ON_SHELF);
+            books[i].amount = books[i].stock + CopiesCount(i, COPY_LENT) + CopiesCount(i, COPY_HELD) +
+                              CopiesCount(i, COPY_DAMAGED);
+        }
+    }
+}
+
+#endif
@@ -4,7 +4,17 @@
 
 struct termios old, current;
 
-char buffer[100];
+/**
+ * @brief Size of the global input buffer.
+ */
+#define BUFFER_SIZE 1024
+
+/**
+ * @brief Longest free text (names, titles, streets...) accepted by fillBuffer.
+ */
+#define TEXT_MAX (BUFFER_SIZE - 3)
+
+char buffer[BUFFER_SIZE];
 
 /**
  * @brief Clears the standard input buffer.
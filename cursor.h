@@ -0,0 +1,194 @@
+#ifndef CURSOR_H
+#define CURSOR_H
+
+#include "slot_set.h"
+#include "sorted_view.h"
+
+/**
+ * @brief Largest page a cursor can hold.
+ */
+#define CURSOR_MAX_PAGE 256
+
+/**
+ * @struct Cursor
+ * @brief A page of records of a table, walked forwards or backwards.
+ *
+ * A page is anchored at the slots it holds rather than at a row number, so records added
+ * or removed elsewhere do not shift it. Moving costs O(page size) plus one bitmap word per
+ * 64 empty slots skipped, whatever the size of the table. A cursor opened on a sorted view
+ * walks the view instead and is anchored at a position in it.
+ *
+ * @var Cursor::set
+ * The occupied slots of the table.
+ *
+ * @var Cursor::capacity
+ * The capacity of the table, read on every move since tables grow.
+ *
+ * @var Cursor::pageSize
+ * Records per page, between 1 and CURSOR_MAX_PAGE.
+ *
+ * @var Cursor::count
+ * Records on the current page.
+ *
+ * @var Cursor::slots
+ * Slots of the records on the current page, in table order or in the order of the view.
+ *
+ * @var Cursor::view
+ * The ordering walked, or NULL to walk the table in slot order.
+ *
+ * @var Cursor::position
+ * Position in the view of the first record on the page.
+ */
+typedef struct {
+    const SlotSet* set;
+    const int* capacity;
+    SortedView* view;
+    int position;
+    int pageSize;
+    int count;
+    int slots[CURSOR_MAX_PAGE];
+} Cursor;
+
+/**
+ * @brief Fills the page with the records of the view from a position onwards.
+ *
+ * The view is sorted again first if its table changed. A position past the end, left by
+ * records removed since, is moved back to the last record.
+ *
+ * @return int The number of records on the page.
+ */
+int cursorFillOrdered(Cursor* c, int position) {
+    pthread_mutex_lock(&c->view->lock);
+    SortedViewRefresh(c->view);
+    if (position > c->view->count - 1) {
+        position = c->view->count - 1;
+    }
+    c->position = position < 0 ? 0 : position;
+    c->count = 0;
+    while (c->count < c->pageSize && c->position + c->count < c->view->count) {
+        c->slots[c->count] = c->view->order[c->position + c->count];
+        c->count++;
+    }
+    pthread_mutex_unlock(&c->view->lock);
+    return c->count;
+}
+
+/**
+ * @brief Fills the page with the records from a slot onwards.
+ *
+ * @return int The number of records on the page.
+ */
+int CursorSeek(Cursor* c, int slot) {
+    if (c->view) {
+        pthread_mutex_lock(&c->view->lock);
+        SortedViewRefresh(c->view);
+        int position = SortedViewFind(c->view, slot);
+        pthread_mutex_unlock(&c->view->lock);
+        return cursorFillOrdered(c, position);
+    }
+    c->count = 0;
+    for (int s = SlotSetNext(c->set, slot, *c->capacity); s != -1 && c->count < c->pageSize;
+         s = SlotSetNext(c->set, s + 1, *c->capacity)) {
+        c->slots[c->count++] = s;
+    }
+    return c->count;
+}
+
+/**
+ * @brief Points a cursor at the first page of a table.
+ *
+ * @return int The number of records on the page.
+ */
+int CursorOpen(Cursor* c, const SlotSet* set, const int* capacity, int pageSize) {
+    c->set = set;
+    c->capacity = capacity;
+    c->view = NULL;
+    c->position = 0;
+    c->pageSize = pageSize < 1 ? 1 : pageSize > CURSOR_MAX_PAGE ? CURSOR_MAX_PAGE : pageSize;
+    return CursorSeek(c, 0);
+}
+
+/**
+ * @brief Points a cursor at the first page of a sorted view.
+ *
+ * @return int The number of records on the page.
+ */
+int CursorOpenSorted(Cursor* c, SortedView* view, int pageSize) {
+    CursorOpen(c, view->set, view->capacity, pageSize);
+    c->view = view;
+    return cursorFillOrdered(c, 0);
+}
+
+/**
+ * @brief Moves to the page after the current one.
+ *
+ * @return int The number of records on the new page, or 0 if this is the last page.
+ *         The current page is kept in that case.
+ */
+int CursorNext(Cursor* c) {
+    if (c->view) {
+        pthread_mutex_lock(&c->view->lock);
+        SortedViewRefresh(c->view);
+        int last = c->position + c->count >= c->view->count;
+        pthread_mutex_unlock(&c->view->lock);
+        return last ? 0 : cursorFillOrdered(c, c->position + c->count);
+    }
+    int from = c->count ? c->slots[c->count - 1] + 1 : 0;
+    if (SlotSetNext(c->set, from, *c->capacity) == -1) {
+        return 0;
+    }
+    return CursorSeek(c, from);
+}
+
+/**
+ * @brief Moves to the page before the current one.
+ *
+ * If fewer than a page of records precede it, the cursor goes back to the first page.
+ *
+ * @return int The number of records on the new page, or 0 if this is the first page.
+ *         The current page is kept in that case.
+ */
+int CursorPrev(Cursor* c) {
+    if (c->view) {
+        if (c->position == 0) {
+            return 0;
+        }
+        return cursorFillOrdered(c, c->position - c->pageSize);
+    }
+    int first = c->count ? c->slots[0] : *c->capacity;
+    int s = SlotSetPrev(c->set, first - 1);
+    if (s == -1) {
+        return 0;
+    }
+    for (int n = 1; n < c->pageSize; n++) {
+        int before = SlotSetPrev(c->set, s - 1);
+        if (before == -1) {
+            break;
+        }
+        s = before;
+    }
+    return CursorSeek(c, s);
+}
+
+/**
+ * @brief Changes the page size, keeping the first record of the page in place.
+ *
+ * @return int The number of records on the page.
+ */
+int CursorResize(Cursor* c, int pageSize) {
+    int first = c->count ? c->slots[0] : 0;
+    c->pageSize = pageSize < 1 ? 1 : pageSize > CURSOR_MAX_PAGE ? CURSOR_MAX_PAGE : pageSize;
+    if (c->view) {
+        return cursorFillOrdered(c, c->position);
+    }
+    return CursorSeek(c, first);
+}
+
+/**
+ * @brief Number of records in the table the cursor walks.
+ */
+int CursorTotal(const Cursor* c) {
+    return c->set->count;
+}
+
+#endif
@@ -0,0 +1,321 @@
+#ifndef DEADLINE_INDEX_H
+#define DEADLINE_INDEX_H
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "models.h"
+#include "repository.h"
+
+/**
+ * @file deadline_index.h
+ * @brief The open loans bucketed by the day of their deadline.
+ *
+ * Every day with at least one deadline has a bucket, and the buckets are kept sorted by
+ * day. The loans of a bucket form an intrusive doubly linked list through per-slot
+ * columns, so a loan is linked or unlinked in constant time once its bucket is found,
+ * and a range of days is walked in the time of a binary search plus the loans it holds.
+ *
+ * The `deadlineDays` and `deadlineClients` columns also give the day and the client of
+ * every open loan by slot, for sweeps over all the loans at once.
+ *
+ * The index is changed under the loans table lock taken exclusively, and read under it
+ * taken shared.
+ */
+
+/**
+ * @brief The day of a loan that is not indexed.
+ */
+#define DEADLINE_NONE INT_MIN
+
+/**
+ * @struct DeadlineBucket
+ * @brief The first loan due on a day.
+ */
+typedef struct {
+    int day;
+    int head;
+} DeadlineBucket;
+
+/**
+ * @brief Called once per loan by DeadlineIndexWalk.
+ */
+typedef void (*DeadlineVisitor)(Loan* l, void* context);
+
+DeadlineBucket* deadlineBuckets;
+int deadlineBucketCount;
+int deadlineBucketCapacity;
+int* deadlineNext;
+int* deadlinePrev;
+int* deadlineDays;
+int* deadlineClients;
+int deadlineCapacity;
+
+/**
+ * @brief Counts the days from 1970-01-01 to a civil date.
+ */
+int daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int yearOfEra = year - era * 400;
+    int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+/**
+ * @brief Gives the civil date of a day counted from 1970-01-01, the inverse of daysFromCivil.
+ */
+void civilFromDays(int days, int* year, int* month, int* day) {
+    days += 719468;
+    int era = (days >= 0 ? days : days - 146096) / 146097;
+    int dayOfEra = days - era * 146097;
+    int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int monthIndex = (5 * dayOfYear + 2) / 153;
+    *day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    *month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    *year = yearOfEra + era * 400 + (*month <= 2);
+}
+
+/**
+ * @brief The day of a YYYY-MM-DD date.
+ *
+ * @return int The days since 1970-01-01, or DEADLINE_NONE if the date cannot be read.
+ */
+int DeadlineDay(const char* date) {
+    int year, month, day;
+    if (sscanf(date, "%d-%d-%d", &year, &month, &day) != 3 || month < 1 || month > 12 || day < 1 || day > 31) {
+        return DEADLINE_NONE;
+    }
+    return daysFromCivil(year, month, day);
+}
+
+/**
+ * @brief The day of the local date at a time.
+ */
+int DeadlineDayAt(time_t t) {
+    struct tm tm;
+    localtime_r(&t, &tm);
+    return daysFromCivil(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+}
+
+/**
+ * @brief The day of today's local date.
+ */
+int DeadlineToday(void) {
+    return DeadlineDayAt(time(NULL));
+}
+
+/**
+ * @brief Finds the first bucket whose day is not before `day`.
+ */
+int deadlineBucketAt(int day) {
+    int low = 0, high = deadlineBucketCount;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (deadlineBuckets[mid].day < day) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief Takes an indexed loan out of its bucket, dropping the bucket if it empties.
+ */
+void deadlineUnlink(int slot) {
+    int next = deadlineNext[slot], prev = deadlinePrev[slot];
+    if (prev != -1) {
+        deadlineNext[prev] = next;
+    } else {
+        int b = deadlineBucketAt(deadlineDays[slot]);
+        if (next != -1) {
+            deadlineBuckets[b].head = next;
+        } else {
+            memmove(&deadlineBuckets[b], &deadlineBuckets[b + 1], (deadlineBucketCount - b - 1) * sizeof(DeadlineBucket));
+            deadlineBucketCount--;
+        }
+    }
+    if (next != -1) {
+        deadlinePrev[next] = prev;
+    }
+    deadlineDays[slot] = DEADLINE_NONE;
+}
+
+/**
+ * @brief Puts a loan at the head of the bucket of a day, adding the bucket if needed.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int deadlineLink(int slot, int day) {
+    int b = deadlineBucketAt(day);
+    if (b == deadlineBucketCount || deadlineBuckets[b].day != day) {
+        if (deadlineBucketCount == deadlineBucketCapacity) {
+            int capacity = deadlineBucketCapacity ? deadlineBucketCapacity * 2 : 64;
+            DeadlineBucket* grown = realloc(deadlineBuckets, capacity * sizeof(DeadlineBucket));
+            if (!grown) {
+                return 0;
+            }
+            deadlineBuckets = grown;
+            deadlineBucketCapacity = capacity;
+        }
+        memmove(&deadlineBuckets[b + 1], &deadlineBuckets[b], (deadlineBucketCount - b) * sizeof(DeadlineBucket));
+        deadlineBucketCount++;
+        deadlineBuckets[b] = (DeadlineBucket) {day, -1};
+    }
+    int head = deadlineBuckets[b].head;
+    deadlineNext[slot] = head;
+    deadlinePrev[slot] = -1;
+    if (head != -1) {
+        deadlinePrev[head] = slot;
+    }
+    deadlineBuckets[b].head = slot;
+    deadlineDays[slot] = day;
+    return 1;
+}
+
+/**
+ * @brief Makes room in the per-slot columns for every slot of the loans table.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int deadlineColumnsFit(void) {
+    if (deadlineCapacity >= loansCapacity) {
+        return 1;
+    }
+    int* next = realloc(deadlineNext, loansCapacity * sizeof(int));
+    if (next) {
+        deadlineNext = next;
+    }
+    int* prev = realloc(deadlinePrev, loansCapacity * sizeof(int));
+    if (prev) {
+        deadlinePrev = prev;
+    }
+    int* days = realloc(deadlineDays, loansCapacity * sizeof(int));
+    if (days) {
+        deadlineDays = days;
+    }
+    int* owners = realloc(deadlineClients, loansCapacity * sizeof(int));
+    if (owners) {
+        deadlineClients = owners;
+    }
+    if (!next || !prev || !days || !owners) {
+        return 0;
+    }
+    for (int i = deadlineCapacity; i < loansCapacity; i++) {
+        deadlineDays[i] = DEADLINE_NONE;
+    }
+    deadlineCapacity = loansCapacity;
+    return 1;
+}
+
+/**
+ * @brief Brings the index entry of a loan slot in line with the loan, after it was opened,
+ *        closed or restored.
+ *
+ * The client of a newly opened loan is recorded by the caller in `deadlineClients`; it is
+ * kept when the loan is closed, so a restored loan finds it again.
+ *
+ * @return int Returns 1 on success, otherwise returns 0 and the loan is left out of the index.
+ *         Taking a closed loan out never fails.
+ */
+int DeadlineIndexSet(int slot) {
+    if (slot >= deadlineCapacity && !deadlineColumnsFit()) {
+        return loans[slot].id == -1;
+    }
+    int day = loans[slot].id != -1 ? DeadlineDay(loans[slot].deadline) : DEADLINE_NONE;
+    if (deadlineDays[slot] == day) {
+        return 1;
+    }
+    if (deadlineDays[slot] != DEADLINE_NONE) {
+        deadlineUnlink(slot);
+    }
+    return day == DEADLINE_NONE || deadlineLink(slot, day);
+}
+
+/**
+ * @brief Hashes a CPF for the client table built by RebuildDeadlineIndex.
+ */
+uint32_t deadlineCpfHash(const char* cpf) {
+    uint32_t h = 2166136261u;
+    for (; *cpf; cpf++) {
+        h = (h ^ (unsigned char) *cpf) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief Indexes every open loan again, with its client, after the data files were read.
+ *
+ * The clients are looked up by CPF in a temporary hash table, so the rebuild takes time
+ * linear in the clients and loans.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int RebuildDeadlineIndex(void) {
+    deadlineBucketCount = 0;
+    if (!deadlineColumnsFit()) {
+        return 0;
+    }
+    uint32_t mask = 1;
+    while (mask < (uint32_t) clientsCapacity * 2) {
+        mask <<= 1;
+    }
+    mask--;
+    int* byCpf = malloc(((size_t) mask + 1) * sizeof(int));
+    if (!byCpf) {
+        return 0;
+    }
+    memset(byCpf, 0xff, ((size_t) mask + 1) * sizeof(int));
+    for (int i = SlotSetNext(&clientsLive, 0, clientsCapacity); i != -1; i = SlotSetNext(&clientsLive, i + 1, clientsCapacity)) {
+        uint32_t h = deadlineCpfHash(clients[i].cpf) & mask;
+        while (byCpf[h] != -1) {
+            h = (h + 1) & mask;
+        }
+        byCpf[h] = i;
+    }
+    for (int i = 0; i < deadlineCapacity; i++) {
+        deadlineDays[i] = DEADLINE_NONE;
+        deadlineClients[i] = -1;
+    }
+    for (int i = SlotSetNext(&loansLive, 0, loansCapacity); i != -1; i = SlotSetNext(&loansLive, i + 1, loansCapacity)) {
+        uint32_t h = deadlineCpfHash(loans[i].userCpf) & mask;
+        while (byCpf[h] != -1 && strcmp(clients[byCpf[h]].cpf, loans[i].userCpf)) {
+            h = (h + 1) & mask;
+        }
+        deadlineClients[i] = byCpf[h];
+        if (!DeadlineIndexSet(i)) {
+            free(byCpf);
+            return 0;
+        }
+    }
+    free(byCpf);
+    return 1;
+}
+
+/**
+ * @brief Calls `visit` for every open loan due from `firstDay` to `lastDay`, both included,
+ *        by day.
+ *
+ * @return int The number of loans visited.
+ */
+int DeadlineIndexWalk(int firstDay, int lastDay, DeadlineVisitor visit, void* context) {
+    int count = 0;
+    for (int b = deadlineBucketAt(firstDay); b < deadlineBucketCount && deadlineBuckets[b].day <= lastDay; b++) {
+        for (int slot = deadlineBuckets[b].head; slot != -1; slot = deadlineNext[slot]) {
+            if (visit) {
+                visit(&loans[slot], context);
+            }
+            count++;
+        }
+    }
+    return count;
+}
+
+#endif
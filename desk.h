@@ -0,0 +1,94 @@
+#ifndef DESK_H
+#define DESK_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @file desk.h
+ * @brief Thin desk client of server.h.
+ *
+ * Reads command lines in the format of batch.h from the standard input, sends each one to
+ * the server and prints the result line it gets back. Nothing is loaded locally.
+ */
+
+/**
+ * @brief Sends the commands of the standard input to a server and prints the results.
+ *
+ * The average round trip is reported on stderr at the end.
+ *
+ * @return int The number of commands that failed, or -1 if the server cannot be reached.
+ */
+int RunDesk(const char* path) {
+    struct sockaddr_un address = {0};
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "%s: socket path too long\n", path);
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1 || connect(fd, (struct sockaddr*) &address, sizeof(address)) == -1) {
+        perror(path);
+        if (fd != -1) {
+            close(fd);
+        }
+        return -1;
+    }
+    FILE* server = fdopen(fd, "r");
+    if (!server) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+
+    char* text = NULL;
+    char* result = NULL;
+    size_t textSize = 0, resultSize = 0;
+    int interactive = isatty(STDIN_FILENO);
+    int commands = 0, failed = 0;
+    double seconds = 0;
+    while (1) {
+        if (interactive) {
+            printf("> ");
+            fflush(stdout);
+        }
+        if (getline(&text, &textSize, stdin) == -1) {
+            break;
+        }
+        text[strcspn(text, "\r\n")] = '\0';
+        if (text[0] == '\0' || text[0] == '#') {
+            continue;
+        }
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (dprintf(fd, "%s\n", text) < 0 || getline(&result, &resultSize, server) == -1) {
+            fprintf(stderr, "%s: connection closed by the server\n", path);
+            failed = -1;
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        seconds += (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        commands++;
+        if (strncmp(result, "OK", 2)) {
+            failed++;
+        }
+        fputs(result, stdout);
+    }
+
+    if (commands) {
+        fprintf(stderr, "%d commands, %d failed, %.3f ms per round trip\n", commands, failed < 0 ? 0 : failed,
+                1000 * seconds / commands);
+    }
+    free(text);
+    free(result);
+    fclose(server);
+    return failed;
+}
+
+#endif
@@ -0,0 +1,345 @@
+#ifndef FINE_LEDGER_H
+#define FINE_LEDGER_H
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arena.h"
+#include "models.h"
+#include "repository.h"
+#include "row_log.h"
+
+/**
+ * @file fine_ledger.h
+ * @brief The fines charged to the clients and the payments they made.
+ *
+ * The ledger is append-only. Entries live in one table grown in its arena, and the entries of a
+ * client are chained from the newest back through `prev`, so posting is an append and a
+ * link. The running balance of a client is kept in `Client::fineAmount` as entries are
+ * posted, so reading it costs nothing.
+ *
+ * The clients owing something are also kept in `ledgerDebts`, ordered by balance then slot.
+ * Posting moves the client to its new place with a binary search, shifting only the keys
+ * between its old and new places, so listing the clients owing more than an amount is a
+ * binary search plus the clients listed.
+ *
+ * On disk the ledger is a list of segments, one per client with entries: the client ID and
+ * the number of entries, then the day and amount of each entry, oldest first.
+ *
+ * The ledger is guarded by the loans table lock: LOCK_LOANS exclusively to post, shared to
+ * read. The balance of a client is written under its stripe of the clients table too.
+ */
+
+/**
+ * @struct LedgerNode
+ * @brief An entry of the ledger, linked to the previous entry of its client.
+ *
+ * An entry of a removed client has a `clientId` of -1 and is unlinked.
+ */
+typedef struct {
+    LedgerEntry entry;
+    int prev;
+} LedgerNode;
+
+/**
+ * @struct LedgerSegment
+ * @brief The header of the entries of a client on disk.
+ */
+typedef struct {
+    int32_t clientId;
+    int32_t count;
+} LedgerSegment;
+
+/**
+ * @struct LedgerRecord
+ * @brief An entry on disk, in its client's segment.
+ */
+typedef struct {
+    int32_t day;
+    int32_t amount;
+} LedgerRecord;
+
+/**
+ * @brief Called once per entry by LedgerForEach.
+ */
+typedef void (*LedgerVisitor)(const LedgerEntry* e, void* context);
+
+LedgerNode* ledgerNodes;
+int ledgerCount;
+int ledgerCapacity;
+Arena ledgerNodesArena;
+
+/**
+ * @brief The newest entry of each client slot, or -1. A column of the clients table.
+ */
+int* ledgerLast;
+int ledgerLastCapacity;
+Arena ledgerLastArena;
+
+/**
+ * @brief The clients owing something, as `balance << 32 | slot` keys in ascending order.
+ *
+ * A column sized to the clients table, since a client has at most one key.
+ */
+uint64_t* ledgerDebts;
+int ledgerDebtCount;
+int ledgerDebtCapacity;
+Arena ledgerDebtsArena;
+
+/**
+ * @brief Reserves the ledger, the newest entries of the clients and their ordering by balance.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int InitLedger(void) {
+    if (!ArenaInit(&ledgerNodesArena, "ledger") || !ArenaInit(&ledgerLastArena, "ledger heads") ||
+        !ArenaInit(&ledgerDebtsArena, "debts")) {
+        return 0;
+    }
+    ledgerNodes = (LedgerNode*) ledgerNodesArena.base;
+    ledgerLast = (int*) ledgerLastArena.base;
+    ledgerDebts = (uint64_t*) ledgerDebtsArena.base;
+    return 1;
+}
+
+/**
+ * @brief The key of a client owing a balance.
+ */
+uint64_t LedgerDebtKey(int slot, int balance) {
+    return (uint64_t) (uint32_t) balance << 32 | (uint32_t) slot;
+}
+
+/**
+ * @brief The position of the first key of `ledgerDebts` not below `key`.
+ */
+int LedgerDebtAt(uint64_t key) {
+    int low = 0, high = ledgerDebtCount;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (ledgerDebts[mid] < key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief Moves a client in `ledgerDebts` after their balance went from `before` to `after`.
+ *
+ * Clients owing nothing have no key. `ledgerDebts` must have room for every client slot.
+ */
+void ledgerDebtMove(int slot, int before, int after) {
+    if (before == after) {
+        return;
+    }
+    int from = before > 0 ? LedgerDebtAt(LedgerDebtKey(slot, before)) : -1;
+    if (after <= 0) {
+        memmove(&ledgerDebts[from], &ledgerDebts[from + 1], (ledgerDebtCount - from - 1) * sizeof(uint64_t));
+        ledgerDebtCount--;
+        return;
+    }
+    uint64_t key = LedgerDebtKey(slot, after);
+    int to = LedgerDebtAt(key);
+    if (from == -1) {
+        memmove(&ledgerDebts[to + 1], &ledgerDebts[to], (ledgerDebtCount - to) * sizeof(uint64_t));
+        ledgerDebtCount++;
+    } else if (to > from) {
+        to--;
+        memmove(&ledgerDebts[from], &ledgerDebts[from + 1], (to - from) * sizeof(uint64_t));
+    } else {
+        memmove(&ledgerDebts[to + 1], &ledgerDebts[to], (from - to) * sizeof(uint64_t));
+    }
+    ledgerDebts[to] = key;
+}
+
+/**
+ * @brief Moves a client to the place of a balance that was put back without posting,
+ *        as TxAbort does with the rows it restores.
+ */
+void LedgerBalanceRestored(int slot, int before) {
+    ledgerDebtMove(slot, before, clients[slot].fineAmount);
+}
+
+/**
+ * @brief Makes room for one more entry, and for the newest entry and the key of every client slot.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int ledgerFit(void) {
+    if (ledgerDebtCapacity < clientsCapacity) {
+        if (!ArenaResizeColumn(&ledgerDebtsArena, sizeof(uint64_t), clientsCapacity)) {
+            return 0;
+        }
+        ledgerDebtCapacity = clientsCapacity;
+    }
+    if (ledgerLastCapacity < clientsCapacity) {
+        if (!ArenaResizeColumn(&ledgerLastArena, sizeof(int), clientsCapacity)) {
+            return 0;
+        }
+        for (int i = ledgerLastCapacity; i < clientsCapacity; i++) {
+            ledgerLast[i] = -1;
+        }
+        ledgerLastCapacity = clientsCapacity;
+    }
+    return ledgerCount < ledgerCapacity || ArenaGrowTable(&ledgerNodesArena, sizeof(LedgerNode), &ledgerCapacity, MAX_ENTITIES) != -1;
+}
+
+/**
+ * @brief Appends an entry to a client's ledger and adds it to their balance.
+ *
+ * Save the client row with TxSave beforehand when a transaction is running.
+ *
+ * @param day The day of the entry, as counted by DeadlineDay.
+ * @param amount The amount in cents: positive for a fine, negative for a payment.
+ * @return int Returns 1 on success, otherwise returns 0 and nothing is posted.
+ */
+int LedgerPost(int clientId, int day, int amount) {
+    if (!ledgerFit()) {
+        return 0;
+    }
+    ledgerNodes[ledgerCount] = (LedgerNode) {{clientId, day, amount}, ledgerLast[clientId]};
+    ledgerLast[clientId] = ledgerCount++;
+    clients[clientId].fineAmount += amount;
+    ledgerDebtMove(clientId, clients[clientId].fineAmount - amount, clients[clientId].fineAmount);
+    RowChanged(ROW_CLIENTS, clientId);
+    return 1;
+}
+
+/**
+ * @brief Drops the entries posted since the ledger held `count` of them, newest first.
+ *
+ * The balances are left alone: TxAbort puts the client rows back itself.
+ */
+void LedgerTruncate(int count) {
+    while (ledgerCount > count) {
+        LedgerNode* n = &ledgerNodes[--ledgerCount];
+        if (n->entry.clientId != -1) {
+            ledgerLast[n->entry.clientId] = n->prev;
+        }
+    }
+}
+
+/**
+ * @brief Detaches the entries of a client being removed, so that their slot starts afresh.
+ */
+void LedgerForget(int clientId) {
+    if (clientId >= ledgerLastCapacity) {
+        return;
+    }
+    for (int node = ledgerLast[clientId]; node != -1; node = ledgerNodes[node].prev) {
+        ledgerNodes[node].entry.clientId = -1;
+    }
+    ledgerLast[clientId] = -1;
+}
+
+/**
+ * @brief Calls `visit` for every entry of a client, newest first.
+ *
+ * @return int The number of entries visited.
+ */
+int LedgerForEach(int clientId, LedgerVisitor visit, void* context) {
+    int count = 0;
+    for (int node = clientId < ledgerLastCapacity ? ledgerLast[clientId] : -1; node != -1; node = ledgerNodes[node].prev) {
+        visit(&ledgerNodes[node].entry, context);
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Orders the keys of `ledgerDebts`.
+ */
+int compareDebts(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*) a;
+    uint64_t y = *(const uint64_t*) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Sets every client's balance to the sum of their entries, and orders the clients
+ *        owing something, after the data files were read.
+ */
+void RebuildBalances(void) {
+    for (int i = 0; i < clientsCapacity; i++) {
+        clients[i].fineAmount = 0;
+    }
+    for (int i = 0; i < ledgerCount; i++) {
+        if (ledgerNodes[i].entry.clientId != -1) {
+            clients[ledgerNodes[i].entry.clientId].fineAmount += ledgerNodes[i].entry.amount;
+        }
+    }
+    ledgerDebtCount = 0;
+    if (!ledgerFit()) {
+        return;
+    }
+    for (int i = 0; i < clientsCapacity; i++) {
+        if (clients[i].fineAmount > 0) {
+            ledgerDebts[ledgerDebtCount++] = LedgerDebtKey(i, clients[i].fineAmount);
+        }
+    }
+    qsort(ledgerDebts, ledgerDebtCount, sizeof(uint64_t), compareDebts);
+}
+
+/**
+ * @brief Reads the segments written by SaveLedger, posting their entries again.
+ *
+ * Segments of client slots beyond the clients table are skipped. Call RebuildBalances afterwards.
+ *
+ * @param f The file to read from, past its magic number.
+ */
+void LoadLedger(FILE* f) {
+    LedgerSegment segment;
+    LedgerRecord record;
+    while (fread(&segment, sizeof(LedgerSegment), 1, f) == 1) {
+        for (int i = 0; i < segment.count; i++) {
+            if (fread(&record, sizeof(LedgerRecord), 1, f) != 1) {
+                return;
+            }
+            if (segment.clientId < 0 || segment.clientId >= clientsCapacity) {
+                continue;
+            }
+            if (!ledgerFit()) {
+                return;
+            }
+            ledgerNodes[ledgerCount] = (LedgerNode) {{segment.clientId, record.day, record.amount}, ledgerLast[segment.clientId]};
+            ledgerLast[segment.clientId] = ledgerCount++;
+        }
+    }
+}
+
+/**
+ * @brief Writes a segment for every client with entries.
+ *
+ * @param f The file to write to, past its magic number.
+ */
+void SaveLedger(FILE* f) {
+    LedgerRecord* records = NULL;
+    int capacity = 0;
+    for (int c = 0; c < ledgerLastCapacity; c++) {
+        LedgerSegment segment = {c, 0};
+        for (int node = ledgerLast[c]; node != -1; node = ledgerNodes[node].prev) {
+            if (segment.count == capacity) {
+                capacity = capacity ? capacity * 2 : 64;
+                LedgerRecord* grown = realloc(records, capacity * sizeof(LedgerRecord));
+                if (!grown) {
+                    free(records);
+                    return;
+                }
+                records = grown;
+            }
+            records[segment.count++] = (LedgerRecord) {ledgerNodes[node].entry.day, ledgerNodes[node].entry.amount};
+        }
+        if (!segment.count) {
+            continue;
+        }
+        fwrite(&segment, sizeof(LedgerSegment), 1, f);
+        for (int i = segment.count - 1; i >= 0; i--) {
+            fwrite(&records[i], sizeof(LedgerRecord), 1, f);
+        }
+    }
+    free(records);
+}
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef FINE_SWEEP_H
+#define FINE_SWEEP_H
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "models.h"
+#include "repository.h"
+#include "deadline_index.h"
+#include "loan_service.h"
+
+/**
+ * @file fine_sweep.h
+ * @brief The nightly sweep that brings every client's accrued fine up to date.
+ *
+ * The sweep reads the deadline and client columns of deadline_index.h rather than the
+ * loan rows. Each thread takes a slice of the loan slots and walks it in blocks: a
+ * branch-free loop computes the fine of every slot of the block in integer cents, which
+ * compilers vectorize, then the fines of the open loans are stored into the `fineAccrued`
+ * column of their clients. A client has at most one open loan, so the threads never write
+ * the same client.
+ *
+ * Accrued fines are not owed yet: a fine is charged to the client's ledger when the loan
+ * is returned.
+ *
+ * Run it with the loans table locked shared and the clients table exclusively.
+ */
+
+/**
+ * @brief Loan slots whose fines are computed at once.
+ */
+#define FINE_SWEEP_BLOCK 4096
+
+/**
+ * @brief Most threads a sweep uses.
+ */
+#define FINE_SWEEP_MAX_THREADS 64
+
+/**
+ * @brief The fine in cents each client slot's open loan had accrued at the last sweep.
+ *
+ * A column of the clients table, grown in its own arena.
+ */
+int* fineAccrued;
+int fineAccruedCapacity;
+Arena fineAccruedArena;
+
+/**
+ * @brief Reserves the accrued fines.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int InitFineSweep(void) {
+    if (!ArenaInit(&fineAccruedArena, "accrued fines")) {
+        return 0;
+    }
+    fineAccrued = (int*) fineAccruedArena.base;
+    return 1;
+}
+
+/**
+ * @struct FineSweepJob
+ * @brief A slice of the clients to clear, or of the loan slots to sweep, and the loans it found.
+ */
+typedef struct {
+    int first;
+    int last;
+    int today;
+    int clear;
+    int swept;
+} FineSweepJob;
+
+/**
+ * @brief Computes the fine a block of loan slots would owe on `today`, 0 for slots with no open loan.
+ */
+void fineSweepBlock(const int* days, int count, int today, int* fines) {
+    for (int i = 0; i < count; i++) {
+        int open = days[i] != DEADLINE_NONE;
+        fines[i] = open * FineCents(open ? days[i] : today, today);
+    }
+}
+
+/**
+ * @brief Clears the fines of a slice of the clients, or sweeps a slice of the loan slots.
+ */
+void* fineSweepSlice(void* arg) {
+    FineSweepJob* job = arg;
+    if (job->clear) {
+        for (int i = job->first; i < job->last; i++) {
+            fineAccrued[i] = 0;
+        }
+        return NULL;
+    }
+    int fines[FINE_SWEEP_BLOCK];
+    for (int start = job->first; start < job->last; start += FINE_SWEEP_BLOCK) {
+        int count = job->last - start < FINE_SWEEP_BLOCK ? job->last - start : FINE_SWEEP_BLOCK;
+        fineSweepBlock(deadlineDays + start, count, job->today, fines);
+        for (int i = 0; i < count; i++) {
+            int client = deadlineClients[start + i];
+            if (deadlineDays[start + i] != DEADLINE_NONE && client != -1) {
+                fineAccrued[client] = fines[i];
+                job->swept++;
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Runs slices of `count` clients or loan slots on `threads` threads, at least one.
+ *
+ * @return int The number of open loans swept.
+ */
+int fineSweepSlices(int count, int today, int clear, int threads) {
+    FineSweepJob jobs[FINE_SWEEP_MAX_THREADS];
+    pthread_t workers[FINE_SWEEP_MAX_THREADS];
+    int started[FINE_SWEEP_MAX_THREADS];
+    threads = threads < 1 ? 1 : threads > FINE_SWEEP_MAX_THREADS ? FINE_SWEEP_MAX_THREADS : threads;
+    for (int t = 0; t < threads; t++) {
+        jobs[t] = (FineSweepJob) {(int) ((long) count * t / threads), (int) ((long) count * (t + 1) / threads), today, clear, 0};
+        started[t] = t > 0 && !pthread_create(&workers[t], NULL, fineSweepSlice, &jobs[t]);
+    }
+    fineSweepSlice(&jobs[0]);
+    int swept = jobs[0].swept;
+    for (int t = 1; t < threads; t++) {
+        if (started[t]) {
+            pthread_join(workers[t], NULL);
+        } else {
+            fineSweepSlice(&jobs[t]);
+        }
+        swept += jobs[t].swept;
+    }
+    return swept;
+}
+
+/**
+ * @brief Sets every client's accrued fine to what their open loan would owe if returned on
+ *        `today`, and clears the accrued fines of the other clients.
+ *
+ * @param today A day as counted by DeadlineDay, usually DeadlineToday().
+ * @param threads The threads to use, or 0 for one per online CPU (at most FINE_SWEEP_MAX_THREADS).
+ * @return int The number of open loans swept, or -1 if the accrued fines cannot be stored.
+ */
+int FineSweep(int today, int threads) {
+    if (fineAccruedCapacity < clientsCapacity) {
+        if (!ArenaResizeColumn(&fineAccruedArena, sizeof(int), clientsCapacity)) {
+            return -1;
+        }
+        fineAccruedCapacity = clientsCapacity;
+    }
+    if (threads <= 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online < 1 ? 1 : (int) online;
+    }
+    fineSweepSlices(fineAccruedCapacity, today, 1, threads);
+    return fineSweepSlices(deadlineCapacity, today, 0, threads);
+}
+
+/**
+ * @brief The fine a client's open loan had accrued at the last sweep.
+ */
+int FineAccrued(const Client* c) {
+    int slot = (int) (c - clients);
+    return slot < fineAccruedCapacity ? fineAccrued[slot] : 0;
+}
+
+#endif
@@ -1,63 +1,53 @@
 #ifndef GENRE_CONTROLLER_H
 #define GENRE_CONTROLLER_H
 #include "models.h"
+#include "screen.h"
+#include "catalog_service.h"
+#include "snapshot.h"
+
+/**
+ * @brief Prints one genre on the genre list.
+ */
+void printGenre(Genre* g, void* context) {
+    printf("ID: %d, Genre: %s\n", g->id, StringGet(g->genre));
+}
 
 /**
  * @brief Removes a genre from the list of genres.
  *
  * This function displays a list of genres and prompts the user to enter the ID of the genre to remove.
- * It checks if any books are associated with the specified genre. If there are books associated with the genre,
- * the function will not remove the genre and will notify the user. If no books are associated with the genre,
- * the function will remove the genre by setting its ID to -1 and its name to "0".
+ * It checks the genre's reference count to know if any books are associated with it. If there are books associated
+ * with the genre, the function will not remove the genre and will notify the user. If no books are associated with
+ * the genre, the function will remove it with GenreRemove.
  */
 void RemoveGenre() {
     int id;
     printf("Genres:\n");
-    for (int i = 0; i < MAX_ENTITIES; i++) {
-        if (genres[i].id != -1) {
-            printf("ID: %d, Genre: %s\n", genres[i].id, genres[i].genre);
-        }
-    }
+    GenreForEach(printGenre, NULL);
     printf("Enter the genre ID to remove: ");
     fillBuffer(20);
     sscanf(buffer, "%d", &id);
-    
-    // Check if any book has this genre
-    for (int i = 0; i < MAX_ENTITIES; i++) {
-        if (books[i].genreId == id) {
-            printf("Cannot remove genre. There are books associated with this genre.\n");
-            printf("Type anything to continue...");
-            getch();
-            system("clear");
-            return;
-        }
-    }
 
-    for (int i = 0; i < MAX_ENTITIES; i++) {
-        if (genres[i].id == id) {
-            genres[i].id = -1;
-            strcpy(genres[i].genre, "0\0");
-            printf("Genre successfully removed!\n");
-            printf("Type anything to continue...");
-            getch();
-            system("clear");
-            return;
-        }
+    Status s = GenreRemove(id);
+    if (s == STATUS_IN_USE) {
+        printf("Cannot remove genre. There are books associated with this genre.\n");
+    } else if (s == STATUS_NOT_FOUND) {
+        printf("Genre not found.\n");
+    } else {
+        printf("Genre successfully removed!\n");
     }
-    printf("Genre not found.\n");
     printf("Type anything to continue...");
     getch();
-    system("clear");
+    ScreenClear();
 }
 
 /**
  * @brief Updates the genre name for a given genre ID.
  *
  * This function prompts the user to enter a genre ID and then searches for the genre
- * with the specified ID in the genres array. If found, it displays the current genre
- * name and prompts the user to enter a new genre name. It then checks if the new genre
- * name already exists in the genres array (excluding the current genre). If the new
- * genre name is unique, it updates the genre name and confirms the update to the user.
+ * with the specified ID. If found, it displays the current genre name and prompts the
+ * user to enter a new genre name, which GenreRename applies unless another genre already
+ * has it. On success it confirms the update to the user.
  * If the genre ID is not found or the new genre name already exists, appropriate
  * messages are displayed.
  */
@@ -66,97 +56,73 @@ void UpdateGenre() {
     printf("Enter the genre ID to update: ");
     fillBuffer(20);
     sscanf(buffer, "%d", &id);
-    for (int i = 0; i < MAX_ENTITIES; i++) {
-        if (genres[i].id == id) {
-            printf("%d %s\n", genres[i].id, genres[i].genre);
-            printf("Enter the new genre name: ");
-            fillBuffer(40);
-            
-            // Check if the new genre name already exists
-            for (int j = 0; j < MAX_ENTITIES; j++) {
-                if (!strcmp(genres[j].genre, buffer) && genres[j].id != id) {
-                    printf("Genre name already exists. Please try again.\n");
-                    printf("Type anything to continue...");
-                    getch();
-                    system("clear");
-                    return;
-                }
-            }
-            
-            strcpy(genres[i].genre, buffer);
-            printf("%d %s\n", genres[i].id, genres[i].genre);
-            printf("Genre successfully updated!\n");
-            printf("Type anything to continue...");
-            getch();
-            system("clear");
-            return;
-        }
+    Genre* g = SearchGenreById(id);
+    if (!g || g->id == -1) {
+        printf("Genre not found.\n");
+        printf("Type anything to continue...");
+        getch();
+        ScreenClear();
+        return;
+    }
+    printf("%d %s\n", g->id, StringGet(g->genre));
+    printf("Enter the new genre name: ");
+    fillBuffer(TEXT_MAX);
+    Status s = GenreRename(id, buffer);
+    if (s == STATUS_DUPLICATE) {
+        printf("Genre name already exists. Please try again.\n");
+    } else if (s != STATUS_OK) {
+        printf("Error: %s.\n", StatusText(s));
+    } else {
+        printf("%d %s\n", g->id, StringGet(g->genre));
+        printf("Genre successfully updated!\n");
     }
-    printf("Genre not found.\n");
     printf("Type anything to continue...");
     getch();
-    system("clear");
+    ScreenClear();
 }
 
 /**
  * @brief Lists all genres stored in the genres array.
  *
- * This function iterates through the genres array and prints the ID and genre
- * name for each genre that has a valid ID (not equal to -1). After listing all
+ * This function walks the genres with GenreForEach and prints the ID and genre
+ * name of each of them. After listing all
  * genres, it prompts the user to type anything to continue and then clears the
  * console screen.
  *
  */
 void ListGenres() {
     printf("Genres:\n");
-    for (int i = 0; i < MAX_ENTITIES; i++) {
-        if (genres[i].id != -1) {
-            printf("ID: %d, Genre: %s\n", genres[i].id, genres[i].genre);
-        }
-    }
+    GenreForEach(printGenre, NULL);
     printf("Type anything to continue...");
     getch();
-    system("clear");
+    ScreenClear();
 }
 
 /**
  * @brief Adds a new genre to the list of genres.
  * 
- * This function prompts the user to enter a new genre name and adds it to the list of genres if an empty slot is available.
- * It also checks if the genre name already exists to avoid duplicates.
+ * This function prompts the user to enter a new genre name and adds it with GenreAdd,
+ * which rejects names that already exist.
  * 
  * @details
- * - If no empty genre slot is available, the function prints an error message and waits for user input before returning.
+ * - If there is no room for a new genre, the function prints an error message and waits for user input before returning.
  * - If the genre name already exists, the function prints an error message and waits for user input before returning.
  * - If the genre name is successfully added, the function prints a success message and waits for user input before clearing the screen.
  */
 void AddGenre() {
-    Genre* g = getEmptyGenre();
-    if (!g) {
-        printf("No empty genre slot available.\n");
-        printf("Type anything to continue...");
-        getch();
-        return;
-    }
     printf("Enter the new genre name: ");
-    fillBuffer(40);
-
-    // Check if the genre name already exists
-    for (int i = 0; i < MAX_ENTITIES; i++) {
-        if (!strcmp(genres[i].genre, buffer) && genres[i].id != -1) {
-            printf("Genre name already exists. Please try again.\n");
-            printf("Type anything to continue...");
-            getch();
-            system("clear");
-            return;
-        }
+    fillBuffer(TEXT_MAX);
+    Status s = GenreAdd(buffer, NULL);
+    if (s == STATUS_DUPLICATE) {
+        printf("Genre name already exists. Please try again.\n");
+    } else if (s != STATUS_OK) {
+        printf("No empty genre slot available.\n");
+    } else {
+        printf("Genre successfully added!\n");
     }
-
-    strcpy(g->genre, buffer);
-    printf("Genre successfully added!\n");
     printf("Type anything to continue...");
     getch();
-    system("clear");
+    ScreenClear();
 }
 
 /**
@@ -183,7 +149,7 @@ void GenreMenu() {
         printf("Genre Menu\n\n1. List Genres\n2. Add Genre\n3. Update Genre\n4. Remove Genre\n5. Back\nOption: ");
         fillBuffer(1);
         sscanf(buffer, "%d", &choice);
-        system("clear");
+        ScreenClear();
         switch (choice) {
             case 1:
                 ListGenres();
@@ -203,9 +169,10 @@ void GenreMenu() {
                 printf("Invalid choice. Please try again.\n");
             printf("Type anything to continue...");
             getch();
-            system("clear");
+            ScreenClear();
             break;
         }
+        SnapshotCommit();
     } while (choice != 5);
 }
 
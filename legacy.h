@@ -0,0 +1,290 @@
+#ifndef LEGACY_H
+#define LEGACY_H
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "models.h"
+#include "repository.h"
+
+/**
+ * @brief Magic number written at the start of every data file.
+ *
+ * Its last character is the version of the file layout. Files without it were saved
+ * before strings were interned and hold the legacy fixed-size records below. Older
+ * files are converted while being imported and written back in the current layout
+ * by SaveData.
+ */
+#define DATA_MAGIC "BBY4"
+
+/**
+ * @brief Layout versions of the data files.
+ *
+ * - DATA_VERSION_LEGACY: no magic number, fixed-size strings.
+ * - DATA_VERSION_INTERNED: interned strings, loans limited to two books.
+ * - DATA_VERSION_ITEMS: loans with a variable number of items in "data/loan_items.bin".
+ * - DATA_VERSION: loan items naming the copy lent, the copies in "data/copies.bin".
+ */
+#define DATA_VERSION_LEGACY 1
+#define DATA_VERSION_INTERNED 2
+#define DATA_VERSION_ITEMS 3
+#define DATA_VERSION 4
+
+/**
+ * @brief Size of a record in a legacy "data/genres.bin".
+ *
+ * The legacy genres file was written with the stride of a LegacyAddress; only the
+ * leading bytes of each record hold the genre.
+ */
+#define LEGACY_GENRE_RECORD_SIZE 100
+
+/**
+ * @brief Layout of a Genre in legacy data files.
+ */
+typedef struct {
+    int id;
+    char genre[40];
+} LegacyGenre;
+
+/**
+ * @brief Layout of an Author in legacy data files.
+ */
+typedef struct {
+    int id;
+    char name[40];
+} LegacyAuthor;
+
+/**
+ * @brief Layout of a Book in legacy data files.
+ */
+typedef struct {
+    int id;
+    char title[40];
+    int authorId;
+    int genreId;
+    int amount;
+    int stock;
+} LegacyBook;
+
+/**
+ * @brief Layout of an Address in legacy data files.
+ */
+typedef struct {
+    int id;
+    char street[40];
+    char number[5];
+    char cep[10];
+    char complement[40];
+} LegacyAddress;
+
+/**
+ * @brief Layout of a Client in legacy data files.
+ */
+typedef struct {
+    char name[40];
+    char cpf[12];
+    int addressId;
+    int fineAmount;
+    int bookId1;
+    int bookId2;
+    char deadline[8];
+} LegacyClient;
+
+/**
+ * @brief Layout of a Client in DATA_VERSION_INTERNED data files.
+ */
+typedef struct {
+    StringId name;
+    char cpf[12];
+    int addressId;
+    int fineAmount;
+    int bookId1;
+    int bookId2;
+    char deadline[8];
+} InternedClient;
+
+/**
+ * @brief Layout of a Loan in legacy and DATA_VERSION_INTERNED data files.
+ */
+typedef struct {
+    int id;
+    char userCpf[12];
+    int book1Id;
+    int book2Id;
+    char startDate[20];
+    char deadline[20];
+} LegacyLoan;
+
+/**
+ * @brief Interns a fixed-size legacy string field.
+ */
+StringId internLegacy(const char* field, size_t size) {
+    char s[41];
+    size_t length = strnlen(field, size < sizeof(s) ? size : sizeof(s) - 1);
+    memcpy(s, field, length);
+    s[length] = '\0';
+    return StringIntern(s);
+}
+
+/**
+ * @brief Reads the layout version of a data file from its magic number.
+ *
+ * The file is left positioned on its first record in every case.
+ *
+ * @param f The file to check.
+ * @return int The version of the file, DATA_VERSION_LEGACY if it has no magic number.
+ */
+int dataFileVersion(FILE* f) {
+    char magic[4];
+    if (fread(magic, sizeof(magic), 1, f) == 1 && !memcmp(magic, DATA_MAGIC, 3) &&
+        magic[3] > '1' && magic[3] <= DATA_MAGIC[3]) {
+        return magic[3] - '0';
+    }
+    fseek(f, 0, SEEK_SET);
+    return DATA_VERSION_LEGACY;
+}
+
+/**
+ * @brief Reads one client saved in an older layout and converts it.
+ *
+ * The book IDs of older clients were never used and are dropped.
+ *
+ * @param version DATA_VERSION_LEGACY or DATA_VERSION_INTERNED.
+ * @return int Returns 1 if a record was read, otherwise returns 0.
+ */
+int readLegacyClient(FILE* f, Client* c, int version) {
+    if (version == DATA_VERSION_INTERNED) {
+        InternedClient old;
+        if (fread(&old, sizeof(old), 1, f) != 1) {
+            return 0;
+        }
+        c->name = old.name;
+        memcpy(c->cpf, old.cpf, sizeof(c->cpf));
+        c->addressId = old.addressId;
+        c->fineAmount = old.fineAmount;
+        memcpy(c->deadline, old.deadline, sizeof(c->deadline));
+        return 1;
+    }
+    LegacyClient old;
+    if (fread(&old, sizeof(old), 1, f) != 1) {
+        return 0;
+    }
+    c->name = internLegacy(old.name, sizeof(old.name));
+    memcpy(c->cpf, old.cpf, sizeof(c->cpf));
+    c->addressId = old.addressId;
+    c->fineAmount = old.fineAmount;
+    memcpy(c->deadline, old.deadline, sizeof(c->deadline));
+    return 1;
+}
+
+/**
+ * @brief Reads one legacy book and converts it.
+ *
+ * @return int Returns 1 if a record was read, otherwise returns 0.
+ */
+int readLegacyBook(FILE* f, Book* b) {
+    LegacyBook old;
+    if (fread(&old, sizeof(old), 1, f) != 1) {
+        return 0;
+    }
+    b->id = old.id;
+    b->title = internLegacy(old.title, sizeof(old.title));
+    b->authorId = old.authorId;
+    b->genreId = old.genreId;
+    b->amount = old.amount;
+    b->stock = old.stock;
+    return 1;
+}
+
+/**
+ * @brief Reads one legacy address and converts it.
+ *
+ * @return int Returns 1 if a record was read, otherwise returns 0.
+ */
+int readLegacyAddress(FILE* f, Address* add) {
+    LegacyAddress old;
+    if (fread(&old, sizeof(old), 1, f) != 1) {
+        return 0;
+    }
+    add->id = old.id;
+    add->street = internLegacy(old.street, sizeof(old.street));
+    add->number = internLegacy(old.number, sizeof(old.number));
+    add->cep = internLegacy(old.cep, sizeof(old.cep));
+    add->complement = internLegacy(old.complement, sizeof(old.complement));
+    return 1;
+}
+
+/**
+ * @brief Reads one legacy genre and converts it.
+ *
+ * @return int Returns 1 if a record was read, otherwise returns 0.
+ */
+int readLegacyGenre(FILE* f, Genre* g) {
+    char record[LEGACY_GENRE_RECORD_SIZE];
+    LegacyGenre old;
+    if (fread(record, sizeof(record), 1, f) != 1) {
+        return 0;
+    }
+    memcpy(&old, record, sizeof(old));
+    g->id = old.id;
+    g->genre = internLegacy(old.genre, sizeof(old.genre));
+    return 1;
+}
+
+/**
+ * @brief Reads one legacy author and converts it.
+ *
+ * @return int Returns 1 if a record was read, otherwise returns 0.
+ */
+int readLegacyAuthor(FILE* f, Author* a) {
+    LegacyAuthor old;
+    if (fread(&old, sizeof(old), 1, f) != 1) {
+        return 0;
+    }
+    a->id = old.id;
+    a->name = internLegacy(old.name, sizeof(old.name));
+    return 1;
+}
+
+/**
+ * @brief Reads one loan limited to two books and moves its books to the loan items.
+ *
+ * @return int Returns 1 if a record was read, otherwise returns 0.
+ */
+int readLegacyLoan(FILE* f, Loan* l) {
+    LegacyLoan old;
+    if (fread(&old, sizeof(old), 1, f) != 1) {
+        return 0;
+    }
+    l->id = old.id;
+    l->itemOffset = 0;
+    l->itemCount = 0;
+    memcpy(l->userCpf, old.userCpf, sizeof(l->userCpf));
+    memcpy(l->startDate, old.startDate, sizeof(l->startDate));
+    memcpy(l->deadline, old.deadline, sizeof(l->deadline));
+    if (l->id != -1 && old.book1Id != -1) {
+        AddLoanItem(l, old.book1Id, -1);
+    }
+    if (l->id != -1 && old.book2Id != -1) {
+        AddLoanItem(l, old.book2Id, -1);
+    }
+    return 1;
+}
+
+/**
+ * @brief Reads one loan item saved before items named their copy.
+ *
+ * The copy is chosen by RebuildCopies.
+ *
+ * @return int Returns 1 if a record was read, otherwise returns 0.
+ */
+int readLegacyLoanItem(FILE* f, LoanItem* item) {
+    int32_t bookId;
+    if (fread(&bookId, sizeof(bookId), 1, f) != 1) {
+        return 0;
+    }
+    *item = (LoanItem) {bookId, -1};
+    return 1;
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef LIST_VIEW_H
+#define LIST_VIEW_H
+#include <stdio.h>
+#include <string.h>
+
+#include "cstdin.h"
+#include "screen.h"
+#include "cursor.h"
+
+/**
+ * @brief Adds the lines of the record in a slot to the page being drawn.
+ */
+typedef void (*ListRow)(int slot, ScreenText* out);
+
+/**
+ * @brief Moves a cursor to the record with the key typed by the user.
+ *
+ * @return int Returns 1 if the key was found, otherwise returns 0.
+ */
+typedef int (*ListSeek)(Cursor* c, const char* key);
+
+/**
+ * @brief Reopens a cursor on the first page of the table walked in another order.
+ */
+typedef int (*ListOrder)(Cursor* c, int order, int pageSize);
+
+/**
+ * @brief Shows a table one page at a time until the user leaves.
+ *
+ * Only the records of the current page are formatted, so a page costs the same
+ * whatever the size of the table. The page size follows the terminal height.
+ * Keys: n or space for the next page, p for the previous one, / to jump to a key,
+ * s to switch to the next order, q or Enter to go back.
+ *
+ * @param title The title shown on the first row.
+ * @param c A cursor opened on the table.
+ * @param rowLines The number of lines `row` adds for one record.
+ * @param row Formats one record.
+ * @param keyName The name of the key asked by /.
+ * @param seek Jumps to a key.
+ * @param orderNames The names of the orders the table can be walked in. The cursor starts in the first.
+ * @param orders The number of orders.
+ * @param reorder Switches the cursor to an order.
+ */
+void ListView(const char* title, Cursor* c, int rowLines, ListRow row, const char* keyName, ListSeek seek,
+              const char* const* orderNames, int orders, ListOrder reorder) {
+    char message[40] = "";
+    int order = 0;
+    ScreenBegin();
+    ScreenClear();
+    while (1) {
+        ScreenBegin();
+        if (!screenBack) {
+            return;
+        }
+        int page = screenRows - 2;
+        if (page / rowLines != c->pageSize) {
+            CursorResize(c, page / rowLines);
+        }
+
+        ScreenText text = {0};
+        for (int k = 0; k < c->count; k++) {
+            row(c->slots[k], &text);
+        }
+        ScreenPut(0, "%s (by %s)", title, orderNames[order]);
+        for (int i = 0; i < text.count && i < page; i++) {
+            ScreenPut(1 + i, "%s", text.lines[i]);
+        }
+        if (c->count == 0) {
+            ScreenPut(1, "Nothing to show.");
+        }
+        ScreenTextFree(&text);
+        ScreenPut(screenRows - 1, "%d in total  [n/p] page  [/] %s  [s] order  [q] back  %s", CursorTotal(c), keyName, message);
+        ScreenFlush();
+        message[0] = '\0';
+
+        switch (getch()) {
+            case 'n': case 'N': case ' ':
+                if (!CursorNext(c)) {
+                    strcpy(message, "Last page.");
+                }
+                break;
+            case 'p': case 'P':
+                if (!CursorPrev(c)) {
+                    strcpy(message, "First page.");
+                }
+                break;
+            case '/':
+                printf("\x1b[%d;1H\x1b[2K%s: ", screenRows, keyName);
+                fflush(stdout);
+                fillBuffer(TEXT_MAX);
+                if (!seek(c, buffer)) {
+                    strcpy(message, "Not found.");
+                }
+                ScreenClear();
+                break;
+            case 's': case 'S':
+                order = (order + 1) % orders;
+                reorder(c, order, c->pageSize);
+                break;
+            case 'q': case 'Q': case '\n': case '\r': case EOF:
+                ScreenClear();
+                return;
+        }
+    }
+}
+
+#endif
@@ -2,158 +2,173 @@
 #define RESERVATION_CONTROLLER_H_
 #include <stdio.h>
 #include <stdlib.h>
-#include <regex.h>
 #include <time.h>
 
 #include "models.h"
 #include "cstdin.h"
-#include "repository.h"
-
-/**
- * @brief Validates if the given date string is in the format YYYY-MM-DD.
- *
- * This function uses regular expressions to check if the input date string
- * matches the format YYYY-MM-DD, where YYYY is a 4-digit year, MM is a 2-digit
- * month, and DD is a 2-digit day.
- *
- * @param date A pointer to a null-terminated string representing the date to be validated.
- * @return Returns 1 if the date is in the valid format, otherwise returns 0.
- */
-int isValidDateFormat(char* date) {
-    regex_t regex;
-    int result;
-
-    result = regcomp(&regex, "^[0-9]{4}-[0-9]{2}-[0-9]{2}$", REG_EXTENDED);
-    if (result) {
-        fprintf(stderr, "Could not compile regex\n");
-        return 0;
-    }
-
-    result = regexec(&regex, date, 0, NULL, 0);
-    regfree(&regex);
-
-    return !result;
-}
+#include "screen.h"
+#include "list_view.h"
+#include "loan_service.h"
+#include "circulation_stats.h"
+#include "co_borrow.h"
 
 /**
  * @brief Creates a loan menu for the user to input loan details.
  * 
- * This function prompts the user to enter the client's name, loan date, and book titles.
+ * This function prompts the user to enter the client's name, loan date, and any number of book titles.
  * It performs various checks such as validating the client, ensuring the client does not already have an active loan,
- * and validating the date format. It also updates the stock of the books being loaned.
+ * validating the date format and making sure every book is in stock. It also updates the stock of the books being loaned.
  * 
  * @note If the client is not found or already has an active loan, the function will terminate early.
  * 
  * @details
  * - Prompts the user to enter the client's name and searches for the client.
  * - Checks if the client already has an active loan.
- * - Prompts the user to enter the loan date and validates the date format.
- * - Prompts the user to enter the titles of the books to be loaned.
- * - Updates the stock of the books being loaned.
- * - Sets the loan deadline to 7 days from the start date.
+ * - Prompts the user to enter the loan date and opens the loan with LoanOpen, which validates the date
+ *   and sets the deadline to LOAN_DAYS days from the start date.
+ * - Prompts the user to enter the titles of the books to be loaned, one per line, until an empty line.
+ *   Each book is lent with LoanAddBook. A loan left without books is dropped with TxAbort.
+ * - Commits the loan, which fails if the client or a picked book was changed by another desk meanwhile,
+ *   and counts its books in the circulation statistics and the co-borrowing matrix.
  * - Displays a success message upon successful loan creation.
  * 
  * @return void
  */
 void CreateLoanMenu() {
-    Loan* l = getEmptyLoan();
-    
     printf("Enter the client's name: ");
-    fillBuffer(40);
+    fillBuffer(TEXT_MAX);
     Client* c = SearchClientByName(buffer);
     if (c == NULL) {
         printf("Client not found.\n");
-        l->id = -1;
         return;
     }
-    strcpy(l->userCpf, c->cpf);
-
-    // Check if the client already has an active loan
-    Loan* existingLoan = SearchLoanByClient(c->cpf);
-    if (existingLoan && existingLoan->id != -1) {
+    if (SearchLoanByClient(c->cpf)) {
         printf("Client already has an active loan.\n");
-        l->id = -1;
         return;
     }
 
     printf("Enter Loan date (YYYY-MM-DD) [Empty if today]: ");
     fillBuffer(20);
-    if(buffer[0] != '\0' && !isValidDateFormat(buffer)) {
-        printf("Invalid date format. Please use the format YYYY-MM-DD.\n");
-        l->id = -1;
+    Loan* l;
+    Transaction tx;
+    TxBegin(&tx);
+    TxRead(ROW_CLIENTS, (int) (c - clients));
+    Status s = LoanOpen(c, buffer, &l);
+    if (s != STATUS_OK) {
+        TxAbort();
+        if (s == STATUS_INVALID) {
+            printf("Invalid date format. Please use the format YYYY-MM-DD.\n");
+        } else {
+            printf("Error: %s.\n", StatusText(s));
+        }
         return;
     }
-    if(buffer[0] == '\0') {
-        time_t t = time(NULL);
-        struct tm tm = *localtime(&t);
-        snprintf(buffer, 20, "%04d-%02d-%02d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
-    }
-    strcpy(l->startDate, buffer);
 
-    printf("Enter the first book's name: ");
-    fillBuffer(40);
-    Book* b = SearchBookByTitle(buffer);
-    Book* b2 = NULL;
-    l->book1Id = b->id;
-    printf("Enter the second book's name (\"Enter\" if none): ");
-    fillBuffer(40);
-    if(buffer[0] != '\0') {
-        b2 = SearchBookByTitle(buffer);
-        l->book2Id = b2->id;
-    } else {
-        l->book2Id = -1;
+    printf("Enter the books' names, one per line (\"Enter\" when done):\n");
+    while (1) {
+        printf("Book %d: ", l->itemCount + 1);
+        fillBuffer(TEXT_MAX);
+        if (buffer[0] == '\0') {
+            break;
+        }
+        Book* b = SearchBookByTitle(buffer);
+        if (!b) {
+            printf("Book not found.\n");
+            continue;
+        }
+        TxRead(ROW_BOOKS, b->id);
+        s = LoanAddBook(l, b);
+        if (s == STATUS_NO_STOCK) {
+            printf("No copies of this book are available.\n");
+        } else if (s != STATUS_OK) {
+            printf("Error adding the book to the loan.\n");
+            break;
+        }
+    }
+    if (l->itemCount == 0) {
+        TxAbort();
+        printf("No books were loaned.\n");
+        printf("Type anything to continue...");
+        getch();
+        ScreenClear();
+        return;
     }
-    struct tm tm = {0};
-    sscanf(l->startDate, "%d-%d-%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday);
-    tm.tm_year -= 1900;
-    tm.tm_mon -= 1;
-    tm.tm_mday += 7;
-    mktime(&tm);
-    strftime(buffer, 20, "%Y-%m-%d", &tm);
-    strcpy(l->deadline, buffer);
-    b->stock--;
-    if(b2 && b2->id != -1){
-        b2->stock--;
+    s = TxCommit();
+    if (s != STATUS_OK) {
+        printf("The loan was not made: %s.\n", StatusText(s));
+        printf("Type anything to continue...");
+        getch();
+        ScreenClear();
+        return;
     }
+    CirculationRecordLoan(l);
+    CoBorrowRecordLoan(l);
     printf("Loan successfully added!\n");
+    printf("Copies lent:");
+    for (int k = 0; k < l->itemCount; k++) {
+        printf(" %08d", loanItems[l->itemOffset + k].copyId);
+    }
+    printf("\n");
     printf("Type anything to continue...");
     getch();
-    system("clear");
+    ScreenClear();
+}
+
+/**
+ * @brief Adds the loan in a slot to a page of the loan list.
+ *
+ * The books of the loan share one line, so every loan takes the same room on the page.
+ */
+void listLoan(int slot, ScreenText* text) {
+    Loan* l = &loans[slot];
+    char titles[BUFFER_SIZE] = "";
+    size_t used = 0;
+    for (int k = 0; k < l->itemCount && used < sizeof(titles); k++) {
+        Book* b = LoanBook(l, k);
+        if (b) {
+            used += snprintf(titles + used, sizeof(titles) - used, "%s%d:%s", k ? "; " : "", b->id, StringGet(b->title));
+        } else {
+            used += snprintf(titles + used, sizeof(titles) - used, "%s%d (removed)", k ? "; " : "", loanItems[l->itemOffset + k].bookId);
+        }
+    }
+    ScreenTextAdd(text, "Loan ID: %d, Client CPF: %s", l->id, l->userCpf);
+    ScreenTextAdd(text, "Start Date: %s, Deadline: %s", l->startDate, l->deadline);
+    ScreenTextAdd(text, "Books: %s", titles);
+    ScreenTextAdd(text, "");
+}
+
+/**
+ * @brief Moves the loan list to the loan with an ID.
+ */
+int seekLoan(Cursor* c, const char* id) {
+    Loan* l = SearchLoanById(atoi(id));
+    return l && CursorSeek(c, l->id);
+}
+
+/**
+ * @brief Reopens the loan list in another order.
+ */
+int orderLoans(Cursor* c, int order, int pageSize) {
+    return LoanCursor(c, (LoanOrder) order, pageSize);
 }
 
 /**
  * @brief Lists all the loans in the system.
  *
- * This function iterates through all the loan entities and prints the details
- * of each loan that has a valid ID. For each loan, it displays the loan ID,
- * client CPF, details of the first book, and if available, details of the second book.
- * It also prints the start date and deadline of the loan.
+ * This function shows the open loans one page at a time and lets the user jump
+ * to a loan ID. For each loan, it displays the loan ID, client CPF, the start
+ * date and deadline of the loan, and the ID and title of every book in the loan.
+ * Pressing s lists the loans by deadline instead.
  *
- * The function waits for user input before clearing the screen.
+ * The screen is cleared when the user leaves the list.
  *
- * @note The function assumes that the `loans` array, `MAX_ENTITIES`, `SearchBookById` function,
- *       and `Book` structure are defined elsewhere in the code.
+ * @note A book removed from the collection since the loan was made is listed by its ID only.
  */
 void ListLoans() {
-    printf("Loans:\n\n");
-    for (int i = 0; i < MAX_ENTITIES;i++){
-        if (loans[i].id != -1) {
-            Book* b1 = SearchBookById(loans[i].book1Id);
-            Book* b2 = SearchBookById(loans[i].book2Id);
-            printf("Loan ID: %d\n", loans[i].id);
-            printf("Client CPF: %s\n", loans[i].userCpf);
-            printf("Book 1 : ID:%d Title:%s\n", b1->id, b1->title);
-            if(b2 && b2->id != -1) {
-                printf("Book 2 : ID:%d Title:%s\n", b2->id, b2->title);
-            }
-            printf("Start Date: %s\n", loans[i].startDate);
-            printf("Deadline: %s\n", loans[i].deadline);
-            printf("\n");
-        }
-    }
-    printf("Type anything to continue...");
-    getch();
-    system("clear");
+    static const char* const orders[] = {"ID", "deadline"};
+    Cursor c;
+    LoanCursor(&c, LOAN_BY_ID, 1);
+    ListView("Loans", &c, 4, listLoan, "Loan ID", seekLoan, orders, 2, orderLoans);
 }
 
 /**
@@ -166,75 +181,263 @@ void ListLoans() {
  * @note The function assumes the existence of several helper functions:
  * - fillBuffer(int size): Fills a buffer with user input.
  * - SearchClientByName(const char* name): Searches for a client by name.
- * - SearchLoanByClient(const char* cpf): Searches for a loan by client CPF.
- * - SearchBookById(int bookId): Searches for a book by its ID.
+ * - LoanReturn(Client* c, time_t now, int* fineCents): Closes the client's loan.
  *
  * @details
  * - If the client is not found, the function prints an error message and returns.
  * - If the loan is not found or does not belong to the client, the function prints an error message and returns.
- * - The stock of the returned books is incremented.
- * - The function calculates the fine based on the number of days late. The fine is $2.00 plus $0.50 for each day late.
+ * - The stock of every returned book is incremented and the loan's items are released, except
+ *   for the copies of reserved books, which are kept for the first client waiting for them.
+ * - The fine is $2.00 plus $0.50 for each day late, computed in cents by LoanFineCents.
  * - The loan is marked as returned by setting its ID to -1.
  * - The function prints the total fine and a success message.
  * - The function waits for user input before clearing the screen.
  */
 void ReturnBookMenu() {
     printf("Enter the client's name to return books: ");
-    fillBuffer(40);
+    fillBuffer(TEXT_MAX);
     Client* c = SearchClientByName(buffer);
     if (c == NULL) {
         printf("Client not found.\n");
         return;
     }
 
-    Loan* l = SearchLoanByClient(c->cpf);
-    if (!l || l->id == -1) {
-        printf("Loan not found or does not belong to the client.\n");
+    int fine;
+    Transaction tx;
+    TxBegin(&tx);
+    Status s = LoanReturn(c, time(NULL), &fine);
+    if (s != STATUS_OK) {
+        TxAbort();
+        if (s == STATUS_NOT_FOUND) {
+            printf("Loan not found or does not belong to the client.\n");
+        } else {
+            printf("Error: %s.\n", StatusText(s));
+        }
+        return;
+    }
+    s = TxCommit();
+    if (s != STATUS_OK) {
+        printf("Error: %s.\n", StatusText(s));
+        return;
+    }
+
+    printf("The total fine is: $%d.%02d\n", fine / 100, fine % 100);
+    printf("Books successfully returned!\n");
+    printf("Type anything to continue...");
+    getch();
+    ScreenClear();
+}
+
+/**
+ * @brief Asks for a client and a book, for the reservation menus.
+ *
+ * @return int Returns 1 if both were found, otherwise prints why and returns 0.
+ */
+int askReservation(Client** c, Book** b) {
+    printf("Enter the client's name: ");
+    fillBuffer(TEXT_MAX);
+    *c = SearchClientByName(buffer);
+    if (*c == NULL) {
+        printf("Client not found.\n");
+        return 0;
+    }
+    printf("Enter the book's name: ");
+    fillBuffer(TEXT_MAX);
+    *b = SearchBookByTitle(buffer);
+    if (*b == NULL) {
+        printf("Book not found.\n");
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Puts a client on the waiting list of a book with no copy on the shelf.
+ *
+ * When a copy of the book is returned, it is kept aside for the first client in line,
+ * and lent to them by their next loan of the book.
+ */
+void ReserveBookMenu() {
+    Client* c;
+    Book* b;
+    if (!askReservation(&c, &b)) {
+        return;
+    }
+    int position;
+    Status s = ReservationAdd(c, b, &position);
+    if (s == STATUS_INVALID) {
+        printf("Copies of this book are available, create a loan instead.\n");
+    } else if (s == STATUS_DUPLICATE) {
+        printf("The client already reserved this book.\n");
+    } else if (s != STATUS_OK) {
+        printf("Error: %s.\n", StatusText(s));
+    } else {
+        printf("Book reserved! Clients ahead: %d\n", position);
+    }
+    printf("Type anything to continue...");
+    getch();
+    ScreenClear();
+}
+
+/**
+ * @brief Takes a client off the waiting list of a book.
+ */
+void CancelReservationMenu() {
+    Client* c;
+    Book* b;
+    if (!askReservation(&c, &b)) {
         return;
     }
+    if (ReservationCancel(c, b) == STATUS_OK) {
+        printf("Reservation cancelled.\n");
+    } else {
+        printf("The client has no reservation of this book.\n");
+    }
+    printf("Type anything to continue...");
+    getch();
+    ScreenClear();
+}
 
-    Book* b1 = SearchBookById(l->book1Id);
-    Book* b2 = SearchBookById(l->book2Id);
+/**
+ * @brief Prints a reservation of a waiting list.
+ */
+void printReservation(const Reservation* r, void* context) {
+    int* position = context;
+    Client* c = &clients[r->clientId];
+    printf("%d. %s (CPF: %s) - %s\n", ++*position, StringGet(c->name), c->cpf, r->held ? "copy held" : "waiting");
+}
 
-    b1->stock++;
-    if (b2 && b2->id != -1) {
-        b2->stock++;
+/**
+ * @brief Shows the waiting list of a book, oldest reservation first.
+ */
+void ListReservationsMenu() {
+    printf("Enter the book's name: ");
+    fillBuffer(TEXT_MAX);
+    Book* b = SearchBookByTitle(buffer);
+    if (b == NULL) {
+        printf("Book not found.\n");
+        return;
+    }
+    int position = 0;
+    ReservationForEach(b->id, printReservation, &position);
+    if (position == 0) {
+        printf("Nobody is waiting for this book.\n");
     }
+    printf("Type anything to continue...");
+    getch();
+    ScreenClear();
+}
+
+/**
+ * @brief Prints a loan of the due dates screen.
+ */
+void printDueLoan(Loan* l, void* context) {
+    (void) context;
+    printf("Loan ID: %d, Client CPF: %s, Deadline: %s\n", l->id, l->userCpf, l->deadline);
+}
 
-    time_t t = time(NULL);
-    struct tm tm = *localtime(&t);
-    char currentDate[20];
-    snprintf(currentDate, 20, "%04d-%02d-%02d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+/**
+ * @brief Shows the overdue loans, the loans expiring at midnight and the loans due in the next days.
+ *
+ * The loans are read from the deadline index, so only the loans shown are visited.
+ */
+void DueLoansMenu() {
+    printf("Show loans due in the next how many days? ");
+    fillBuffer(4);
+    int days = atoi(buffer);
+    int today = DeadlineToday();
+    ScreenClear();
 
-    char deadlineStr[20];
-    strcpy(deadlineStr, l->deadline);
-    struct tm deadlineTm = {0};
-    int year, month, day;
-    sscanf(deadlineStr, "%d-%d-%d", &year, &month, &day);
+    printf("Overdue:\n");
+    if (LoansOverdue(today, printDueLoan, NULL) == 0) {
+        printf("None.\n");
+    }
+    printf("\nExpiring at midnight:\n");
+    if (LoansDueBetween(today, today, printDueLoan, NULL) == 0) {
+        printf("None.\n");
+    }
+    printf("\nDue in the next %d days:\n", days > 0 ? days : 0);
+    if (days <= 0 || LoansDueBetween(today + 1, today + days, printDueLoan, NULL) == 0) {
+        printf("None.\n");
+    }
+    printf("\nType anything to continue...");
+    getch();
+    ScreenClear();
+}
 
-    deadlineTm.tm_year = year - 1900;
-    deadlineTm.tm_mon = month - 1;
-    deadlineTm.tm_mday = day;
-    time_t deadlineTime = mktime(&deadlineTm);
+/**
+ * @brief Prints a day counted from 1970-01-01 as YYYY-MM-DD, or "-" if it is unknown.
+ */
+void printDay(int day) {
+    int year, month, dayOfMonth;
+    if (day == DEADLINE_NONE) {
+        printf("-");
+        return;
+    }
+    civilFromDays(day, &year, &month, &dayOfMonth);
+    printf("%04d-%02d-%02d", year, month, dayOfMonth);
+}
 
-    double seconds = difftime(t, deadlineTime);
-    int daysLate = seconds / (60 * 60 * 24);
-    double fine = 2.0 + (daysLate > 0 ? daysLate * 0.50 : 0);
+/**
+ * @brief Prints a returned loan with the titles of its books.
+ */
+void printArchivedLoan(const ArchivedLoan* a, const LoanItem* items, void* context) {
+    (void) context;
+    printf("CPF: %s, Borrowed: ", a->userCpf);
+    printDay(a->startDay);
+    printf(", Due: ");
+    printDay(a->deadlineDay);
+    printf(", Returned: ");
+    printDay(a->returnDay);
+    printf(", Fine: $%d.%02d\n", a->fineCents / 100, a->fineCents % 100);
+    for (int k = 0; k < a->itemCount; k++) {
+        Book* b = SearchBookById(items[k].bookId);
+        printf("  - %s\n", b ? StringGet(b->title) : "(removed book)");
+    }
+}
 
-    printf("The total fine is: $%.2f\n", fine);
+/**
+ * @brief Shows the returned loans of a client or of a book, newest first.
+ *
+ * Only the months from the one asked for are read, all of them if none is given.
+ */
+void LoanHistoryMenu() {
+    int choice = 0, year = 0, month = 0;
+    printf("History of:\n1. Client\n2. Book\nOption: ");
+    fillBuffer(1);
+    sscanf(buffer, "%d", &choice);
+    if (choice != 1 && choice != 2) {
+        ScreenClear();
+        return;
+    }
+    char key[BUFFER_SIZE];
+    printf(choice == 1 ? "Enter the client's CPF: " : "Enter the book's name: ");
+    fillBuffer(choice == 1 ? 11 : TEXT_MAX);
+    strcpy(key, buffer);
+    printf("Since which month (YYYY-MM, empty for all)? ");
+    fillBuffer(7);
+    int firstMonth = sscanf(buffer, "%d-%d", &year, &month) == 2 ? year * 12 + month - 1 : INT_MIN;
+    ScreenClear();
 
-    l->id = -1; // Mark the loan as returned
-    printf("Books successfully returned!\n");
-    printf("Type anything to continue...");
+    int found;
+    if (choice == 1) {
+        found = HistoryOfClient(key, firstMonth, INT_MAX, printArchivedLoan, NULL);
+    } else {
+        Book* b = SearchBookByTitle(key);
+        found = b ? HistoryOfBook(b->id, firstMonth, INT_MAX, printArchivedLoan, NULL) : 0;
+    }
+    printf("\n%d returned loan(s).\n", found);
+    printf("\nType anything to continue...");
     getch();
-    system("clear");
+    ScreenClear();
 }
 
 /**
  * @brief Displays the reservation menu and handles user input for loan operations.
  *
  * This function presents a menu to the user with options to list loans, create a loan,
- * return books, or go back. It processes the user's choice and calls the appropriate
+ * return books, reserve a book, cancel a reservation, show a waiting list, show the loans
+ * due soon, show the returned loans of a client or a book, or go back. It processes the user's choice and calls the appropriate
  * function based on the selection. The menu continues to be displayed until the user
  * chooses to go back.
  *
@@ -248,10 +451,11 @@ void ReturnBookMenu() {
 void ReservationMenu(void) {
     int choice;
     do {
-        printf("Loan\n\n1. List Loans\n2. Create Loan\n3. Return Book(s)\n4. Back\n");
+        printf("Loan\n\n1. List Loans\n2. Create Loan\n3. Return Book(s)\n4. Reserve a Book\n"
+               "5. Cancel Reservation\n6. Waiting List\n7. Due Dates\n8. History\n9. Back\n");
         fillBuffer(1);
         sscanf(buffer, "%d", &choice);
-        system("clear");
+        ScreenClear();
         switch(choice) {
             case 1:
                 ListLoans();
@@ -263,6 +467,21 @@ void ReservationMenu(void) {
                 ReturnBookMenu();
                 break;
             case 4:
+                ReserveBookMenu();
+                break;
+            case 5:
+                CancelReservationMenu();
+                break;
+            case 6:
+                ListReservationsMenu();
+                break;
+            case 7:
+                DueLoansMenu();
+                break;
+            case 8:
+                LoanHistoryMenu();
+                break;
+            case 9:
                 // Handle return
                 printf("Return selected.\n");
                 // Add return handling code here
@@ -271,6 +490,7 @@ void ReservationMenu(void) {
                 printf("Invalid choice. Please try again.\n");
                 break;
         }
-    }while(choice != 4);
+        SnapshotCommit();
+    }while(choice != 9);
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,489 @@
+#ifndef LOAN_HISTORY_H
+#define LOAN_HISTORY_H
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "models.h"
+#include "repository.h"
+#include "deadline_index.h"
+
+/**
+ * @file loan_history.h
+ * @brief The returned loans, archived in partitions by the month of their return.
+ *
+ * Returned loans leave the loans table for the partition of their month, which is only
+ * ever appended to. Every partition has its own small hash indexes: by CPF, chaining the
+ * loans of a client from the newest back, and by book, chaining the books lent the same
+ * way. A query for a client or a book walks the partitions of the months asked for, newest
+ * first, and only reads the loans its index chains lead to.
+ *
+ * Loans are archived under the CPF the client had at the time.
+ *
+ * On disk every partition is written as its month and counts, then its loans, then its
+ * books. The indexes are rebuilt when the file is read.
+ *
+ * The history is guarded by the loans table lock: LOCK_LOANS exclusively to archive, shared
+ * to read.
+ */
+
+/**
+ * @brief The head of an index slot whose chain was emptied by HistoryTruncate.
+ */
+#define HISTORY_TOMBSTONE -2
+
+/**
+ * @struct HistoryIndexSlot
+ * @brief A key of a partition index: its hash and the newest entry with it, or -1 if unused.
+ */
+typedef struct {
+    uint32_t hash;
+    int head;
+} HistoryIndexSlot;
+
+/**
+ * @struct HistoryIndex
+ * @brief An open-addressing hash index of a partition. `capacity` is 0 or a power of two.
+ */
+typedef struct {
+    HistoryIndexSlot* slots;
+    int capacity;
+    int used;
+} HistoryIndex;
+
+/**
+ * @struct HistoryPartition
+ * @brief The loans returned in a month, with their books and indexes.
+ *
+ * @var HistoryPartition::month
+ * The month, as counted by HistoryMonthOf.
+ *
+ * @var HistoryPartition::clientNext
+ * For every loan, the previous loan of the same CPF in the partition, or -1.
+ *
+ * @var HistoryPartition::archivedAfter
+ * For every loan, the month of the loan archived just before it, for HistoryTruncate.
+ *
+ * @var HistoryPartition::bookNext
+ * For every book, the previous book lent with the same ID in the partition, or -1.
+ *
+ * @var HistoryPartition::itemLoan
+ * For every book, the loan it was lent in.
+ */
+typedef struct {
+    int month;
+    ArchivedLoan* loans;
+    int loanCount;
+    int loanCapacity;
+    int* clientNext;
+    int* archivedAfter;
+    LoanItem* items;
+    int itemCount;
+    int itemCapacity;
+    int* bookNext;
+    int* itemLoan;
+    HistoryIndex byCpf;
+    HistoryIndex byBook;
+} HistoryPartition;
+
+/**
+ * @struct HistoryPartitionHeader
+ * @brief The header of a partition on disk.
+ */
+typedef struct {
+    int32_t month;
+    int32_t loanCount;
+    int32_t itemCount;
+} HistoryPartitionHeader;
+
+/**
+ * @brief Called once per archived loan by HistoryOfClient and HistoryOfBook, with its books.
+ */
+typedef void (*HistoryVisitor)(const ArchivedLoan* a, const LoanItem* items, void* context);
+
+HistoryPartition* historyPartitions;
+int historyPartitionCount;
+int historyPartitionCapacity;
+int historyCount;
+int historyLastMonth;
+
+/**
+ * @brief The month of a day counted from 1970-01-01, as the year times 12 plus the month from 0.
+ */
+int HistoryMonthOf(int day) {
+    int year, month, dayOfMonth;
+    civilFromDays(day, &year, &month, &dayOfMonth);
+    return year * 12 + month - 1;
+}
+
+/**
+ * @brief Finds the first partition whose month is not before `month`.
+ */
+int historyPartitionAt(int month) {
+    int low = 0, high = historyPartitionCount;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (historyPartitions[mid].month < month) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief The partition of a month, added if `create` is set.
+ *
+ * @return HistoryPartition* The partition, or NULL if there is none and none could be added.
+ */
+HistoryPartition* historyPartitionOf(int month, int create) {
+    int b = historyPartitionAt(month);
+    if (b < historyPartitionCount && historyPartitions[b].month == month) {
+        return &historyPartitions[b];
+    }
+    if (!create) {
+        return NULL;
+    }
+    if (historyPartitionCount == historyPartitionCapacity) {
+        int capacity = historyPartitionCapacity ? historyPartitionCapacity * 2 : 16;
+        HistoryPartition* grown = realloc(historyPartitions, capacity * sizeof(HistoryPartition));
+        if (!grown) {
+            return NULL;
+        }
+        historyPartitions = grown;
+        historyPartitionCapacity = capacity;
+    }
+    memmove(&historyPartitions[b + 1], &historyPartitions[b], (historyPartitionCount - b) * sizeof(HistoryPartition));
+    historyPartitionCount++;
+    memset(&historyPartitions[b], 0, sizeof(HistoryPartition));
+    historyPartitions[b].month = month;
+    return &historyPartitions[b];
+}
+
+/**
+ * @brief Makes room in a partition for `loans` more loans and `items` more books.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int historyPartitionFit(HistoryPartition* p, int loans, int items) {
+    if (p->loanCount + loans > p->loanCapacity) {
+        int capacity = p->loanCapacity ? p->loanCapacity : 16;
+        while (capacity < p->loanCount + loans) {
+            capacity *= 2;
+        }
+        ArchivedLoan* grown = realloc(p->loans, capacity * sizeof(ArchivedLoan));
+        if (grown) {
+            p->loans = grown;
+        }
+        int* next = realloc(p->clientNext, capacity * sizeof(int));
+        if (next) {
+            p->clientNext = next;
+        }
+        int* after = realloc(p->archivedAfter, capacity * sizeof(int));
+        if (after) {
+            p->archivedAfter = after;
+        }
+        if (!grown || !next || !after) {
+            return 0;
+        }
+        p->loanCapacity = capacity;
+    }
+    if (p->itemCount + items > p->itemCapacity) {
+        int capacity = p->itemCapacity ? p->itemCapacity : 16;
+        while (capacity < p->itemCount + items) {
+            capacity *= 2;
+        }
+        LoanItem* grown = realloc(p->items, capacity * sizeof(LoanItem));
+        if (grown) {
+            p->items = grown;
+        }
+        int* next = realloc(p->bookNext, capacity * sizeof(int));
+        if (next) {
+            p->bookNext = next;
+        }
+        int* owners = realloc(p->itemLoan, capacity * sizeof(int));
+        if (owners) {
+            p->itemLoan = owners;
+        }
+        if (!grown || !next || !owners) {
+            return 0;
+        }
+        p->itemCapacity = capacity;
+    }
+    return 1;
+}
+
+/**
+ * @brief Hashes a book ID for the book index of a partition.
+ */
+uint32_t historyBookHash(int bookId) {
+    return (uint32_t) bookId * 2654435761u;
+}
+
+/**
+ * @brief Finds the slot of a key in an index of a partition: a CPF in `byCpf`, a book ID in `byBook`.
+ *
+ * @return int The slot holding the key, the unused slot it would go in, or -1 if the index is empty.
+ */
+int historySlotOf(const HistoryPartition* p, const HistoryIndex* x, uint32_t hash, const char* cpf, int bookId) {
+    if (!x->capacity) {
+        return -1;
+    }
+    uint32_t mask = (uint32_t) x->capacity - 1;
+    for (uint32_t s = hash & mask; ; s = (s + 1) & mask) {
+        const HistoryIndexSlot* slot = &x->slots[s];
+        if (slot->head == -1) {
+            return (int) s;
+        }
+        if (slot->head != HISTORY_TOMBSTONE && slot->hash == hash &&
+            (x == &p->byCpf ? !strcmp(p->loans[slot->head].userCpf, cpf) : p->items[slot->head].bookId == bookId)) {
+            return (int) s;
+        }
+    }
+}
+
+/**
+ * @brief Makes room in an index for `keys` more keys, keeping it at most half full.
+ *
+ * Emptied keys are dropped when the index grows.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int historyIndexFit(HistoryIndex* x, int keys) {
+    if ((x->used + keys) * 2 <= x->capacity) {
+        return 1;
+    }
+    int capacity = x->capacity ? x->capacity : 16;
+    while ((x->used + keys) * 2 > capacity) {
+        capacity *= 2;
+    }
+    HistoryIndexSlot* slots = malloc(capacity * sizeof(HistoryIndexSlot));
+    if (!slots) {
+        return 0;
+    }
+    for (int i = 0; i < capacity; i++) {
+        slots[i].head = -1;
+    }
+    int used = 0;
+    uint32_t mask = (uint32_t) capacity - 1;
+    for (int i = 0; i < x->capacity; i++) {
+        if (x->slots[i].head >= 0) {
+            uint32_t s = x->slots[i].hash & mask;
+            while (slots[s].head != -1) {
+                s = (s + 1) & mask;
+            }
+            slots[s] = x->slots[i];
+            used++;
+        }
+    }
+    free(x->slots);
+    x->slots = slots;
+    x->capacity = capacity;
+    x->used = used;
+    return 1;
+}
+
+/**
+ * @brief Puts an entry at the head of the chain of its key, adding the key if needed.
+ *
+ * The index must have room for the key.
+ */
+void historyIndexLink(HistoryPartition* p, HistoryIndex* x, uint32_t hash, const char* cpf, int bookId, int entry, int* next) {
+    HistoryIndexSlot* slot = &x->slots[historySlotOf(p, x, hash, cpf, bookId)];
+    if (slot->head == -1) {
+        slot->hash = hash;
+        x->used++;
+    }
+    next[entry] = slot->head;
+    slot->head = entry;
+}
+
+/**
+ * @brief Takes the entry at the head of the chain of its key off the index.
+ */
+void historyIndexUnlink(HistoryPartition* p, HistoryIndex* x, uint32_t hash, const char* cpf, int bookId, int* next) {
+    HistoryIndexSlot* slot = &x->slots[historySlotOf(p, x, hash, cpf, bookId)];
+    slot->head = next[slot->head] != -1 ? next[slot->head] : HISTORY_TOMBSTONE;
+}
+
+/**
+ * @brief Links the newest loan of a partition, and its books, into the indexes.
+ */
+void historyLink(HistoryPartition* p) {
+    int i = p->loanCount - 1;
+    ArchivedLoan* a = &p->loans[i];
+    historyIndexLink(p, &p->byCpf, deadlineCpfHash(a->userCpf), a->userCpf, -1, i, p->clientNext);
+    for (int k = a->itemOffset; k < a->itemOffset + a->itemCount; k++) {
+        p->itemLoan[k] = i;
+        historyIndexLink(p, &p->byBook, historyBookHash(p->items[k].bookId), NULL, p->items[k].bookId, k, p->bookNext);
+    }
+    p->archivedAfter[i] = historyLastMonth;
+    historyLastMonth = p->month;
+    historyCount++;
+}
+
+/**
+ * @brief Archives a loan being returned.
+ *
+ * @param returnDay The day of the return, which picks the partition.
+ * @param fineCents The fine charged for the loan.
+ * @return int Returns 1 on success, otherwise returns 0 and nothing is archived.
+ */
+int HistoryArchive(const Loan* l, int returnDay, int fineCents) {
+    HistoryPartition* p = historyPartitionOf(HistoryMonthOf(returnDay), 1);
+    if (!p || !historyPartitionFit(p, 1, l->itemCount) || !historyIndexFit(&p->byCpf, 1) ||
+        !historyIndexFit(&p->byBook, l->itemCount)) {
+        return 0;
+    }
+    ArchivedLoan* a = &p->loans[p->loanCount++];
+    strcpy(a->userCpf, l->userCpf);
+    a->startDay = DeadlineDay(l->startDate);
+    a->deadlineDay = DeadlineDay(l->deadline);
+    a->returnDay = returnDay;
+    a->fineCents = fineCents;
+    a->itemOffset = p->itemCount;
+    a->itemCount = l->itemCount;
+    memcpy(&p->items[p->itemCount], &loanItems[l->itemOffset], l->itemCount * sizeof(LoanItem));
+    p->itemCount += l->itemCount;
+    historyLink(p);
+    return 1;
+}
+
+/**
+ * @brief Drops the loans archived since the history held `count` of them, newest first.
+ */
+void HistoryTruncate(int count) {
+    while (historyCount > count) {
+        HistoryPartition* p = historyPartitionOf(historyLastMonth, 0);
+        int i = p->loanCount - 1;
+        ArchivedLoan* a = &p->loans[i];
+        for (int k = a->itemOffset + a->itemCount - 1; k >= a->itemOffset; k--) {
+            historyIndexUnlink(p, &p->byBook, historyBookHash(p->items[k].bookId), NULL, p->items[k].bookId, p->bookNext);
+        }
+        historyIndexUnlink(p, &p->byCpf, deadlineCpfHash(a->userCpf), a->userCpf, -1, p->clientNext);
+        historyLastMonth = p->archivedAfter[i];
+        p->itemCount -= a->itemCount;
+        p->loanCount--;
+        historyCount--;
+    }
+}
+
+/**
+ * @brief Finds the partitions of the months from `firstMonth` to `lastMonth`, both included.
+ *
+ * @param first Receives the first of them.
+ * @return int One past the last of them.
+ */
+int historyPartitionsBetween(int firstMonth, int lastMonth, int* first) {
+    *first = historyPartitionAt(firstMonth);
+    return lastMonth == INT_MAX ? historyPartitionCount : historyPartitionAt(lastMonth + 1);
+}
+
+/**
+ * @brief Calls `visit` for every loan of a client returned from `firstMonth` to `lastMonth`,
+ *        newest first.
+ *
+ * @param firstMonth The first month, as counted by HistoryMonthOf, or INT_MIN.
+ * @param lastMonth The last month, or INT_MAX.
+ * @param visit The visitor, or NULL to only count the loans.
+ * @return int The number of loans.
+ */
+int HistoryOfClient(const char* cpf, int firstMonth, int lastMonth, HistoryVisitor visit, void* context) {
+    uint32_t hash = deadlineCpfHash(cpf);
+    int first, count = 0;
+    for (int b = historyPartitionsBetween(firstMonth, lastMonth, &first) - 1; b >= first; b--) {
+        HistoryPartition* p = &historyPartitions[b];
+        int s = historySlotOf(p, &p->byCpf, hash, cpf, -1);
+        for (int i = s == -1 ? -1 : p->byCpf.slots[s].head; i >= 0; i = p->clientNext[i]) {
+            if (visit) {
+                visit(&p->loans[i], &p->items[p->loans[i].itemOffset], context);
+            }
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Calls `visit` for every loan of a book returned from `firstMonth` to `lastMonth`,
+ *        newest first.
+ *
+ * @param visit The visitor, or NULL to only count the loans.
+ * @return int The number of loans.
+ */
+int HistoryOfBook(int bookId, int firstMonth, int lastMonth, HistoryVisitor visit, void* context) {
+    uint32_t hash = historyBookHash(bookId);
+    int first, count = 0;
+    for (int b = historyPartitionsBetween(firstMonth, lastMonth, &first) - 1; b >= first; b--) {
+        HistoryPartition* p = &historyPartitions[b];
+        int s = historySlotOf(p, &p->byBook, hash, NULL, bookId);
+        int last = -1;
+        for (int k = s == -1 ? -1 : p->byBook.slots[s].head; k >= 0; k = p->bookNext[k]) {
+            int i = p->itemLoan[k];
+            if (i == last) {
+                continue;
+            }
+            if (visit) {
+                visit(&p->loans[i], &p->items[p->loans[i].itemOffset], context);
+            }
+            last = i;
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Reads the partitions written by SaveHistory and indexes them again.
+ *
+ * @param f The file to read from, past its magic number.
+ * @param copies 1 if the items name their copy, 0 for files saved before, whose items hold
+ *        their book alone and are read with no copy. Those are widened in place, last first,
+ *        so that none is overwritten before it is read.
+ */
+void LoadHistory(FILE* f, int copies) {
+    HistoryPartitionHeader header;
+    while (fread(&header, sizeof(HistoryPartitionHeader), 1, f) == 1 && header.loanCount >= 0 && header.itemCount >= 0) {
+        HistoryPartition* p = historyPartitionOf(header.month, 1);
+        if (!p || p->loanCount || !historyPartitionFit(p, header.loanCount, header.itemCount) ||
+            !historyIndexFit(&p->byCpf, header.loanCount) || !historyIndexFit(&p->byBook, header.itemCount) ||
+            fread(p->loans, sizeof(ArchivedLoan), header.loanCount, f) != (size_t) header.loanCount ||
+            fread(p->items, copies ? sizeof(LoanItem) : sizeof(int32_t), header.itemCount, f) != (size_t) header.itemCount) {
+            return;
+        }
+        for (int k = header.itemCount - 1; !copies && k >= 0; k--) {
+            p->items[k] = (LoanItem) {((int32_t*) p->items)[k], -1};
+        }
+        p->itemCount = header.itemCount;
+        for (int i = 0; i < header.loanCount; i++) {
+            ArchivedLoan* a = &p->loans[i];
+            a->userCpf[sizeof(a->userCpf) - 1] = '\0';
+            if (a->itemOffset < 0 || a->itemCount < 0 || a->itemOffset + a->itemCount > p->itemCount) {
+                a->itemOffset = 0;
+                a->itemCount = 0;
+            }
+            p->loanCount = i + 1;
+            historyLink(p);
+        }
+    }
+}
+
+/**
+ * @brief Writes every partition, oldest month first.
+ *
+ * @param f The file to write to, past its magic number.
+ */
+void SaveHistory(FILE* f) {
+    for (int b = 0; b < historyPartitionCount; b++) {
+        HistoryPartition* p = &historyPartitions[b];
+        HistoryPartitionHeader header = {p->month, p->loanCount, p->itemCount};
+        fwrite(&header, sizeof(HistoryPartitionHeader), 1, f);
+        fwrite(p->loans, sizeof(ArchivedLoan), p->loanCount, f);
+        fwrite(p->items, sizeof(LoanItem), p->itemCount, f);
+    }
+}
+
+#endif
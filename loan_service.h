@@ -0,0 +1,425 @@
+#ifndef LOAN_SERVICE_H
+#define LOAN_SERVICE_H
+#include <limits.h>
+#include <regex.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "models.h"
+#include "status.h"
+#include "repository.h"
+#include "snapshot.h"
+#include "transaction.h"
+#include "catalog_service.h"
+#include "reservations.h"
+#include "deadline_index.h"
+#include "fine_ledger.h"
+#include "loan_history.h"
+#include "cursor.h"
+
+/**
+ * @brief Number of days a client may keep the books of a loan.
+ */
+#define LOAN_DAYS 7
+
+/**
+ * @brief Fine charged on every return, in cents.
+ */
+#define FINE_BASE_CENTS 200
+
+/**
+ * @brief Fine charged for each day past the deadline, in cents.
+ */
+#define FINE_DAILY_CENTS 50
+
+/**
+ * @brief Called once per open loan by LoanForEach.
+ */
+typedef void (*LoanVisitor)(Loan* l, void* context);
+
+/**
+ * @struct CirculationTotals
+ * @brief The counts of a circulation report, all read from one snapshot.
+ *
+ * In a consistent snapshot `copies - inStock` equals `booksOnLoan`, plus the copies held
+ * for reservations and the damaged ones, which snapshots do not hold.
+ */
+typedef struct {
+    int clients;
+    int books;
+    int copies;
+    int inStock;
+    int openLoans;
+    int booksOnLoan;
+    int overdueLoans;
+} CirculationTotals;
+
+/**
+ * @brief Orders a loan listing can be walked in.
+ */
+typedef enum {
+    LOAN_BY_ID,
+    LOAN_BY_DEADLINE
+} LoanOrder;
+
+/**
+ * @brief Validates if the given date string is in the format YYYY-MM-DD.
+ *
+ * This function uses regular expressions to check if the input date string
+ * matches the format YYYY-MM-DD, where YYYY is a 4-digit year, MM is a 2-digit
+ * month, and DD is a 2-digit day.
+ *
+ * @param date A pointer to a null-terminated string representing the date to be validated.
+ * @return Returns 1 if the date is in the valid format, otherwise returns 0.
+ */
+int isValidDateFormat(const char* date) {
+    regex_t regex;
+    int result;
+
+    result = regcomp(&regex, "^[0-9]{4}-[0-9]{2}-[0-9]{2}$", REG_EXTENDED);
+    if (result) {
+        return 0;
+    }
+
+    result = regexec(&regex, date, 0, NULL, 0);
+    regfree(&regex);
+
+    return !result;
+}
+
+/**
+ * @brief Opens an empty loan for a client.
+ *
+ * Books are then added one at a time with LoanAddBook. Run it inside a transaction, so
+ * that a loan left without books can be dropped with TxAbort.
+ *
+ * @param startDate The start date as YYYY-MM-DD, or NULL or "" for today. The deadline is
+ *        LOAN_DAYS later.
+ * @param out Receives the new loan on success.
+ * @return Status STATUS_OK, STATUS_ACTIVE_LOAN if the client already has a loan, STATUS_INVALID
+ *         for a malformed date, or STATUS_NO_MEMORY.
+ */
+Status LoanOpen(Client* c, const char* startDate, Loan** out) {
+    if (SearchLoanByClient(c->cpf)) {
+        return STATUS_ACTIVE_LOAN;
+    }
+    char date[20];
+    if (startDate && startDate[0] != '\0') {
+        if (!isValidDateFormat(startDate)) {
+            return STATUS_INVALID;
+        }
+        strcpy(date, startDate);
+    } else {
+        time_t t = time(NULL);
+        struct tm tm;
+        localtime_r(&t, &tm);
+        snprintf(date, sizeof(date), "%04d-%02d-%02d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+    }
+    Loan* l = getEmptyLoan();
+    if (!l) {
+        return STATUS_NO_MEMORY;
+    }
+    if (!TxCreated(ROW_LOANS, l->id)) {
+        initEmptyLoan(l);
+        return STATUS_NO_MEMORY;
+    }
+    strcpy(l->userCpf, c->cpf);
+    strcpy(l->startDate, date);
+
+    struct tm tm = {0};
+    sscanf(l->startDate, "%d-%d-%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday);
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_mday += LOAN_DAYS;
+    mktime(&tm);
+    strftime(l->deadline, sizeof(l->deadline), "%Y-%m-%d", &tm);
+    if (!DeadlineIndexSet(l->id)) {
+        initEmptyLoan(l);
+        return STATUS_NO_MEMORY;
+    }
+    deadlineClients[l->id] = (int) (c - clients);
+    *out = l;
+    return STATUS_OK;
+}
+
+/**
+ * @brief Lends one copy of a book in a loan, and names it in the loan's new item.
+ *
+ * A copy held for the client's reservation is lent before one from the shelf. If the
+ * loan is aborted afterwards, that copy goes back on the shelf.
+ *
+ * @return Status STATUS_OK, STATUS_NOT_FOUND if the book is at another branch than the loan,
+ *         STATUS_NO_STOCK if no copy is available, or STATUS_NO_MEMORY.
+ */
+Status LoanAddBook(Loan* l, Book* b) {
+    if (rowBranches[ROW_BOOKS][b->id] != rowBranches[ROW_LOANS][l->id]) {
+        return STATUS_NOT_FOUND;
+    }
+    if (!TxReserve(2) || !TxSave(ROW_LOANS, l->id)) {
+        return STATUS_NO_MEMORY;
+    }
+    Client* c = BookHasReservations(b->id) ? SearchClientByCPF(l->userCpf) : NULL;
+    int held = c && ReservationRemove((int) (c - clients), b->id, 1, NULL);
+    int copy = held ? CopyTake(b->id, COPY_HELD, COPY_LENT) : BookTakeCopy(b);
+    if (copy == -1) {
+        return STATUS_NO_STOCK;
+    }
+    if (!AddLoanItem(l, b->id, copy)) {
+        BookReturnCopy(b, copy);
+        if (held) {
+            StockChanged(b->id, 1);
+        }
+        return STATUS_NO_MEMORY;
+    }
+    TxStock(b->id, copy, -1);
+    if (!held) {
+        StockChanged(b->id, -1);
+    }
+    RowChanged(ROW_LOANS, l->id);
+    booksVersion++;
+    return STATUS_OK;
+}
+
+/**
+ * @brief Puts every copy of a loan back in stock and frees its items.
+ *
+ * A returned copy of a reserved book is held for the first client waiting for it
+ * instead. Those promotions are not undone by TxAbort, so nothing may fail once the
+ * books are restocked. The undo log must have room for the books and the loan.
+ */
+void restockLoan(Loan* l) {
+    for (int k = 0; k < l->itemCount; k++) {
+        const LoanItem* item = &loanItems[l->itemOffset + k];
+        Book* b = SearchBookById(item->bookId);
+        if (b && ReservationPromote(b->id) == -1) {
+            BookReturnCopy(b, item->copyId);
+            TxStock(b->id, item->copyId, 1);
+            StockChanged(b->id, 1);
+        } else if (b && item->copyId != -1) {
+            CopyMove(item->copyId, COPY_HELD);
+        }
+    }
+    booksVersion++;
+    TxSave(ROW_LOANS, l->id);
+    FreeLoanItems(l);
+    initEmptyLoan(l);
+    DeadlineIndexSet((int) (l - loans));
+    if (!txActive) {
+        CompactSparseLoanItems();
+    }
+}
+
+/**
+ * @brief Puts a client on the waiting list of a book.
+ *
+ * @param position Receives the number of reservations ahead of the client's. May be NULL.
+ * @return Status STATUS_OK, STATUS_INVALID if a copy is on the shelf, STATUS_DUPLICATE if the
+ *         client already reserved the book, or STATUS_NO_MEMORY.
+ */
+Status ReservationAdd(Client* c, Book* b, int* position) {
+    int clientId = (int) (c - clients);
+    if (b->stock > 0) {
+        return STATUS_INVALID;
+    }
+    if (ReservationPosition(clientId, b->id) != -1) {
+        return STATUS_DUPLICATE;
+    }
+    if (!ReservationEnqueue(clientId, b->id, 0)) {
+        return STATUS_NO_MEMORY;
+    }
+    if (position) {
+        *position = ReservationPosition(clientId, b->id);
+    }
+    return STATUS_OK;
+}
+
+/**
+ * @brief Takes a client off the waiting list of a book.
+ *
+ * A copy held for the client goes to the next client waiting, or back on the shelf.
+ *
+ * @return Status STATUS_OK, or STATUS_NOT_FOUND if the client has no reservation of the book.
+ */
+Status ReservationCancel(Client* c, Book* b) {
+    int held;
+    if (!ReservationRemove((int) (c - clients), b->id, 0, &held)) {
+        return STATUS_NOT_FOUND;
+    }
+    if (held && ReservationPromote(b->id) == -1) {
+        BookReturnCopy(b, CopyNext(b->id, COPY_HELD, 0));
+        StockChanged(b->id, 1);
+        booksVersion++;
+    }
+    return STATUS_OK;
+}
+
+/**
+ * @brief Computes the fine of a loan due on one day and returned on another.
+ *
+ * The fine is FINE_BASE_CENTS plus FINE_DAILY_CENTS for each full day past the deadline.
+ * It takes integers only, so that FineSweep can compute it in vectorized loops.
+ *
+ * @param deadline The day of the deadline, as counted by DeadlineDay.
+ * @param today The day of the return.
+ * @return int The fine in cents.
+ */
+int FineCents(int deadline, int today) {
+    int daysLate = today - deadline;
+    return FINE_BASE_CENTS + (daysLate > 0 ? daysLate * FINE_DAILY_CENTS : 0);
+}
+
+/**
+ * @brief Computes the fine due when a loan is returned.
+ *
+ * @param now The time of the return.
+ * @return int The fine in cents. A deadline that cannot be read is never late.
+ */
+int LoanFineCents(const Loan* l, time_t now) {
+    int today = DeadlineDayAt(now);
+    int deadline = DeadlineDay(l->deadline);
+    return FineCents(deadline == DEADLINE_NONE ? today : deadline, today);
+}
+
+/**
+ * @brief Returns every book of a client's loan, charges the fine to the client's ledger and
+ *        moves the loan to the history.
+ *
+ * @param now The time of the return, used for the fine and the history partition.
+ * @param fineCents Receives the fine in cents. May be NULL.
+ * @return Status STATUS_OK, STATUS_NOT_FOUND if the client has no open loan, or STATUS_NO_MEMORY
+ *         if the undo log of the current transaction, the ledger or the history cannot grow.
+ */
+Status LoanReturn(Client* c, time_t now, int* fineCents) {
+    Loan* l = SearchLoanByClient(c->cpf);
+    if (!l) {
+        return STATUS_NOT_FOUND;
+    }
+    int fine = LoanFineCents(l, now);
+    int today = DeadlineDayAt(now);
+    if (!TxReserve(l->itemCount + 2) || !TxSave(ROW_CLIENTS, (int) (c - clients)) ||
+        !HistoryArchive(l, today, fine) || !LedgerPost((int) (c - clients), today, fine)) {
+        return STATUS_NO_MEMORY;
+    }
+    if (fineCents) {
+        *fineCents = fine;
+    }
+    restockLoan(l);
+    return STATUS_OK;
+}
+
+/**
+ * @brief Returns the book of the k-th item of a loan.
+ *
+ * @return Book* The book, or NULL if it was removed from the collection.
+ */
+Book* LoanBook(const Loan* l, int k) {
+    return SearchBookById(loanItems[l->itemOffset + k].bookId);
+}
+
+/**
+ * @brief Calls `visit` for every open loan, in ID order.
+ */
+void LoanForEach(LoanVisitor visit, void* context) {
+    for (int i = SlotSetNext(&loansLive, 0, loansCapacity); i != -1; i = SlotSetNext(&loansLive, i + 1, loansCapacity)) {
+        visit(&loans[i], context);
+    }
+}
+
+/**
+ * @brief Calls `visit` for every open loan due before a day, by deadline.
+ *
+ * @param today A day as counted by DeadlineDay, usually DeadlineToday().
+ * @param visit The visitor, or NULL to only count the loans.
+ * @return int The number of overdue loans.
+ */
+int LoansOverdue(int today, LoanVisitor visit, void* context) {
+    return DeadlineIndexWalk(INT_MIN, today - 1, visit, context);
+}
+
+/**
+ * @brief Calls `visit` for every open loan due from `firstDay` to `lastDay`, both included,
+ *        by deadline.
+ *
+ * Loans due on `today` expire at midnight.
+ *
+ * @param visit The visitor, or NULL to only count the loans.
+ * @return int The number of loans due in those days.
+ */
+int LoansDueBetween(int firstDay, int lastDay, LoanVisitor visit, void* context) {
+    return DeadlineIndexWalk(firstDay, lastDay, visit, context);
+}
+
+/**
+ * @brief Counts the clients, copies and open loans of the current snapshot.
+ *
+ * Takes no table lock, so it never waits on loans and returns being made meanwhile.
+ *
+ * @param today The current date as YYYY-MM-DD. Loans due before it are overdue.
+ * @return Status STATUS_OK, or STATUS_NO_MEMORY if no snapshot can be built.
+ */
+Status CirculationReport(const char* today, CirculationTotals* totals) {
+    const SnapshotVersion* v = SnapshotPin();
+    if (!v) {
+        return STATUS_NO_MEMORY;
+    }
+    *totals = (CirculationTotals) {0};
+    for (int i = 0; i < SnapshotCapacity(v, ROW_CLIENTS); i++) {
+        const Client* c = SnapshotClient(v, i);
+        totals->clients += c && strcmp(c->cpf, "0");
+    }
+    for (int i = 0; i < SnapshotCapacity(v, ROW_BOOKS); i++) {
+        const Book* b = SnapshotBook(v, i);
+        if (b && b->id != -1) {
+            totals->books++;
+            totals->copies += b->amount;
+            totals->inStock += b->stock;
+        }
+    }
+    for (int i = 0; i < SnapshotCapacity(v, ROW_LOANS); i++) {
+        const Loan* l = SnapshotLoan(v, i);
+        if (l && l->id != -1) {
+            totals->openLoans++;
+            totals->booksOnLoan += l->itemCount;
+            totals->overdueLoans += strcmp(l->deadline, today) < 0;
+        }
+    }
+    SnapshotUnpin();
+    return STATUS_OK;
+}
+
+/**
+ * @brief Packs the deadline of the loan in a slot as YYYYMMDD.
+ */
+uint32_t loanDeadlineKey(int slot) {
+    int year = 0, month = 0, day = 0;
+    sscanf(loans[slot].deadline, "%d-%d-%d", &year, &month, &day);
+    return (uint32_t) (year * 10000 + month * 100 + day);
+}
+
+unsigned loansVersionOf(void) {
+    return loansVersion;
+}
+
+/**
+ * @brief The open loans sorted by deadline, sorted again when the loans table changes.
+ */
+SortedView loansByDeadline = {&loansLive, &loansCapacity, loanDeadlineKey, NULL, loansVersionOf,
+                              PTHREAD_MUTEX_INITIALIZER};
+
+/**
+ * @brief Points a cursor at the first page of open loans.
+ *
+ * Loan IDs are slots, so `CursorSeek(c, id)` moves to the page starting at a loan.
+ *
+ * @param order The order to walk the loans in.
+ * @return int The number of loans on the page.
+ */
+int LoanCursor(Cursor* c, LoanOrder order, int pageSize) {
+    if (order == LOAN_BY_DEADLINE) {
+        return CursorOpenSorted(c, &loansByDeadline, pageSize);
+    }
+    return CursorOpen(c, &loansLive, &loansCapacity, pageSize);
+}
+
+#endif
@@ -0,0 +1,308 @@
+#ifndef MAINTENANCE_CONTROLLER_H
+#define MAINTENANCE_CONTROLLER_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "cstdin.h"
+#include "screen.h"
+#include "repository.h"
+#include "address_index.h"
+#include "reference_counts.h"
+#include "loan_service.h"
+#include "fine_sweep.h"
+#include "circulation_stats.h"
+#include "snapshot.h"
+
+/**
+ * @brief Items listed per dimension by the popularity menu.
+ */
+#define POPULAR_ITEMS 10
+
+/**
+ * @brief Prints how many bytes of address space an arena has reserved, how many of them are
+ *        committed and how many of those are in use.
+ */
+void ArenaPrintStats(const Arena* a) {
+    static const char* modes[] = {"regular pages", "transparent huge pages", "explicit huge pages"};
+    double percentage = a->committed ? 100.0 * a->used / a->committed : 0;
+    printf("%-20s reserved: %12zu bytes, committed: %10zu bytes, used: %10zu bytes (%5.1f%%), %s\n",
+           a->name, a->reserved, a->committed, a->used, percentage, modes[a->hugePages]);
+}
+
+/**
+ * @brief Prints the memory reserved, committed and used by every table.
+ */
+void PrintStorageStats(void) {
+    printf("Storage:\n\n");
+    ArenaPrintStats(&clientsArena);
+    ArenaPrintStats(&booksArena);
+    ArenaPrintStats(&addressesArena);
+    ArenaPrintStats(&genresArena);
+    ArenaPrintStats(&authorsArena);
+    ArenaPrintStats(&loansArena);
+    ArenaPrintStats(&loanItemsArena);
+    ArenaPrintStats(&addressRefsArena);
+    ArenaPrintStats(&authorRefsArena);
+    ArenaPrintStats(&genreRefsArena);
+    ArenaPrintStats(&bookViewsArena);
+    ArenaPrintStats(&rowStampsArenas[ROW_CLIENTS]);
+    ArenaPrintStats(&rowStampsArenas[ROW_BOOKS]);
+    ArenaPrintStats(&rowStampsArenas[ROW_LOANS]);
+    for (int t = 0; t < ROW_LOAN_ITEMS; t++) {
+        ArenaPrintStats(&rowBranchesArenas[t]);
+    }
+    for (int b = 0; b < branchCount; b++) {
+        for (int t = 0; t < ROW_LOAN_ITEMS; t++) {
+            ArenaPrintStats(&branchRows[b][t].arena);
+        }
+    }
+    ArenaPrintStats(&copiesArena);
+    ArenaPrintStats(&copyRunsArena);
+    for (int state = 0; state < COPY_STATES; state++) {
+        ArenaPrintStats(&copyBitsArenas[state]);
+    }
+    ArenaPrintStats(&clientsLive.arena);
+    ArenaPrintStats(&booksLive.arena);
+    ArenaPrintStats(&loansLive.arena);
+    ArenaPrintStats(&stringsArena);
+    ArenaPrintStats(&stringOffsetsArena);
+    ArenaPrintStats(&ledgerNodesArena);
+    ArenaPrintStats(&ledgerLastArena);
+    ArenaPrintStats(&ledgerDebtsArena);
+    ArenaPrintStats(&fineAccruedArena);
+    ArenaPrintStats(&statsGenreTopsArena);
+}
+
+/**
+ * @brief Normalizes every address and merges the duplicates, then reports how many were removed.
+ */
+void MergeAddressesMenu() {
+    int removed = MergeDuplicateAddresses();
+    printf("%d address(es) merged or removed.\n", removed);
+    printf("Type anything to continue...");
+    getch();
+    ScreenClear();
+}
+
+/**
+ * @brief Prints one reference count that drifted.
+ */
+void printReferenceDrift(const char* table, int id, int recorded, int counted, void* context) {
+    printf("%s %d: recorded %d, counted %d\n", table, id, recorded, counted);
+}
+
+/**
+ * @brief Recomputes every reference count, reports the drifted ones and offers to repair them.
+ */
+void VerifyReferenceCountsMenu() {
+    int drift = VerifyReferenceCounts(0, printReferenceDrift, NULL);
+    if (drift < 0) {
+        printf("Not enough memory to verify the reference counts.\n");
+    } else if (drift == 0) {
+        printf("All reference counts are consistent.\n");
+    } else {
+        printf("\n%d reference count(s) drifted. Repair them? (Y or N) ", drift);
+        fillBuffer(1);
+        if (buffer[0] == 'Y') {
+            VerifyReferenceCounts(1, NULL, NULL);
+            printf("Reference counts repaired.\n");
+        }
+    }
+    printf("Type anything to continue...");
+    getch();
+    ScreenClear();
+}
+
+/**
+ * @brief Prints the circulation counts of the current snapshot.
+ */
+void CirculationReportMenu() {
+    CirculationTotals totals;
+    char today[11];
+    time_t now = time(NULL);
+    struct tm tm;
+    strftime(today, sizeof(today), "%Y-%m-%d", localtime_r(&now, &tm));
+    if (CirculationReport(today, &totals) != STATUS_OK) {
+        printf("Not enough memory for the report.\n");
+    } else {
+        printf("Circulation on %s:\n\n", today);
+        printf("Clients:        %d\n", totals.clients);
+        printf("Books:          %d\n", totals.books);
+        printf("Copies:         %d\n", totals.copies);
+        printf("In stock:       %d\n", totals.inStock);
+        printf("Open loans:     %d\n", totals.openLoans);
+        printf("Books on loan:  %d\n", totals.booksOnLoan);
+        printf("Overdue loans:  %d\n", totals.overdueLoans);
+    }
+    printf("\nType anything to continue...");
+    getch();
+    ScreenClear();
+}
+
+/**
+ * @brief Brings every client's accrued fine up to date, on one thread per CPU.
+ */
+void FineSweepMenu() {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int swept = FineSweep(DeadlineToday(), 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("Fines accrued on %d open loan(s), in %.3f s.\n", swept, seconds);
+    printf("\nType anything to continue...");
+    getch();
+    ScreenClear();
+}
+
+/**
+ * @brief The name of a counted book, author or genre.
+ */
+const char* popularName(StatsDimension dimension, int id) {
+    if (dimension == STATS_BOOKS) {
+        Book* b = SearchBookById(id);
+        return b ? StringGet(b->title) : "(removed)";
+    }
+    if (dimension == STATS_AUTHORS) {
+        Author* a = SearchAuthorById(id);
+        return a ? StringGet(a->name) : "(removed)";
+    }
+    Genre* g = SearchGenreById(id);
+    return g ? StringGet(g->genre) : "(removed)";
+}
+
+/**
+ * @brief Prints the most lent items of a dimension in a window.
+ */
+void printPopular(const char* heading, StatsDimension dimension, int days, int genreId) {
+    HeavyHitter top[POPULAR_ITEMS];
+    int count = CirculationTop(dimension, days, genreId, top, POPULAR_ITEMS);
+    printf("%s:\n", heading);
+    if (count <= 0) {
+        printf("  (none)\n");
+    }
+    for (int i = 0; i < count; i++) {
+        printf("  %2d. %-40s about %u\n", i + 1, popularName(dimension, top[i].id), top[i].count);
+    }
+    printf("\n");
+}
+
+/**
+ * @brief Shows the books, authors and genres lent the most over the last days, estimated by
+ *        circulation_stats.h, or only the books of one genre.
+ */
+void PopularMenu() {
+    int days = 0;
+    printf("Lent over the last 1, 7 or 30 days: ");
+    fillBuffer(3);
+    sscanf(buffer, "%d", &days);
+    if (circulationWindowOf(days) == -1) {
+        printf("Choose 1, 7 or 30 days.\n");
+    } else {
+        printf("Genre [Empty for all]: ");
+        fillBuffer(TEXT_MAX);
+        Genre* g = buffer[0] ? SearchGenreByName(buffer) : NULL;
+        if (buffer[0] && !g) {
+            printf("Genre not found.\n");
+        } else {
+            CirculationAdvance(DeadlineToday());
+            ScreenClear();
+            printf("Most lent over the last %d day(s)%s%s:\n\n", days, g ? " in " : "", g ? StringGet(g->genre) : "");
+            printPopular("Books", STATS_BOOKS, days, g ? g->id : -1);
+            if (!g) {
+                printPopular("Authors", STATS_AUTHORS, days, -1);
+                printPopular("Genres", STATS_GENRES, days, -1);
+            }
+        }
+    }
+    printf("Type anything to continue...");
+    getch();
+    ScreenClear();
+}
+
+/**
+ * @brief Lists the branches with the size of their partitions, then moves the desk to a
+ *        branch, adding it if there is none with that name.
+ */
+void BranchMenu() {
+    printf("%-3s %-20s %8s %8s %8s\n", "", "Branch", "Clients", "Books", "Loans");
+    for (int b = 0; b < branchCount; b++) {
+        printf("%-3s %-20s %8d %8d %8d\n", b == branchCurrent ? "*" : "", BranchName(b),
+               branchRows[b][ROW_CLIENTS].count, branchRows[b][ROW_BOOKS].count, branchRows[b][ROW_LOANS].count);
+    }
+    printf("\nWork at branch [Empty to stay]: ");
+    fillBuffer(TEXT_MAX);
+    if (buffer[0]) {
+        int b = BranchFind(buffer);
+        Status s = b == -1 ? BranchAdd(buffer, &b) : STATUS_OK;
+        if (s == STATUS_OK) {
+            branchCurrent = b;
+            printf("Working at %s.\n", BranchName(b));
+        } else {
+            printf("Could not add the branch: %s.\n", StatusText(s));
+        }
+    }
+    printf("Type anything to continue...");
+    getch();
+    ScreenClear();
+}
+
+/**
+ * @brief Displays the maintenance menu and handles user input.
+ *
+ * The menu provides the following options:
+ * 1. Show storage statistics
+ * 2. Normalize and merge duplicate addresses
+ * 3. Verify the address, author and genre reference counts
+ * 4. Show the circulation report
+ * 5. Update the accrued fines
+ * 6. Show the most lent books, authors and genres
+ * 7. List the branches and choose the one to work at
+ * 8. Go back to the previous menu
+ */
+void MaintenanceMenu() {
+    int choice = 0;
+    do {
+        printf("Maintenance\n\n1. Storage\n2. Merge Duplicate Addresses\n3. Verify Reference Counts\n4. Circulation Report\n5. Fine Sweep\n6. Popular\n7. Branch\n8. Back\n");
+        fillBuffer(1);
+        sscanf(buffer, "%d", &choice);
+        ScreenClear();
+        switch(choice) {
+            case 1:
+                PrintStorageStats();
+                printf("\nType anything to continue...");
+                getch();
+                ScreenClear();
+                break;
+            case 2:
+                MergeAddressesMenu();
+                break;
+            case 3:
+                VerifyReferenceCountsMenu();
+                break;
+            case 4:
+                CirculationReportMenu();
+                break;
+            case 5:
+                FineSweepMenu();
+                break;
+            case 6:
+                PopularMenu();
+                break;
+            case 7:
+                BranchMenu();
+                break;
+            case 8:
+                break;
+            default:
+                printf("Invalid choice. Please try again.\n");
+                printf("Type anything to continue...");
+                getch();
+                ScreenClear();
+                break;
+        }
+        SnapshotCommit();
+    } while(choice != 8);
+}
+
+#endif
@@ -1,5 +1,6 @@
 #ifndef MODELS_H
 #define MODELS_H
+#include "string_heap.h"
 #define MAX_ENTITIES 50
 
 /**
@@ -10,11 +11,11 @@
  * The unique identifier for the genre.
  * 
  * @var Genre::genre
- * The name of the genre, stored as a string with a maximum length of 40 characters.
+ * The name of the genre, interned in the string heap.
  */
 typedef struct {
     int id;
-    char genre[40];
+    StringId genre;
 } Genre;
 
 /**
@@ -25,11 +26,11 @@ typedef struct {
  * Member 'id' contains the unique identifier for the author.
  * 
  * @var Author::name
- * Member 'name' contains the name of the author, with a maximum length of 40 characters.
+ * Member 'name' contains the name of the author, interned in the string heap.
  */
 typedef struct {
     int id;
-    char name[40];
+    StringId name;
 } Author;
 
 /**
@@ -40,7 +41,7 @@ typedef struct {
  * Unique identifier for the book.
  * 
  * @var Book::title
- * Title of the book. Maximum length is 40 characters.
+ * Title of the book, interned in the string heap.
  * 
  * @var Book::authorId
  * Identifier for the author of the book.
@@ -49,20 +50,37 @@ typedef struct {
  * Identifier for the genre of the book.
  * 
  * @var Book::amount
- * Total amount of the book available.
+ * Total amount of the book available, damaged copies included.
  * 
  * @var Book::stock
- * Current stock of the book.
+ * Current stock of the book: its copies on the shelf. Loans take and return copies with
+ * BookTakeCopy and BookReturnCopy, atomically and without locking the book. Which copies
+ * they are is kept by copies.h.
  */
 typedef struct {
     int id;
-    char title[40];
+    StringId title;
     int authorId;
     int genreId;
     int amount;
-    int stock;
+    _Atomic int stock;
 } Book;
 
+/**
+ * @struct BookView
+ * @brief The author and genre names of a book, resolved ahead of time for listings.
+ *
+ * @var BookView::author
+ * Name of the author of the book, or STRING_EMPTY if the author is missing.
+ *
+ * @var BookView::genre
+ * Name of the genre of the book, or STRING_EMPTY if the genre is missing.
+ */
+typedef struct {
+    StringId author;
+    StringId genre;
+} BookView;
+
 /**
  * @struct Address
  * @brief Represents an address with various details.
@@ -71,23 +89,23 @@ typedef struct {
  * Member 'id' represents the unique identifier for the address.
  * 
  * @var Address::street
- * Member 'street' represents the name of the street. It is a character array with a maximum length of 40 characters.
+ * Member 'street' represents the name of the street, interned in the string heap.
  * 
  * @var Address::number
- * Member 'number' represents the number of the address. It is a character array with a maximum length of 5 characters.
+ * Member 'number' represents the number of the address, interned in the string heap.
  * 
  * @var Address::cep
- * Member 'cep' represents the postal code (CEP) of the address. It is a character array with a maximum length of 10 characters.
+ * Member 'cep' represents the postal code (CEP) of the address, interned in the string heap.
  * 
  * @var Address::complement
- * Member 'complement' represents additional address information. It is a character array with a maximum length of 40 characters.
+ * Member 'complement' represents additional address information, interned in the string heap.
  */
 typedef struct {
     int id;
-    char street[40];
-    char number[5];
-    char cep[10];
-    char complement[40];
+    StringId street;
+    StringId number;
+    StringId cep;
+    StringId complement;
 } Address;
 
 /**
@@ -95,10 +113,10 @@ typedef struct {
  * @brief Represents a client in the system.
  * 
  * This structure holds information about a client, including their personal details,
- * address, fines, and borrowed books.
+ * address and fines. The books a client borrowed are listed by their loan.
  * 
  * @var Client::name
- * Member 'name' stores the name of the client. It is a character array with a maximum length of 40 characters.
+ * Member 'name' stores the name of the client, interned in the string heap.
  * 
  * @var Client::cpf
  * Member 'cpf' stores the CPF (Cadastro de Pessoas Físicas) of the client. It is a character array with a maximum length of 12 characters.
@@ -107,35 +125,87 @@ typedef struct {
  * Member 'addressId' stores the identifier for the client's address. It is an integer value.
  * 
  * @var Client::fineAmount
- * Member 'fineAmount' stores the total amount of fines the client has. It is an integer value.
- * 
- * @var Client::bookId1
- * Member 'bookId1' stores the identifier of the first book borrowed by the client. It is an integer value.
- * 
- * @var Client::bookId2
- * Member 'bookId2' stores the identifier of the second book borrowed by the client. It is an integer value.
+ * Member 'fineAmount' stores the fines in cents the client still owes: the running balance of their ledger.
  * 
  * @var Client::deadline
  * Member 'deadline' stores the deadline for returning the borrowed books. It is a character array with a maximum length of 8 characters.
  */
 typedef struct
 {
-    char name[40];
+    StringId name;
     char cpf[12];
     int addressId;
     int fineAmount;
-    int bookId1;
-    int bookId2;
     char deadline[8];
 } Client;
 
+/**
+ * @brief Where a copy of a book is. A copy is always in exactly one state.
+ *
+ * COPY_RETIRED copies left the collection; their barcodes are not given again.
+ */
+typedef enum {
+    COPY_ON_SHELF,
+    COPY_LENT,
+    COPY_HELD,
+    COPY_DAMAGED,
+    COPY_STATES,
+    COPY_RETIRED = COPY_STATES
+} CopyState;
+
+/**
+ * @struct Copy
+ * @brief Represents one physical copy of a book. Its barcode is its index in the copy table.
+ *
+ * @var Copy::bookId
+ * Member 'bookId' contains the ID of the book the copy is of.
+ *
+ * @var Copy::state
+ * Member 'state' contains the CopyState of the copy.
+ */
+typedef struct {
+    int bookId;
+    _Atomic int state;
+} Copy;
+
+/**
+ * @struct CopyRun
+ * @brief The copies of a book, contiguous in the copy table.
+ *
+ * @var CopyRun::first
+ * Member 'first' contains the barcode of the first copy of the book.
+ *
+ * @var CopyRun::count
+ * Member 'count' contains the number of copies, retired ones included.
+ */
+typedef struct {
+    int first;
+    int count;
+} CopyRun;
+
+/**
+ * @struct LoanItem
+ * @brief Represents one book borrowed in a loan.
+ * 
+ * @var LoanItem::bookId
+ * Member 'bookId' contains the ID of the borrowed book.
+ *
+ * @var LoanItem::copyId
+ * Member 'copyId' contains the barcode of the copy lent, or -1 for loans archived before
+ * copies had barcodes.
+ */
+typedef struct {
+    int bookId;
+    int copyId;
+} LoanItem;
+
 /**
  * @struct Loan
  * @brief Represents a loan record in the system.
  * 
  * This structure holds information about a loan, including the loan ID, 
  * the user's CPF (Cadastro de Pessoas Físicas, Brazilian individual taxpayer registry identification), 
- * the IDs of two books associated with the loan, and the start and deadline dates of the loan.
+ * the range of its items in the loan items array, and the start and deadline dates of the loan.
  * 
  * @var Loan::id
  * Member 'id' contains the unique identifier for the loan.
@@ -143,11 +213,11 @@ typedef struct
  * @var Loan::userCpf
  * Member 'userCpf' contains the CPF of the user who took the loan.
  * 
- * @var Loan::book1Id
- * Member 'book1Id' contains the ID of the first book in the loan.
+ * @var Loan::itemOffset
+ * Member 'itemOffset' contains the index of the loan's first item in `loanItems`.
  * 
- * @var Loan::book2Id
- * Member 'book2Id' contains the ID of the second book in the loan.
+ * @var Loan::itemCount
+ * Member 'itemCount' contains the number of books in the loan. Its items are contiguous.
  * 
  * @var Loan::startDate
  * Member 'startDate' contains the start date of the loan in a string format.
@@ -158,11 +228,86 @@ typedef struct
 typedef struct {
     int id;
     char userCpf[12];
-    int book1Id;
-    int book2Id;
+    int itemOffset;
+    int itemCount;
     char startDate[20];
     char deadline[20];
 } Loan;
+
+/**
+ * @struct ArchivedLoan
+ * @brief Represents a returned loan kept in the loan history.
+ *
+ * Days are counted from 1970-01-01.
+ *
+ * @var ArchivedLoan::userCpf
+ * Member 'userCpf' contains the CPF of the client at the time of the loan.
+ *
+ * @var ArchivedLoan::startDay
+ * Member 'startDay' contains the day the loan started.
+ *
+ * @var ArchivedLoan::deadlineDay
+ * Member 'deadlineDay' contains the day the loan was due.
+ *
+ * @var ArchivedLoan::returnDay
+ * Member 'returnDay' contains the day the books were returned.
+ *
+ * @var ArchivedLoan::fineCents
+ * Member 'fineCents' contains the fine charged for the loan, in cents.
+ *
+ * @var ArchivedLoan::itemOffset
+ * Member 'itemOffset' contains the index of the loan's first book in the items of its partition.
+ *
+ * @var ArchivedLoan::itemCount
+ * Member 'itemCount' contains the number of books in the loan.
+ */
+typedef struct {
+    char userCpf[12];
+    int startDay;
+    int deadlineDay;
+    int returnDay;
+    int fineCents;
+    int itemOffset;
+    int itemCount;
+} ArchivedLoan;
+
+/**
+ * @struct Reservation
+ * @brief Represents a client waiting for a copy of a book.
+ *
+ * @var Reservation::clientId
+ * Member 'clientId' contains the ID of the client who reserved the book.
+ *
+ * @var Reservation::bookId
+ * Member 'bookId' contains the ID of the reserved book.
+ *
+ * @var Reservation::held
+ * Member 'held' is 1 once a returned copy is kept aside for the client, otherwise 0.
+ */
+typedef struct {
+    int clientId;
+    int bookId;
+    int held;
+} Reservation;
+
+/**
+ * @struct LedgerEntry
+ * @brief Represents a fine charged to a client or a payment they made.
+ *
+ * @var LedgerEntry::clientId
+ * Member 'clientId' contains the ID of the client.
+ *
+ * @var LedgerEntry::day
+ * Member 'day' contains the day of the entry, counted from 1970-01-01.
+ *
+ * @var LedgerEntry::amount
+ * Member 'amount' contains the amount in cents, positive for a fine and negative for a payment.
+ */
+typedef struct {
+    int clientId;
+    int day;
+    int amount;
+} LedgerEntry;
 /**
  * @struct Admin
  * @brief Represents an administrator with login credentials.
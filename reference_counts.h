@@ -0,0 +1,222 @@
+#ifndef REFERENCE_COUNTS_H
+#define REFERENCE_COUNTS_H
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "models.h"
+#include "repository.h"
+
+/**
+ * @brief Upper bound on the threads VerifyReferenceCounts splits the tables across.
+ */
+#define VERIFY_MAX_THREADS 8
+
+/**
+ * @brief Called by VerifyReferenceCounts for every count that drifted.
+ *
+ * @param table "Author", "Genre" or "Address".
+ * @param id The ID of the referenced record.
+ * @param recorded The maintained count.
+ * @param counted The recomputed count.
+ */
+typedef void (*ReferenceDriftVisitor)(const char* table, int id, int recorded, int counted, void* context);
+
+/**
+ * @brief Records that one more book is written by an author.
+ *
+ * @param id The ID of the author.
+ */
+void AcquireAuthor(int id) {
+    if (id >= 0 && id < authorsCapacity) {
+        authorRefs[id]++;
+    }
+}
+
+/**
+ * @brief Records that one book less is written by an author.
+ *
+ * @param id The ID of the author.
+ */
+void ReleaseAuthor(int id) {
+    if (id >= 0 && id < authorsCapacity && authorRefs[id] > 0) {
+        authorRefs[id]--;
+    }
+}
+
+/**
+ * @brief Records that one more book belongs to a genre.
+ *
+ * @param id The ID of the genre.
+ */
+void AcquireGenre(int id) {
+    if (id >= 0 && id < genresCapacity) {
+        genreRefs[id]++;
+    }
+}
+
+/**
+ * @brief Records that one book less belongs to a genre.
+ *
+ * @param id The ID of the genre.
+ */
+void ReleaseGenre(int id) {
+    if (id >= 0 && id < genresCapacity && genreRefs[id] > 0) {
+        genreRefs[id]--;
+    }
+}
+
+/**
+ * @brief Counts a book against its author and genre.
+ */
+void LinkBook(const Book* b) {
+    AcquireAuthor(b->authorId);
+    AcquireGenre(b->genreId);
+}
+
+/**
+ * @brief Stops counting a book against its author and genre.
+ */
+void UnlinkBook(const Book* b) {
+    ReleaseAuthor(b->authorId);
+    ReleaseGenre(b->genreId);
+}
+
+/**
+ * @brief Recomputes the author and genre reference counts from the books.
+ *
+ * Called once after the data files are imported. Address counts are rebuilt by RebuildAddressIndex.
+ */
+void RebuildReferenceCounts(void) {
+    memset(authorRefs, 0, authorsCapacity * sizeof(int));
+    memset(genreRefs, 0, genresCapacity * sizeof(int));
+    for (int i = 0; i < booksCapacity; i++) {
+        if (books[i].id != -1) {
+            LinkBook(&books[i]);
+        }
+    }
+}
+
+/**
+ * @struct ReferenceCountJob
+ * @brief A slice of the books and clients tables counted by one verification thread.
+ *
+ * Each job counts into its own arrays, so the threads never write to shared memory.
+ */
+typedef struct {
+    int firstBook;
+    int lastBook;
+    int firstClient;
+    int lastClient;
+    int* authorCounts;
+    int* genreCounts;
+    int* addressCounts;
+} ReferenceCountJob;
+
+/**
+ * @brief Counts the references held by the books and clients of one job.
+ */
+void* countReferences(void* arg) {
+    ReferenceCountJob* job = arg;
+    for (int i = job->firstBook; i < job->lastBook; i++) {
+        Book* b = &books[i];
+        if (b->id == -1) {
+            continue;
+        }
+        if (b->authorId >= 0 && b->authorId < authorsCapacity) {
+            job->authorCounts[b->authorId]++;
+        }
+        if (b->genreId >= 0 && b->genreId < genresCapacity) {
+            job->genreCounts[b->genreId]++;
+        }
+    }
+    for (int i = job->firstClient; i < job->lastClient; i++) {
+        int id = clients[i].addressId;
+        if (strcmp(clients[i].cpf, "0") && id >= 0 && id < addressesCapacity) {
+            job->addressCounts[id]++;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Compares one column of recorded reference counts with the recomputed ones.
+ *
+ * @return int The number of entries that differ.
+ */
+int compareReferenceCounts(const char* name, int* recorded, const int* counted, int capacity, int repair,
+                           ReferenceDriftVisitor report, void* context) {
+    int drift = 0;
+    for (int i = 0; i < capacity; i++) {
+        if (recorded[i] != counted[i]) {
+            if (report) {
+                report(name, i, recorded[i], counted[i], context);
+            }
+            if (repair) {
+                recorded[i] = counted[i];
+            }
+            drift++;
+        }
+    }
+    return drift;
+}
+
+/**
+ * @brief Recomputes every reference count in parallel and reports the ones that drifted to `report`.
+ *
+ * The books and clients tables are split into one slice per online CPU (at most
+ * VERIFY_MAX_THREADS). Each thread counts its slice into private arrays, which are
+ * summed once every thread has finished.
+ *
+ * @param repair If nonzero, the recorded counts are overwritten with the recomputed ones.
+ * @param report Called for every count that differs. May be NULL.
+ * @return int The number of counts that differ, or -1 if memory could not be allocated.
+ */
+int VerifyReferenceCounts(int repair, ReferenceDriftVisitor report, void* context) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = online < 1 ? 1 : online > VERIFY_MAX_THREADS ? VERIFY_MAX_THREADS : (int) online;
+    int columns = authorsCapacity + genresCapacity + addressesCapacity;
+    ReferenceCountJob jobs[VERIFY_MAX_THREADS];
+    pthread_t workers[VERIFY_MAX_THREADS];
+    int started[VERIFY_MAX_THREADS];
+
+    int* counts = calloc((size_t) threads * columns, sizeof(int));
+    if (!counts) {
+        return -1;
+    }
+    for (int t = 0; t < threads; t++) {
+        jobs[t].firstBook = (int) ((long) booksCapacity * t / threads);
+        jobs[t].lastBook = (int) ((long) booksCapacity * (t + 1) / threads);
+        jobs[t].firstClient = (int) ((long) clientsCapacity * t / threads);
+        jobs[t].lastClient = (int) ((long) clientsCapacity * (t + 1) / threads);
+        jobs[t].authorCounts = counts + (size_t) t * columns;
+        jobs[t].genreCounts = jobs[t].authorCounts + authorsCapacity;
+        jobs[t].addressCounts = jobs[t].genreCounts + genresCapacity;
+        started[t] = t > 0 && !pthread_create(&workers[t], NULL, countReferences, &jobs[t]);
+    }
+    countReferences(&jobs[0]);
+    for (int t = 1; t < threads; t++) {
+        if (started[t]) {
+            pthread_join(workers[t], NULL);
+        } else {
+            countReferences(&jobs[t]);
+        }
+    }
+    for (int t = 1; t < threads; t++) {
+        for (int i = 0; i < columns; i++) {
+            counts[i] += counts[(size_t) t * columns + i];
+        }
+    }
+
+    int drift = compareReferenceCounts("Author", authorRefs, jobs[0].authorCounts, authorsCapacity, repair,
+                                       report, context);
+    drift += compareReferenceCounts("Genre", genreRefs, jobs[0].genreCounts, genresCapacity, repair,
+                                    report, context);
+    drift += compareReferenceCounts("Address", addressRefs, jobs[0].addressCounts, addressesCapacity, repair,
+                                    report, context);
+    free(counts);
+    return drift;
+}
+
+#endif
@@ -2,32 +2,586 @@
 #define REPOSITORY_H
 
 #include "models.h"
+#include "arena.h"
+#include "string_heap.h"
+#include "slot_set.h"
+#include "row_log.h"
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h> 
 
-Client clients[MAX_ENTITIES];
-Book books[MAX_ENTITIES];
-Address addresses[MAX_ENTITIES];
-Genre genres[MAX_ENTITIES];
-Author authors[MAX_ENTITIES];
-Loan loans[MAX_ENTITIES];
+Client* clients;
+Book* books;
+Address* addresses;
+Genre* genres;
+Author* authors;
+Loan* loans;
 Admin adm[10];
 
+int clientsCapacity;
+int booksCapacity;
+int addressesCapacity;
+int genresCapacity;
+int authorsCapacity;
+int loansCapacity;
+
+Arena clientsArena;
+Arena booksArena;
+Arena addressesArena;
+Arena genresArena;
+Arena authorsArena;
+Arena loansArena;
+
+/**
+ * @brief Books of every loan, stored back to back.
+ *
+ * A loan owns the `itemCount` entries starting at its `itemOffset`. Items are only
+ * appended at `loanItemsUsed`; the ones of returned loans become garbage until
+ * CompactLoanItems slides the live ones down.
+ */
+LoanItem* loanItems;
+int loanItemsCapacity;
+int loanItemsUsed;
+int loanItemsLive;
+Arena loanItemsArena;
+
+/**
+ * @brief Number of clients living at each address, indexed like `addresses`.
+ */
+int* addressRefs;
+Arena addressRefsArena;
+
+/**
+ * @brief Number of books written by each author, indexed like `authors`.
+ */
+int* authorRefs;
+Arena authorRefsArena;
+
+/**
+ * @brief Number of books of each genre, indexed like `genres`.
+ */
+int* genreRefs;
+Arena genreRefsArena;
+
+/**
+ * @brief Resolved author and genre names of each book, indexed like `books`.
+ *
+ * Kept up to date by book_view.h so that listings read one row per book.
+ */
+BookView* bookViews;
+Arena bookViewsArena;
+
+/**
+ * @brief The physical copies of the books, by barcode, and the copies of each book, indexed
+ *        like `books`.
+ *
+ * Copies are only appended, at `copiesUsed`, so barcodes are never given twice.
+ */
+Copy* copies;
+int copiesCapacity;
+int copiesUsed;
+Arena copiesArena;
+CopyRun* copyRuns;
+Arena copyRunsArena;
+
+/**
+ * @brief One bit per copy for each CopyState, set for the copies in that state.
+ *
+ * The copies of a book share words with their neighbours, so the bits are only changed
+ * with atomic operations.
+ */
+_Atomic uint64_t* copyBits[COPY_STATES];
+Arena copyBitsArenas[COPY_STATES];
+
+/**
+ * @brief Occupied slots of the clients, books and loans tables, for the listings.
+ */
+SlotSet clientsLive;
+SlotSet booksLive;
+SlotSet loansLive;
+
+/**
+ * @brief Most library branches.
+ */
+#define BRANCH_MAX 16
+
+/**
+ * @brief The branch every record belongs to until placed in another, and the only one at first.
+ */
+#define BRANCH_MAIN 0
+
+/**
+ * @brief The branch of every slot of the clients, books and loans tables, indexed by RowTable.
+ *
+ * A client belongs to their home branch, a book to the branch holding its copies and a loan
+ * to the branch it was made at. Emptied slots keep their branch until they are taken again.
+ */
+int* rowBranches[ROW_LOAN_ITEMS];
+Arena rowBranchesArenas[ROW_LOAN_ITEMS];
+
+/**
+ * @brief The partitions of the branches: their occupied slots of every table, by RowTable.
+ *
+ * A scan of one branch walks its own partition, so it never reads another branch's rows.
+ */
+SlotSet branchRows[BRANCH_MAX][ROW_LOAN_ITEMS];
+int branchCount;
+
+/**
+ * @brief The branch the desk on the calling thread works at. New clients, books and loans go
+ *        to it, and books are looked up by title in it.
+ */
+_Thread_local int branchCurrent = BRANCH_MAIN;
+
+/**
+ * @brief Puts an occupied slot in the partition of its branch.
+ */
+void BranchSlotAdd(RowTable table, int slot) {
+    SlotSetAdd(&branchRows[rowBranches[table][slot]][table], slot);
+}
+
+/**
+ * @brief Takes an emptied slot out of the partition of its branch.
+ */
+void BranchSlotRemove(RowTable table, int slot) {
+    SlotSetRemove(&branchRows[rowBranches[table][slot]][table], slot);
+}
+
+/**
+ * @brief Gives a slot being taken to the branch of the calling thread.
+ */
+void branchTake(RowTable table, int slot) {
+    BranchSlotRemove(table, slot);
+    rowBranches[table][slot] = branchCurrent;
+    BranchSlotAdd(table, slot);
+}
+
+/**
+ * @brief Grows a branch column and the partitions of every branch with a table.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int branchResize(RowTable table, int capacity) {
+    if (!ArenaResizeColumn(&rowBranchesArenas[table], sizeof(int), capacity)) {
+        return 0;
+    }
+    for (int b = 0; b < branchCount; b++) {
+        if (!SlotSetResize(&branchRows[b][table], capacity)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Change counters of the clients, books, loans and authors tables.
+ *
+ * Bumped whenever a record is added, removed or edited, so that sorted views know when
+ * they must be sorted again. Atomic because edits under different row stripes may bump
+ * the same counter at once.
+ */
+_Atomic unsigned clientsVersion;
+_Atomic unsigned booksVersion;
+_Atomic unsigned loansVersion;
+_Atomic unsigned authorsVersion;
+
+/**
+ * @brief Marks a slot of the clients table as empty.
+ */
+void initEmptyClient(Client* c) {
+    SlotSetRemove(&clientsLive, (int) (c - clients));
+    BranchSlotRemove(ROW_CLIENTS, (int) (c - clients));
+    RowChanged(ROW_CLIENTS, (int) (c - clients));
+    clientsVersion++;
+    strcpy(c->cpf, "0\0");
+    c->name = STRING_EMPTY;
+    strcpy(c->deadline, "0\0");
+    c->addressId = -1;
+    c->fineAmount = 0;
+}
+
+/**
+ * @brief Marks a slot of the books table as empty.
+ */
+void initEmptyBook(Book* b) {
+    SlotSetRemove(&booksLive, (int) (b - books));
+    BranchSlotRemove(ROW_BOOKS, (int) (b - books));
+    RowChanged(ROW_BOOKS, (int) (b - books));
+    booksVersion++;
+    b->title = STRING_EMPTY;
+    b->authorId = -1;
+    b->genreId = -1;
+    b->id = -1;
+    b->amount = 0;
+    b->stock = 0;
+    copyRuns[b - books] = (CopyRun) {0, 0};
+}
+
+/**
+ * @brief Marks an address slot as empty.
+ */
+void initEmptyAddress(Address* add) {
+    add->street = STRING_EMPTY;
+    add->number = STRING_EMPTY;
+    add->cep = STRING_EMPTY;
+    add->complement = STRING_EMPTY;
+    add->id = -1;
+}
+
+/**
+ * @brief Marks a genre slot as empty.
+ */
+void initEmptyGenre(Genre* g) {
+    g->genre = STRING_EMPTY;
+    g->id = -1;
+}
+
+/**
+ * @brief Marks an author slot as empty.
+ */
+void initEmptyAuthor(Author* a) {
+    authorsVersion++;
+    a->id = -1;
+    a->name = STRING_EMPTY;
+}
+
+/**
+ * @brief Marks a slot of the loans table as empty.
+ */
+void initEmptyLoan(Loan* l) {
+    SlotSetRemove(&loansLive, (int) (l - loans));
+    BranchSlotRemove(ROW_LOANS, (int) (l - loans));
+    RowChanged(ROW_LOANS, (int) (l - loans));
+    loansVersion++;
+    l->id = -1;
+    l->itemOffset = 0;
+    l->itemCount = 0;
+    strcpy(l->userCpf, "0\0");
+    strcpy(l->startDate, "0\0");
+    strcpy(l->deadline, "0\0");
+}
+
+/**
+ * @brief Grows the clients table and marks the new slots as empty.
+ *
+ * @return int The index of the first new slot, or -1 if the table cannot grow.
+ */
+int growClients(void) {
+    int first = ArenaGrowTable(&clientsArena, sizeof(Client), &clientsCapacity, MAX_ENTITIES);
+    if (first != -1 && (!SlotSetResize(&clientsLive, clientsCapacity) || !branchResize(ROW_CLIENTS, clientsCapacity) ||
+                        !ArenaResizeColumn(&rowStampsArenas[ROW_CLIENTS], sizeof(unsigned), clientsCapacity))) {
+        clientsCapacity = first;
+        return -1;
+    }
+    for (int i = first; first != -1 && i < clientsCapacity; i++) {
+        initEmptyClient(&clients[i]);
+    }
+    return first;
+}
+
+/**
+ * @brief Grows the books table and marks the new slots as empty.
+ *
+ * @return int The index of the first new slot, or -1 if the table cannot grow.
+ */
+int growBooks(void) {
+    int first = ArenaGrowTable(&booksArena, sizeof(Book), &booksCapacity, MAX_ENTITIES);
+    if (first != -1 && (!SlotSetResize(&booksLive, booksCapacity) || !branchResize(ROW_BOOKS, booksCapacity) ||
+                        !ArenaResizeColumn(&bookViewsArena, sizeof(BookView), booksCapacity) ||
+                        !ArenaResizeColumn(&copyRunsArena, sizeof(CopyRun), booksCapacity) ||
+                        !ArenaResizeColumn(&rowStampsArenas[ROW_BOOKS], sizeof(unsigned), booksCapacity))) {
+        booksCapacity = first;
+        return -1;
+    }
+    for (int i = first; first != -1 && i < booksCapacity; i++) {
+        initEmptyBook(&books[i]);
+    }
+    return first;
+}
+
+/**
+ * @brief Grows the addresses table and marks the new slots as empty.
+ *
+ * @return int The index of the first new slot, or -1 if the table cannot grow.
+ */
+int growAddresses(void) {
+    int first = ArenaGrowTable(&addressesArena, sizeof(Address), &addressesCapacity, MAX_ENTITIES);
+    if (first != -1 && !ArenaResizeColumn(&addressRefsArena, sizeof(int), addressesCapacity)) {
+        addressesCapacity = first;
+        return -1;
+    }
+    for (int i = first; first != -1 && i < addressesCapacity; i++) {
+        initEmptyAddress(&addresses[i]);
+    }
+    return first;
+}
+
+/**
+ * @brief Grows the genres table and marks the new slots as empty.
+ *
+ * @return int The index of the first new slot, or -1 if the table cannot grow.
+ */
+int growGenres(void) {
+    int first = ArenaGrowTable(&genresArena, sizeof(Genre), &genresCapacity, MAX_ENTITIES);
+    if (first != -1 && !ArenaResizeColumn(&genreRefsArena, sizeof(int), genresCapacity)) {
+        genresCapacity = first;
+        return -1;
+    }
+    for (int i = first; first != -1 && i < genresCapacity; i++) {
+        initEmptyGenre(&genres[i]);
+    }
+    return first;
+}
+
+/**
+ * @brief Grows the authors table and marks the new slots as empty.
+ *
+ * @return int The index of the first new slot, or -1 if the table cannot grow.
+ */
+int growAuthors(void) {
+    int first = ArenaGrowTable(&authorsArena, sizeof(Author), &authorsCapacity, MAX_ENTITIES);
+    if (first != -1 && !ArenaResizeColumn(&authorRefsArena, sizeof(int), authorsCapacity)) {
+        authorsCapacity = first;
+        return -1;
+    }
+    for (int i = first; first != -1 && i < authorsCapacity; i++) {
+        initEmptyAuthor(&authors[i]);
+    }
+    return first;
+}
+
+/**
+ * @brief Grows the loans table and marks the new slots as empty.
+ *
+ * @return int The index of the first new slot, or -1 if the table cannot grow.
+ */
+int growLoans(void) {
+    int first = ArenaGrowTable(&loansArena, sizeof(Loan), &loansCapacity, MAX_ENTITIES);
+    if (first != -1 && (!SlotSetResize(&loansLive, loansCapacity) || !branchResize(ROW_LOANS, loansCapacity) ||
+                        !ArenaResizeColumn(&rowStampsArenas[ROW_LOANS], sizeof(unsigned), loansCapacity))) {
+        loansCapacity = first;
+        return -1;
+    }
+    for (int i = first; first != -1 && i < loansCapacity; i++) {
+        initEmptyLoan(&loans[i]);
+    }
+    return first;
+}
+
+/**
+ * @brief Orders loans by the position of their items.
+ */
+int compareLoanItemOffsets(const void* a, const void* b) {
+    return loans[*(const int*) a].itemOffset - loans[*(const int*) b].itemOffset;
+}
+
+/**
+ * @brief Slides the items of every open loan down over the garbage left by returned loans.
+ *
+ * Loans are visited in the order of their items, so each block only ever moves towards
+ * the start of the array and the relative order of the items is kept.
+ */
+void CompactLoanItems(void) {
+    int* order = malloc(loansCapacity * sizeof(int));
+    int n = 0;
+    if (!order) {
+        return;
+    }
+    for (int i = 0; i < loansCapacity; i++) {
+        if (loans[i].id != -1 && loans[i].itemCount > 0) {
+            order[n++] = i;
+        }
+    }
+    qsort(order, n, sizeof(int), compareLoanItemOffsets);
+    int used = 0;
+    for (int k = 0; k < n; k++) {
+        Loan* l = &loans[order[k]];
+        memmove(&loanItems[used], &loanItems[l->itemOffset], l->itemCount * sizeof(LoanItem));
+        l->itemOffset = used;
+        used += l->itemCount;
+    }
+    free(order);
+    loanItemsUsed = used;
+    loanItemsLive = used;
+    TableChanged(ROW_LOANS);
+    TableChanged(ROW_LOAN_ITEMS);
+}
+
+/**
+ * @brief Appends a book to a loan.
+ *
+ * The loan's items are kept contiguous: if other items were appended after them, they are
+ * first moved to the end of the array. `l` may not be in the loans table yet, as when
+ * a data file is read, so the caller calls RowChanged for it.
+ *
+ * @param l The loan.
+ * @param bookId The ID of the borrowed book.
+ * @param copyId The barcode of the copy lent, or -1 if it is not known yet.
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int AddLoanItem(Loan* l, int bookId, int copyId) {
+    int atEnd = l->itemCount == 0 || l->itemOffset + l->itemCount == loanItemsUsed;
+    int needed = loanItemsUsed + (atEnd ? 1 : l->itemCount + 1);
+    while (needed > loanItemsCapacity) {
+        if (ArenaGrowTable(&loanItemsArena, sizeof(LoanItem), &loanItemsCapacity, MAX_ENTITIES * 2) == -1) {
+            return 0;
+        }
+    }
+    if (l->itemCount == 0) {
+        l->itemOffset = loanItemsUsed;
+    } else if (!atEnd) {
+        memcpy(&loanItems[loanItemsUsed], &loanItems[l->itemOffset], l->itemCount * sizeof(LoanItem));
+        for (int k = 0; k < l->itemCount; k++) {
+            RowChanged(ROW_LOAN_ITEMS, loanItemsUsed + k);
+        }
+        l->itemOffset = loanItemsUsed;
+        loanItemsUsed += l->itemCount;
+    }
+    RowChanged(ROW_LOAN_ITEMS, loanItemsUsed);
+    loanItems[loanItemsUsed++] = (LoanItem) {bookId, copyId};
+    l->itemCount++;
+    loanItemsLive++;
+    return 1;
+}
+
+/**
+ * @brief Releases the items of a loan.
+ *
+ * Items at the end of the array are reclaimed at once; the others are reclaimed by
+ * CompactSparseLoanItems once garbage makes up more than half of the array.
+ *
+ * @param l The loan.
+ */
+void FreeLoanItems(Loan* l) {
+    if (l->itemOffset + l->itemCount == loanItemsUsed) {
+        loanItemsUsed = l->itemOffset;
+    }
+    loanItemsLive -= l->itemCount;
+    l->itemOffset = 0;
+    l->itemCount = 0;
+    RowChanged(ROW_LOANS, (int) (l - loans));
+}
+
+/**
+ * @brief Runs CompactLoanItems once garbage makes up more than half of the loan items.
+ */
+void CompactSparseLoanItems(void) {
+    if (loanItemsUsed > MAX_ENTITIES && loanItemsUsed > loanItemsLive * 2) {
+        CompactLoanItems();
+    }
+}
+
+/**
+ * @brief Reserves one arena per table and points the tables at them.
+ *
+ * The tables start empty; ImportData grows them while reading the data files.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int InitRepository(void) {
+    if (!ArenaInit(&clientsArena, "clients") || !ArenaInit(&booksArena, "books") ||
+        !ArenaInit(&addressesArena, "addresses") || !ArenaInit(&genresArena, "genres") ||
+        !ArenaInit(&authorsArena, "authors") || !ArenaInit(&loansArena, "loans") ||
+        !ArenaInit(&addressRefsArena, "address refs") || !ArenaInit(&authorRefsArena, "author refs") ||
+        !ArenaInit(&genreRefsArena, "genre refs") || !ArenaInit(&loanItemsArena, "loan items") ||
+        !SlotSetInit(&clientsLive, "live clients") || !SlotSetInit(&booksLive, "live books") ||
+        !SlotSetInit(&loansLive, "live loans") || !ArenaInit(&bookViewsArena, "book views") ||
+        !ArenaInit(&rowStampsArenas[ROW_CLIENTS], "client stamps") ||
+        !ArenaInit(&rowStampsArenas[ROW_BOOKS], "book stamps") ||
+        !ArenaInit(&rowStampsArenas[ROW_LOANS], "loan stamps") ||
+        !ArenaInit(&rowBranchesArenas[ROW_CLIENTS], "client branches") ||
+        !ArenaInit(&rowBranchesArenas[ROW_BOOKS], "book branches") ||
+        !ArenaInit(&rowBranchesArenas[ROW_LOANS], "loan branches") ||
+        !SlotSetInit(&branchRows[BRANCH_MAIN][ROW_CLIENTS], "main branch clients") ||
+        !SlotSetInit(&branchRows[BRANCH_MAIN][ROW_BOOKS], "main branch books") ||
+        !SlotSetInit(&branchRows[BRANCH_MAIN][ROW_LOANS], "main branch loans") ||
+        !ArenaInit(&copiesArena, "copies") || !ArenaInit(&copyRunsArena, "copy runs") ||
+        !ArenaInit(&copyBitsArenas[COPY_ON_SHELF], "copies on shelf") ||
+        !ArenaInit(&copyBitsArenas[COPY_LENT], "copies lent") ||
+        !ArenaInit(&copyBitsArenas[COPY_HELD], "copies held") ||
+        !ArenaInit(&copyBitsArenas[COPY_DAMAGED], "copies damaged")) {
+        return 0;
+    }
+    branchCount = 1;
+    clients = (Client*) clientsArena.base;
+    books = (Book*) booksArena.base;
+    addresses = (Address*) addressesArena.base;
+    genres = (Genre*) genresArena.base;
+    authors = (Author*) authorsArena.base;
+    loans = (Loan*) loansArena.base;
+    loanItems = (LoanItem*) loanItemsArena.base;
+    addressRefs = (int*) addressRefsArena.base;
+    authorRefs = (int*) authorRefsArena.base;
+    genreRefs = (int*) genreRefsArena.base;
+    bookViews = (BookView*) bookViewsArena.base;
+    copies = (Copy*) copiesArena.base;
+    copyRuns = (CopyRun*) copyRunsArena.base;
+    for (int s = 0; s < COPY_STATES; s++) {
+        copyBits[s] = (_Atomic uint64_t*) copyBitsArenas[s].base;
+    }
+    for (int t = 0; t < ROW_LOAN_ITEMS; t++) {
+        rowStamps[t] = (_Atomic unsigned*) rowStampsArenas[t].base;
+        rowBranches[t] = (int*) rowBranchesArenas[t].base;
+    }
+    return 1;
+}
+
+/**
+ * @brief Recomputes the occupied slots of the clients, books and loans tables, and the
+ *        partitions of the branches from the branch of every slot.
+ *
+ * Called once after the data files are imported.
+ */
+void RebuildLiveSlots(void) {
+    SlotSetClear(&clientsLive, clientsCapacity);
+    SlotSetClear(&booksLive, booksCapacity);
+    SlotSetClear(&loansLive, loansCapacity);
+    for (int b = 0; b < branchCount; b++) {
+        SlotSetClear(&branchRows[b][ROW_CLIENTS], clientsCapacity);
+        SlotSetClear(&branchRows[b][ROW_BOOKS], booksCapacity);
+        SlotSetClear(&branchRows[b][ROW_LOANS], loansCapacity);
+    }
+    for (int i = 0; i < clientsCapacity; i++) {
+        if (strcmp(clients[i].cpf, "0")) {
+            SlotSetAdd(&clientsLive, i);
+            BranchSlotAdd(ROW_CLIENTS, i);
+        }
+    }
+    for (int i = 0; i < booksCapacity; i++) {
+        if (books[i].id != -1) {
+            SlotSetAdd(&booksLive, i);
+            BranchSlotAdd(ROW_BOOKS, i);
+        }
+    }
+    for (int i = 0; i < loansCapacity; i++) {
+        if (loans[i].id != -1) {
+            SlotSetAdd(&loansLive, i);
+            BranchSlotAdd(ROW_LOANS, i);
+        }
+    }
+    clientsVersion++;
+    booksVersion++;
+    loansVersion++;
+    authorsVersion++;
+}
 
 /**
  * @brief Retrieves the first empty user from the clients array.
  *
  * This function iterates through the clients array and returns a pointer
- * to the first Client structure where the cpf field is equal to "0".
+ * to the first Client structure where the cpf field is equal to "0". If every
+ * slot is taken, the clients table grows.
  *
  * @return Client* Pointer to the first empty Client structure, or NULL if no empty user is found.
  */
 Client* getEmptyUser(){
-    for(int i = 0 ; i < MAX_ENTITIES ; i++){
+    for(int i = 0 ; i < clientsCapacity ; i++){
         if(!strcmp(clients[i].cpf, "0")){
             return &clients[i];
         }
     }
-    return NULL;
+    int i = growClients();
+    return i == -1 ? NULL : &clients[i];
 }
 
 /**
@@ -35,18 +589,31 @@ Client* getEmptyUser(){
  *
  * This function iterates through the books array to find a book with an id of -1,
  * indicating that it is empty. Once found, it assigns the current index as the id
- * and returns a pointer to the empty book.
+ * and returns a pointer to the empty book. If every slot is taken, the table grows first.
  *
  * @return Book* Pointer to the empty book if found, otherwise NULL.
  */
 Book* getEmptyBook(){
-    for(int i = 0 ; i < MAX_ENTITIES ; i++){
+    for(int i = 0 ; i < booksCapacity ; i++){
         if(books[i].id == -1){
             books[i].id = i;
+            SlotSetAdd(&booksLive, i);
+            branchTake(ROW_BOOKS, i);
+            RowChanged(ROW_BOOKS, i);
+            booksVersion++;
             return &books[i];
         }
     }
-    return NULL;
+    int i = growBooks();
+    if(i == -1){
+        return NULL;
+    }
+    books[i].id = i;
+    SlotSetAdd(&booksLive, i);
+    branchTake(ROW_BOOKS, i);
+    RowChanged(ROW_BOOKS, i);
+    booksVersion++;
+    return &books[i];
 }
 
 /**
@@ -55,18 +622,23 @@ Book* getEmptyBook(){
  * This function iterates through the addresses array to find an address
  * with an id of -1, indicating that it is empty. Once found, it assigns
  * the index value to the id field of the address and returns a pointer
- * to the address.
+ * to the address. If every slot is taken, the table grows first.
  *
  * @return Address* Pointer to the empty address if found, otherwise NULL.
  */
 Address* getEmptyAddress(){
-    for(int i = 0 ; i < MAX_ENTITIES ; i++){
+    for(int i = 0 ; i < addressesCapacity ; i++){
         if(addresses[i].id == -1){
             addresses[i].id = i;
             return &addresses[i];
         }
     }
-    return NULL;
+    int i = growAddresses();
+    if(i == -1){
+        return NULL;
+    }
+    addresses[i].id = i;
+    return &addresses[i];
 }
 
 /**
@@ -74,18 +646,23 @@ Address* getEmptyAddress(){
  *
  * This function iterates through the genres array to find an element with an id of -1,
  * indicating that it is empty. Once found, it assigns the current index as the id and
- * returns a pointer to the empty Genre object.
+ * returns a pointer to the empty Genre object. If every slot is taken, the table grows first.
  *
  * @return Genre* Pointer to the empty Genre object if found, otherwise NULL.
  */
 Genre* getEmptyGenre(){
-    for(int i = 0 ; i < MAX_ENTITIES ; i++){
+    for(int i = 0 ; i < genresCapacity ; i++){
         if(genres[i].id == -1){
             genres[i].id = i;
             return &genres[i];
         }
     }
-    return NULL;
+    int i = growGenres();
+    if(i == -1){
+        return NULL;
+    }
+    genres[i].id = i;
+    return &genres[i];
 }
 
 
@@ -94,18 +671,25 @@ Genre* getEmptyGenre(){
  *
  * This function iterates through the authors array to find an Author object
  * with an id of -1, indicating that it is empty. Once found, it assigns the
- * current index as the id of the Author and returns a pointer to it.
+ * current index as the id of the Author and returns a pointer to it. If every slot is taken, the table grows first.
  *
  * @return A pointer to an empty Author object if found, otherwise NULL.
  */
 Author* getEmptyAuthor(){
-    for(int i = 0 ; i < MAX_ENTITIES ; i++){
+    for(int i = 0 ; i < authorsCapacity ; i++){
         if(authors[i].id == -1){
             authors[i].id = i;
+            authorsVersion++;
             return &authors[i];
         }
     }
-    return NULL;
+    int i = growAuthors();
+    if(i == -1){
+        return NULL;
+    }
+    authors[i].id = i;
+    authorsVersion++;
+    return &authors[i];
 }
 
 /**
@@ -113,37 +697,48 @@ Author* getEmptyAuthor(){
  *
  * This function iterates through the array of loans and returns a pointer to the first loan
  * that has an id of -1, indicating it is empty. It also assigns the index value to the id of
- * the loan to mark it as occupied.
+ * the loan to mark it as occupied. If every slot is taken, the table grows first.
  *
  * @return Loan* Pointer to the empty loan if found, otherwise NULL.
  */
 Loan* getEmptyLoan(){
-    for(int i = 0 ; i < MAX_ENTITIES ; i++){
+    for(int i = 0 ; i < loansCapacity ; i++){
         if(loans[i].id == -1){
             loans[i].id = i;
+            SlotSetAdd(&loansLive, i);
+            branchTake(ROW_LOANS, i);
+            RowChanged(ROW_LOANS, i);
+            loansVersion++;
             return &loans[i];
         }
     }
-    return NULL;
+    int i = growLoans();
+    if(i == -1){
+        return NULL;
+    }
+    loans[i].id = i;
+    SlotSetAdd(&loansLive, i);
+    branchTake(ROW_LOANS, i);
+    RowChanged(ROW_LOANS, i);
+    loansVersion++;
+    return &loans[i];
 }
 
 /**
  * @brief Searches for an Address by its ID.
  *
- * This function iterates through a list of addresses and returns a pointer
- * to the Address structure that matches the given ID. If no matching address
- * is found, the function returns NULL.
+ * IDs are the slot indexes assigned by getEmptyAddress, so the address is read
+ * straight from its slot. If the slot is empty or out of range, the function
+ * returns NULL.
  *
  * @param id The ID of the address to search for.
  * @return Address* Pointer to the Address structure if found, otherwise NULL.
  */
 Address* SearchAddressById(int id) {
-    for(int i = 0; i < MAX_ENTITIES; i++){
-        if (addresses[i].id == id) {
-            return &addresses[i];
-        }
+    if (id < 0 || id >= addressesCapacity || addresses[id].id != id) {
+        return NULL;
     }
-    return NULL;
+    return &addresses[id];
 }
 
 /**
@@ -156,8 +751,8 @@ Address* SearchAddressById(int id) {
  * @param cpf A string representing the CPF of the client to search for.
  * @return A pointer to the Client structure if a match is found, otherwise NULL.
  */
-Client* SearchClientByCPF(char* cpf) {
-    for(int i = 0; i < MAX_ENTITIES; i++){
+Client* SearchClientByCPF(const char* cpf) {
+    for(int i = 0; i < clientsCapacity; i++){
         if (!strcmp(clients[i].cpf, cpf)) {
             return &clients[i];
         }
@@ -168,16 +763,17 @@ Client* SearchClientByCPF(char* cpf) {
 /**
  * @brief Searches for a client by name.
  *
- * This function iterates through the list of clients and compares each client's name
- * with the provided name. If a match is found, a pointer to the corresponding client
- * is returned.
+ * This function looks the name up in the string heap and then compares the interned
+ * identifier with each registered client's name. If a match is found, a pointer to the
+ * corresponding client is returned.
  *
  * @param name The name of the client to search for.
  * @return A pointer to the client if found, otherwise NULL.
  */
-Client* SearchClientByName(char* name) {
-    for(int i = 0; i < MAX_ENTITIES; i++){
-        if (!strcmp(clients[i].name, name)) {
+Client* SearchClientByName(const char* name) {
+    StringId id = StringFind(name);
+    for(int i = 0; id != STRING_NONE && i < clientsCapacity; i++){
+        if (clients[i].name == id && strcmp(clients[i].cpf, "0")) {
             return &clients[i];
         }
     }
@@ -187,20 +783,18 @@ Client* SearchClientByName(char* name) {
 /**
  * @brief Searches for a loan by its ID.
  *
- * This function iterates through the list of loans and returns a pointer to the loan
- * that matches the given ID. If no loan with the specified ID is found, the function
+ * IDs are the slot indexes assigned by getEmptyLoan, so the loan is read
+ * straight from its slot. If the slot is empty or out of range, the function
  * returns NULL.
  *
  * @param id The ID of the loan to search for.
  * @return A pointer to the loan with the specified ID, or NULL if no such loan is found.
  */
 Loan* SearchLoanById(int id) {
-    for(int i = 0; i < MAX_ENTITIES; i++){
-        if (loans[i].id == id) {
-            return &loans[i];
-        }
+    if (id < 0 || id >= loansCapacity || loans[id].id != id) {
+        return NULL;
     }
-    return NULL;
+    return &loans[id];
 }
 
 /**
@@ -214,8 +808,8 @@ Loan* SearchLoanById(int id) {
  * @return A pointer to the Loan structure if a matching loan is found, 
  *         otherwise NULL.
  */
-Loan* SearchLoanByClient(char* clientId) {
-    for(int i = 0; i < MAX_ENTITIES; i++){
+Loan* SearchLoanByClient(const char* clientId) {
+    for(int i = 0; i < loansCapacity; i++){
         if (!strcmp(loans[i].userCpf, clientId) && loans[i].id != -1) {
             return &loans[i];
         }
@@ -223,57 +817,78 @@ Loan* SearchLoanByClient(char* clientId) {
     return NULL;
 }
 
+/**
+ * @brief Checks if a book is currently on loan.
+ *
+ * This function iterates through the items of every open loan (id is not -1) and checks
+ * if any of them is the given book. If a match is found, the function returns 1 indicating
+ * that the book is on loan. Otherwise, it returns 0.
+ *
+ * @param bookId The ID of the book to check.
+ * @return int Returns 1 if the book is on loan, otherwise returns 0.
+ */
+int IsBookOnLoan(int bookId) {
+    for (int i = 0; i < loansCapacity; i++) {
+        if (loans[i].id == -1) {
+            continue;
+        }
+        for (int k = 0; k < loans[i].itemCount; k++) {
+            if (loanItems[loans[i].itemOffset + k].bookId == bookId) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
 /**
  * @brief Searches for a genre by its ID.
  *
- * This function iterates through an array of genres and returns a pointer to the genre
- * that matches the given ID. If no genre with the specified ID is found, the function
+ * IDs are the slot indexes assigned by getEmptyGenre, so the genre is read
+ * straight from its slot. If the slot is empty or out of range, the function
  * returns NULL.
  *
  * @param id The ID of the genre to search for.
  * @return A pointer to the genre with the specified ID, or NULL if no such genre is found.
  */
 Genre* SearchGenreById(int id) {
-    for(int i = 0; i < MAX_ENTITIES; i++){
-        if (genres[i].id == id) {
-            return &genres[i];
-        }
+    if (id < 0 || id >= genresCapacity || genres[id].id != id) {
+        return NULL;
     }
-    return NULL;
+    return &genres[id];
 }
 
 /**
  * @brief Searches for an author by their ID.
  *
- * This function iterates through a list of authors and returns a pointer
- * to the author with the specified ID. If no author with the given ID is found,
- * the function returns NULL.
+ * IDs are the slot indexes assigned by getEmptyAuthor, so the author is read
+ * straight from its slot. If the slot is empty or out of range, the function
+ * returns NULL.
  *
  * @param id The ID of the author to search for.
  * @return A pointer to the Author with the specified ID, or NULL if no such author is found.
  */
 Author* SearchAuthorById(int id) {
-    for(int i = 0; i < MAX_ENTITIES; i++) {
-        if (authors[i].id == id) {
-            return &authors[i];
-        }
+    if (id < 0 || id >= authorsCapacity || authors[id].id != id) {
+        return NULL;
     }
-    return NULL;
+    return &authors[id];
 }
 
 /**
  * @brief Searches for an author by name.
  *
- * This function iterates through a list of authors and compares each author's name
- * with the provided name. If a match is found, a pointer to the corresponding Author
+ * This function looks the name up in the string heap and then compares the interned
+ * identifier with each registered author's name. If a match is found, a pointer to the corresponding Author
  * structure is returned. If no match is found, NULL is returned.
  *
  * @param name The name of the author to search for.
  * @return A pointer to the Author structure if a match is found, otherwise NULL.
  */
-Author* SearchAuthorByName(char* name) {
-    for(int i = 0; i < MAX_ENTITIES; i++) {
-        if (!strcmp(authors[i].name, name)) {
+Author* SearchAuthorByName(const char* name) {
+    StringId id = StringFind(name);
+    for(int i = 0; id != STRING_NONE && i < authorsCapacity; i++) {
+        if (authors[i].name == id && authors[i].id != -1) {
             return &authors[i];
         }
     }
@@ -283,35 +898,36 @@ Author* SearchAuthorByName(char* name) {
 /**
  * @brief Searches for a book by its ID.
  *
- * This function iterates through the list of books and returns a pointer to the book
- * that matches the given ID. If no book with the specified ID is found, the function
+ * IDs are the slot indexes assigned by getEmptyBook, so the book is read
+ * straight from its slot. If the slot is empty or out of range, the function
  * returns NULL.
  *
  * @param id The ID of the book to search for.
  * @return A pointer to the book with the specified ID, or NULL if no such book is found.
  */
 Book* SearchBookById(int id) {
-    for(int i = 0; i < MAX_ENTITIES; i++) {
-        if (books[i].id == id) {
-            return &books[i];
-        }
+    if (id < 0 || id >= booksCapacity || books[id].id != id) {
+        return NULL;
     }
-    return NULL;
+    return &books[id];
 }
 
 /**
- * @brief Searches for a book by its title.
+ * @brief Searches for a book by its title at the branch of the calling thread.
  *
- * This function iterates through the list of books and compares each book's title
- * with the provided title. If a match is found, it returns a pointer to the book.
- * If no match is found, it returns NULL.
+ * This function looks the title up in the string heap and then compares the interned
+ * identifier with the title of each book in the partition of the branch. If a match is found,
+ * it returns a pointer to the book. If no match is found, it returns NULL. Other branches may
+ * hold books with the same title.
  *
  * @param title The title of the book to search for.
  * @return A pointer to the book if found, otherwise NULL.
  */
-Book* SearchBookByTitle(char* title) {
-    for(int i = 0; i < MAX_ENTITIES; i++) {
-        if (!strcmp(books[i].title, title)) {
+Book* SearchBookByTitle(const char* title) {
+    StringId id = StringFind(title);
+    const SlotSet* partition = &branchRows[branchCurrent][ROW_BOOKS];
+    for(int i = SlotSetNext(partition, 0, booksCapacity); id != STRING_NONE && i != -1; i = SlotSetNext(partition, i + 1, booksCapacity)) {
+        if (books[i].title == id && books[i].id != -1) {
             return &books[i];
         }
     }
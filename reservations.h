@@ -0,0 +1,264 @@
+#ifndef RESERVATIONS_H
+#define RESERVATIONS_H
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "models.h"
+#include "repository.h"
+
+/**
+ * @file reservations.h
+ * @brief First-come first-served waiting lists of the books.
+ *
+ * Reservations live in a pool of nodes, and every book has an intrusive singly linked
+ * queue through them. The queue starts with the reservations holding a returned copy,
+ * followed by the ones still waiting; `waiting` points at the first of those, so the
+ * next client in line is promoted in constant time. Freed nodes are chained on a free
+ * list and reused.
+ *
+ * The queues are guarded by the loans table lock: LOCK_LOANS exclusively to change them,
+ * shared to read them.
+ */
+
+/**
+ * @struct ReservationNode
+ * @brief A reservation in the pool, linked to the next one of its book.
+ *
+ * A free node has a `bookId` of -1 and links to the next free node.
+ */
+typedef struct {
+    Reservation reservation;
+    int next;
+} ReservationNode;
+
+/**
+ * @struct ReservationQueue
+ * @brief The reservations of a book: the oldest, the first still waiting and the newest.
+ */
+typedef struct {
+    int head;
+    int waiting;
+    int tail;
+} ReservationQueue;
+
+/**
+ * @brief Called once per reservation by ReservationForEach.
+ */
+typedef void (*ReservationVisitor)(const Reservation* r, void* context);
+
+ReservationNode* reservationPool;
+int reservationCapacity;
+int reservationFree = -1;
+ReservationQueue* reservationQueues;
+int reservationQueuesCapacity;
+
+/**
+ * @brief The queue of a book, made room for if `grow` is set.
+ *
+ * @return ReservationQueue* The queue, or NULL if the book has none and none could be made.
+ */
+ReservationQueue* reservationQueueOf(int bookId, int grow) {
+    if (bookId < 0) {
+        return NULL;
+    }
+    if (bookId >= reservationQueuesCapacity) {
+        if (!grow) {
+            return NULL;
+        }
+        int capacity = reservationQueuesCapacity ? reservationQueuesCapacity : MAX_ENTITIES;
+        while (capacity <= bookId) {
+            capacity *= 2;
+        }
+        ReservationQueue* grown = realloc(reservationQueues, capacity * sizeof(ReservationQueue));
+        if (!grown) {
+            return NULL;
+        }
+        for (int i = reservationQueuesCapacity; i < capacity; i++) {
+            grown[i] = (ReservationQueue) {-1, -1, -1};
+        }
+        reservationQueues = grown;
+        reservationQueuesCapacity = capacity;
+    }
+    return &reservationQueues[bookId];
+}
+
+/**
+ * @brief Takes a node off the free list, growing the pool if it is empty.
+ *
+ * @return int The node, or -1 if the pool cannot grow.
+ */
+int reservationAlloc(void) {
+    if (reservationFree == -1) {
+        int capacity = reservationCapacity ? reservationCapacity * 2 : MAX_ENTITIES;
+        ReservationNode* grown = realloc(reservationPool, capacity * sizeof(ReservationNode));
+        if (!grown) {
+            return -1;
+        }
+        for (int i = capacity - 1; i >= reservationCapacity; i--) {
+            grown[i].reservation.bookId = -1;
+            grown[i].next = reservationFree;
+            reservationFree = i;
+        }
+        reservationPool = grown;
+        reservationCapacity = capacity;
+    }
+    int node = reservationFree;
+    reservationFree = reservationPool[node].next;
+    return node;
+}
+
+/**
+ * @brief Puts a reservation at the end of its book's queue.
+ *
+ * A held reservation must be enqueued before the waiting ones of its book.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int ReservationEnqueue(int clientId, int bookId, int held) {
+    ReservationQueue* q = reservationQueueOf(bookId, 1);
+    int node = q ? reservationAlloc() : -1;
+    if (node == -1) {
+        return 0;
+    }
+    reservationPool[node].reservation = (Reservation) {clientId, bookId, held};
+    reservationPool[node].next = -1;
+    if (q->tail == -1) {
+        q->head = node;
+    } else {
+        reservationPool[q->tail].next = node;
+    }
+    q->tail = node;
+    if (!held && q->waiting == -1) {
+        q->waiting = node;
+    }
+    return 1;
+}
+
+/**
+ * @brief Keeps a returned copy of a book for the first client waiting for it.
+ *
+ * @return int The ID of that client, or -1 if nobody is waiting.
+ */
+int ReservationPromote(int bookId) {
+    ReservationQueue* q = reservationQueueOf(bookId, 0);
+    if (!q || q->waiting == -1) {
+        return -1;
+    }
+    ReservationNode* n = &reservationPool[q->waiting];
+    n->reservation.held = 1;
+    q->waiting = n->next;
+    return n->reservation.clientId;
+}
+
+/**
+ * @brief Takes a reservation of a client off its book's queue.
+ *
+ * @param heldOnly 1 to only take a reservation holding a copy, found among the first of the queue.
+ * @param held Set to 1 if the reservation was holding a copy, otherwise 0. May be NULL.
+ * @return int Returns 1 if the reservation was found, otherwise returns 0.
+ */
+int ReservationRemove(int clientId, int bookId, int heldOnly, int* held) {
+    ReservationQueue* q = reservationQueueOf(bookId, 0);
+    int prev = -1;
+    for (int node = q ? q->head : -1; node != -1 && !(heldOnly && node == q->waiting); node = reservationPool[node].next) {
+        ReservationNode* n = &reservationPool[node];
+        if (n->reservation.clientId != clientId) {
+            prev = node;
+            continue;
+        }
+        if (prev == -1) {
+            q->head = n->next;
+        } else {
+            reservationPool[prev].next = n->next;
+        }
+        if (q->waiting == node) {
+            q->waiting = n->next;
+        }
+        if (q->tail == node) {
+            q->tail = prev;
+        }
+        if (held) {
+            *held = n->reservation.held;
+        }
+        n->reservation.bookId = -1;
+        n->next = reservationFree;
+        reservationFree = node;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Finds the place of a client in a book's queue.
+ *
+ * @return int The number of reservations before the client's, or -1 if the client has none.
+ */
+int ReservationPosition(int clientId, int bookId) {
+    ReservationQueue* q = reservationQueueOf(bookId, 0);
+    int position = 0;
+    for (int node = q ? q->head : -1; node != -1; node = reservationPool[node].next, position++) {
+        if (reservationPool[node].reservation.clientId == clientId) {
+            return position;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Tells whether a book has reservations, held or waiting.
+ */
+int BookHasReservations(int bookId) {
+    ReservationQueue* q = reservationQueueOf(bookId, 0);
+    return q && q->head != -1;
+}
+
+/**
+ * @brief Tells whether a client has reservations, held or waiting.
+ */
+int ClientHasReservations(int clientId) {
+    for (int i = 0; i < reservationCapacity; i++) {
+        if (reservationPool[i].reservation.bookId != -1 && reservationPool[i].reservation.clientId == clientId) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Calls `visit` for every reservation of a book, oldest first.
+ */
+void ReservationForEach(int bookId, ReservationVisitor visit, void* context) {
+    ReservationQueue* q = reservationQueueOf(bookId, 0);
+    for (int node = q ? q->head : -1; node != -1; node = reservationPool[node].next) {
+        visit(&reservationPool[node].reservation, context);
+    }
+}
+
+/**
+ * @brief Reads the reservations written by SaveReservations, queueing them again in order.
+ *
+ * @param f The file to read from, past its magic number.
+ */
+void LoadReservations(FILE* f) {
+    Reservation r;
+    while (fread(&r, sizeof(Reservation), 1, f) == 1) {
+        if (!ReservationEnqueue(r.clientId, r.bookId, r.held)) {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Writes every reservation, book by book and oldest first.
+ *
+ * @param f The file to write to, past its magic number.
+ */
+void SaveReservations(FILE* f) {
+    for (int b = 0; b < reservationQueuesCapacity; b++) {
+        for (int node = reservationQueues[b].head; node != -1; node = reservationPool[node].next) {
+            fwrite(&reservationPool[node].reservation, sizeof(Reservation), 1, f);
+        }
+    }
+}
+
+#endif
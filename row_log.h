@@ -0,0 +1,124 @@
+#ifndef ROW_LOG_H
+#define ROW_LOG_H
+#include <stdlib.h>
+
+#include "arena.h"
+
+/**
+ * @file row_log.h
+ * @brief The rows changed by the command running on each thread.
+ *
+ * The services record here every row of the clients, books, loans and loan items tables
+ * they write. snapshot.h copies those rows into a new version of the tables when the
+ * command commits, while its locks still cover them. Every row of the clients, books and
+ * loans tables logged with RowChanged also gets its stamp bumped, which transaction.h
+ * validates.
+ */
+
+/**
+ * @brief The tables whose rows are logged.
+ */
+typedef enum {
+    ROW_CLIENTS,
+    ROW_BOOKS,
+    ROW_LOANS,
+    ROW_LOAN_ITEMS,
+    ROW_TABLES
+} RowTable;
+
+/**
+ * @brief The bit of a table in RowLog::whole.
+ */
+#define ROW_BIT(table) (1u << (table))
+
+/**
+ * @struct RowChange
+ * @brief A changed row.
+ *
+ * A nonzero `stockDelta` marks a book whose stock alone was changed by that many copies,
+ * while other desks may be changing it too.
+ */
+typedef struct {
+    RowTable table;
+    int slot;
+    int stockDelta;
+} RowChange;
+
+/**
+ * @struct RowLog
+ * @brief The rows changed by a thread since its last commit.
+ *
+ * `whole` marks the tables rewritten as a whole, such as the loan items by
+ * CompactLoanItems, or every table when a change could not be logged.
+ */
+typedef struct {
+    RowChange* changes;
+    int count;
+    int capacity;
+    unsigned whole;
+} RowLog;
+
+_Thread_local RowLog rowLog;
+
+/**
+ * @brief Change stamps of the rows of the clients, books and loans tables.
+ *
+ * A stamp is bumped after each write of its row. The columns are sized by the grow
+ * functions of repository.h, before the new rows are first written.
+ */
+_Atomic unsigned* rowStamps[ROW_LOAN_ITEMS];
+Arena rowStampsArenas[ROW_LOAN_ITEMS];
+
+/**
+ * @brief Appends a change to the log.
+ */
+void rowLogAdd(RowTable table, int slot, int stockDelta) {
+    if (rowLog.count == rowLog.capacity) {
+        int capacity = rowLog.capacity ? rowLog.capacity * 2 : 64;
+        RowChange* grown = realloc(rowLog.changes, capacity * sizeof(RowChange));
+        if (!grown) {
+            rowLog.whole = ROW_BIT(ROW_TABLES) - 1;
+            return;
+        }
+        rowLog.changes = grown;
+        rowLog.capacity = capacity;
+    }
+    rowLog.changes[rowLog.count++] = (RowChange) {table, slot, stockDelta};
+}
+
+/**
+ * @brief Records that a row was written.
+ */
+void RowChanged(RowTable table, int slot) {
+    if (table != ROW_LOAN_ITEMS) {
+        rowStamps[table][slot]++;
+    }
+    rowLogAdd(table, slot, 0);
+}
+
+/**
+ * @brief Records that copies of a book were taken (negative `delta`) or returned.
+ *
+ * The stamp of the book is left alone: a transaction that picked the book only conflicts
+ * with changes to the book itself, not with other desks lending it.
+ */
+void StockChanged(int slot, int delta) {
+    rowLogAdd(ROW_BOOKS, slot, delta);
+}
+
+/**
+ * @brief Records that every row of a table may have been written.
+ */
+void TableChanged(RowTable table) {
+    rowLog.whole |= ROW_BIT(table);
+}
+
+/**
+ * @brief Forgets the changes of the calling thread.
+ */
+void RowLogClear(void) {
+    rowLog.count = 0;
+    rowLog.whole = 0;
+}
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef SCREEN_H
+#define SCREEN_H
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "cstdin.h"
+
+/**
+ * @file screen.h
+ * @brief Terminal rendering without spawning `clear`.
+ *
+ * The screen is cleared with ANSI sequences written straight to stdout. Full-screen views
+ * draw into a back buffer; ScreenFlush compares it with what the terminal already shows
+ * and only rewrites the changed part of each row.
+ */
+
+/**
+ * @brief What the terminal currently shows, one byte per cell. '\0' marks an unknown cell.
+ */
+char* screenFront;
+
+/**
+ * @brief The frame being drawn.
+ */
+char* screenBack;
+
+int screenRows;
+int screenCols;
+
+/**
+ * @brief Lines of text collected before they are drawn.
+ */
+typedef struct {
+    char** lines;
+    int count;
+    int capacity;
+} ScreenText;
+
+/**
+ * @brief Clears the terminal and homes the cursor.
+ *
+ * Replaces `system("clear")`: the same escape sequences, without forking a shell.
+ */
+void ScreenClear(void) {
+    fputs("\x1b[H\x1b[2J\x1b[3J", stdout);
+    fflush(stdout);
+    if (screenFront) {
+        memset(screenFront, ' ', (size_t) screenRows * screenCols);
+    }
+}
+
+/**
+ * @brief Starts a new frame: follows the terminal size and blanks the back buffer.
+ *
+ * The last column is left unused so that writing the bottom-right cell never scrolls.
+ */
+void ScreenBegin(void) {
+    struct winsize ws;
+    int rows = 24, cols = 80;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 2 && ws.ws_col > 1) {
+        rows = ws.ws_row;
+        cols = ws.ws_col - 1;
+    }
+    if (rows != screenRows || cols != screenCols) {
+        char* front = realloc(screenFront, (size_t) rows * cols);
+        char* back = front ? realloc(screenBack, (size_t) rows * cols) : NULL;
+        if (!front || !back) {
+            free(front);
+            free(screenBack);
+            screenFront = screenBack = NULL;
+            screenRows = screenCols = 0;
+            return;
+        }
+        screenFront = front;
+        screenBack = back;
+        screenRows = rows;
+        screenCols = cols;
+        memset(screenFront, '\0', (size_t) rows * cols);
+    }
+    memset(screenBack, ' ', (size_t) rows * cols);
+}
+
+/**
+ * @brief Writes formatted text on a row of the back buffer, cut at the screen width.
+ */
+void ScreenPut(int row, const char* format, ...) {
+    if (!screenBack || row < 0 || row >= screenRows) {
+        return;
+    }
+    char line[screenCols + 1];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    char* cell = screenBack + (size_t) row * screenCols;
+    for (int i = 0; line[i] != '\0'; i++) {
+        cell[i] = (unsigned char) line[i] < ' ' ? ' ' : line[i];
+    }
+}
+
+/**
+ * @brief Sends the difference between the back buffer and the terminal.
+ *
+ * For each row, only the span from the first to the last changed cell is rewritten.
+ * The cursor is left at the end of the last row.
+ */
+void ScreenFlush(void) {
+    if (!screenBack) {
+        return;
+    }
+    for (int r = 0; r < screenRows; r++) {
+        char* front = screenFront + (size_t) r * screenCols;
+        char* back = screenBack + (size_t) r * screenCols;
+        int first = 0, last = screenCols - 1;
+        while (first < screenCols && front[first] == back[first]) {
+            first++;
+        }
+        if (first == screenCols) {
+            continue;
+        }
+        while (front[last] == back[last]) {
+            last--;
+        }
+        printf("\x1b[%d;%dH", r + 1, first + 1);
+        fwrite(back + first, 1, last - first + 1, stdout);
+        memcpy(front + first, back + first, last - first + 1);
+    }
+    printf("\x1b[%d;%dH", screenRows, screenCols);
+    fflush(stdout);
+}
+
+/**
+ * @brief Appends a formatted line to a text. The line is dropped if memory runs out.
+ */
+void ScreenTextAdd(ScreenText* t, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (length < 0) {
+        return;
+    }
+    if (t->count == t->capacity) {
+        int capacity = t->capacity ? t->capacity * 2 : 64;
+        char** lines = realloc(t->lines, capacity * sizeof(char*));
+        if (!lines) {
+            return;
+        }
+        t->lines = lines;
+        t->capacity = capacity;
+    }
+    char* line = malloc(length + 1);
+    if (!line) {
+        return;
+    }
+    va_start(args, format);
+    vsnprintf(line, length + 1, format, args);
+    va_end(args);
+    t->lines[t->count++] = line;
+}
+
+/**
+ * @brief Frees every line of a text.
+ */
+void ScreenTextFree(ScreenText* t) {
+    for (int i = 0; i < t->count; i++) {
+        free(t->lines[i]);
+    }
+    free(t->lines);
+    t->lines = NULL;
+    t->count = t->capacity = 0;
+}
+
+#endif
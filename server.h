@@ -0,0 +1,274 @@
+#ifndef SERVER_H
+#define SERVER_H
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "batch.h"
+
+/**
+ * @file server.h
+ * @brief Serves the commands of batch.h to many circulation desks over a Unix domain socket.
+ *
+ * The data files are loaded once and every desk works on the same tables in memory. One
+ * thread runs an epoll loop, so commands never overlap and the services need no locking.
+ * A desk sends command lines and gets back one result line per command, in the format of
+ * batch.h; each connection must LOGIN on its own, and works at its own branch. SIGINT or SIGTERM stop the server, and
+ * the caller then saves the data.
+ */
+
+/**
+ * @brief Most events taken from epoll at once.
+ */
+#define SERVER_MAX_EVENTS 64
+
+/**
+ * @brief Longest command line accepted. A desk sending a longer one is disconnected.
+ */
+#define SERVER_MAX_LINE 65536
+
+/**
+ * @struct ServerConnection
+ * @brief A connected desk, with the bytes it sent but that were not run yet and the
+ *        results not sent yet.
+ *
+ * The listening socket and the signal descriptor are also wrapped in one, so that every
+ * epoll event points at a ServerConnection.
+ */
+typedef struct ServerConnection {
+    int fd;
+    int loggedIn;
+    int branch;
+    int line;
+    char* in;
+    size_t inUsed;
+    char* out;
+    size_t outUsed;
+    size_t outSent;
+    struct ServerConnection* next;
+    struct ServerConnection* prev;
+} ServerConnection;
+
+/**
+ * @brief Connected desks, most recent first.
+ */
+ServerConnection* serverConnections;
+
+/**
+ * @brief Commands run since the server started.
+ */
+long serverCommands;
+
+/**
+ * @brief Accepts a desk and starts watching it for commands.
+ *
+ * @return int Returns 1 on success, otherwise returns 0 and the desk is disconnected.
+ */
+int serverAccept(int epoll, int fd) {
+    ServerConnection* c = calloc(1, sizeof(ServerConnection));
+    char* in = malloc(SERVER_MAX_LINE);
+    struct epoll_event event = {EPOLLIN, {.ptr = c}};
+    if (!c || !in || epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event) == -1) {
+        free(c);
+        free(in);
+        close(fd);
+        return 0;
+    }
+    c->fd = fd;
+    c->in = in;
+    c->next = serverConnections;
+    if (serverConnections) {
+        serverConnections->prev = c;
+    }
+    serverConnections = c;
+    return 1;
+}
+
+/**
+ * @brief Disconnects a desk.
+ */
+void serverClose(int epoll, ServerConnection* c) {
+    epoll_ctl(epoll, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    if (c->prev) {
+        c->prev->next = c->next;
+    } else {
+        serverConnections = c->next;
+    }
+    if (c->next) {
+        c->next->prev = c->prev;
+    }
+    free(c->in);
+    free(c->out);
+    free(c);
+}
+
+/**
+ * @brief Sends as many pending results as the socket takes, and watches for room if some remain.
+ *
+ * @return int Returns 1 if the desk is still connected, otherwise returns 0.
+ */
+int serverFlush(int epoll, ServerConnection* c) {
+    while (c->outSent < c->outUsed) {
+        ssize_t sent = send(c->fd, c->out + c->outSent, c->outUsed - c->outSent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (sent == -1 && errno != EINTR) {
+            return 0;
+        }
+        if (sent > 0) {
+            c->outSent += sent;
+        }
+    }
+    int pending = c->outSent < c->outUsed;
+    if (!pending) {
+        c->outUsed = c->outSent = 0;
+    }
+    struct epoll_event event = {pending ? EPOLLIN | EPOLLOUT : EPOLLIN, {.ptr = c}};
+    epoll_ctl(epoll, EPOLL_CTL_MOD, c->fd, &event);
+    return 1;
+}
+
+/**
+ * @brief Reads what a desk sent and runs every complete command line.
+ *
+ * @return int Returns 1 if the desk is still connected, otherwise returns 0.
+ */
+int serverRead(ServerConnection* c) {
+    ssize_t got = recv(c->fd, c->in + c->inUsed, SERVER_MAX_LINE - c->inUsed, MSG_DONTWAIT);
+    if (got == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return 1;
+    }
+    if (got <= 0) {
+        return 0;
+    }
+    c->inUsed += got;
+
+    char* results = NULL;
+    size_t size = 0;
+    FILE* out = open_memstream(&results, &size);
+    if (!out) {
+        return 0;
+    }
+    char* start = c->in;
+    char* end;
+    while ((end = memchr(start, '\n', c->in + c->inUsed - start))) {
+        *end = '\0';
+        c->line++;
+        char* args;
+        char* command = batchParse(start, &args);
+        if (command) {
+            batchCommand(out, c->line, command, args, &c->loggedIn, &c->branch);
+            serverCommands++;
+        }
+        start = end + 1;
+    }
+    fclose(out);
+    c->inUsed -= start - c->in;
+    memmove(c->in, start, c->inUsed);
+
+    if (size) {
+        char* grown = realloc(c->out, c->outUsed + size);
+        if (!grown) {
+            free(results);
+            return 0;
+        }
+        memcpy(grown + c->outUsed, results, size);
+        c->out = grown;
+        c->outUsed += size;
+    }
+    free(results);
+    return c->inUsed < SERVER_MAX_LINE;
+}
+
+/**
+ * @brief Serves desks on a socket until SIGINT or SIGTERM.
+ *
+ * A stale socket file left at `path` is replaced.
+ *
+ * @return int Returns 0 after a clean stop, or -1 if the socket cannot be set up.
+ */
+int RunServer(const char* path) {
+    struct sockaddr_un address = {0};
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "%s: socket path too long\n", path);
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+
+    ServerConnection listening = {0}, stopping = {0};
+    listening.fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    stopping.fd = signalfd(-1, &signals, SFD_CLOEXEC);
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event accepting = {EPOLLIN, {.ptr = &listening}};
+    struct epoll_event signalled = {EPOLLIN, {.ptr = &stopping}};
+    unlink(path);
+    if (listening.fd == -1 || stopping.fd == -1 || epoll == -1 ||
+        bind(listening.fd, (struct sockaddr*) &address, sizeof(address)) == -1 ||
+        listen(listening.fd, SOMAXCONN) == -1 ||
+        epoll_ctl(epoll, EPOLL_CTL_ADD, listening.fd, &accepting) == -1 ||
+        epoll_ctl(epoll, EPOLL_CTL_ADD, stopping.fd, &signalled) == -1) {
+        perror(path);
+        close(listening.fd);
+        close(stopping.fd);
+        close(epoll);
+        return -1;
+    }
+    fprintf(stderr, "Serving on %s\n", path);
+
+    long accepted = 0;
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    for (int running = 1; running;) {
+        int n = epoll_wait(epoll, events, SERVER_MAX_EVENTS, -1);
+        for (int i = 0; i < n; i++) {
+            ServerConnection* c = events[i].data.ptr;
+            if (c == &stopping) {
+                struct signalfd_siginfo info;
+                running = read(stopping.fd, &info, sizeof(info)) != sizeof(info);
+            } else if (c == &listening) {
+                int fd;
+                while ((fd = accept(listening.fd, NULL, NULL)) != -1) {
+                    accepted += serverAccept(epoll, fd);
+                }
+            } else {
+                int connected = 1;
+                if (events[i].events & EPOLLIN) {
+                    connected = serverRead(c);
+                } else if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                    connected = 0;
+                }
+                if (!serverFlush(epoll, c) || !connected) {
+                    serverClose(epoll, c);
+                }
+            }
+        }
+    }
+
+    while (serverConnections) {
+        serverClose(epoll, serverConnections);
+    }
+    close(epoll);
+    close(stopping.fd);
+    close(listening.fd);
+    unlink(path);
+    sigprocmask(SIG_UNBLOCK, &signals, NULL);
+    fprintf(stderr, "%ld desks served, %ld commands\n", accepted, serverCommands);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef SLOT_SET_H
+#define SLOT_SET_H
+#include <stdint.h>
+
+#include "arena.h"
+
+/**
+ * @struct SlotSet
+ * @brief One bit per slot of a table, set while the slot holds a record.
+ *
+ * Lets listings jump over runs of empty slots 64 at a time instead of testing every record.
+ *
+ * @var SlotSet::bits
+ * The bitmap, stored at the base of its own arena.
+ *
+ * @var SlotSet::count
+ * Number of set bits, i.e. of records in the table.
+ */
+typedef struct {
+    uint64_t* bits;
+    int count;
+    Arena arena;
+} SlotSet;
+
+/**
+ * @brief Reserves the bitmap of a table.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int SlotSetInit(SlotSet* s, const char* name) {
+    if (!ArenaInit(&s->arena, name)) {
+        return 0;
+    }
+    s->bits = (uint64_t*) s->arena.base;
+    s->count = 0;
+    return 1;
+}
+
+/**
+ * @brief Makes room for the slots of a table that grew. New slots start empty.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int SlotSetResize(SlotSet* s, int capacity) {
+    return ArenaResizeColumn(&s->arena, sizeof(uint64_t), (capacity + 63) / 64);
+}
+
+/**
+ * @brief Marks a slot as holding a record.
+ */
+void SlotSetAdd(SlotSet* s, int slot) {
+    uint64_t bit = (uint64_t) 1 << (slot & 63);
+    if (!(s->bits[slot >> 6] & bit)) {
+        s->bits[slot >> 6] |= bit;
+        s->count++;
+    }
+}
+
+/**
+ * @brief Marks a slot as empty.
+ */
+void SlotSetRemove(SlotSet* s, int slot) {
+    uint64_t bit = (uint64_t) 1 << (slot & 63);
+    if (s->bits[slot >> 6] & bit) {
+        s->bits[slot >> 6] &= ~bit;
+        s->count--;
+    }
+}
+
+/**
+ * @brief Marks every slot as empty.
+ */
+void SlotSetClear(SlotSet* s, int capacity) {
+    memset(s->bits, 0, ((capacity + 63) / 64) * sizeof(uint64_t));
+    s->count = 0;
+}
+
+/**
+ * @brief Finds the first record at or after a slot.
+ *
+ * @return int The slot, or -1 if there is none before `capacity`.
+ */
+int SlotSetNext(const SlotSet* s, int from, int capacity) {
+    if (from < 0) {
+        from = 0;
+    }
+    if (from >= capacity) {
+        return -1;
+    }
+    int w = from >> 6;
+    uint64_t word = s->bits[w] & (~(uint64_t) 0 << (from & 63));
+    int words = (capacity + 63) / 64;
+    while (!word) {
+        if (++w >= words) {
+            return -1;
+        }
+        word = s->bits[w];
+    }
+    int slot = (w << 6) + __builtin_ctzll(word);
+    return slot < capacity ? slot : -1;
+}
+
+/**
+ * @brief Finds the last record at or before a slot.
+ *
+ * @return int The slot, or -1 if there is none.
+ */
+int SlotSetPrev(const SlotSet* s, int from) {
+    if (from < 0) {
+        return -1;
+    }
+    int w = from >> 6;
+    uint64_t word = s->bits[w] & (~(uint64_t) 0 >> (63 - (from & 63)));
+    while (!word) {
+        if (--w < 0) {
+            return -1;
+        }
+        word = s->bits[w];
+    }
+    return (w << 6) + 63 - __builtin_clzll(word);
+}
+
+#endif
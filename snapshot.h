@@ -0,0 +1,478 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "models.h"
+#include "repository.h"
+#include "row_log.h"
+
+/**
+ * @file snapshot.h
+ * @brief Immutable versions of the clients, books, loans and loan items tables, for reports
+ *        that must not wait on the desks.
+ *
+ * A version holds its tables in chunks of SNAPSHOT_CHUNK rows. When a command commits,
+ * the rows in its RowLog are copied into a new version: the chunks holding them are copied
+ * first, the other chunks are shared with the previous version. The new version is then
+ * published with one atomic store.
+ *
+ * A reader pins the current epoch in a slot of `snapshotPins` before loading the version,
+ * and reads it without any lock. A replaced version is retired with the epoch of the
+ * version that replaced it, and freed with the chunks it no longer shares once every
+ * pinned epoch has reached that one.
+ *
+ * A batch command commits when it ends, and the terminal menus commit after every operation,
+ * so that a thread's log stays short and the current version stays recent.
+ *
+ * Commits must run while the command still holds the locks of the rows it changed, so
+ * that a version never holds half of another command's changes. Stocks are the exception:
+ * desks change them at once without a lock on the book, so a commit adds its own stock
+ * changes to the previous version's row instead of copying the live one.
+ */
+
+/**
+ * @brief Rows per chunk of a version.
+ */
+#define SNAPSHOT_CHUNK 64
+
+/**
+ * @brief Readers that may hold a version at once. Further readers wait for a free slot.
+ */
+#define SNAPSHOT_READERS 64
+
+/**
+ * @struct SnapshotTable
+ * @brief The rows of a table in a version. A NULL chunk holds no row yet.
+ *
+ * A table the next version did not change passes its `chunks` array on to it, and sets
+ * `lent` so that the array is not freed along with this version.
+ */
+typedef struct {
+    int capacity;
+    int chunkCount;
+    char** chunks;
+    int lent;
+} SnapshotTable;
+
+/**
+ * @struct SnapshotVersion
+ * @brief One published version of the tables.
+ *
+ * `dropped` lists the chunks the next version replaced, which are freed along with this one.
+ */
+typedef struct SnapshotVersion {
+    uint64_t epoch;
+    SnapshotTable tables[ROW_TABLES];
+    char** dropped;
+    int droppedCount;
+    uint64_t retiredAt;
+    struct SnapshotVersion* retiredNext;
+} SnapshotVersion;
+
+SnapshotVersion* _Atomic snapshotCurrent;
+
+/**
+ * @brief The epoch of `snapshotCurrent`. Epochs start at 1.
+ */
+_Atomic uint64_t snapshotEpoch;
+
+/**
+ * @brief The epoch pinned by each reader, or 0 for a free slot.
+ */
+_Atomic uint64_t snapshotPins[SNAPSHOT_READERS];
+
+/**
+ * @brief The slot pinned by the calling thread, or -1.
+ */
+_Thread_local int snapshotPin = -1;
+
+/**
+ * @brief Serializes commits and guards the retired versions.
+ */
+pthread_mutex_t snapshotLock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Retired versions, oldest first.
+ */
+SnapshotVersion* snapshotRetired;
+SnapshotVersion* snapshotRetiredLast;
+
+/**
+ * @brief The size of a row of a table.
+ */
+size_t snapshotRowSize(RowTable table) {
+    static const size_t sizes[ROW_TABLES] = {sizeof(Client), sizeof(Book), sizeof(Loan), sizeof(LoanItem)};
+    return sizes[table];
+}
+
+/**
+ * @brief The rows of a table in memory.
+ */
+const char* snapshotLiveRows(RowTable table) {
+    switch (table) {
+        case ROW_CLIENTS:
+            return (const char*) clients;
+        case ROW_BOOKS:
+            return (const char*) books;
+        case ROW_LOANS:
+            return (const char*) loans;
+        default:
+            return (const char*) loanItems;
+    }
+}
+
+/**
+ * @brief The capacity of a table in memory.
+ */
+int snapshotLiveCapacity(RowTable table) {
+    switch (table) {
+        case ROW_CLIENTS:
+            return clientsCapacity;
+        case ROW_BOOKS:
+            return booksCapacity;
+        case ROW_LOANS:
+            return loansCapacity;
+        default:
+            return loanItemsCapacity;
+    }
+}
+
+/**
+ * @brief The chunk of a table shared with the previous version, or NULL.
+ */
+char* snapshotSharedChunk(const SnapshotVersion* prev, RowTable table, int k) {
+    return prev && k < prev->tables[table].chunkCount ? prev->tables[table].chunks[k] : NULL;
+}
+
+/**
+ * @brief Frees a version, with the chunks the next version replaced.
+ */
+void snapshotFree(SnapshotVersion* v) {
+    for (int i = 0; i < v->droppedCount; i++) {
+        free(v->dropped[i]);
+    }
+    free(v->dropped);
+    for (int t = 0; t < ROW_TABLES; t++) {
+        if (!v->tables[t].lent) {
+            free(v->tables[t].chunks);
+        }
+    }
+    free(v);
+}
+
+/**
+ * @brief Frees a version that was being built, with the chunks it does not share.
+ */
+void snapshotDiscard(SnapshotVersion* next, const SnapshotVersion* prev) {
+    for (int t = 0; t < ROW_TABLES; t++) {
+        if (prev && next->tables[t].chunks == prev->tables[t].chunks) {
+            continue;
+        }
+        for (int k = 0; next->tables[t].chunks && k < next->tables[t].chunkCount; k++) {
+            if (next->tables[t].chunks[k] != snapshotSharedChunk(prev, t, k)) {
+                free(next->tables[t].chunks[k]);
+            }
+        }
+        free(next->tables[t].chunks);
+    }
+    free(next);
+}
+
+/**
+ * @brief Gives a chunk of the version being built its own copy, so that its rows can be written.
+ *
+ * The shared chunk is appended to `dropped`.
+ *
+ * @return char* The chunk, or NULL if it cannot be allocated.
+ */
+char* snapshotOwnChunk(SnapshotVersion* next, const SnapshotVersion* prev, RowTable table, int k,
+                       char** dropped, int* droppedCount) {
+    char* shared = snapshotSharedChunk(prev, table, k);
+    if (next->tables[table].chunks[k] && next->tables[table].chunks[k] != shared) {
+        return next->tables[table].chunks[k];
+    }
+    size_t bytes = SNAPSHOT_CHUNK * snapshotRowSize(table);
+    char* chunk = shared ? malloc(bytes) : calloc(1, bytes);
+    if (!chunk) {
+        return NULL;
+    }
+    if (shared) {
+        memcpy(chunk, shared, bytes);
+        dropped[(*droppedCount)++] = shared;
+    }
+    next->tables[table].chunks[k] = chunk;
+    return chunk;
+}
+
+/**
+ * @brief Frees the retired versions no reader can still hold.
+ */
+void snapshotReclaim(void) {
+    uint64_t oldest = UINT64_MAX;
+    for (int i = 0; i < SNAPSHOT_READERS; i++) {
+        uint64_t pinned = snapshotPins[i];
+        if (pinned && pinned < oldest) {
+            oldest = pinned;
+        }
+    }
+    while (snapshotRetired && snapshotRetired->retiredAt <= oldest) {
+        SnapshotVersion* v = snapshotRetired;
+        snapshotRetired = v->retiredNext;
+        snapshotFree(v);
+    }
+    if (!snapshotRetired) {
+        snapshotRetiredLast = NULL;
+    }
+}
+
+/**
+ * @brief Tells whether the calling thread logged a whole row, rather than a stock change alone.
+ */
+int snapshotRowLogged(RowTable table, int slot) {
+    for (int i = 0; i < rowLog.count; i++) {
+        RowChange* change = &rowLog.changes[i];
+        if (change->table == table && change->slot == slot && !change->stockDelta) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Builds the next version from the changes of the calling thread.
+ *
+ * @return SnapshotVersion* The version, or NULL if memory ran out.
+ */
+SnapshotVersion* snapshotBuild(const SnapshotVersion* prev, char*** dropped, int* droppedCount) {
+    unsigned whole = prev ? rowLog.whole : ROW_BIT(ROW_TABLES) - 1;
+    SnapshotVersion* next = calloc(1, sizeof(SnapshotVersion));
+    if (!next) {
+        return NULL;
+    }
+    int bound = rowLog.count;
+    int changed[ROW_TABLES] = {0};
+    for (int i = 0; i < rowLog.count; i++) {
+        changed[rowLog.changes[i].table] = 1;
+    }
+    for (RowTable t = 0; t < ROW_TABLES; t++) {
+        if (prev && !changed[t] && !(whole & ROW_BIT(t))) {
+            next->tables[t] = prev->tables[t];
+            next->tables[t].lent = 0;
+            continue;
+        }
+        int capacity = prev ? prev->tables[t].capacity : 0;
+        if ((whole & ROW_BIT(t)) && snapshotLiveCapacity(t) > capacity) {
+            capacity = snapshotLiveCapacity(t);
+        }
+        for (int i = 0; i < rowLog.count; i++) {
+            if (rowLog.changes[i].table == t && rowLog.changes[i].slot >= capacity) {
+                capacity = rowLog.changes[i].slot + 1;
+            }
+        }
+        SnapshotTable* table = &next->tables[t];
+        table->capacity = capacity;
+        table->chunkCount = (capacity + SNAPSHOT_CHUNK - 1) / SNAPSHOT_CHUNK;
+        table->chunks = calloc(table->chunkCount ? table->chunkCount : 1, sizeof(char*));
+        if (!table->chunks) {
+            snapshotDiscard(next, prev);
+            return NULL;
+        }
+        for (int k = 0; prev && k < prev->tables[t].chunkCount; k++) {
+            table->chunks[k] = prev->tables[t].chunks[k];
+        }
+        if (whole & ROW_BIT(t)) {
+            bound += table->chunkCount;
+        }
+    }
+
+    *droppedCount = 0;
+    *dropped = malloc((bound ? bound : 1) * sizeof(char*));
+    if (!*dropped) {
+        snapshotDiscard(next, prev);
+        return NULL;
+    }
+    for (int t = 0; t < ROW_TABLES; t++) {
+        if (!(whole & ROW_BIT(t))) {
+            continue;
+        }
+        size_t size = snapshotRowSize(t);
+        int live = snapshotLiveCapacity(t);
+        for (int k = 0; k * SNAPSHOT_CHUNK < live; k++) {
+            char* chunk = snapshotOwnChunk(next, prev, t, k, *dropped, droppedCount);
+            if (!chunk) {
+                free(*dropped);
+                snapshotDiscard(next, prev);
+                return NULL;
+            }
+            int rows = live - k * SNAPSHOT_CHUNK < SNAPSHOT_CHUNK ? live - k * SNAPSHOT_CHUNK : SNAPSHOT_CHUNK;
+            memcpy(chunk, snapshotLiveRows(t) + (size_t) k * SNAPSHOT_CHUNK * size, rows * size);
+        }
+    }
+    for (int i = 0; i < rowLog.count; i++) {
+        RowTable t = rowLog.changes[i].table;
+        int slot = rowLog.changes[i].slot;
+        int stockDelta = rowLog.changes[i].stockDelta;
+        if ((whole & ROW_BIT(t)) || (stockDelta && snapshotRowLogged(t, slot))) {
+            continue;
+        }
+        size_t size = snapshotRowSize(t);
+        char* chunk = snapshotOwnChunk(next, prev, t, slot / SNAPSHOT_CHUNK, *dropped, droppedCount);
+        if (!chunk) {
+            free(*dropped);
+            snapshotDiscard(next, prev);
+            return NULL;
+        }
+        if (stockDelta) {
+            ((Book*) chunk)[slot % SNAPSHOT_CHUNK].stock += stockDelta;
+        } else {
+            memcpy(chunk + (slot % SNAPSHOT_CHUNK) * size, snapshotLiveRows(t) + (size_t) slot * size, size);
+        }
+    }
+    return next;
+}
+
+/**
+ * @brief Publishes the rows changed by the calling thread as a new version.
+ *
+ * Must be called while the command still holds the locks of those rows. Does nothing if
+ * the thread changed nothing since its last commit.
+ *
+ * @return int Returns 1 on success, otherwise returns 0 and the changes stay logged for the next commit.
+ */
+int SnapshotCommit(void) {
+    if (rowLog.count == 0 && rowLog.whole == 0 && snapshotCurrent) {
+        return 1;
+    }
+    pthread_mutex_lock(&snapshotLock);
+    SnapshotVersion* prev = snapshotCurrent;
+    char** dropped;
+    int droppedCount;
+    SnapshotVersion* next = snapshotBuild(prev, &dropped, &droppedCount);
+    if (!next) {
+        pthread_mutex_unlock(&snapshotLock);
+        return 0;
+    }
+    next->epoch = prev ? prev->epoch + 1 : 1;
+    snapshotCurrent = next;
+    snapshotEpoch = next->epoch;
+    if (prev) {
+        for (int t = 0; t < ROW_TABLES; t++) {
+            prev->tables[t].lent = prev->tables[t].chunks == next->tables[t].chunks;
+        }
+        prev->dropped = dropped;
+        prev->droppedCount = droppedCount;
+        prev->retiredAt = next->epoch;
+        if (snapshotRetiredLast) {
+            snapshotRetiredLast->retiredNext = prev;
+        } else {
+            snapshotRetired = prev;
+        }
+        snapshotRetiredLast = prev;
+    } else {
+        free(dropped);
+    }
+    snapshotReclaim();
+    pthread_mutex_unlock(&snapshotLock);
+    RowLogClear();
+    return 1;
+}
+
+/**
+ * @brief Copies every table into a new version.
+ *
+ * Called once after the data files are imported.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int SnapshotRebuild(void) {
+    for (int t = 0; t < ROW_TABLES; t++) {
+        TableChanged(t);
+    }
+    return SnapshotCommit();
+}
+
+/**
+ * @brief Pins the current version for the calling thread.
+ *
+ * The thread's own pending changes are committed first, so it sees them. The version must
+ * be released with SnapshotUnpin, and a thread holds at most one version at a time.
+ *
+ * @return const SnapshotVersion* The version, or NULL if none could be built.
+ */
+const SnapshotVersion* SnapshotPin(void) {
+    if ((rowLog.count || rowLog.whole || !snapshotCurrent) && !SnapshotCommit() && !snapshotCurrent) {
+        return NULL;
+    }
+    while (1) {
+        for (int i = 0; i < SNAPSHOT_READERS; i++) {
+            uint64_t unpinned = 0;
+            if (atomic_compare_exchange_strong(&snapshotPins[i], &unpinned, snapshotEpoch)) {
+                snapshotPin = i;
+                return snapshotCurrent;
+            }
+        }
+        sched_yield();
+    }
+}
+
+/**
+ * @brief Releases the version pinned by the calling thread.
+ */
+void SnapshotUnpin(void) {
+    if (snapshotPin != -1) {
+        snapshotPins[snapshotPin] = 0;
+        snapshotPin = -1;
+    }
+}
+
+/**
+ * @brief The number of rows of a table in a version.
+ */
+int SnapshotCapacity(const SnapshotVersion* v, RowTable table) {
+    return v->tables[table].capacity;
+}
+
+/**
+ * @brief A row of a version, or NULL if the version has no such row.
+ */
+const void* SnapshotRow(const SnapshotVersion* v, RowTable table, int slot) {
+    if (slot < 0 || slot >= v->tables[table].capacity || !v->tables[table].chunks[slot / SNAPSHOT_CHUNK]) {
+        return NULL;
+    }
+    return v->tables[table].chunks[slot / SNAPSHOT_CHUNK] + (slot % SNAPSHOT_CHUNK) * snapshotRowSize(table);
+}
+
+/**
+ * @brief The client in a slot of a version, or NULL.
+ */
+const Client* SnapshotClient(const SnapshotVersion* v, int slot) {
+    return SnapshotRow(v, ROW_CLIENTS, slot);
+}
+
+/**
+ * @brief The book in a slot of a version, or NULL.
+ */
+const Book* SnapshotBook(const SnapshotVersion* v, int slot) {
+    return SnapshotRow(v, ROW_BOOKS, slot);
+}
+
+/**
+ * @brief The loan in a slot of a version, or NULL.
+ */
+const Loan* SnapshotLoan(const SnapshotVersion* v, int slot) {
+    return SnapshotRow(v, ROW_LOANS, slot);
+}
+
+/**
+ * @brief The loan item in a slot of a version, or NULL.
+ */
+const LoanItem* SnapshotLoanItem(const SnapshotVersion* v, int slot) {
+    return SnapshotRow(v, ROW_LOAN_ITEMS, slot);
+}
+
+#endif
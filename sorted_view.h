@@ -0,0 +1,266 @@
+#ifndef SORTED_VIEW_H
+#define SORTED_VIEW_H
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "slot_set.h"
+
+/**
+ * @brief Upper bound on the threads a sort is split across.
+ */
+#define SORT_MAX_THREADS 8
+
+/**
+ * @brief Below this many records a range is sorted by the calling thread alone.
+ */
+#define SORT_PARALLEL_MIN 16384
+
+/**
+ * @brief Gives the 32-bit sort key of the record in a slot. Equal keys are ordered by `SortTie`.
+ */
+typedef uint32_t (*SortKeyOf)(int slot);
+
+/**
+ * @brief Orders two records whose keys are equal.
+ *
+ * @return int Negative, zero or positive like strcmp. Records still equal keep slot order.
+ */
+typedef int (*SortTie)(int a, int b);
+
+/**
+ * @brief Gives the current version of the tables an ordering is built from.
+ */
+typedef unsigned (*SortVersion)(void);
+
+/**
+ * @struct SortedView
+ * @brief The records of a table in the order of a key, cached until the table changes.
+ *
+ * Records are sorted as packed 64-bit words, the key in the high half and the slot in the
+ * low half, so most comparisons are a single integer compare. String keys pack their first
+ * four bytes and only fall back to `tie` when those are equal. Large tables are sorted by a
+ * merge sort split across threads.
+ *
+ * @var SortedView::set
+ * The occupied slots of the table.
+ *
+ * @var SortedView::capacity
+ * The capacity of the table.
+ *
+ * @var SortedView::key
+ * Packs the key of a record.
+ *
+ * @var SortedView::tie
+ * Orders records with equal packed keys, or NULL if the packed key is the whole key.
+ *
+ * @var SortedView::version
+ * Reads the version of the tables the key depends on.
+ *
+ * @var SortedView::lock
+ * Held while `order` and `keys` are rebuilt or read, so that threads listing the same
+ * table under a shared table lock do not race on the cache.
+ *
+ * @var SortedView::builtVersion
+ * The version `order` was built at.
+ *
+ * @var SortedView::built
+ * 1 once `order` has been built.
+ *
+ * @var SortedView::order
+ * Slots of the records, in key order.
+ *
+ * @var SortedView::count
+ * Records in `order`.
+ *
+ * @var SortedView::keys
+ * The packed keys `order` was read from, kept so seeks can binary search.
+ */
+typedef struct {
+    const SlotSet* set;
+    const int* capacity;
+    SortKeyOf key;
+    SortTie tie;
+    SortVersion version;
+    pthread_mutex_t lock;
+    unsigned builtVersion;
+    int built;
+    int* order;
+    int count;
+    uint64_t* keys;
+} SortedView;
+
+/**
+ * @brief Packs the first four bytes of a string so that integer order matches strcmp order.
+ */
+uint32_t SortKeyOfString(const char* s) {
+    uint32_t key = 0;
+    for (int i = 0; i < 4; i++) {
+        key <<= 8;
+        if (*s) {
+            key |= (unsigned char) *s++;
+        }
+    }
+    return key;
+}
+
+/**
+ * @brief Tells whether one packed record sorts before another.
+ */
+int sortedBefore(const SortedView* v, uint64_t a, uint64_t b) {
+    if (v->tie && (a >> 32) == (b >> 32)) {
+        int order = v->tie((int) (uint32_t) a, (int) (uint32_t) b);
+        if (order) {
+            return order < 0;
+        }
+    }
+    return a < b;
+}
+
+/**
+ * @brief Merges the sorted runs [from, mid) and [mid, to) of `src` into `dst`.
+ */
+void mergeRuns(const SortedView* v, const uint64_t* src, uint64_t* dst, int from, int mid, int to) {
+    int i = from, j = mid, k = from;
+    while (i < mid && j < to) {
+        dst[k++] = sortedBefore(v, src[j], src[i]) ? src[j++] : src[i++];
+    }
+    while (i < mid) {
+        dst[k++] = src[i++];
+    }
+    while (j < to) {
+        dst[k++] = src[j++];
+    }
+}
+
+/**
+ * @brief Sorts [from, to) of `keys` on the calling thread, using `scratch` as the second buffer.
+ */
+void sortRange(const SortedView* v, uint64_t* keys, uint64_t* scratch, int from, int to) {
+    uint64_t* src = keys;
+    uint64_t* dst = scratch;
+    for (int width = 1; width < to - from; width *= 2) {
+        for (int lo = from; lo < to; lo += 2 * width) {
+            int mid = lo + width < to ? lo + width : to;
+            int hi = mid + width < to ? mid + width : to;
+            mergeRuns(v, src, dst, lo, mid, hi);
+        }
+        uint64_t* swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != keys) {
+        memcpy(keys + from, src + from, (size_t) (to - from) * sizeof(uint64_t));
+    }
+}
+
+/**
+ * @brief A range of a sort handed to a thread, and the threads it may use.
+ */
+typedef struct {
+    const SortedView* view;
+    uint64_t* keys;
+    uint64_t* scratch;
+    int from;
+    int to;
+    int threads;
+} SortJob;
+
+/**
+ * @brief Sorts the range of a job, handing its left half to a new thread while threads remain.
+ */
+void* sortJob(void* arg) {
+    SortJob* job = arg;
+    if (job->threads < 2 || job->to - job->from < SORT_PARALLEL_MIN) {
+        sortRange(job->view, job->keys, job->scratch, job->from, job->to);
+        return NULL;
+    }
+    int mid = job->from + (job->to - job->from) / 2;
+    SortJob left = *job, right = *job;
+    left.to = mid;
+    left.threads = job->threads / 2;
+    right.from = mid;
+    right.threads = job->threads - left.threads;
+
+    pthread_t worker;
+    int started = !pthread_create(&worker, NULL, sortJob, &left);
+    if (!started) {
+        sortJob(&left);
+    }
+    sortJob(&right);
+    if (started) {
+        pthread_join(worker, NULL);
+    }
+    mergeRuns(job->view, job->keys, job->scratch, job->from, mid, job->to);
+    memcpy(job->keys + job->from, job->scratch + job->from, (size_t) (job->to - job->from) * sizeof(uint64_t));
+    return NULL;
+}
+
+/**
+ * @brief Sorts the table again if it changed since the ordering was built.
+ *
+ * The caller holds `lock`.
+ *
+ * @return int Returns 1 if the ordering is current, or 0 if memory ran out; the previous
+ *         ordering is kept in that case.
+ */
+int SortedViewRefresh(SortedView* v) {
+    unsigned version = v->version();
+    if (v->built && v->builtVersion == version) {
+        return 1;
+    }
+    int n = v->set->count;
+    uint64_t* keys = malloc((n ? n : 1) * sizeof(uint64_t));
+    uint64_t* scratch = malloc((n ? n : 1) * sizeof(uint64_t));
+    int* order = malloc((n ? n : 1) * sizeof(int));
+    if (!keys || !scratch || !order) {
+        free(keys);
+        free(scratch);
+        free(order);
+        return 0;
+    }
+
+    int count = 0;
+    for (int s = SlotSetNext(v->set, 0, *v->capacity); s != -1 && count < n; s = SlotSetNext(v->set, s + 1, *v->capacity)) {
+        keys[count++] = (uint64_t) v->key(s) << 32 | (uint32_t) s;
+    }
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    SortJob job = {v, keys, scratch, 0, count, online < 1 ? 1 : online > SORT_MAX_THREADS ? SORT_MAX_THREADS : (int) online};
+    sortJob(&job);
+    for (int i = 0; i < count; i++) {
+        order[i] = (int) (uint32_t) keys[i];
+    }
+    free(scratch);
+
+    free(v->order);
+    free(v->keys);
+    v->order = order;
+    v->keys = keys;
+    v->count = count;
+    v->builtVersion = version;
+    v->built = 1;
+    return 1;
+}
+
+/**
+ * @brief Finds where the record in a slot stands in the ordering. The caller holds `lock`.
+ *
+ * @return int The position of the first record that does not sort before it.
+ */
+int SortedViewFind(const SortedView* v, int slot) {
+    uint64_t packed = (uint64_t) v->key(slot) << 32 | (uint32_t) slot;
+    int lo = 0, hi = v->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (sortedBefore(v, v->keys[mid], packed)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+#endif
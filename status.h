@@ -0,0 +1,45 @@
+#ifndef STATUS_H
+#define STATUS_H
+
+/**
+ * @brief Result of an operation of the core.
+ *
+ * Operations never print anything; they return one of these codes and leave
+ * reporting to the front end.
+ */
+typedef enum {
+    STATUS_OK = 0,
+    STATUS_NOT_FOUND,
+    STATUS_DUPLICATE,
+    STATUS_INVALID,
+    STATUS_IN_USE,
+    STATUS_ACTIVE_LOAN,
+    STATUS_NO_STOCK,
+    STATUS_ON_LOAN,
+    STATUS_NO_MEMORY,
+    STATUS_CONFLICT
+} Status;
+
+/**
+ * @brief Returns a short, stable English description of a status code.
+ *
+ * @param s The status code.
+ * @return const char* The description.
+ */
+const char* StatusText(Status s) {
+    switch (s) {
+        case STATUS_OK: return "ok";
+        case STATUS_NOT_FOUND: return "not found";
+        case STATUS_DUPLICATE: return "already exists";
+        case STATUS_INVALID: return "invalid argument";
+        case STATUS_IN_USE: return "still referenced";
+        case STATUS_ACTIVE_LOAN: return "client has an active loan";
+        case STATUS_NO_STOCK: return "no copies available";
+        case STATUS_ON_LOAN: return "book is on loan";
+        case STATUS_NO_MEMORY: return "storage is full";
+        case STATUS_CONFLICT: return "changed by someone else, try again";
+    }
+    return "unknown status";
+}
+
+#endif
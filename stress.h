@@ -0,0 +1,645 @@
+#ifndef STRESS_H
+#define STRESS_H
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bookbyte.h"
+
+/**
+ * @file stress.h
+ * @brief Multi-threaded benchmark of the table locks and the snapshots.
+ *
+ * Reader threads look clients up under shared locks while a writer keeps changing their
+ * CPFs and names under exclusive ones, in rounds of 1, 2, 4... readers. Every read checks
+ * that the CPF and the name it got are one of the two values the writer alternates between,
+ * so a torn read would be counted. A reporter thread meanwhile scans every benchmark client
+ * in snapshots, without locks, and checks them the same way. The clients are only added in
+ * memory, nothing is saved.
+ *
+ * RunCheckout benchmarks the stock of one hot title instead: every thread takes a copy and
+ * puts it back, first with BookTakeCopy and BookReturnCopy, then with a check and decrement
+ * under the stripe lock of the book, and counts the copies lent beyond the stock.
+ *
+ * RunFineSweep adds as many clients and open loans as asked, times FineSweep over them
+ * with 1, 2, 4... threads up to one per CPU, and checks every fine it computed.
+ *
+ * RunPopularity counts as many lent books as asked in the circulation statistics, spread
+ * over 30 days and drawn from a Zipf distribution of POPULARITY_BOOKS titles, and compares
+ * the estimated top books of the month with an exact count.
+ *
+ * RunCoBorrow archives as many loans as asked, made by COBORROW_BENCH_CLIENTS clients every
+ * two weeks, times CoBorrowRebuild over them with 1, 2, 4... threads up to one per CPU, checks
+ * that every rebuild gives the same matrix, and times the queries.
+ */
+
+/**
+ * @brief Clients added for the benchmark.
+ */
+#define STRESS_CLIENTS 4096
+
+/**
+ * @brief Pause of the writer between two changes, in microseconds.
+ */
+#define STRESS_WRITE_PAUSE_US 100
+
+/**
+ * @brief Slots of the benchmark clients.
+ */
+int stressSlots[STRESS_CLIENTS];
+
+/**
+ * @brief Cleared to end a round.
+ */
+_Atomic int stressRunning;
+
+/**
+ * @struct StressJob
+ * @brief What a benchmark thread does and what it counted.
+ */
+typedef struct {
+    int writer;
+    int reporter;
+    unsigned seed;
+    long operations;
+    long torn;
+} StressJob;
+
+/**
+ * @brief Writes the two CPFs a benchmark client alternates between.
+ */
+void stressCpfs(int i, char* first, char* second) {
+    sprintf(first, "7%010d", i);
+    sprintf(second, "8%010d", i);
+}
+
+/**
+ * @brief Reads benchmark clients until the round ends, checking every CPF and name.
+ */
+void stressRead(StressJob* job) {
+    LockSet locks = {LOCK_BIT(LOCK_CLIENTS), 0};
+    char first[12], second[12], cpf[12];
+    while (stressRunning) {
+        int i = rand_r(&job->seed) % STRESS_CLIENTS;
+        int slot = stressSlots[i];
+        LockTables(locks);
+        LockStripes(LOCK_CLIENTS, StripeOf(slot), 0);
+        memcpy(cpf, clients[slot].cpf, sizeof(cpf));
+        const char* name = StringGet(clients[slot].name);
+        int nameTorn = strcmp(name, "STRESS A") && strcmp(name, "STRESS B");
+        UnlockStripes(LOCK_CLIENTS, StripeOf(slot));
+        UnlockTables(locks);
+
+        stressCpfs(i, first, second);
+        if (nameTorn || (strcmp(cpf, first) && strcmp(cpf, second))) {
+            job->torn++;
+        }
+        job->operations++;
+    }
+}
+
+/**
+ * @brief Flips the CPF and the name of benchmark clients until the round ends.
+ *
+ * The CPF is a scanned field, so it is changed under the clients table lock; the name
+ * only under the stripe of the row.
+ */
+void stressWrite(StressJob* job) {
+    LockSet cpfLocks = {0, LOCK_BIT(LOCK_CLIENTS) | LOCK_BIT(LOCK_LOANS)};
+    LockSet nameLocks = {LOCK_BIT(LOCK_CLIENTS), LOCK_BIT(LOCK_STRINGS)};
+    struct timespec pause = {0, STRESS_WRITE_PAUSE_US * 1000};
+    char first[12], second[12];
+    while (stressRunning) {
+        int i = rand_r(&job->seed) % STRESS_CLIENTS;
+        Client* c = &clients[stressSlots[i]];
+        stressCpfs(i, first, second);
+
+        LockTables(cpfLocks);
+        ClientChangeCpf(c, strcmp(c->cpf, first) ? first : second);
+        SnapshotCommit();
+        UnlockTables(cpfLocks);
+
+        LockTables(nameLocks);
+        LockStripes(LOCK_CLIENTS, StripeOf(stressSlots[i]), 1);
+        ClientRename(c, strcmp(StringGet(c->name), "STRESS A") ? "STRESS A" : "STRESS B");
+        SnapshotCommit();
+        UnlockStripes(LOCK_CLIENTS, StripeOf(stressSlots[i]));
+        UnlockTables(nameLocks);
+
+        job->operations++;
+        nanosleep(&pause, NULL);
+    }
+}
+
+/**
+ * @brief Scans every benchmark client in snapshots until the round ends, checking every CPF and name.
+ */
+void stressReport(StressJob* job) {
+    char first[12], second[12];
+    while (stressRunning) {
+        const SnapshotVersion* v = SnapshotPin();
+        if (!v) {
+            break;
+        }
+        for (int i = 0; i < STRESS_CLIENTS; i++) {
+            const Client* c = SnapshotClient(v, stressSlots[i]);
+            const char* name = c ? StringGet(c->name) : "";
+            stressCpfs(i, first, second);
+            if (!c || (strcmp(name, "STRESS A") && strcmp(name, "STRESS B")) ||
+                (strcmp(c->cpf, first) && strcmp(c->cpf, second))) {
+                job->torn++;
+            }
+        }
+        SnapshotUnpin();
+        job->operations++;
+    }
+}
+
+/**
+ * @brief Runs a benchmark thread.
+ */
+void* stressThread(void* arg) {
+    StressJob* job = arg;
+    if (job->writer) {
+        stressWrite(job);
+    } else if (job->reporter) {
+        stressReport(job);
+    } else {
+        stressRead(job);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Runs one round with `readers` reader threads, one writer and one reporter.
+ *
+ * @return long The number of torn reads seen.
+ */
+long stressRound(int readers, double seconds) {
+    StressJob jobs[readers + 2];
+    pthread_t threads[readers + 2];
+    int started[readers + 2];
+    stressRunning = 1;
+    for (int t = 0; t <= readers + 1; t++) {
+        jobs[t] = (StressJob) {t == readers, t == readers + 1, 2654435761u * (t + 1), 0, 0};
+        started[t] = !pthread_create(&threads[t], NULL, stressThread, &jobs[t]);
+    }
+    struct timespec round = {(time_t) seconds, (long) ((seconds - (time_t) seconds) * 1e9)};
+    nanosleep(&round, NULL);
+    stressRunning = 0;
+
+    long reads = 0, torn = 0;
+    for (int t = 0; t <= readers + 1; t++) {
+        if (started[t]) {
+            pthread_join(threads[t], NULL);
+        }
+        if (t < readers) {
+            reads += jobs[t].operations;
+        }
+        torn += jobs[t].torn;
+    }
+    printf("%3d readers: %12.0f reads/s, %8.0f writes/s, %6.0f reports/s, %ld torn reads\n", readers,
+           reads / seconds, jobs[readers].operations / seconds, jobs[readers + 1].operations / seconds, torn);
+    return torn;
+}
+
+/**
+ * @brief Adds the benchmark clients and runs rounds of up to `maxReaders` readers.
+ *
+ * @return int Returns 0 if no read was torn, 1 if one was, or -1 if the clients cannot be added.
+ */
+int RunStress(int maxReaders, double seconds) {
+    char first[12], second[12];
+    for (int i = 0; i < STRESS_CLIENTS; i++) {
+        Client* c;
+        stressCpfs(i, first, second);
+        if (ClientAdd("STRESS A", first, "STRESS", "1", "00000000", "", &c) != STATUS_OK) {
+            fprintf(stderr, "Cannot add the benchmark clients\n");
+            return -1;
+        }
+        stressSlots[i] = (int) (c - clients);
+    }
+    SnapshotCommit();
+    long torn = 0;
+    for (int readers = 1; ; readers = readers * 2 < maxReaders ? readers * 2 : maxReaders) {
+        torn += stressRound(readers, seconds);
+        if (readers >= maxReaders) {
+            break;
+        }
+    }
+    return torn ? 1 : 0;
+}
+
+/**
+ * @brief Copies of the hot title of the checkout benchmark.
+ */
+#define CHECKOUT_COPIES 16
+
+/**
+ * @brief The hot title of the checkout benchmark.
+ */
+Book* checkoutBook;
+
+/**
+ * @brief Copies of the hot title currently lent by the benchmark threads.
+ */
+_Atomic int checkoutLent;
+
+/**
+ * @struct CheckoutJob
+ * @brief What a checkout benchmark thread does and what it counted.
+ */
+typedef struct {
+    int locked;
+    long checkouts;
+    long oversold;
+} CheckoutJob;
+
+/**
+ * @brief Takes a copy of the hot title under its stripe lock.
+ */
+int checkoutTakeLocked(void) {
+    LockSet locks = {LOCK_BIT(LOCK_BOOKS), 0};
+    int taken = 0;
+    LockTables(locks);
+    LockStripes(LOCK_BOOKS, StripeOf(checkoutBook->id), 1);
+    if (checkoutBook->stock > 0) {
+        checkoutBook->stock--;
+        taken = 1;
+    }
+    UnlockStripes(LOCK_BOOKS, StripeOf(checkoutBook->id));
+    UnlockTables(locks);
+    return taken;
+}
+
+/**
+ * @brief Puts a copy of the hot title back under its stripe lock.
+ */
+void checkoutReturnLocked(void) {
+    LockSet locks = {LOCK_BIT(LOCK_BOOKS), 0};
+    LockTables(locks);
+    LockStripes(LOCK_BOOKS, StripeOf(checkoutBook->id), 1);
+    checkoutBook->stock++;
+    UnlockStripes(LOCK_BOOKS, StripeOf(checkoutBook->id));
+    UnlockTables(locks);
+}
+
+/**
+ * @brief Takes and returns copies of the hot title until the round ends.
+ */
+void* checkoutThread(void* arg) {
+    CheckoutJob* job = arg;
+    while (stressRunning) {
+        int copy = -1;
+        if (job->locked ? !checkoutTakeLocked() : (copy = BookTakeCopy(checkoutBook)) == -1) {
+            continue;
+        }
+        if (atomic_fetch_add(&checkoutLent, 1) >= CHECKOUT_COPIES) {
+            job->oversold++;
+        }
+        atomic_fetch_sub(&checkoutLent, 1);
+        if (job->locked) {
+            checkoutReturnLocked();
+        } else {
+            BookReturnCopy(checkoutBook, copy);
+        }
+        job->checkouts++;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Runs one round of `threads` checkout threads.
+ *
+ * @param oversold Incremented by the copies lent beyond the stock.
+ * @return double The checkouts per second.
+ */
+double checkoutRound(int threads, int locked, double seconds, long* oversold) {
+    CheckoutJob jobs[threads];
+    pthread_t handles[threads];
+    int started[threads];
+    stressRunning = 1;
+    for (int t = 0; t < threads; t++) {
+        jobs[t] = (CheckoutJob) {locked, 0, 0};
+        started[t] = !pthread_create(&handles[t], NULL, checkoutThread, &jobs[t]);
+    }
+    struct timespec round = {(time_t) seconds, (long) ((seconds - (time_t) seconds) * 1e9)};
+    nanosleep(&round, NULL);
+    stressRunning = 0;
+
+    long checkouts = 0;
+    for (int t = 0; t < threads; t++) {
+        if (started[t]) {
+            pthread_join(handles[t], NULL);
+        }
+        checkouts += jobs[t].checkouts;
+        *oversold += jobs[t].oversold;
+    }
+    return checkouts / seconds;
+}
+
+/**
+ * @brief Adds a hot title and runs checkout rounds of up to `maxThreads` threads.
+ *
+ * @return int Returns 0 if no copy was oversold and the stock ends where it started, 1 otherwise,
+ *         or -1 if the title cannot be added.
+ */
+int RunCheckout(int maxThreads, double seconds) {
+    Author* a = SearchAuthorByName("STRESS");
+    Genre* g = SearchGenreByName("STRESS");
+    if ((!a && AuthorAdd("STRESS", &a) != STATUS_OK) || (!g && GenreAdd("STRESS", &g) != STATUS_OK) ||
+        BookAdd("STRESS CHECKOUT", a->id, g->id, CHECKOUT_COPIES, &checkoutBook) != STATUS_OK) {
+        fprintf(stderr, "Cannot add the benchmark title\n");
+        return -1;
+    }
+    long oversold = 0;
+    for (int threads = 1; ; threads = threads * 2 < maxThreads ? threads * 2 : maxThreads) {
+        double lockFree = checkoutRound(threads, 0, seconds, &oversold);
+        double locked = checkoutRound(threads, 1, seconds, &oversold);
+        printf("%3d threads: %12.0f checkouts/s lock-free, %12.0f checkouts/s locked, %ld oversold\n", threads,
+               lockFree, locked, oversold);
+        if (threads >= maxThreads) {
+            break;
+        }
+    }
+    if (checkoutBook->stock != CHECKOUT_COPIES) {
+        printf("Stock ended at %d instead of %d\n", (int) checkoutBook->stock, CHECKOUT_COPIES);
+        return 1;
+    }
+    return oversold ? 1 : 0;
+}
+
+/**
+ * @brief Adds `count` clients, each with an open loan due on a day of this year.
+ *
+ * @param firstLoan Receives the slot of the first loan added.
+ * @return int The slot of the first client added, or -1 if the tables cannot grow.
+ */
+int fineSweepFill(int count, int* firstLoan) {
+    int firstClient = clientsCapacity;
+    *firstLoan = loansCapacity;
+    while (clientsCapacity < firstClient + count) {
+        if (growClients() == -1) {
+            return -1;
+        }
+    }
+    while (loansCapacity < *firstLoan + count) {
+        if (growLoans() == -1) {
+            return -1;
+        }
+    }
+    StringId name = StringIntern("FINE SWEEP");
+    for (int i = 0; i < count; i++) {
+        Client* c = &clients[firstClient + i];
+        Loan* l = &loans[*firstLoan + i];
+        c->name = name;
+        sprintf(c->cpf, "6%010d", i);
+        l->id = *firstLoan + i;
+        strcpy(l->userCpf, c->cpf);
+        strcpy(l->startDate, "2000-01-01");
+        sprintf(l->deadline, "2026-%02d-%02d", 1 + i % 12, 1 + i % 28);
+    }
+    RebuildLiveSlots();
+    return RebuildDeadlineIndex() ? firstClient : -1;
+}
+
+/**
+ * @brief Times the fine sweep over `count` open loans.
+ *
+ * @return int Returns 0 if every fine is right, 1 if one is not, or -1 if the loans cannot be added.
+ */
+int RunFineSweep(int count) {
+    int today = DeadlineToday();
+    int firstLoan;
+    int first = fineSweepFill(count, &firstLoan);
+    if (first == -1) {
+        fprintf(stderr, "Cannot add the benchmark loans\n");
+        return -1;
+    }
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    int maxThreads = online < 1 ? 1 : online > FINE_SWEEP_MAX_THREADS ? FINE_SWEEP_MAX_THREADS : (int) online;
+    for (int threads = 1; ; threads = threads * 2 < maxThreads ? threads * 2 : maxThreads) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int swept = FineSweep(today, threads);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("%3d threads: %d loans in %.3f s, %12.0f loans/s\n", threads, swept, seconds, swept / seconds);
+        if (threads >= maxThreads) {
+            break;
+        }
+    }
+    long wrong = 0;
+    for (int i = 0; i < count; i++) {
+        Client* c = &clients[first + i];
+        Loan* l = SearchLoanById(firstLoan + i);
+        wrong += !l || FineAccrued(c) != FineCents(DeadlineDay(l->deadline), today);
+    }
+    printf("%ld wrong fines\n", wrong);
+    return wrong ? 1 : 0;
+}
+
+/**
+ * @brief Titles drawn by RunPopularity.
+ */
+#define POPULARITY_BOOKS 100000
+
+/**
+ * @brief Top books compared by RunPopularity.
+ */
+#define POPULARITY_TOP 10
+
+/**
+ * @brief Draws a book from the cumulative distribution of the titles.
+ */
+int popularityDraw(const double* cumulative, unsigned* seed) {
+    double u = (double) rand_r(seed) / ((double) RAND_MAX + 1) * cumulative[POPULARITY_BOOKS - 1];
+    int low = 0, high = POPULARITY_BOOKS - 1;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (cumulative[mid] <= u) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief Times counting `count` lent books and reading the top books of the month, and
+ *        compares them with the exact counts.
+ *
+ * @return int Returns 0 if every estimated top book is in the exact top and no estimate is
+ *         below its count, 1 otherwise, or -1 if memory ran out.
+ */
+int RunPopularity(int count) {
+    double* cumulative = malloc(POPULARITY_BOOKS * sizeof(double));
+    uint32_t* exact = calloc(POPULARITY_BOOKS, sizeof(uint32_t));
+    if (!cumulative || !exact) {
+        free(cumulative);
+        free(exact);
+        fprintf(stderr, "Cannot draw the benchmark books\n");
+        return -1;
+    }
+    double sum = 0;
+    for (int i = 0; i < POPULARITY_BOOKS; i++) {
+        sum += 1.0 / (i + 1);
+        cumulative[i] = sum;
+    }
+    int today = DeadlineToday();
+    unsigned seed = 1;
+    circulationDay = INT_MIN;
+    CirculationAdvance(today);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < count; i++) {
+        int book = popularityDraw(cumulative, &seed);
+        CirculationRecord(STATS_BOOKS, book, today - 29 + (int) ((long) i * 30 / count));
+        exact[book]++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("Counted %d books in %.3f s, %12.0f books/s\n", count, seconds, count / seconds);
+
+    HeavyHitter top[POPULARITY_TOP];
+    int found = 0;
+    int queries = 100000;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < queries; i++) {
+        found = CirculationTop(STATS_BOOKS, 30, -1, top, POPULARITY_TOP);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("Read the top %d books %d times in %.3f s, %.2f us each\n", POPULARITY_TOP, queries, seconds, seconds * 1e6 / queries);
+
+    uint32_t cutoff = 0;
+    for (int k = 0; k < POPULARITY_TOP; k++) {
+        uint32_t best = 0;
+        for (int i = 0; i < POPULARITY_BOOKS; i++) {
+            best = exact[i] > best && (k == 0 || exact[i] < cutoff) ? exact[i] : best;
+        }
+        cutoff = best;
+    }
+    int recalled = 0, under = 0;
+    double error = 0;
+    for (int i = 0; i < found; i++) {
+        recalled += exact[top[i].id] >= cutoff;
+        under += top[i].count < exact[top[i].id];
+        double e = (double) (top[i].count - exact[top[i].id]) / count;
+        error = e > error ? e : error;
+    }
+    printf("%d of the top %d books found, largest overestimate %.4f%% of the books counted\n", recalled, found, error * 100);
+    free(cumulative);
+    free(exact);
+    return recalled == found && found == POPULARITY_TOP && !under ? 0 : 1;
+}
+
+/**
+ * @brief Books drawn by RunCoBorrow.
+ */
+#define COBORROW_BENCH_BOOKS 20000
+
+/**
+ * @brief Clients making the loans of RunCoBorrow.
+ */
+#define COBORROW_BENCH_CLIENTS 100000
+
+/**
+ * @brief Archives `count` loans of one to three books, the popular books drawn more often.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int coBorrowFill(int count) {
+    while (booksCapacity < COBORROW_BENCH_BOOKS) {
+        if (growBooks() == -1) {
+            return 0;
+        }
+    }
+    unsigned seed = 1;
+    int firstDay = DeadlineToday() - (count / COBORROW_BENCH_CLIENTS + 1) * 14;
+    for (int i = 0; i < count; i++) {
+        Loan l = {0};
+        int start = firstDay + i / COBORROW_BENCH_CLIENTS * 14;
+        int year, month, day;
+        civilFromDays(start, &year, &month, &day);
+        sprintf(l.startDate, "%04d-%02d-%02d", year, month, day);
+        sprintf(l.deadline, "%04d-%02d-%02d", year, month, day);
+        sprintf(l.userCpf, "5%010d", i % COBORROW_BENCH_CLIENTS);
+        for (int k = rand_r(&seed) % 3; k >= 0; k--) {
+            double r = (double) rand_r(&seed) / ((double) RAND_MAX + 1);
+            if (!AddLoanItem(&l, (int) (r * r * r * COBORROW_BENCH_BOOKS), -1)) {
+                return 0;
+            }
+        }
+        int archived = HistoryArchive(&l, start + 7, 0);
+        loanItemsUsed = l.itemOffset;
+        loanItemsLive -= l.itemCount;
+        if (!archived) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Times rebuilding the co-borrowing matrix from `count` archived loans, and its queries.
+ *
+ * @return int Returns 0 if every rebuild gave the same matrix, 1 if one did not, or -1 if the
+ *         loans or the matrix do not fit in memory.
+ */
+int RunCoBorrow(int count) {
+    if (!coBorrowFill(count)) {
+        fprintf(stderr, "Cannot archive the benchmark loans\n");
+        return -1;
+    }
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    int maxThreads = online < 1 ? 1 : online > COBORROW_MAX_THREADS ? COBORROW_MAX_THREADS : (int) online;
+    CoBorrow* first = NULL;
+    long entries = 0;
+    int different = 0;
+    for (int threads = 1; ; threads = threads * 2 < maxThreads ? threads * 2 : maxThreads) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int rebuilt = CoBorrowRebuild(threads);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (!rebuilt) {
+            fprintf(stderr, "Cannot rebuild the matrix\n");
+            free(first);
+            return -1;
+        }
+        double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("%3d threads: %d loans in %.3f s, %ld pairs\n", threads, count, seconds, coBorrowRows[coBorrowRowCount]);
+        if (!first) {
+            entries = coBorrowRows[coBorrowRowCount];
+            first = malloc((entries ? entries : 1) * sizeof(CoBorrow));
+            if (first) {
+                memcpy(first, coBorrowEntries, entries * sizeof(CoBorrow));
+            }
+        } else {
+            different += entries != coBorrowRows[coBorrowRowCount] || memcmp(first, coBorrowEntries, entries * sizeof(CoBorrow));
+        }
+        if (threads >= maxThreads) {
+            break;
+        }
+    }
+    free(first);
+
+    CoBorrow top[10];
+    int queries = 1000000;
+    unsigned seed = 2;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < queries; i++) {
+        CoBorrowTop(rand_r(&seed) % COBORROW_BENCH_BOOKS, top, 10);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("Read the top 10 of %d books in %.3f s, %.2f us each\n", queries, seconds, seconds * 1e6 / queries);
+    printf("%d rebuilds differed from the first\n", different);
+    return different ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,194 @@
+#ifndef STRING_HEAP_H
+#define STRING_HEAP_H
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+/**
+ * @brief Identifier of a string stored in the string heap.
+ *
+ * Equal strings always have the same identifier, so two interned strings can be
+ * compared with `==`.
+ */
+typedef uint32_t StringId;
+
+/**
+ * @brief Identifier of the empty string, used by empty slots.
+ */
+#define STRING_EMPTY 0
+
+/**
+ * @brief Returned by StringFind when a string has never been interned.
+ */
+#define STRING_NONE UINT32_MAX
+
+Arena stringsArena;
+Arena stringOffsetsArena;
+
+uint32_t* stringOffsets;
+int stringOffsetsCapacity;
+
+/**
+ * @brief Number of interned strings.
+ *
+ * Atomic so that StringGet can run without a lock while another thread interns: the
+ * offset of a new string is written before the count that makes it visible.
+ */
+_Atomic uint32_t stringCount;
+
+StringId* stringHash;
+uint32_t stringHashMask;
+
+/**
+ * @brief Hashes a string with 32-bit FNV-1a.
+ */
+uint32_t stringHashOf(const char* s) {
+    uint32_t h = 2166136261u;
+    while (*s) {
+        h ^= (unsigned char) *s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief Returns the characters of an interned string.
+ *
+ * @param id The identifier of the string.
+ * @return const char* The string, or "" for an unknown identifier. It lives as long as the
+ *         program and is never modified.
+ */
+const char* StringGet(StringId id) {
+    return id < stringCount ? stringsArena.base + stringOffsets[id] : "";
+}
+
+/**
+ * @brief Finds the hash slot holding `s`, or the empty slot where it would go.
+ */
+StringId* stringSlot(const char* s, uint32_t h) {
+    for (uint32_t i = h & stringHashMask; ; i = (i + 1) & stringHashMask) {
+        if (stringHash[i] == STRING_NONE || !strcmp(StringGet(stringHash[i]), s)) {
+            return &stringHash[i];
+        }
+    }
+}
+
+/**
+ * @brief Doubles the hash table once it is half full.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int stringHashGrow(void) {
+    uint32_t size = (stringHashMask + 1) * 2;
+    StringId* table = malloc(size * sizeof(StringId));
+    if (!table) {
+        return 0;
+    }
+    memset(table, 0xff, size * sizeof(StringId));
+    free(stringHash);
+    stringHash = table;
+    stringHashMask = size - 1;
+    for (StringId id = 0; id < stringCount; id++) {
+        *stringSlot(StringGet(id), stringHashOf(StringGet(id))) = id;
+    }
+    return 1;
+}
+
+/**
+ * @brief Looks a string up without adding it to the heap.
+ *
+ * @param s The string to look for.
+ * @return StringId The identifier of the string, or STRING_NONE if it was never interned.
+ */
+StringId StringFind(const char* s) {
+    return *stringSlot(s, stringHashOf(s));
+}
+
+/**
+ * @brief Returns the identifier of a string, adding it to the heap if needed.
+ *
+ * @param s The string to intern.
+ * @return StringId The identifier of the string, or STRING_NONE if the heap is full.
+ */
+StringId StringIntern(const char* s) {
+    uint32_t h = stringHashOf(s);
+    StringId* slot = stringSlot(s, h);
+    if (*slot != STRING_NONE) {
+        return *slot;
+    }
+    if ((int) stringCount == stringOffsetsCapacity &&
+        ArenaGrowTable(&stringOffsetsArena, sizeof(uint32_t), &stringOffsetsCapacity, 1024) == -1) {
+        return STRING_NONE;
+    }
+    size_t length = strlen(s) + 1;
+    char* copy = ArenaAllocPacked(&stringsArena, length);
+    if (!copy) {
+        return STRING_NONE;
+    }
+    memcpy(copy, s, length);
+    StringId id = stringCount;
+    stringOffsets[id] = (uint32_t) (copy - stringsArena.base);
+    stringCount = id + 1;
+    *slot = id;
+    if (stringCount * 2 > stringHashMask + 1) {
+        stringHashGrow();
+    }
+    return id;
+}
+
+/**
+ * @brief Reserves the string heap and interns the empty string as STRING_EMPTY.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int InitStringHeap(void) {
+    if (!ArenaInit(&stringsArena, "strings") || !ArenaInit(&stringOffsetsArena, "string ids")) {
+        return 0;
+    }
+    stringOffsets = (uint32_t*) stringOffsetsArena.base;
+    stringHashMask = 1023;
+    stringHash = malloc((stringHashMask + 1) * sizeof(StringId));
+    if (!stringHash) {
+        return 0;
+    }
+    memset(stringHash, 0xff, (stringHashMask + 1) * sizeof(StringId));
+    return StringIntern("") == STRING_EMPTY;
+}
+
+/**
+ * @brief Reads the strings of a heap saved by SaveStringHeap, in identifier order.
+ *
+ * Identifiers are assigned in the order the strings are read, so they match the ones
+ * stored in the tables that were saved alongside the heap.
+ *
+ * @param f The file to read from.
+ */
+void LoadStringHeap(FILE* f) {
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* data = malloc(size + 1);
+    if (!data) {
+        return;
+    }
+    size = (long) fread(data, 1, size, f);
+    data[size] = '\0';
+    for (long i = 0; i < size; i += strlen(data + i) + 1) {
+        StringIntern(data + i);
+    }
+    free(data);
+}
+
+/**
+ * @brief Writes every interned string, NUL terminated, in identifier order.
+ *
+ * @param f The file to write to.
+ */
+void SaveStringHeap(FILE* f) {
+    fwrite(stringsArena.base, 1, stringsArena.used, f);
+}
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef TABLE_LOCKS_H
+#define TABLE_LOCKS_H
+#include <pthread.h>
+#include <stdint.h>
+
+/**
+ * @file table_locks.h
+ * @brief Reader-writer locks over the tables, for front ends that run commands on several threads.
+ *
+ * Every table has one lock for the whole table and LOCK_STRIPES locks for its rows, row `i`
+ * belonging to stripe `i % LOCK_STRIPES`. The rules are:
+ *
+ * - Adding or removing a record, growing a table, or changing a field that lookups scan
+ *   (CPFs, titles, IDs, the links between records) takes the table exclusively.
+ * - Changing another field in place (a name, an address ID) takes the table shared and the
+ *   stripes of the changed rows exclusively.
+ * - The stock of a book is an atomic counter. Lending and returning copies take the books
+ *   table shared and no stripe, with BookTakeCopy and BookReturnCopy.
+ * - Reading such a field takes the table shared and the stripe of the row shared. Reading
+ *   only the scanned fields takes the table shared alone.
+ * - StringFind takes LOCK_STRINGS shared and StringIntern takes it exclusively. StringGet
+ *   needs no lock for an ID read under a table lock: the characters of an interned string
+ *   never move and are never rewritten, and the ID was published under that lock.
+ *
+ * So a reader never sees a string field half written: in-row strings such as CPFs and
+ * dates are only written under the table lock, and interned strings are swapped as one
+ * 32-bit ID under the row's stripe. Tables are locked in LockTable order, then stripes
+ * in table order and ascending stripe order, so two commands never wait on each other
+ * in a cycle.
+ */
+
+/**
+ * @brief Stripes of row locks per table.
+ */
+#define LOCK_STRIPES 64
+
+/**
+ * @brief The lockable tables, in the order they are locked.
+ */
+typedef enum {
+    LOCK_STRINGS,
+    LOCK_ADDRESSES,
+    LOCK_AUTHORS,
+    LOCK_GENRES,
+    LOCK_CLIENTS,
+    LOCK_BOOKS,
+    LOCK_LOANS,
+    LOCK_TABLES
+} LockTable;
+
+/**
+ * @brief The bit of a table in a LockSet mask.
+ */
+#define LOCK_BIT(table) (1u << (table))
+
+/**
+ * @struct LockSet
+ * @brief The tables a command locks, shared or exclusively. A table in both is locked exclusively.
+ */
+typedef struct {
+    unsigned shared;
+    unsigned exclusive;
+} LockSet;
+
+/**
+ * @struct TableLock
+ * @brief The lock of a table and the locks of its row stripes.
+ */
+typedef struct {
+    pthread_rwlock_t table;
+    pthread_rwlock_t stripes[LOCK_STRIPES];
+} TableLock;
+
+TableLock tableLocks[LOCK_TABLES];
+
+/**
+ * @brief Creates the table and stripe locks.
+ *
+ * @return int Returns 1 on success, otherwise returns 0.
+ */
+int InitTableLocks(void) {
+    for (int t = 0; t < LOCK_TABLES; t++) {
+        if (pthread_rwlock_init(&tableLocks[t].table, NULL)) {
+            return 0;
+        }
+        for (int s = 0; s < LOCK_STRIPES; s++) {
+            if (pthread_rwlock_init(&tableLocks[t].stripes[s], NULL)) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Locks the tables of a set, in LockTable order.
+ */
+void LockTables(LockSet set) {
+    for (int t = 0; t < LOCK_TABLES; t++) {
+        if (set.exclusive & LOCK_BIT(t)) {
+            pthread_rwlock_wrlock(&tableLocks[t].table);
+        } else if (set.shared & LOCK_BIT(t)) {
+            pthread_rwlock_rdlock(&tableLocks[t].table);
+        }
+    }
+}
+
+/**
+ * @brief Unlocks the tables of a set locked by LockTables.
+ */
+void UnlockTables(LockSet set) {
+    for (int t = LOCK_TABLES - 1; t >= 0; t--) {
+        if ((set.exclusive | set.shared) & LOCK_BIT(t)) {
+            pthread_rwlock_unlock(&tableLocks[t].table);
+        }
+    }
+}
+
+/**
+ * @brief The bit of the stripe of a row in a stripe mask.
+ */
+uint64_t StripeOf(int slot) {
+    return (uint64_t) 1 << (slot % LOCK_STRIPES);
+}
+
+/**
+ * @brief Locks stripes of rows of a table, in ascending order. The table must be locked shared.
+ *
+ * @param stripes A mask of StripeOf bits.
+ * @param exclusive 1 to change the rows, 0 to read them.
+ */
+void LockStripes(LockTable table, uint64_t stripes, int exclusive) {
+    for (int s = 0; s < LOCK_STRIPES; s++) {
+        if (stripes & ((uint64_t) 1 << s)) {
+            if (exclusive) {
+                pthread_rwlock_wrlock(&tableLocks[table].stripes[s]);
+            } else {
+                pthread_rwlock_rdlock(&tableLocks[table].stripes[s]);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Unlocks stripes locked by LockStripes.
+ */
+void UnlockStripes(LockTable table, uint64_t stripes) {
+    for (int s = LOCK_STRIPES - 1; s >= 0; s--) {
+        if (stripes & ((uint64_t) 1 << s)) {
+            pthread_rwlock_unlock(&tableLocks[table].stripes[s]);
+        }
+    }
+}
+
+#endif
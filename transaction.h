@@ -0,0 +1,358 @@
+#ifndef TRANSACTION_H
+#define TRANSACTION_H
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "models.h"
+#include "status.h"
+#include "repository.h"
+#include "copies.h"
+#include "row_log.h"
+#include "deadline_index.h"
+#include "fine_ledger.h"
+#include "loan_history.h"
+
+/**
+ * @file transaction.h
+ * @brief Transactions over the clients, books and loans tables, with an undo log and
+ *        optimistic validation.
+ *
+ * TxBegin makes a transaction current on the calling thread. While it is, the services save
+ * a row with TxSave before they first write it, and mark the rows they fill with TxCreated.
+ * TxAbort puts the saved rows back, empties the created ones, restores the loan items
+ * counters and drops the ledger entries posted and the loans archived, so a half-made loan
+ * leaves no trace. Loan items are not compacted before the transaction ends, since that
+ * would move items the undo log points at. Copies taken or put back with the atomic stock
+ * operations are recorded with TxStock, and TxAbort compensates for them by the same count
+ * rather than restoring the stock, which other desks may have changed since. The copies
+ * themselves go back where they were: a copy taken goes back on the shelf, a copy put back
+ * is lent again. The loans table, locked exclusively by loans and returns, keeps the latter
+ * from being lent to anyone else meanwhile.
+ *
+ * Rows the transaction decides on without holding their locks, such as the client and the
+ * books picked at an interactive desk, are recorded with TxRead along with their stamp.
+ * TxCommit takes no lock: it checks that none of them was written by anyone else since,
+ * and otherwise aborts with STATUS_CONFLICT so that the desk can try again.
+ *
+ * A thread runs at most one transaction at a time.
+ */
+
+/**
+ * @brief The image of a saved row.
+ */
+typedef union {
+    Client client;
+    Book book;
+    Loan loan;
+} TxImage;
+
+/**
+ * @brief What TxAbort does with a row of the undo log.
+ */
+typedef enum {
+    TX_SAVED,
+    TX_CREATED,
+    TX_STOCK
+} TxUndoKind;
+
+/**
+ * @struct TxUndo
+ * @brief A row written by the transaction, with its stamp before the first write.
+ *
+ * `stockDelta` is the number of copies a TX_STOCK entry put back, negative if it took them,
+ * and `copy` the barcode of the copy, or -1.
+ */
+typedef struct {
+    RowTable table;
+    int slot;
+    TxUndoKind kind;
+    unsigned stamp;
+    int stockDelta;
+    int copy;
+    TxImage before;
+} TxUndo;
+
+/**
+ * @struct TxReadRow
+ * @brief A row the transaction read, with its stamp at the time.
+ */
+typedef struct {
+    RowTable table;
+    int slot;
+    unsigned stamp;
+} TxReadRow;
+
+/**
+ * @struct Transaction
+ * @brief The undo log and the read set of a transaction.
+ *
+ * `failed` is set when a read could not be recorded, which makes TxCommit abort.
+ */
+typedef struct {
+    TxUndo* undo;
+    int undoCount;
+    int undoCapacity;
+    TxReadRow* reads;
+    int readCount;
+    int readCapacity;
+    int loanItemsUsed;
+    int loanItemsLive;
+    int ledgerCount;
+    int historyCount;
+    int failed;
+} Transaction;
+
+/**
+ * @brief The transaction of the calling thread, or NULL.
+ */
+_Thread_local Transaction* txActive;
+
+/**
+ * @brief Starts a transaction on the calling thread.
+ */
+void TxBegin(Transaction* tx) {
+    memset(tx, 0, sizeof(Transaction));
+    tx->loanItemsUsed = loanItemsUsed;
+    tx->loanItemsLive = loanItemsLive;
+    tx->ledgerCount = ledgerCount;
+    tx->historyCount = historyCount;
+    txActive = tx;
+}
+
+/**
+ * @brief The undo entry of a row, or NULL if the transaction has not written it.
+ */
+TxUndo* txUndoOf(RowTable table, int slot) {
+    for (int i = 0; i < txActive->undoCount; i++) {
+        if (txActive->undo[i].table == table && txActive->undo[i].slot == slot) {
+            return &txActive->undo[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Makes room for `n` more entries in the undo log.
+ *
+ * @return int Returns 1 on success or without a transaction, otherwise returns 0.
+ */
+int TxReserve(int n) {
+    if (!txActive || txActive->undoCount + n <= txActive->undoCapacity) {
+        return 1;
+    }
+    int capacity = txActive->undoCapacity ? txActive->undoCapacity : 8;
+    while (capacity < txActive->undoCount + n) {
+        capacity *= 2;
+    }
+    TxUndo* grown = realloc(txActive->undo, capacity * sizeof(TxUndo));
+    if (!grown) {
+        return 0;
+    }
+    txActive->undo = grown;
+    txActive->undoCapacity = capacity;
+    return 1;
+}
+
+/**
+ * @brief Adds a row to the undo log, unless it is saved or created there already.
+ */
+int txLog(RowTable table, int slot, TxUndoKind kind) {
+    if (!txActive) {
+        return 1;
+    }
+    for (int i = 0; kind != TX_STOCK && i < txActive->undoCount; i++) {
+        TxUndo* u = &txActive->undo[i];
+        if (u->table == table && u->slot == slot && u->kind != TX_STOCK) {
+            return 1;
+        }
+    }
+    if (!TxReserve(1)) {
+        return 0;
+    }
+    TxUndo* u = &txActive->undo[txActive->undoCount++];
+    u->table = table;
+    u->slot = slot;
+    u->kind = kind;
+    u->stamp = rowStamps[table][slot];
+    u->stockDelta = 0;
+    u->copy = -1;
+    if (kind == TX_SAVED && table == ROW_CLIENTS) {
+        u->before.client = clients[slot];
+    } else if (kind == TX_SAVED && table == ROW_BOOKS) {
+        u->before.book = books[slot];
+    } else if (kind == TX_SAVED) {
+        u->before.loan = loans[slot];
+    }
+    return 1;
+}
+
+/**
+ * @brief Saves a row before it is first written by the transaction.
+ *
+ * @return int Returns 1 on success or without a transaction, otherwise returns 0 and the row
+ *         must not be written.
+ */
+int TxSave(RowTable table, int slot) {
+    return txLog(table, slot, TX_SAVED);
+}
+
+/**
+ * @brief Marks a row as filled by the transaction, so that TxAbort empties it.
+ *
+ * @return int Returns 1 on success or without a transaction, otherwise returns 0.
+ */
+int TxCreated(RowTable table, int slot) {
+    return txLog(table, slot, TX_CREATED);
+}
+
+/**
+ * @brief Records copies of a book taken (negative `delta`) or put back by the transaction.
+ *
+ * @param copy The barcode of the copy when `delta` is 1 or -1, otherwise -1.
+ * @return int Returns 1 on success or without a transaction, otherwise returns 0. Reserve the
+ *         room with TxReserve beforehand when the copies are already taken.
+ */
+int TxStock(int slot, int copy, int delta) {
+    if (!txLog(ROW_BOOKS, slot, TX_STOCK)) {
+        return 0;
+    }
+    if (txActive) {
+        txActive->undo[txActive->undoCount - 1].stockDelta = delta;
+        txActive->undo[txActive->undoCount - 1].copy = copy;
+    }
+    return 1;
+}
+
+/**
+ * @brief Records the stamp of a row the transaction decides on.
+ *
+ * Rows the transaction already wrote are not recorded, their stamp was taken by TxSave.
+ */
+void TxRead(RowTable table, int slot) {
+    if (!txActive || txUndoOf(table, slot)) {
+        return;
+    }
+    if (txActive->readCount == txActive->readCapacity) {
+        int capacity = txActive->readCapacity ? txActive->readCapacity * 2 : 8;
+        TxReadRow* grown = realloc(txActive->reads, capacity * sizeof(TxReadRow));
+        if (!grown) {
+            txActive->failed = 1;
+            return;
+        }
+        txActive->reads = grown;
+        txActive->readCapacity = capacity;
+    }
+    txActive->reads[txActive->readCount++] = (TxReadRow) {table, slot, rowStamps[table][slot]};
+}
+
+/**
+ * @brief Puts a saved row back and brings the occupied slots and change counters in line.
+ */
+void txRestore(const TxUndo* u) {
+    switch (u->table) {
+        case ROW_CLIENTS: {
+            int balance = clients[u->slot].fineAmount;
+            clients[u->slot] = u->before.client;
+            LedgerBalanceRestored(u->slot, balance);
+            if (strcmp(clients[u->slot].cpf, "0")) {
+                SlotSetAdd(&clientsLive, u->slot);
+                BranchSlotAdd(ROW_CLIENTS, u->slot);
+            } else {
+                SlotSetRemove(&clientsLive, u->slot);
+                BranchSlotRemove(ROW_CLIENTS, u->slot);
+            }
+            clientsVersion++;
+            break;
+        }
+        case ROW_BOOKS:
+            books[u->slot] = u->before.book;
+            if (books[u->slot].id != -1) {
+                SlotSetAdd(&booksLive, u->slot);
+                BranchSlotAdd(ROW_BOOKS, u->slot);
+            } else {
+                SlotSetRemove(&booksLive, u->slot);
+                BranchSlotRemove(ROW_BOOKS, u->slot);
+            }
+            booksVersion++;
+            break;
+        default:
+            loans[u->slot] = u->before.loan;
+            if (loans[u->slot].id != -1) {
+                SlotSetAdd(&loansLive, u->slot);
+                BranchSlotAdd(ROW_LOANS, u->slot);
+            } else {
+                SlotSetRemove(&loansLive, u->slot);
+                BranchSlotRemove(ROW_LOANS, u->slot);
+            }
+            DeadlineIndexSet(u->slot);
+            loansVersion++;
+            break;
+    }
+    RowChanged(u->table, u->slot);
+}
+
+/**
+ * @brief Ends the transaction of the calling thread.
+ */
+void txEnd(void) {
+    free(txActive->undo);
+    free(txActive->reads);
+    txActive = NULL;
+}
+
+/**
+ * @brief Undoes every write of the transaction, newest first, and ends it.
+ */
+void TxAbort(void) {
+    for (int i = txActive->undoCount - 1; i >= 0; i--) {
+        TxUndo* u = &txActive->undo[i];
+        if (u->kind == TX_SAVED) {
+            txRestore(u);
+        } else if (u->kind == TX_STOCK) {
+            if (u->copy != -1) {
+                CopyMove(u->copy, u->stockDelta < 0 ? COPY_ON_SHELF : COPY_LENT);
+            }
+            atomic_fetch_sub(&books[u->slot].stock, u->stockDelta);
+            StockChanged(u->slot, -u->stockDelta);
+            booksVersion++;
+        } else if (u->table == ROW_CLIENTS) {
+            initEmptyClient(&clients[u->slot]);
+        } else if (u->table == ROW_BOOKS) {
+            initEmptyBook(&books[u->slot]);
+        } else {
+            initEmptyLoan(&loans[u->slot]);
+            DeadlineIndexSet(u->slot);
+        }
+    }
+    loanItemsUsed = txActive->loanItemsUsed;
+    loanItemsLive = txActive->loanItemsLive;
+    LedgerTruncate(txActive->ledgerCount);
+    HistoryTruncate(txActive->historyCount);
+    txEnd();
+}
+
+/**
+ * @brief Checks that no row the transaction read was written by someone else, and ends it.
+ *
+ * @return Status STATUS_OK, or STATUS_CONFLICT or STATUS_NO_MEMORY after the transaction was aborted.
+ */
+Status TxCommit(void) {
+    Status s = txActive->failed ? STATUS_NO_MEMORY : STATUS_OK;
+    for (int i = 0; s == STATUS_OK && i < txActive->readCount; i++) {
+        TxReadRow* r = &txActive->reads[i];
+        TxUndo* u = txUndoOf(r->table, r->slot);
+        if ((u ? u->stamp : rowStamps[r->table][r->slot]) != r->stamp) {
+            s = STATUS_CONFLICT;
+        }
+    }
+    if (s != STATUS_OK) {
+        TxAbort();
+        return s;
+    }
+    txEnd();
+    CompactSparseLoanItems();
+    return STATUS_OK;
+}
+
+#endif